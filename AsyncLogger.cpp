@@ -0,0 +1,202 @@
+#include "AsyncLogger.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace winvert4
+{
+    namespace {
+        // Hand a batch to the writer once it reaches this size
+        constexpr size_t kBatchBytes = 64 * 1024;
+        // Idle flusher wake-up period (bounds latency when producers do not signal)
+        constexpr auto kFlushInterval = std::chrono::milliseconds(10);
+
+        size_t RoundUpPow2(size_t v)
+        {
+            size_t p = 2;
+            while (p < v) p <<= 1;
+            return p;
+        }
+
+        int64_t NowMs()
+        {
+            using namespace std::chrono;
+            return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+        // "HH:MM:SS:mmm " in local time, as the original synchronous logger wrote it
+        void AppendHeader(std::string& out, int64_t timeMs)
+        {
+            static thread_local std::time_t s_cachedSec = -1;
+            static thread_local std::tm s_cachedTm{};
+            const std::time_t sec = std::time_t(timeMs / 1000);
+            if (sec != s_cachedSec)
+            {
+#if defined(_WIN32)
+                localtime_s(&s_cachedTm, &sec);
+#else
+                localtime_r(&sec, &s_cachedTm);
+#endif
+                s_cachedSec = sec;
+            }
+            char header[32];
+            const int n = std::snprintf(header, sizeof(header), "%02d:%02d:%02d:%03d ",
+                s_cachedTm.tm_hour, s_cachedTm.tm_min, s_cachedTm.tm_sec, int(timeMs % 1000));
+            if (n > 0) out.append(header, size_t(n));
+        }
+    }
+
+    AsyncLogger::AsyncLogger(size_t slotCount)
+    {
+        const size_t n = RoundUpPow2(slotCount);
+        m_slots.reset(new Slot[n]);
+        m_mask = n - 1;
+        for (size_t i = 0; i < n; ++i) m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    AsyncLogger::~AsyncLogger()
+    {
+        Stop();
+    }
+
+    void AsyncLogger::Start(Writer writer)
+    {
+        if (m_running.exchange(true)) return;
+        m_writer = std::move(writer);
+        m_thread = std::thread(&AsyncLogger::FlusherProc_, this);
+    }
+
+    void AsyncLogger::Stop()
+    {
+        if (!m_running.exchange(false)) return;
+        m_wakeCv.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    bool AsyncLogger::Push(const char* line)
+    {
+        return Push(line, line ? std::strlen(line) : 0);
+    }
+
+    bool AsyncLogger::Push(const char* line, size_t len)
+    {
+        // Bounded MPSC ring (Vyukov): claim a slot by CAS on the enqueue position;
+        // its sequence number says whether the flusher has released it yet
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+        for (;;)
+        {
+            slot = &m_slots[pos & m_mask];
+            const size_t seq = slot->seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->timeMs = NowMs();
+        const size_t n = (len < sizeof(slot->text)) ? len : sizeof(slot->text);
+        if (n) std::memcpy(slot->text, line, n);
+        slot->len = uint32_t(n);
+        slot->seq.store(pos + 1, std::memory_order_release);
+
+        // Wake the flusher early when the ring is half full (once per wake-up, not per line)
+        if (pos + 1 - m_flushedPos.load(std::memory_order_relaxed) > (m_mask + 1) / 2 &&
+            !m_wakePending.exchange(true, std::memory_order_relaxed))
+        {
+            m_wakeCv.notify_one();
+        }
+        return true;
+    }
+
+    bool AsyncLogger::PopInto_(std::string& batch)
+    {
+        Slot& slot = m_slots[m_dequeuePos & m_mask];
+        if (slot.seq.load(std::memory_order_acquire) != m_dequeuePos + 1) return false;
+
+        AppendHeader(batch, slot.timeMs);
+        batch.append(slot.text, slot.len);
+        batch.append("\r\n", 2);
+
+        slot.seq.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+        ++m_dequeuePos;
+        return true;
+    }
+
+    void AsyncLogger::WriteBatch_(std::string& batch)
+    {
+        if (batch.empty()) return;
+        if (m_writer) m_writer(batch.data(), batch.size());
+        batch.clear();
+    }
+
+    void AsyncLogger::Flush()
+    {
+        const size_t target = m_enqueuePos.load(std::memory_order_acquire);
+        if (!m_running.load(std::memory_order_acquire)) return;
+        m_wakeCv.notify_one();
+        std::unique_lock<std::mutex> lk(m_wakeMutex);
+        m_flushedCv.wait(lk, [&] {
+            return m_flushedPos.load(std::memory_order_acquire) >= target || !m_running.load(std::memory_order_acquire);
+        });
+    }
+
+    void AsyncLogger::FlusherProc_()
+    {
+        std::string batch;
+        batch.reserve(kBatchBytes + kSlotSize * 2);
+        for (;;)
+        {
+            bool any = false;
+            uint64_t lines = 0;
+            while (PopInto_(batch))
+            {
+                any = true;
+                ++lines;
+                if (batch.size() >= kBatchBytes) WriteBatch_(batch);
+            }
+
+            const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+            if (dropped != m_droppedReported)
+            {
+                char note[96];
+                const int n = std::snprintf(note, sizeof(note), "log: dropped %llu lines (ring full)\r\n",
+                    static_cast<unsigned long long>(dropped - m_droppedReported));
+                AppendHeader(batch, NowMs());
+                if (n > 0) batch.append(note, size_t(n));
+                m_droppedReported = dropped;
+            }
+            WriteBatch_(batch);
+            m_written.fetch_add(lines, std::memory_order_relaxed);
+
+            {
+                std::lock_guard<std::mutex> lk(m_wakeMutex);
+                m_flushedPos.store(m_dequeuePos, std::memory_order_release);
+            }
+            m_flushedCv.notify_all();
+
+            if (any) continue;
+            if (!m_running.load(std::memory_order_acquire))
+            {
+                // Drain: a producer may have claimed a slot and not published it yet
+                if (m_enqueuePos.load(std::memory_order_acquire) == m_dequeuePos) break;
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lk(m_wakeMutex);
+            m_wakeCv.wait_for(lk, kFlushInterval);
+            m_wakePending.store(false, std::memory_order_relaxed);
+        }
+        m_flushedCv.notify_all();
+    }
+}
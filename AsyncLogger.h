@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace winvert4
+{
+    // Asynchronous line logger. Producers copy a line into a bounded lock-free
+    // MPSC ring (one CAS per line, no locks, no I/O); a background thread drains
+    // it, prefixes the local time and hands batches to a writer that keeps its
+    // file open. When the ring is full the line is dropped and counted, and the
+    // flusher reports the count in the log. Portable: the file handling lives in
+    // the writer supplied by the caller (see Log.h).
+    class AsyncLogger
+    {
+    public:
+        // Receives formatted, newline-terminated batches on the flusher thread.
+        using Writer = std::function<void(const char* data, size_t size)>;
+
+        static constexpr size_t kSlotSize = 512;   // bytes per ring slot (longer lines are truncated)
+        static constexpr size_t kDefaultSlots = 4096;
+
+        explicit AsyncLogger(size_t slotCount = kDefaultSlots);
+        ~AsyncLogger();
+
+        AsyncLogger(const AsyncLogger&) = delete;
+        AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+        // Start the flusher; lines pushed before Start are kept until it runs.
+        void Start(Writer writer);
+        // Drain everything and stop the flusher (also done by the destructor).
+        void Stop();
+
+        // Thread-safe and wait-free unless the ring is contended. False when dropped.
+        bool Push(const char* line, size_t len);
+        bool Push(const char* line);
+
+        // Block until every line pushed before the call has been written.
+        void Flush();
+
+        uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+        uint64_t Written() const { return m_written.load(std::memory_order_relaxed); }
+
+    private:
+        struct alignas(64) Slot
+        {
+            std::atomic<size_t> seq{ 0 };
+            int64_t timeMs{ 0 };  // system_clock milliseconds since epoch
+            uint32_t len{ 0 };
+            char text[kSlotSize - sizeof(std::atomic<size_t>) - sizeof(int64_t) - sizeof(uint32_t) - 4]{};
+        };
+
+        bool PopInto_(std::string& batch);
+        void FlusherProc_();
+        void WriteBatch_(std::string& batch);
+
+        std::unique_ptr<Slot[]> m_slots;
+        size_t m_mask{ 0 };
+        alignas(64) std::atomic<size_t> m_enqueuePos{ 0 };
+        alignas(64) size_t m_dequeuePos{ 0 };  // flusher thread only
+
+        std::atomic<uint64_t> m_dropped{ 0 };
+        uint64_t m_droppedReported{ 0 };
+        std::atomic<uint64_t> m_written{ 0 };
+
+        Writer m_writer;
+        std::thread m_thread;
+        std::atomic<bool> m_running{ false };
+        std::mutex m_wakeMutex;
+        std::condition_variable m_wakeCv;
+        std::condition_variable m_flushedCv;
+        std::atomic<bool> m_wakePending{ false };
+        std::atomic<size_t> m_flushedPos{ 0 };
+    };
+}
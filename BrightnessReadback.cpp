@@ -0,0 +1,126 @@
+#include "BrightnessReadback.h"
+
+namespace winvert4
+{
+    ReadbackRing::ReadbackRing(uint32_t slots)
+        : m_issuedFrame(slots ? slots : 1, 0)
+    {
+    }
+
+    bool ReadbackRing::Issue(IReadbackTarget& target, uint64_t frame)
+    {
+        if (m_count == Slots()) return false;
+        const uint32_t slot = (m_head + m_count) % Slots();
+        if (!target.Issue(slot)) return false;
+        m_issuedFrame[slot] = frame;
+        ++m_count;
+        return true;
+    }
+
+    bool ReadbackRing::Poll(IReadbackTarget& target, Result& result)
+    {
+        while (m_count > 0)
+        {
+            // The GPU finishes copies in order: a pending oldest slot means every
+            // newer one is pending too
+            const uint32_t slot = m_head;
+            const ReadbackStatus status = target.TryRead(slot, result.pixel);
+            if (status == ReadbackStatus::Pending) return false;
+            m_head = (m_head + 1) % Slots();
+            --m_count;
+            if (status == ReadbackStatus::Ready)
+            {
+                result.issuedFrame = m_issuedFrame[slot];
+                return true;
+            }
+            ++m_failed;
+        }
+        return false;
+    }
+
+    bool BrightnessDebounce::Update(float luma, int delayFrames)
+    {
+        // Choose the darker result by comparing luma to inverted luma
+        const bool desired = (1.0f - luma) < luma;
+        const bool previous = m_invert;
+        if (delayFrames <= 0)
+        {
+            m_invert = desired;
+            ClearPending();
+        }
+        else if (desired == m_invert)
+        {
+            ClearPending();
+        }
+        else
+        {
+            if (m_pendingCount == 0 || m_pendingState != desired)
+            {
+                m_pendingState = desired;
+                m_pendingCount = 1;
+            }
+            else
+            {
+                ++m_pendingCount;
+            }
+            if (m_pendingCount >= delayFrames)
+            {
+                m_invert = desired;
+                m_pendingCount = 0;
+            }
+        }
+        return m_invert != previous;
+    }
+
+    float BrightnessMonitor::Luma(const Bgra8& px, const float lumaWeights[3])
+    {
+        return px.r / 255.0f * lumaWeights[0] + px.g / 255.0f * lumaWeights[1] + px.b / 255.0f * lumaWeights[2];
+    }
+
+    BrightnessMonitor::FrameResult BrightnessMonitor::Frame(IReadbackTarget& target, bool regionChanged,
+        const float lumaWeights[3], int delayFrames)
+    {
+        FrameResult out;
+        ++m_frame;
+
+        ReadbackRing::Result r;
+        while (m_ring.Poll(target, r))
+        {
+            m_last = r.pixel;
+            m_hasLast = true;
+            ++out.samples;
+            out.luma = Luma(r.pixel, lumaWeights);
+            out.latencyFrames = uint32_t(m_frame - r.issuedFrame);
+            out.flipped |= m_debounce.Update(out.luma, delayFrames);
+        }
+
+        // Nothing measured yet: take a first reading even if the region is idle
+        if (regionChanged || (!m_hasLast && m_ring.InFlight() == 0)) m_wantIssue = true;
+        // With every slot in flight the change is picked up once one frees; a target
+        // that queued nothing is not retried until the region changes again
+        if (m_wantIssue && m_ring.InFlight() < m_ring.Slots())
+        {
+            m_ring.Issue(target, m_frame);
+            m_wantIssue = false;
+        }
+
+        if (out.samples == 0 && m_hasLast && m_debounce.Pending() && m_ring.InFlight() == 0)
+        {
+            out.flipped |= m_debounce.Update(Luma(m_last, lumaWeights), delayFrames);
+        }
+        return out;
+    }
+
+    void BrightnessMonitor::Disable(bool invert)
+    {
+        m_debounce.Force(invert);
+        ResetReadbacks();
+    }
+
+    void BrightnessMonitor::ResetReadbacks()
+    {
+        m_ring.Reset();
+        m_hasLast = false;
+        m_wantIssue = false;
+    }
+}
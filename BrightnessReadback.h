@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace winvert4
+{
+    // One pixel of a 1x1 readback, in the B8G8R8A8 order of the mip chain
+    struct Bgra8
+    {
+        uint8_t b{ 0 }, g{ 0 }, r{ 0 }, a{ 0 };
+    };
+
+    enum class ReadbackStatus
+    {
+        Ready,
+        Pending,  // the GPU has not finished the copy yet
+        Failed,
+    };
+
+    // Device side of a readback ring: each slot is one staging resource.
+    class IReadbackTarget
+    {
+    public:
+        virtual ~IReadbackTarget() = default;
+        // Queue the GPU work that leaves the region's average color in slot; false
+        // if nothing was queued
+        virtual bool Issue(uint32_t slot) = 0;
+        // Read slot without waiting for the GPU
+        virtual ReadbackStatus TryRead(uint32_t slot, Bgra8& out) = 0;
+    };
+
+    // Keeps up to Slots() readbacks in flight and collects them in issue order as
+    // the GPU finishes them, so the caller never blocks on a Map. Single-threaded;
+    // portable.
+    class ReadbackRing
+    {
+    public:
+        static constexpr uint32_t kDefaultSlots = 3;
+
+        struct Result
+        {
+            Bgra8 pixel;
+            uint64_t issuedFrame{ 0 };
+        };
+
+        explicit ReadbackRing(uint32_t slots = kDefaultSlots);
+
+        // Issue into the next free slot; false when all are in flight or the target
+        // queued nothing
+        bool Issue(IReadbackTarget& target, uint64_t frame);
+        // The oldest readback, if it has finished. Failed readbacks are dropped.
+        bool Poll(IReadbackTarget& target, Result& result);
+        // Forget in-flight readbacks (e.g. their staging resources were recreated)
+        void Reset() { m_head = 0; m_count = 0; }
+
+        uint32_t InFlight() const { return m_count; }
+        uint32_t Slots() const { return uint32_t(m_issuedFrame.size()); }
+        uint64_t Failed() const { return m_failed; }
+
+    private:
+        std::vector<uint64_t> m_issuedFrame;  // by slot
+        uint32_t m_head{ 0 };   // oldest in-flight slot
+        uint32_t m_count{ 0 };
+        uint64_t m_failed{ 0 };
+    };
+
+    // Brightness protection's flip decision: invert when that makes the region
+    // darker, after the new choice held for delayFrames consecutive measurements.
+    class BrightnessDebounce
+    {
+    public:
+        // One measurement; true when the effective invert flipped
+        bool Update(float luma, int delayFrames);
+        // Protection off, or settings changed: follow invert with nothing pending
+        void Force(bool invert) { m_invert = invert; ClearPending(); }
+        void ClearPending() { m_pendingCount = 0; m_pendingState = m_invert; }
+
+        bool Invert() const { return m_invert; }
+        bool Pending() const { return m_pendingCount > 0; }
+
+    private:
+        bool m_invert{ false };
+        int  m_pendingCount{ 0 };
+        bool m_pendingState{ false };
+    };
+
+    // Drives a ReadbackRing and a BrightnessDebounce from the render thread. A new
+    // readback is issued only when the region may have changed; results are
+    // consumed a few frames late, each feeding the debounce once. While a flip is
+    // pending on an unchanged region, the last measurement counts again for each
+    // frame, as a fresh readback of the same pixels would. Portable.
+    class BrightnessMonitor
+    {
+    public:
+        struct FrameResult
+        {
+            uint32_t samples{ 0 };        // readbacks consumed this frame
+            float luma{ 0.0f };           // newest measurement (when samples > 0)
+            uint32_t latencyFrames{ 0 };  // its age in frames
+            bool flipped{ false };
+        };
+
+        explicit BrightnessMonitor(uint32_t slots = ReadbackRing::kDefaultSlots) : m_ring(slots) {}
+
+        // One rendered frame with protection on. regionChanged: the region's pixels
+        // may differ from those of the last issued readback.
+        FrameResult Frame(IReadbackTarget& target, bool regionChanged, const float lumaWeights[3], int delayFrames);
+
+        // Protection off: follow invert and drop in-flight readbacks
+        void Disable(bool invert);
+        // Settings changed: restart the debounce from the current state
+        void ClearPending() { m_debounce.ClearPending(); }
+        // Staging resources were recreated: in-flight readbacks are lost
+        void ResetReadbacks();
+
+        bool Invert() const { return m_debounce.Invert(); }
+        // More frames are needed to settle: readbacks outstanding or a flip pending
+        bool NeedsFrames() const { return m_ring.InFlight() > 0 || m_wantIssue || m_debounce.Pending(); }
+        const ReadbackRing& Ring() const { return m_ring; }
+
+        static float Luma(const Bgra8& px, const float lumaWeights[3]);
+
+    private:
+        ReadbackRing m_ring;
+        BrightnessDebounce m_debounce;
+        uint64_t m_frame{ 0 };
+        Bgra8 m_last{};
+        bool m_hasLast{ false };
+        bool m_wantIssue{ false };  // region changed since the last issued readback
+    };
+}
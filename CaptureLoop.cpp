@@ -0,0 +1,488 @@
+#include "CaptureLoop.h"
+#include "FrameTrace.h"
+#include <algorithm>
+#include <chrono>
+
+namespace winvert4
+{
+    namespace {
+        void Bump(std::atomic<uint64_t>& stat, metrics::Counter* mirror, uint64_t n = 1)
+        {
+            stat.fetch_add(n, std::memory_order_relaxed);
+            if (mirror && n) mirror->Add(n);
+        }
+    }
+
+    CaptureLoop::CaptureLoop()
+    {
+        m_subscribers.store(new SubscriberList(), std::memory_order_release);
+    }
+
+    CaptureLoop::~CaptureLoop()
+    {
+        FreeRetired_();
+        delete m_subscribers.load(std::memory_order_acquire);
+    }
+
+    // The subscriber list is read-copy-update with a single reader, the loop thread.
+    // The reader bumps m_readEpoch to odd before loading the list and back to even
+    // when done; a writer that swapped in a new list waits for the epoch to move on
+    // before freeing the old one, so a pinned list is never freed under the loop.
+
+    const CaptureLoop::SubscriberList& CaptureLoop::EnterRead_()
+    {
+        m_readEpoch.fetch_add(1, std::memory_order_seq_cst);
+        return *m_subscribers.load(std::memory_order_seq_cst);
+    }
+
+    void CaptureLoop::ExitRead_()
+    {
+        m_readEpoch.fetch_add(1, std::memory_order_seq_cst);
+        // Lists retired without waiting (additions, removals from inside OnFrame)
+        // can go now: nothing is pinned
+        if (m_hasRetired.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lk(m_subMutex);
+            FreeRetired_();
+        }
+    }
+
+    void CaptureLoop::Publish_(SubscriberList* next)
+    {
+        m_subscriberCount.store(next->size(), std::memory_order_release);
+        m_subscribers.store(next, std::memory_order_seq_cst);
+    }
+
+    void CaptureLoop::Synchronize_()
+    {
+        const uint64_t epoch = m_readEpoch.load(std::memory_order_seq_cst);
+        if ((epoch & 1) == 0) return;
+        // The loop is mid-dispatch (at most one frame of renders); back off politely
+        for (int spins = 0; m_readEpoch.load(std::memory_order_seq_cst) == epoch; ++spins)
+        {
+            if (spins < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    void CaptureLoop::FreeRetired_()
+    {
+        for (SubscriberList* list : m_retired) delete list;
+        m_retired.clear();
+        m_hasRetired.store(false, std::memory_order_release);
+    }
+
+    void CaptureLoop::AddSubscriber(IFrameSink* sink, const PixelRect& region)
+    {
+        std::lock_guard<std::mutex> lk(m_subMutex);
+        SubscriberList* old = m_subscribers.load(std::memory_order_acquire);
+        auto* next = new SubscriberList(*old);
+        next->push_back(Subscriber{ sink, region });
+        Publish_(next);
+        // Nothing to wait for: the loop may keep using the old list until its next frame
+        m_retired.push_back(old);
+        m_hasRetired.store(true, std::memory_order_release);
+        m_subCv.notify_all();
+    }
+
+    void CaptureLoop::RemoveSubscriber(IFrameSink* sink)
+    {
+        SubscriberList* old = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(m_subMutex);
+            old = m_subscribers.load(std::memory_order_acquire);
+            auto* next = new SubscriberList();
+            next->reserve(old->size());
+            for (const auto& s : *old)
+            {
+                if (s.sink != sink) next->push_back(s);
+            }
+            Publish_(next);
+            if (std::this_thread::get_id() == m_loopThread.load(std::memory_order_relaxed))
+            {
+                // Called from inside a dispatch; the pinned list is freed when it ends
+                m_retired.push_back(old);
+                m_hasRetired.store(true, std::memory_order_release);
+                ForgetRedraws_(sink);
+                return;
+            }
+        }
+        // Outside the lock: a sink may call back into the loop while we wait
+        Synchronize_();
+        delete old;
+        ForgetRedraws_(sink);
+    }
+
+    void CaptureLoop::ForgetRedraws_(IFrameSink* sink)
+    {
+        std::lock_guard<std::mutex> lk(m_redrawMutex);
+        auto isSink = [sink](const RedrawRequest& r) { return r.sink == sink; };
+        m_redrawPending.erase(std::remove_if(m_redrawPending.begin(), m_redrawPending.end(), isSink), m_redrawPending.end());
+        m_redrawServiced.erase(std::remove_if(m_redrawServiced.begin(), m_redrawServiced.end(), isSink), m_redrawServiced.end());
+        m_hasRedraw.store(!m_redrawPending.empty(), std::memory_order_release);
+        m_redrawTimed.erase(std::remove_if(m_redrawTimed.begin(), m_redrawTimed.end(),
+            [sink](const TimedRedraw& r) { return r.sink == sink; }), m_redrawTimed.end());
+    }
+
+    void CaptureLoop::QueueRedraw_(IFrameSink* sink, uint64_t generation)
+    {
+        for (auto& r : m_redrawPending)
+        {
+            if (r.sink != sink) continue;
+            // Coalesce; generation 0 (unconditional) wins over any number
+            if (r.generation != 0) r.generation = (generation == 0) ? 0 : std::max(r.generation, generation);
+            m_hasRedraw.store(true, std::memory_order_release);
+            return;
+        }
+        m_redrawPending.push_back(RedrawRequest{ sink, generation });
+        m_hasRedraw.store(true, std::memory_order_release);
+    }
+
+    void CaptureLoop::RequestRedraw(IFrameSink* sink, uint64_t generation)
+    {
+        if (!sink) return;
+        std::lock_guard<std::mutex> lk(m_redrawMutex);
+        if (generation != 0)
+        {
+            for (const auto& r : m_redrawServiced)
+            {
+                if (r.sink == sink && r.generation >= generation) return;  // already on screen
+            }
+        }
+        QueueRedraw_(sink, generation);
+        if (m_runningSource) m_runningSource->Wake();
+    }
+
+    void CaptureLoop::RequestRedrawAt(IFrameSink* sink, uint64_t dueNs)
+    {
+        if (!sink) return;
+        std::lock_guard<std::mutex> lk(m_redrawMutex);
+        auto it = std::find_if(m_redrawTimed.begin(), m_redrawTimed.end(),
+            [sink](const TimedRedraw& r) { return r.sink == sink; });
+        if (it == m_redrawTimed.end()) m_redrawTimed.push_back(TimedRedraw{ sink, dueNs });
+        else it->dueNs = std::min(it->dueNs, dueNs);
+        const uint64_t next = m_nextDueNs.load(std::memory_order_relaxed);
+        if (dueNs >= next) return;
+        m_nextDueNs.store(dueNs, std::memory_order_release);
+        // The loop thread picks the deadline up before its next wait; others may
+        // need to cut a wait short
+        if (m_runningSource && std::this_thread::get_id() != m_loopThread.load(std::memory_order_relaxed))
+        {
+            m_runningSource->Wake();
+        }
+    }
+
+    uint32_t CaptureLoop::PromoteDueRedraws_(uint32_t maxMs)
+    {
+        if (m_nextDueNs.load(std::memory_order_acquire) == UINT64_MAX) return maxMs;
+        const uint64_t now = metrics::NowNs();
+        std::lock_guard<std::mutex> lk(m_redrawMutex);
+        uint64_t next = UINT64_MAX;
+        auto it = m_redrawTimed.begin();
+        while (it != m_redrawTimed.end())
+        {
+            if (it->dueNs <= now)
+            {
+                QueueRedraw_(it->sink, 0);
+                it = m_redrawTimed.erase(it);
+                continue;
+            }
+            next = std::min(next, it->dueNs);
+            ++it;
+        }
+        m_nextDueNs.store(next, std::memory_order_release);
+        if (next == UINT64_MAX) return maxMs;
+        // Round up so the wait does not end just short of the deadline
+        return uint32_t(std::min<uint64_t>((next - now + 999999) / 1000000, maxMs));
+    }
+
+    void CaptureLoop::DropTimedRedraws_()
+    {
+        if (m_nextDueNs.load(std::memory_order_acquire) == UINT64_MAX) return;
+        std::lock_guard<std::mutex> lk(m_redrawMutex);
+        m_redrawTimed.clear();
+        m_nextDueNs.store(UINT64_MAX, std::memory_order_release);
+    }
+
+    void CaptureLoop::TakeRedraws_()
+    {
+        m_redrawTaken.clear();
+        if (!m_hasRedraw.load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lk(m_redrawMutex);
+        // Swap so both vectors keep their capacity: no allocation once warmed up
+        m_redrawTaken.swap(m_redrawPending);
+        m_hasRedraw.store(false, std::memory_order_release);
+        for (const auto& t : m_redrawTaken)
+        {
+            if (t.generation == 0) continue;
+            auto it = std::find_if(m_redrawServiced.begin(), m_redrawServiced.end(),
+                [&t](const RedrawRequest& r) { return r.sink == t.sink; });
+            if (it == m_redrawServiced.end()) m_redrawServiced.push_back(t);
+            else it->generation = std::max(it->generation, t.generation);
+        }
+    }
+
+    void CaptureLoop::Stop()
+    {
+        std::lock_guard<std::mutex> lk(m_subMutex);
+        m_stop.store(true, std::memory_order_release);
+        m_subCv.notify_all();
+    }
+
+    void CaptureLoop::BindMetrics(metrics::Registry& registry, const std::string& prefix)
+    {
+        m_metrics.frames = &registry.GetCounter(prefix + ".frames");
+        m_metrics.timeouts = &registry.GetCounter(prefix + ".timeouts");
+        m_metrics.failures = &registry.GetCounter(prefix + ".failures");
+        m_metrics.renders = &registry.GetCounter(prefix + ".renders");
+        m_metrics.presents = &registry.GetCounter(prefix + ".presents");
+        m_metrics.redraws = &registry.GetCounter(prefix + ".redraws");
+        m_metrics.bytesCopied = &registry.GetCounter(prefix + ".bytes_copied");
+        m_metrics.losses = &registry.GetCounter(prefix + ".losses");
+        m_metrics.recoveries = &registry.GetCounter(prefix + ".recoveries");
+        m_metrics.refreshHz = &registry.GetGauge(prefix + ".refresh_hz");
+        m_metrics.recoverTime = &registry.GetHistogram(prefix + ".recover_ns");
+    }
+
+    CaptureLoop::Stats CaptureLoop::GetStats() const
+    {
+        Stats s;
+        s.frames = m_frames.load(std::memory_order_relaxed);
+        s.timeouts = m_timeouts.load(std::memory_order_relaxed);
+        s.failures = m_failures.load(std::memory_order_relaxed);
+        s.renders = m_renders.load(std::memory_order_relaxed);
+        s.presents = m_presents.load(std::memory_order_relaxed);
+        s.redraws = m_redraws.load(std::memory_order_relaxed);
+        s.losses = m_losses.load(std::memory_order_relaxed);
+        s.recoveries = m_recoveries.load(std::memory_order_relaxed);
+        s.recoveryAttempts = m_recoveryAttempts.load(std::memory_order_relaxed);
+        s.lastRecoverNs = m_lastRecoverNs.load(std::memory_order_relaxed);
+        s.maxRecoverNs = m_maxRecoverNs.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void CaptureLoop::Run(IFrameSource& source)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_redrawMutex);
+            m_runningSource = &source;
+        }
+        ResetRefresh_(source);
+        uint32_t failures = 0;
+        while (!IsStopping())
+        {
+            const AcquireStatus st = Step(source);
+            if (st == AcquireStatus::Failed && ++failures < m_recoveryPolicy.failuresBeforeReset) continue;
+            if (st == AcquireStatus::AccessLost || st == AcquireStatus::Failed)
+            {
+                if (!Recover_(source)) break;
+            }
+            failures = 0;
+        }
+        std::lock_guard<std::mutex> lk(m_redrawMutex);
+        m_runningSource = nullptr;
+    }
+
+    void CaptureLoop::ResetRefresh_(const IFrameSource& source)
+    {
+        m_refresh.Reset(source.TicksPerSecond(), source.RefreshHz());
+        std::lock_guard<std::mutex> lk(m_refreshMutex);
+        m_refreshEstimate = RefreshEstimator::Estimate{};
+    }
+
+    RefreshEstimator::Estimate CaptureLoop::GetRefreshEstimate() const
+    {
+        std::lock_guard<std::mutex> lk(m_refreshMutex);
+        return m_refreshEstimate;
+    }
+
+    void CaptureLoop::WaitUnlessStopping_(uint32_t ms)
+    {
+        std::unique_lock<std::mutex> lk(m_subMutex);
+        m_subCv.wait_for(lk, std::chrono::milliseconds(ms), [this] { return IsStopping(); });
+    }
+
+    bool CaptureLoop::Recover_(IFrameSource& source)
+    {
+        using namespace std::chrono;
+        Bump(m_losses, m_metrics.losses);
+        m_recovering.store(true, std::memory_order_release);
+        if (m_hooks.onLost) m_hooks.onLost();
+
+        // Nothing is presented meanwhile, so the windows keep showing the last good frame.
+        // Retry at once (a mode change is usually over by now), then back off: the
+        // secure desktop or a fullscreen app can hold the output for minutes.
+        const auto lostAt = steady_clock::now();
+        uint32_t attempts = 0;
+        uint32_t delayMs = m_recoveryPolicy.initialDelayMs;
+        for (;;)
+        {
+            if (IsStopping())
+            {
+                m_recovering.store(false, std::memory_order_release);
+                return false;
+            }
+            ++attempts;
+            m_recoveryAttempts.fetch_add(1, std::memory_order_relaxed);
+            if (source.Recreate()) break;
+            WaitUnlessStopping_(delayMs);
+            delayMs = std::min(m_recoveryPolicy.maxDelayMs, std::max(1u, delayMs * 2));
+        }
+
+        const uint64_t recoverNs = uint64_t(duration_cast<nanoseconds>(steady_clock::now() - lostAt).count());
+        m_lastRecoverNs.store(recoverNs, std::memory_order_relaxed);
+        if (recoverNs > m_maxRecoverNs.load(std::memory_order_relaxed)) m_maxRecoverNs.store(recoverNs, std::memory_order_relaxed);
+        Bump(m_recoveries, m_metrics.recoveries);
+        m_recovering.store(false, std::memory_order_release);
+        // The mode may have changed; measure the new one from scratch
+        ResetRefresh_(source);
+        if (m_metrics.recoverTime) m_metrics.recoverTime->Record(recoverNs, metrics::NowNs());
+        if (m_hooks.onRecovered) m_hooks.onRecovered(recoverNs, attempts);
+
+        // The desktop may look different now (new mode, dismissed prompt) and may stay
+        // idle; refresh every subscriber from whatever the new capture holds
+        TakeRedraws_();
+        const SubscriberList& subs = EnterRead_();
+        if (source.SharedFrame())
+        {
+            FrameEvent ev;
+            ev.frame = source.SharedFrame();
+            ev.regionDirty = true;
+            uint64_t redraws = 0, presents = 0;
+            for (const auto& s : subs)
+            {
+                if (!s.sink) continue;
+                ++redraws;
+                if (s.sink->OnFrame(ev)) ++presents;
+            }
+            Bump(m_renders, m_metrics.renders, redraws);
+            Bump(m_presents, m_metrics.presents, presents);
+            Bump(m_redraws, m_metrics.redraws, redraws);
+        }
+        ExitRead_();
+        return true;
+    }
+
+    bool CaptureLoop::WaitForSubscribers_()
+    {
+        if (SubscriberCount() > 0 || m_hooks.runWithoutSubscribers) return true;
+        // Idle until someone subscribes; the short period keeps Stop() responsive
+        std::unique_lock<std::mutex> lk(m_subMutex);
+        m_subCv.wait_for(lk, std::chrono::milliseconds(50), [this] { return IsStopping() || SubscriberCount() > 0; });
+        return !IsStopping() && SubscriberCount() > 0;
+    }
+
+    void CaptureLoop::RedrawLast_(IFrameSource& source, const SubscriberList& subs)
+    {
+        // No new desktop frame: render the last one, but only for the sinks that asked
+        if (m_redrawTaken.empty() || !source.SharedFrame()) return;
+        FrameEvent ev;
+        ev.frame = source.SharedFrame();
+        uint64_t redraws = 0, presents = 0;
+        for (const auto& s : subs)
+        {
+            if (!s.sink) continue;
+            const bool requested = std::any_of(m_redrawTaken.begin(), m_redrawTaken.end(),
+                [&s](const RedrawRequest& r) { return r.sink == s.sink; });
+            if (!requested) continue;
+            // Source unchanged; the sink decides from its own state whether anything needs drawing
+            ++redraws;
+            if (s.sink->OnFrame(ev)) ++presents;
+        }
+        Bump(m_renders, m_metrics.renders, redraws);
+        Bump(m_presents, m_metrics.presents, presents);
+        Bump(m_redraws, m_metrics.redraws, redraws);
+    }
+
+    AcquireStatus CaptureLoop::Step(IFrameSource& source)
+    {
+        m_loopThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        if (m_hooks.beforeAcquire) m_hooks.beforeAcquire();
+        if (!WaitForSubscribers_()) return AcquireStatus::Timeout;
+
+        FrameInfo fi{};
+        // With a redraw pending, only give a fresh desktop frame a moment to arrive (it
+        // would serve the request too); otherwise block until the next timed redraw at
+        // the latest, RequestRedraw wakes the source
+        const uint32_t untilTimedMs = PromoteDueRedraws_(16u);
+        const uint32_t waitMs = m_hasRedraw.load(std::memory_order_acquire) ? 1u : std::max(untilTimedMs, 1u);
+        AcquireStatus st;
+        {
+            frametrace::TraceScope ts(frametrace::Stage::Acquire);
+            st = source.Acquire(waitMs, fi, m_damage);
+            ts.SetArg(st == AcquireStatus::Frame ? fi.accumulatedFrames : 0);
+        }
+        if (st == AcquireStatus::Timeout)
+        {
+            Bump(m_timeouts, m_metrics.timeouts);
+            TakeRedraws_();
+            if (!m_redrawTaken.empty())
+            {
+                RedrawLast_(source, EnterRead_());
+                ExitRead_();
+            }
+            return st;
+        }
+        if (st != AcquireStatus::Frame)
+        {
+            Bump(m_failures, m_metrics.failures);
+            return st;
+        }
+        Bump(m_frames, m_metrics.frames);
+        {
+            const uint64_t accepted = m_refresh.Accepted();
+            m_refresh.AddPresent(fi.presentTicks, fi.accumulatedFrames);
+            if (m_refresh.Accepted() != accepted && m_refresh.Accepted() % kRefreshPublishFrames == 0)
+            {
+                const RefreshEstimator::Estimate est = m_refresh.Get();
+                if (m_metrics.refreshHz) m_metrics.refreshHz->Set(est.hz);
+                std::lock_guard<std::mutex> lk(m_refreshMutex);
+                m_refreshEstimate = est;
+            }
+        }
+
+        {
+            // Copy only the changed regions into the shared frame
+            frametrace::TraceScope ts(frametrace::Stage::CopyFrame);
+            source.CopyFrame(m_damage);
+            ts.SetArg(m_damage.IsFull() ? 0 : m_damage.Rects().size());
+            // Both sources copy 4-byte BGRA pixels
+            if (m_metrics.bytesCopied) m_metrics.bytesCopied->Add(uint64_t(m_damage.DamagedArea()) * 4);
+        }
+        {
+            // The shared frame is up to date; give the source its frame back before
+            // rendering so a slow subscriber cannot hold up the next acquire
+            frametrace::TraceScope ts(frametrace::Stage::ReleaseFrame);
+            source.Release();
+        }
+
+        // Subscribers are still notified; each skips the frame if neither its region nor its settings changed.
+        // Every sink sees this frame, so requests made so far are served by it; ones made
+        // during the dispatch stay pending.
+        TakeRedraws_();
+        DropTimedRedraws_();
+        bool anyPresented = false;
+        const SubscriberList& subs = EnterRead_();
+        if (source.SharedFrame())
+        {
+            FrameEvent ev;
+            ev.frame = source.SharedFrame();
+            ev.presentTicks = fi.presentTicks;
+            uint64_t renders = 0, presents = 0;
+            for (const auto& s : subs)
+            {
+                if (!s.sink) continue;
+                ev.regionDirty = m_damage.Intersects(s.region);
+                ++renders;
+                if (s.sink->OnFrame(ev)) ++presents;
+            }
+            anyPresented = presents > 0;
+            Bump(m_renders, m_metrics.renders, renders);
+            Bump(m_presents, m_metrics.presents, presents);
+        }
+
+        if (m_hooks.afterFrame) m_hooks.afterFrame(m_damage, anyPresented, subs);
+        ExitRead_();
+        return st;
+    }
+}
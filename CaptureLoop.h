@@ -0,0 +1,215 @@
+#pragma once
+#include "FrameSource.h"
+#include "RefreshEstimator.h"
+#include "Metrics.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace winvert4
+{
+    struct FrameEvent
+    {
+        const void* frame{ nullptr };   // IFrameSource::SharedFrame()
+        uint64_t presentTicks{ 0 };     // 0 for redraws of the last frame
+        bool regionDirty{ false };      // damage touched the subscriber's region
+    };
+
+    // Receives frames from a CaptureLoop on the capture thread.
+    class IFrameSink
+    {
+    public:
+        virtual ~IFrameSink() = default;
+        // Returns true when a new image was presented.
+        virtual bool OnFrame(const FrameEvent& ev) = 0;
+    };
+
+    // The per-output frame loop: acquire, copy damage, fan out to subscribers, and
+    // redraw the last frame for subscribers that asked for it. Knows nothing about
+    // DXGI; the source and the sinks supply the platform parts.
+    class CaptureLoop
+    {
+    public:
+        struct Subscriber
+        {
+            IFrameSink* sink{ nullptr };
+            PixelRect region{};  // source-local pixels
+        };
+
+        struct Hooks
+        {
+            // Start of every iteration (e.g. pumping a debug window's messages)
+            std::function<void()> beforeAcquire;
+            // After an acquired frame was copied, released and fanned out
+            std::function<void(const FrameDamage&, bool anyPresented, const std::vector<Subscriber>&)> afterFrame;
+            // Keep acquiring with no subscribers (the debug mirror shows raw frames)
+            bool runWithoutSubscribers{ false };
+            // The source lost its capture; recovery is starting
+            std::function<void()> onLost;
+            // The source was recreated after recoverNs and this many attempts
+            std::function<void(uint64_t recoverNs, uint32_t attempts)> onRecovered;
+        };
+
+        struct RecoveryPolicy
+        {
+            uint32_t initialDelayMs{ 16 };     // wait after the first failed Recreate
+            uint32_t maxDelayMs{ 1000 };       // backoff cap: once the output is back, recovery takes at most this long
+            uint32_t failuresBeforeReset{ 8 }; // consecutive Failed acquires handled like AccessLost
+        };
+
+        struct Stats
+        {
+            uint64_t frames{ 0 };     // frames acquired
+            uint64_t timeouts{ 0 };
+            uint64_t failures{ 0 };
+            uint64_t renders{ 0 };    // OnFrame calls
+            uint64_t presents{ 0 };   // OnFrame calls that presented
+            uint64_t redraws{ 0 };    // OnFrame calls that re-rendered the last frame on request
+            uint64_t losses{ 0 };     // times capture was lost
+            uint64_t recoveries{ 0 }; // times it was recreated
+            uint64_t recoveryAttempts{ 0 };
+            uint64_t lastRecoverNs{ 0 };  // loss to recreated capture
+            uint64_t maxRecoverNs{ 0 };
+        };
+
+        CaptureLoop();
+        ~CaptureLoop();
+        CaptureLoop(const CaptureLoop&) = delete;
+        CaptureLoop& operator=(const CaptureLoop&) = delete;
+
+        void SetHooks(Hooks hooks) { m_hooks = std::move(hooks); }
+        void SetRecoveryPolicy(const RecoveryPolicy& policy) { m_recoveryPolicy = policy; }
+        // Also publish the stats as registry metrics named prefix + ".frames" etc. Call
+        // before Run().
+        void BindMetrics(metrics::Registry& registry, const std::string& prefix);
+
+        // Subscriber changes publish a new immutable list; the loop reads the current
+        // one without locking or allocating. Once RemoveSubscriber returns, the sink is
+        // not called again (unless the call comes from inside that sink's OnFrame on
+        // the loop thread, where waiting would deadlock; the current dispatch finishes).
+        void AddSubscriber(IFrameSink* sink, const PixelRect& region);
+        void RemoveSubscriber(IFrameSink* sink);
+        size_t SubscriberCount() const { return m_subscriberCount.load(std::memory_order_acquire); }
+        // Have sink render the last frame once, even if the desktop stays idle. Requests
+        // for the same sink coalesce; one whose generation (e.g. a settings generation)
+        // was already serviced is dropped. Generation 0 always redraws. Wakes the source
+        // of a running loop so the redraw does not wait out the acquire timeout.
+        void RequestRedraw(IFrameSink* sink, uint64_t generation = 0);
+        // Redraw sink once metrics::NowNs() reaches dueNs, unless a desktop frame
+        // reaches it first. For follow-up frames paced to the display (e.g. waiting
+        // out a GPU readback) rather than as fast as the loop spins; the earliest
+        // deadline per sink wins.
+        void RequestRedrawAt(IFrameSink* sink, uint64_t dueNs);
+
+        // Run iterations until Stop(). A lost capture is recreated with exponential
+        // backoff; subscribers stay attached and keep their last presented image.
+        void Run(IFrameSource& source);
+        // One iteration; returns the acquire status, or Timeout when it only waited for
+        // subscribers. Recovery from AccessLost is left to Run().
+        AcquireStatus Step(IFrameSource& source);
+        void Stop();
+        bool IsStopping() const { return m_stop.load(std::memory_order_acquire); }
+
+        bool IsRecovering() const { return m_recovering.load(std::memory_order_acquire); }
+        // Measured present cadence of the source, refreshed every kRefreshPublishFrames
+        // accepted frames; reset when capture is recreated. Any thread.
+        RefreshEstimator::Estimate GetRefreshEstimate() const;
+        static constexpr uint64_t kRefreshPublishFrames = 32;
+
+        Stats GetStats() const;
+
+    private:
+        using SubscriberList = std::vector<Subscriber>;
+
+        // Read side: pins the current list until ExitRead_ (loop thread only)
+        const SubscriberList& EnterRead_();
+        void ExitRead_();
+        // Write side (m_subMutex held): swap in next and retire the old list
+        void Publish_(SubscriberList* next);
+        // Wait until the loop is outside any read section that began before now
+        void Synchronize_();
+        void FreeRetired_();
+
+        // False when the loop should not acquire (no subscribers, or stopping)
+        bool WaitForSubscribers_();
+        // Loop thread: move pending requests into m_redrawTaken and mark them serviced
+        void TakeRedraws_();
+        void ForgetRedraws_(IFrameSink* sink);
+        // m_redrawMutex held: add or coalesce a pending request
+        void QueueRedraw_(IFrameSink* sink, uint64_t generation);
+        // Loop thread: queue the timed requests that are due; ms until the next one
+        // (at most maxMs)
+        uint32_t PromoteDueRedraws_(uint32_t maxMs);
+        // Loop thread: a desktop frame goes to every sink, serving all timed requests
+        void DropTimedRedraws_();
+        void RedrawLast_(IFrameSource& source, const SubscriberList& subs);
+        // Recreate the source until it succeeds or Stop(); false when stopped
+        bool Recover_(IFrameSource& source);
+        // Sleep up to ms, returning early on Stop()
+        void WaitUnlessStopping_(uint32_t ms);
+        void ResetRefresh_(const IFrameSource& source);
+
+        Hooks m_hooks;
+        RecoveryPolicy m_recoveryPolicy;
+        std::atomic<bool> m_recovering{ false };
+        std::atomic<SubscriberList*> m_subscribers{ nullptr };
+        std::atomic<size_t> m_subscriberCount{ 0 };
+        // Odd while the loop is dispatching from a pinned list
+        std::atomic<uint64_t> m_readEpoch{ 0 };
+        std::atomic<bool> m_hasRetired{ false };
+        std::vector<SubscriberList*> m_retired;  // guarded by m_subMutex
+        std::atomic<std::thread::id> m_loopThread{};
+        mutable std::mutex m_subMutex;  // serializes writers; also used to sleep with no subscribers
+        std::condition_variable m_subCv;
+        std::atomic<bool> m_stop{ false };
+
+        struct RedrawRequest
+        {
+            IFrameSink* sink{ nullptr };
+            uint64_t generation{ 0 };
+        };
+        std::mutex m_redrawMutex;
+        std::vector<RedrawRequest> m_redrawPending;   // guarded by m_redrawMutex; one per sink
+        std::vector<RedrawRequest> m_redrawServiced;  // guarded by m_redrawMutex; last generation per sink
+        std::vector<RedrawRequest> m_redrawTaken;     // loop thread only
+        std::atomic<bool> m_hasRedraw{ false };
+        struct TimedRedraw
+        {
+            IFrameSink* sink{ nullptr };
+            uint64_t dueNs{ 0 };
+        };
+        std::vector<TimedRedraw> m_redrawTimed;       // guarded by m_redrawMutex; one per sink
+        std::atomic<uint64_t> m_nextDueNs{ UINT64_MAX };  // earliest in m_redrawTimed
+        IFrameSource* m_runningSource{ nullptr };     // guarded by m_redrawMutex; set while Run() is active
+        FrameDamage m_damage;
+        RefreshEstimator m_refresh;  // loop thread only
+        mutable std::mutex m_refreshMutex;
+        RefreshEstimator::Estimate m_refreshEstimate;  // guarded by m_refreshMutex
+
+        std::atomic<uint64_t> m_frames{ 0 }, m_timeouts{ 0 }, m_failures{ 0 };
+        std::atomic<uint64_t> m_renders{ 0 }, m_presents{ 0 }, m_redraws{ 0 };
+        std::atomic<uint64_t> m_losses{ 0 }, m_recoveries{ 0 }, m_recoveryAttempts{ 0 };
+        std::atomic<uint64_t> m_lastRecoverNs{ 0 }, m_maxRecoverNs{ 0 };
+
+        // Registry mirrors of the stats (null until BindMetrics)
+        struct BoundMetrics
+        {
+            metrics::Counter* frames{ nullptr };
+            metrics::Counter* timeouts{ nullptr };
+            metrics::Counter* failures{ nullptr };
+            metrics::Counter* renders{ nullptr };
+            metrics::Counter* presents{ nullptr };
+            metrics::Counter* redraws{ nullptr };
+            metrics::Counter* bytesCopied{ nullptr };
+            metrics::Counter* losses{ nullptr };
+            metrics::Counter* recoveries{ nullptr };
+            metrics::Gauge* refreshHz{ nullptr };
+            metrics::Histogram* recoverTime{ nullptr };
+        } m_metrics;
+    };
+}
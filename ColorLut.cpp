@@ -0,0 +1,78 @@
+#include "ColorLut.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Below this radius (in 0..1 RGB units, ~6 steps of the 65^3 lattice) use 129^3
+    constexpr float kFineToleranceRadius = 24.0f / 255.0f;
+
+    inline uint16_t ToUnorm16(float v)
+    {
+        v = (v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f;
+        return static_cast<uint16_t>(v * 65535.0f + 0.5f);
+    }
+}
+
+uint32_t ColorLut::ChooseSize(const EffectKernel& kernel)
+{
+    if (kernel.GetConstants().enableColorMap == 0) return kSmallSize;
+    const float r = kernel.GetColorMaps().MinRadius();
+    return (r > 0.0f && r < kFineToleranceRadius) ? kLargeSize : kSmallSize;
+}
+
+void ColorLut::Bake(const EffectKernel& kernel, uint32_t size)
+{
+    size = std::max(2u, size);
+    m_size = size;
+    m_texels.resize(size_t(size) * size * size * 4);
+
+    const float step = 1.0f / float(size - 1);
+    uint16_t* out = m_texels.data();
+    for (uint32_t b = 0; b < size; ++b)
+    {
+        for (uint32_t g = 0; g < size; ++g)
+        {
+            for (uint32_t r = 0; r < size; ++r, out += 4)
+            {
+                const float in[3] = { float(r) * step, float(g) * step, float(b) * step };
+                float shaded[3];
+                kernel.ShadePixel(in, shaded);
+                out[0] = ToUnorm16(shaded[0]);
+                out[1] = ToUnorm16(shaded[1]);
+                out[2] = ToUnorm16(shaded[2]);
+                out[3] = 65535;
+            }
+        }
+    }
+}
+
+void ColorLut::Sample(const float in[3], float out[3]) const
+{
+    if (m_size < 2) { out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; return; }
+
+    const float maxIndex = float(m_size - 1);
+    uint32_t i0[3], i1[3];
+    float f[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        const float x = std::clamp(in[c], 0.0f, 1.0f) * maxIndex;
+        const float fl = std::floor(x);
+        i0[c] = static_cast<uint32_t>(fl);
+        i1[c] = std::min(i0[c] + 1, m_size - 1);
+        f[c] = x - fl;
+    }
+
+    auto texel = [this](uint32_t r, uint32_t g, uint32_t b, int c) {
+        return float(m_texels[((size_t(b) * m_size + g) * m_size + r) * 4 + c]) / 65535.0f;
+    };
+    for (int c = 0; c < 3; ++c)
+    {
+        const float c00 = texel(i0[0], i0[1], i0[2], c) + f[0] * (texel(i1[0], i0[1], i0[2], c) - texel(i0[0], i0[1], i0[2], c));
+        const float c10 = texel(i0[0], i1[1], i0[2], c) + f[0] * (texel(i1[0], i1[1], i0[2], c) - texel(i0[0], i1[1], i0[2], c));
+        const float c01 = texel(i0[0], i0[1], i1[2], c) + f[0] * (texel(i1[0], i0[1], i1[2], c) - texel(i0[0], i0[1], i1[2], c));
+        const float c11 = texel(i0[0], i1[1], i1[2], c) + f[0] * (texel(i1[0], i1[1], i1[2], c) - texel(i0[0], i1[1], i1[2], c));
+        const float c0 = c00 + f[1] * (c10 - c00);
+        const float c1 = c01 + f[1] * (c11 - c01);
+        out[c] = c0 + f[2] * (c1 - c0);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "EffectKernel.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Precomputed 3D RGB lattice of the full kPS chain (invert, matrix, color maps).
+// Baked on the CPU with EffectKernel whenever the effect changes so the pixel
+// shader replaces the per-pixel color-map loop with one trilinear lookup.
+// Trilinear filtering rounds off each map's peak and blurs the hard edges where
+// overlapping maps take over from one another, so the LUT is only used for map
+// sets the constant buffer cannot hold; smaller sets run the exact loop.
+class ColorLut
+{
+public:
+    static constexpr uint32_t kSmallSize = 65;
+    static constexpr uint32_t kLargeSize = 129;
+
+    // True when enabledMaps enabled maps need the LUT: past kMaxColorMaps the
+    // constant buffer cannot carry the list for the exact loop.
+    static bool Needed(uint32_t enabledMaps) { return enabledMaps > kMaxColorMaps; }
+
+    // Lattice size for the given constants: small tolerances need the finer lattice
+    // so their falloff spans enough cells to interpolate well.
+    static uint32_t ChooseSize(const EffectKernel& kernel);
+
+    // Evaluate the kernel at every lattice point (size^3 evaluations).
+    void Bake(const EffectKernel& kernel, uint32_t size);
+
+    uint32_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+
+    // RGBA16 UNORM texels, red fastest then green then blue (Texture3D x/y/z).
+    const uint16_t* Data() const { return m_texels.data(); }
+    uint32_t RowPitch() const { return m_size * 4u * uint32_t(sizeof(uint16_t)); }
+    uint32_t SlicePitch() const { return RowPitch() * m_size; }
+
+    // Texture coordinate mapping for texel-center addressing: uvw = rgb * Scale() + Bias()
+    float Scale() const { return m_size ? float(m_size - 1) / float(m_size) : 1.0f; }
+    float Bias() const { return m_size ? 0.5f / float(m_size) : 0.0f; }
+
+    // CPU trilinear lookup with the same addressing as the GPU sampler.
+    void Sample(const float in[3], float out[3]) const;
+
+private:
+    uint32_t m_size{ 0 };
+    std::vector<uint16_t> m_texels;
+};
@@ -0,0 +1,140 @@
+#include "ColorMapIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Matches the shader's "t2 > 1e-12" guard: smaller spheres never match
+    constexpr float kMinT2 = 1e-12f;
+    // Finest grid (32^3 cells); cells around half the typical radius keep lists short
+    // while the cell table still fits in cache
+    constexpr uint32_t kMaxGrid = 32;
+    // Cap on total cell entries so a few huge tolerances cannot blow up memory
+    constexpr size_t kMaxCellEntries = size_t(1) << 20;
+    // Sphere bounds are padded so float rounding at the rim never drops a candidate
+    constexpr float kBoundsPad = 1e-4f;
+}
+
+ColorMapItem ColorMapIndex::Prepare(const ColorMapEntry& e)
+{
+    ColorMapItem it{};
+    it.src[0] = e.srcR / 255.0f; it.src[1] = e.srcG / 255.0f; it.src[2] = e.srcB / 255.0f;
+    it.dst[0] = e.dstR / 255.0f; it.dst[1] = e.dstG / 255.0f; it.dst[2] = e.dstB / 255.0f;
+    const float t = std::max(0, std::min(255, e.tolerance)) / 255.0f;
+    it.t2 = t * t; // squared radius avoids a sqrt per test
+    return it;
+}
+
+void ColorMapIndex::Clear()
+{
+    m_items.clear();
+    m_grid = 0;
+    m_minRadius = 0.0f;
+    m_cellStart.clear();
+    m_cellItems.clear();
+}
+
+void ColorMapIndex::Build(const std::vector<ColorMapEntry>& maps)
+{
+    m_items.clear();
+    for (const auto& e : maps)
+    {
+        if (e.enabled) m_items.push_back(Prepare(e));
+    }
+    BuildGrid_();
+}
+
+void ColorMapIndex::Build(const PixelCB& cb)
+{
+    m_items.clear();
+    const uint32_t count = std::min(cb.colorMapCount, kMaxColorMaps);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ColorMapItem it{};
+        for (int c = 0; c < 3; ++c)
+        {
+            it.src[c] = cb.colorMapSrc[i][c];
+            it.dst[c] = cb.colorMapDst[i][c];
+        }
+        it.t2 = cb.colorMapSrc[i][3];
+        m_items.push_back(it);
+    }
+    BuildGrid_();
+}
+
+void ColorMapIndex::BuildGrid_()
+{
+    m_grid = 0;
+    m_minRadius = 0.0f;
+    m_cellStart.clear();
+    m_cellItems.clear();
+
+    std::vector<float> radii;
+    radii.reserve(m_items.size());
+    for (const auto& it : m_items)
+    {
+        if (it.t2 > kMinT2) radii.push_back(std::sqrt(it.t2));
+    }
+    if (radii.empty()) return;
+    m_minRadius = *std::min_element(radii.begin(), radii.end());
+
+    // Size cells to about half the median radius; small sets need no more than
+    // a few hundred cells per map
+    std::nth_element(radii.begin(), radii.begin() + radii.size() / 2, radii.end());
+    const float median = radii[radii.size() / 2];
+    const float byCount = std::ceil(std::cbrt(float(radii.size()) * 512.0f));
+    uint32_t grid = uint32_t(std::min({ float(kMaxGrid), byCount, std::ceil(2.0f / median) }));
+    grid = std::max(1u, grid);
+
+    // Per-item cell bounds for a given grid size
+    struct Bounds { uint32_t lo[3], hi[3]; };
+    std::vector<Bounds> bounds(m_items.size());
+    auto computeBounds = [&](uint32_t n) {
+        m_grid = n;
+        size_t total = 0;
+        for (size_t i = 0; i < m_items.size(); ++i)
+        {
+            const ColorMapItem& it = m_items[i];
+            Bounds& bd = bounds[i];
+            if (!(it.t2 > kMinT2)) { bd = Bounds{ { 1,1,1 }, { 0,0,0 } }; continue; }
+            const float r = std::sqrt(it.t2) * (1.0f + kBoundsPad) + kBoundsPad;
+            size_t cells = 1;
+            for (int c = 0; c < 3; ++c)
+            {
+                bd.lo[c] = CellOf_(it.src[c] - r);
+                bd.hi[c] = CellOf_(it.src[c] + r);
+                cells *= size_t(bd.hi[c] - bd.lo[c] + 1);
+            }
+            total += cells;
+        }
+        return total;
+    };
+    size_t total = computeBounds(grid);
+    while (total > kMaxCellEntries && grid > 1)
+    {
+        grid = std::max(1u, grid / 2);
+        total = computeBounds(grid);
+    }
+
+    // Counting pass, then fill in item order so each cell list stays ascending
+    const size_t cellCount = size_t(grid) * grid * grid;
+    m_cellStart.assign(cellCount + 1, 0);
+    for (const Bounds& bd : bounds)
+    {
+        for (uint32_t b = bd.lo[2]; b <= bd.hi[2] && bd.lo[0] <= bd.hi[0]; ++b)
+            for (uint32_t g = bd.lo[1]; g <= bd.hi[1]; ++g)
+                for (uint32_t r = bd.lo[0]; r <= bd.hi[0]; ++r)
+                    ++m_cellStart[(size_t(b) * grid + g) * grid + r + 1];
+    }
+    for (size_t c = 0; c < cellCount; ++c) m_cellStart[c + 1] += m_cellStart[c];
+
+    m_cellItems.resize(total);
+    std::vector<uint32_t> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (uint32_t i = 0; i < uint32_t(bounds.size()); ++i)
+    {
+        const Bounds& bd = bounds[i];
+        for (uint32_t b = bd.lo[2]; b <= bd.hi[2] && bd.lo[0] <= bd.hi[0]; ++b)
+            for (uint32_t g = bd.lo[1]; g <= bd.hi[1]; ++g)
+                for (uint32_t r = bd.lo[0]; r <= bd.hi[0]; ++r)
+                    m_cellItems[cursor[(size_t(b) * grid + g) * grid + r]++] = i;
+    }
+}
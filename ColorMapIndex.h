@@ -0,0 +1,66 @@
+#pragma once
+#include "EffectConstants.h"
+#include "EffectSettings.h"
+#include <cstdint>
+#include <vector>
+
+// One prepared color map in shader units: normalized source/destination RGB and
+// the squared tolerance radius (same packing as PixelCB.colorMapSrc/colorMapDst).
+struct ColorMapItem
+{
+    float src[3]{ 0,0,0 };
+    float t2{ 0.0f };
+    float dst[3]{ 0,0,0 };
+};
+
+// Uncapped color-map set bucketed into a uniform RGB grid. Each map is listed in
+// every cell its tolerance sphere touches, so a pixel only tests the maps of its
+// own cell instead of the whole list. Candidates keep list order, so the first
+// map wins ties exactly as in the shader's linear loop.
+class ColorMapIndex
+{
+public:
+    // Settings entry -> shader units (disabled entries are not converted)
+    static ColorMapItem Prepare(const ColorMapEntry& e);
+
+    void Clear();
+    // All enabled entries, no cap
+    void Build(const std::vector<ColorMapEntry>& maps);
+    // The first colorMapCount entries packed in the constants
+    void Build(const PixelCB& cb);
+
+    bool Empty() const { return m_items.empty(); }
+    uint32_t Size() const { return uint32_t(m_items.size()); }
+    const ColorMapItem& operator[](uint32_t i) const { return m_items[i]; }
+    uint32_t GridSize() const { return m_grid; }
+
+    // Smallest non-zero tolerance radius in the set (0 when none can match).
+    float MinRadius() const { return m_minRadius; }
+
+    // Indices (ascending) of the maps whose sphere may contain rgb. Values outside
+    // 0..1 resolve to the border cells, which cover every sphere reaching past the cube.
+    const uint32_t* Candidates(float r, float g, float b, uint32_t& count) const
+    {
+        if (m_grid == 0) { count = 0; return nullptr; }
+        const uint32_t cell = (CellOf_(b) * m_grid + CellOf_(g)) * m_grid + CellOf_(r);
+        const uint32_t begin = m_cellStart[cell];
+        count = m_cellStart[cell + 1] - begin;
+        return m_cellItems.data() + begin;
+    }
+
+private:
+    void BuildGrid_();
+    uint32_t CellOf_(float x) const
+    {
+        const float s = x * float(m_grid);
+        if (!(s > 0.0f)) return 0; // also catches NaN
+        if (s >= float(m_grid)) return m_grid - 1;
+        return uint32_t(s);
+    }
+
+    std::vector<ColorMapItem> m_items;
+    uint32_t m_grid{ 0 };
+    float m_minRadius{ 0.0f };
+    std::vector<uint32_t> m_cellStart; // grid^3 + 1 offsets into m_cellItems
+    std::vector<uint32_t> m_cellItems;
+};
@@ -0,0 +1,148 @@
+#include "DirtyRects.h"
+#include <algorithm>
+
+namespace {
+    // Merge two rects when their bounding box is at most this much larger than their
+    // combined area: one slightly larger copy beats two copy calls
+    constexpr float kMergeSlack = 1.25f;
+}
+
+bool Intersects(const PixelRect& a, const PixelRect& b)
+{
+    return !Intersection(a, b).Empty();
+}
+
+PixelRect Intersection(const PixelRect& a, const PixelRect& b)
+{
+    PixelRect r{};
+    r.left   = std::max(a.left,   b.left);
+    r.top    = std::max(a.top,    b.top);
+    r.right  = std::min(a.right,  b.right);
+    r.bottom = std::min(a.bottom, b.bottom);
+    return r;
+}
+
+PixelRect BoundingUnion(const PixelRect& a, const PixelRect& b)
+{
+    if (a.Empty()) return b;
+    if (b.Empty()) return a;
+    PixelRect r{};
+    r.left   = std::min(a.left,   b.left);
+    r.top    = std::min(a.top,    b.top);
+    r.right  = std::max(a.right,  b.right);
+    r.bottom = std::max(a.bottom, b.bottom);
+    return r;
+}
+
+void FrameDamage::Reset(int32_t width, int32_t height)
+{
+    m_width = std::max(0, width);
+    m_height = std::max(0, height);
+    m_full = false;
+    m_rects.clear();
+}
+
+void FrameDamage::MarkAll()
+{
+    m_full = true;
+    m_rects.clear();
+}
+
+void FrameDamage::AddDirty(const PixelRect& r)
+{
+    Add_(r);
+}
+
+void FrameDamage::AddMove(int32_t srcX, int32_t srcY, const PixelRect& dst)
+{
+    // The source is unchanged by the move; any later change there arrives as a dirty rect
+    (void)srcX; (void)srcY;
+    Add_(dst);
+}
+
+void FrameDamage::Add_(const PixelRect& r)
+{
+    if (m_full) return;
+    const PixelRect c = Intersection(r, Bounds());
+    if (!c.Empty()) m_rects.push_back(c);
+}
+
+void FrameDamage::Finalize(size_t maxRects, float fullFraction)
+{
+    if (m_full) return;
+
+    // Greedy merge of overlapping/touching rects that fit snugly in their bounding box.
+    // A grown rect is re-tested against the rest; one pass is enough for typical damage.
+    for (size_t i = 0; i < m_rects.size(); ++i)
+    {
+        for (size_t j = i + 1; j < m_rects.size(); ++j)
+        {
+            const PixelRect& a = m_rects[i];
+            const PixelRect& b = m_rects[j];
+            const bool touching = a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+            if (!touching) continue;
+            const PixelRect u = BoundingUnion(a, b);
+            if (float(u.Area()) > kMergeSlack * float(a.Area() + b.Area())) continue;
+            m_rects[i] = u;
+            m_rects.erase(m_rects.begin() + j);
+            j = i; // restart the scan for the grown rect
+        }
+    }
+
+    // Too many pieces: merge the pair whose bounding box grows the least
+    const size_t limit = std::max<size_t>(1, maxRects);
+    while (m_rects.size() > limit)
+    {
+        size_t bi = 0, bj = 1;
+        int64_t bestGrowth = INT64_MAX;
+        for (size_t i = 0; i < m_rects.size(); ++i)
+        {
+            for (size_t j = i + 1; j < m_rects.size(); ++j)
+            {
+                const int64_t growth = BoundingUnion(m_rects[i], m_rects[j]).Area() - m_rects[i].Area() - m_rects[j].Area();
+                if (growth < bestGrowth) { bestGrowth = growth; bi = i; bj = j; }
+            }
+        }
+        m_rects[bi] = BoundingUnion(m_rects[bi], m_rects[bj]);
+        m_rects.erase(m_rects.begin() + bj);
+    }
+
+    const int64_t total = int64_t(m_width) * int64_t(m_height);
+    if (total > 0 && float(DamagedArea()) >= fullFraction * float(total)) MarkAll();
+}
+
+int64_t FrameDamage::DamagedArea() const
+{
+    if (m_full) return Bounds().Area();
+    // Upper bound (overlaps counted twice); only used for the copy-vs-full decision
+    int64_t sum = 0;
+    for (const auto& r : m_rects) sum += r.Area();
+    return sum;
+}
+
+bool FrameDamage::Intersects(const PixelRect& region) const
+{
+    if (m_full) return ::Intersects(region, Bounds());
+    for (const auto& r : m_rects)
+    {
+        if (::Intersects(r, region)) return true;
+    }
+    return false;
+}
+
+size_t FrameDamage::ClipTo(const PixelRect& region, std::vector<PixelRect>& out) const
+{
+    const size_t before = out.size();
+    if (m_full)
+    {
+        const PixelRect c = Intersection(region, Bounds());
+        if (!c.Empty()) out.push_back(c);
+        return out.size() - before;
+    }
+    for (const auto& r : m_rects)
+    {
+        const PixelRect c = Intersection(r, region);
+        if (!c.Empty()) out.push_back(c);
+    }
+    return out.size() - before;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Output-local pixel rectangle, half-open like RECT/D3D11_BOX (right/bottom exclusive).
+// Kept free of Windows headers so the bookkeeping builds and runs on any platform.
+struct PixelRect
+{
+    int32_t left{ 0 }, top{ 0 }, right{ 0 }, bottom{ 0 };
+
+    bool Empty() const { return right <= left || bottom <= top; }
+    int64_t Area() const { return Empty() ? 0 : int64_t(right - left) * int64_t(bottom - top); }
+};
+
+bool Intersects(const PixelRect& a, const PixelRect& b);
+PixelRect Intersection(const PixelRect& a, const PixelRect& b);
+PixelRect BoundingUnion(const PixelRect& a, const PixelRect& b);
+
+// Damage accumulated for one acquired desktop frame: dirty rects plus move-rect
+// destinations, clipped to the output and merged into a short copy list.
+// Move rects are replayed as damage at their destination: the acquired surface
+// already holds the moved pixels, so copying the destination from it brings the
+// retained frame up to date without a GPU self-copy.
+class FrameDamage
+{
+public:
+    // Start a frame for an output of the given size (empty damage).
+    void Reset(int32_t width, int32_t height);
+    // Whole output changed (first frame, lost metadata, mode change).
+    void MarkAll();
+
+    void AddDirty(const PixelRect& r);
+    // DXGI_OUTDUPL_MOVE_RECT: pixels at (srcX, srcY) moved to dst.
+    void AddMove(int32_t srcX, int32_t srcY, const PixelRect& dst);
+
+    // Merge overlapping rects when the bounding box wastes little area, then collapse
+    // the cheapest pairs until at most maxRects remain. Escalates to a full-frame copy
+    // when the damaged area exceeds fullFraction of the output.
+    void Finalize(size_t maxRects, float fullFraction);
+
+    bool IsFull() const { return m_full; }
+    bool IsEmpty() const { return !m_full && m_rects.empty(); }
+    const std::vector<PixelRect>& Rects() const { return m_rects; }
+    int64_t DamagedArea() const;
+    PixelRect Bounds() const { return PixelRect{ 0, 0, m_width, m_height }; }
+
+    // True when any damage touches region (output-local).
+    bool Intersects(const PixelRect& region) const;
+    // Damage clipped to region; returns the number of rects appended to out.
+    size_t ClipTo(const PixelRect& region, std::vector<PixelRect>& out) const;
+
+private:
+    void Add_(const PixelRect& r);
+
+    int32_t m_width{ 0 }, m_height{ 0 };
+    bool m_full{ false };
+    std::vector<PixelRect> m_rects;
+};
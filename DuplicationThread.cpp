@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "Log.h"
+#include "FrameTrace.h"
 #include "DuplicationThread.h"
+#include "DxgiFrameSource.h"
 #include "Subscription.h"
 #include "EffectWindow.h"
 #include <wrl.h>
@@ -14,6 +16,7 @@
 #include <chrono>
 
 using Microsoft::WRL::ComPtr;
+namespace frametrace = winvert4::frametrace;
 
 namespace {
 static LRESULT CALLBACK MirrorWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -132,6 +135,14 @@ static bool ProbeTexturePatch(
     outSum = sum; outMin = vmin; outMax = vmax;
     return true;
 }
+
+// Subscription regions are in desktop coordinates; damage is output-local
+static PixelRect RegionToOutput(const RECT& region, const RECT& outputRect)
+{
+    return PixelRect{
+        int32_t(region.left   - outputRect.left), int32_t(region.top    - outputRect.top),
+        int32_t(region.right  - outputRect.left), int32_t(region.bottom - outputRect.top) };
+}
 } // namespace
 
 // ===== DuplicationThread (implementation aligned with DuplicationThread.h) =====
@@ -145,7 +156,7 @@ DuplicationThread::DuplicationThread(IDXGIAdapter1* adapter, IDXGIOutput1* outpu
     if (m_output) {
         if (SUCCEEDED(m_output->GetDesc(&outDesc))) {
             m_outputRect = outDesc.DesktopCoordinates;
-            winvert4::Logf("DT: ctor output rect=(%ld,%ld,%ld,%ld)",
+            WINVERT_INFO(DT, "DT: ctor output rect=(%ld,%ld,%ld,%ld)",
                 m_outputRect.left, m_outputRect.top, m_outputRect.right, m_outputRect.bottom);
         }
     }
@@ -164,10 +175,10 @@ DuplicationThread::DuplicationThread(IDXGIAdapter1* adapter, IDXGIOutput1* outpu
                                    flags, fls, _countof(fls),
                                    D3D11_SDK_VERSION, &m_device, &flOut, &m_context);
     if (FAILED(hr)) {
-        winvert4::Logf("DT: device create FAILED hr=0x%08X", hr);
+        WINVERT_WARN(DT, "DT: device create FAILED hr=0x%08X", hr);
         return;
     }
-    winvert4::Logf("DT: device/context created featureLevel=0x%X", flOut);
+    WINVERT_INFO(DT, "DT: device/context created featureLevel=0x%X", flOut);
 }
 
 DuplicationThread::~DuplicationThread()
@@ -184,10 +195,7 @@ void DuplicationThread::Run()
 void DuplicationThread::Stop()
 {
     if (!m_isRunning.exchange(false)) return;
-    {
-        std::lock_guard<std::mutex> lk(m_subMutex);
-        m_subCv.notify_all();
-    }
+    m_loop.Stop();
     if (m_thread.joinable()) m_thread.join();
     
 #if defined(_DEBUG) && defined(WINVERT_OBS_MIRROR)
@@ -199,123 +207,61 @@ void DuplicationThread::Stop()
     m_mirrorFactory.Reset();
 #endif
     
-    m_duplication.Reset();
-    m_fullTexture.Reset();
+    m_source.reset();
     m_context.Reset();
     m_device.Reset();
 }
 
 void DuplicationThread::AddSubscription(const Subscription& sub)
 {
-    std::lock_guard<std::mutex> lk(m_subMutex);
-    m_subscriptions.push_back(sub);
-    winvert4::Logf("DT: AddSubscription sub=%p rect=(%ld,%ld,%ld,%ld) count=%zu",
-        sub.Subscriber, sub.Region.left, sub.Region.top, sub.Region.right, sub.Region.bottom, m_subscriptions.size());
-    m_subCv.notify_all();
+    // Subscribers are EffectWindows; the loop drives them through IFrameSink
+    m_loop.AddSubscriber(static_cast<EffectWindow*>(sub.Subscriber), RegionToOutput(sub.Region, m_outputRect));
+    WINVERT_INFO(DT, "DT: AddSubscription sub=%p rect=(%ld,%ld,%ld,%ld) count=%zu",
+        sub.Subscriber, sub.Region.left, sub.Region.top, sub.Region.right, sub.Region.bottom, m_loop.SubscriberCount());
 }
 
 void DuplicationThread::RemoveSubscriber(ISubscriber* sub)
 {
-    std::lock_guard<std::mutex> lk(m_subMutex);
-    m_subscriptions.erase(
-        std::remove_if(m_subscriptions.begin(), m_subscriptions.end(),
-            [sub](const Subscription& s) { return s.Subscriber == sub; }),
-        m_subscriptions.end());
+    m_loop.RemoveSubscriber(static_cast<EffectWindow*>(sub));
 }
 
-void DuplicationThread::RequestRedraw()
+float DuplicationThread::GetOutputHz() const
 {
-    // Try to present effects immediately for ~32 cycles (~32ms at 1ms wait)
-    m_redrawCountdown.store(32, std::memory_order_relaxed);
+    const winvert4::RefreshEstimator::Estimate est = m_loop.GetRefreshEstimate();
+    return est.valid ? est.hz : m_outputHz.load(std::memory_order_relaxed);
+}
+
+void DuplicationThread::RequestRedraw(ISubscriber* sub, uint64_t settingsGen)
+{
+    m_loop.RequestRedraw(static_cast<EffectWindow*>(sub), settingsGen);
+}
+
+void DuplicationThread::RequestRedrawAt(ISubscriber* sub, uint64_t dueNs)
+{
+    m_loop.RequestRedrawAt(static_cast<EffectWindow*>(sub), dueNs);
 }
 
 void DuplicationThread::ThreadProc()
 {
     if (!m_output || !m_device) return;
 
-    // Create duplication
-    ComPtr<IDXGIOutputDuplication> dupl;
-    HRESULT hr = m_output->DuplicateOutput(m_device.Get(), &dupl);
-    if (FAILED(hr)) {
-        winvert4::Logf("DT: DuplicateOutput failed hr=0x%08X", hr);
-        return;
-    }
-    m_duplication = dupl;
-
-    // Describe duplication
-    DXGI_OUTDUPL_DESC dd{};
-    m_duplication->GetDesc(&dd);
-    winvert4::Logf("DT: desc: Mode=%ux%u fmt=%u Rot=%u",
-        dd.ModeDesc.Width, dd.ModeDesc.Height, dd.ModeDesc.Format, dd.Rotation);
-    // Cache monitor refresh rate if available
-    if (dd.ModeDesc.RefreshRate.Denominator != 0)
-    {
-        m_outputHz = static_cast<float>(double(dd.ModeDesc.RefreshRate.Numerator) / double(dd.ModeDesc.RefreshRate.Denominator));
-        // Snap to common rates
-        if (m_outputHz > 23.9f && m_outputHz < 24.1f) m_outputHz = 24.0f;
-        else if (m_outputHz > 29.9f && m_outputHz < 30.1f) m_outputHz = 30.0f;
-        else if (m_outputHz > 47.9f && m_outputHz < 48.1f) m_outputHz = 48.0f;
-        else if (m_outputHz > 59.0f && m_outputHz < 60.5f) m_outputHz = 60.0f;
-        else if (m_outputHz > 71.0f && m_outputHz < 72.5f) m_outputHz = 72.0f;
-        else if (m_outputHz > 119.0f && m_outputHz < 121.0f) m_outputHz = 120.0f;
-        else if (m_outputHz > 143.0f && m_outputHz < 145.0f) m_outputHz = 144.0f;
-        else if (m_outputHz > 159.0f && m_outputHz < 161.0f) m_outputHz = 160.0f;
-    }
-    else if (m_outputHz <= 0.0f)
     {
-        m_outputHz = 60.0f; // sensible default
-    }
-
-    // Create full-frame texture to copy into
-    D3D11_TEXTURE2D_DESC texDesc{};
-    texDesc.Width = dd.ModeDesc.Width;
-    texDesc.Height = dd.ModeDesc.Height;
-    texDesc.MipLevels = 1;
-    texDesc.ArraySize = 1;
-    texDesc.Format = dd.ModeDesc.Format; // usually BGRA8 (87)
-    texDesc.SampleDesc.Count = 1;
-    texDesc.Usage = D3D11_USAGE_DEFAULT;
-    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    texDesc.CPUAccessFlags = 0;
-    texDesc.MiscFlags = 0;
-    m_device->CreateTexture2D(&texDesc, nullptr, &m_fullTexture);
-    if (m_fullTexture) {
-        winvert4::Logf("DT: full-frame texture created %ux%u", texDesc.Width, texDesc.Height);
-    } else {
-        winvert4::Log("DT: full-frame texture creation FAILED");
+        char traceName[48];
+        snprintf(traceName, sizeof(traceName), "DT %ld,%ld", m_outputRect.left, m_outputRect.top);
+        frametrace::Recorder::Global().SetThreadName(traceName);
+        char metricPrefix[48];
+        snprintf(metricPrefix, sizeof(metricPrefix), "capture.%ld,%ld", m_outputRect.left, m_outputRect.top);
+        m_loop.BindMetrics(winvert4::metrics::Registry::Global(), metricPrefix);
     }
 
-    // Warm-up: try to capture one frame up front so first subscriber can render
-    // immediately without waiting for a random desktop update cadence.
-    {
-        DXGI_OUTDUPL_FRAME_INFO fi{};
-        ComPtr<IDXGIResource> res;
-        HRESULT hrWarm = m_duplication->AcquireNextFrame(250, &fi, &res);
-        if (SUCCEEDED(hrWarm))
-        {
-            ComPtr<ID3D11Texture2D> frameTex;
-            res.As(&frameTex);
-            if (frameTex && m_fullTexture)
-            {
-                m_context->CopyResource(m_fullTexture.Get(), frameTex.Get());
-                winvert4::Log("DT: warm-up frame captured");
-            }
-            m_duplication->ReleaseFrame();
-        }
-        else if (hrWarm == DXGI_ERROR_WAIT_TIMEOUT)
-        {
-            winvert4::Log("DT: warm-up frame timeout");
-        }
-        else
-        {
-            winvert4::Logf("DT: warm-up AcquireNextFrame failed hr=0x%08X", hrWarm);
-        }
-    }
+    m_source = std::make_unique<DxgiFrameSource>(m_device.Get(), m_context.Get(), m_output.Get());
+    if (!m_source->Start()) return;
+    m_outputHz.store(m_source->RefreshHz(), std::memory_order_relaxed);
 
 #if defined(_DEBUG) && defined(WINVERT_OBS_MIRROR)
     if (m_enableMirror)
     {
-        winvert4::Log("DT: mirror creation requested for this output");
+        WINVERT_DEBUG(DT, "DT: mirror creation requested for this output");
         DXGI_OUTPUT_DESC outputDesc{};
         if (SUCCEEDED(m_output->GetDesc(&outputDesc)))
         {
@@ -356,7 +302,7 @@ void DuplicationThread::ThreadProc()
                 nullptr, nullptr, GetModuleHandleW(nullptr), nullptr);
 
             if (!m_mirrorHwnd) {
-                winvert4::Logf("DT: mirror window creation FAILED err=%u", GetLastError());
+                WINVERT_WARN(DT, "DT: mirror window creation FAILED err=%u", GetLastError());
             }
             else {
                 // Force the mirror to be a true top-level app window and visible to shell enumeration.
@@ -374,13 +320,13 @@ void DuplicationThread::ThreadProc()
                 SetWindowPos(m_mirrorHwnd, HWND_TOP, mirrorWindowLeft, mirrorWindowTop,
                     mirrorWindowWidth, mirrorWindowHeight,
                     SWP_SHOWWINDOW | SWP_NOACTIVATE);
-                winvert4::Logf("DT: mirror window HWND=%p created and shown", m_mirrorHwnd);
+                WINVERT_DEBUG(DT, "DT: mirror window HWND=%p created and shown", m_mirrorHwnd);
                 ComPtr<IDXGIDevice> dxgiDevice;
                 if (SUCCEEDED(m_device.As(&dxgiDevice))) {
                     ComPtr<IDXGIAdapter> dxgiAdapter;
                     if (SUCCEEDED(dxgiDevice->GetAdapter(&dxgiAdapter))) {
                         if (FAILED(dxgiAdapter->GetParent(IID_PPV_ARGS(&m_mirrorFactory)))) {
-                            winvert4::Log("DT: mirror factory query FAILED; trying CreateDXGIFactory2 fallback");
+                            WINVERT_WARN(DT, "DT: mirror factory query FAILED; trying CreateDXGIFactory2 fallback");
                         }
                     }
                 }
@@ -388,12 +334,12 @@ void DuplicationThread::ThreadProc()
                 if (!m_mirrorFactory) {
                     HRESULT hrFactory = CreateDXGIFactory2(0, IID_PPV_ARGS(&m_mirrorFactory));
                     if (FAILED(hrFactory)) {
-                        winvert4::Logf("DT: CreateDXGIFactory2 fallback FAILED hr=0x%08X", hrFactory);
+                        WINVERT_WARN(DT, "DT: CreateDXGIFactory2 fallback FAILED hr=0x%08X", hrFactory);
                     }
                 }
 
                 if (!m_mirrorFactory) {
-                    winvert4::Log("DT: mirror factory is not available");
+                    WINVERT_WARN(DT, "DT: mirror factory is not available");
                 }
 
                 if (m_mirrorFactory) {
@@ -410,157 +356,96 @@ void DuplicationThread::ThreadProc()
                     HRESULT hrMirror = m_mirrorFactory->CreateSwapChainForHwnd(
                         m_device.Get(), m_mirrorHwnd, &sd, nullptr, nullptr, &m_mirrorSwapChain);
                     if (FAILED(hrMirror)) {
-                        winvert4::Logf("DT: mirror swapchain create failed hr=0x%08X", hrMirror);
+                        WINVERT_WARN(DT, "DT: mirror swapchain create failed hr=0x%08X", hrMirror);
                         ShowWindow(m_mirrorHwnd, SW_SHOW);
                         UpdateWindow(m_mirrorHwnd);
-                        winvert4::Log("DT: mirror window shown without swapchain");
+                        WINVERT_WARN(DT, "DT: mirror window shown without swapchain");
                     } else {
                         ShowWindow(m_mirrorHwnd, SW_SHOWMAXIMIZED);
                         UpdateWindow(m_mirrorHwnd);
-                        winvert4::Log("DT: early debug mirror window created");
+                        WINVERT_DEBUG(DT, "DT: early debug mirror window created");
                     }
                 }
             }
         }
         else
         {
-            winvert4::Log("DT: mirror output GetDesc FAILED");
+            WINVERT_WARN(DT, "DT: mirror output GetDesc FAILED");
         }
     }
 #endif
 
     // Frame loop
-    while (m_isRunning) {
+    winvert4::CaptureLoop::Hooks hooks;
 #if defined(_DEBUG) && defined(WINVERT_OBS_MIRROR)
-        if (m_mirrorHwnd) {
+    if (m_mirrorSwapChain && m_mirrorHwnd) {
+        hooks.runWithoutSubscribers = true;
+        hooks.beforeAcquire = [this] {
             MSG msg;
             while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) {
                 TranslateMessage(&msg);
                 DispatchMessageW(&msg);
             }
-        }
-#endif
-        {
-            std::unique_lock<std::mutex> lk(m_subMutex);
-            if (m_subscriptions.empty())
-            {
-                bool hasMirror = false;
-#if defined(_DEBUG) && defined(WINVERT_OBS_MIRROR)
-                hasMirror = (m_mirrorSwapChain && m_mirrorHwnd);
+        };
+        hooks.afterFrame = [this](const FrameDamage& damage, bool anyPresented, const std::vector<winvert4::CaptureLoop::Subscriber>& subs) {
+            // Raw unprocessed output with effect overlay; unchanged frames are skipped
+            if (anyPresented || !damage.IsEmpty()) PresentMirror_(subs);
+        };
+    }
 #endif
-                if (!hasMirror)
-                {
-                    m_subCv.wait_for(lk, std::chrono::milliseconds(50), [this] { return !m_isRunning || !m_subscriptions.empty(); });
-                    if (!m_isRunning) break;
-                    if (m_subscriptions.empty()) continue;
-                }
-            }
-        }
+    hooks.onLost = [this] {
+        WINVERT_WARN(DT, "DT: duplication access lost on output (%ld,%ld); recreating", m_outputRect.left, m_outputRect.top);
+    };
+    hooks.onRecovered = [this](uint64_t recoverNs, uint32_t attempts) {
+        m_outputHz.store(m_source->RefreshHz(), std::memory_order_relaxed);
+        WINVERT_INFO(DT, "DT: duplication recreated after %.1f ms (%u attempts), %dx%d @ %.2f Hz",
+            double(recoverNs) / 1e6, attempts, m_source->Width(), m_source->Height(), m_source->RefreshHz());
+    };
+    m_loop.SetHooks(std::move(hooks));
+    m_loop.Run(*m_source);
+}
 
-        DXGI_OUTDUPL_FRAME_INFO fi{};
-        ComPtr<IDXGIResource> res;
-        const UINT waitMs = (m_redrawCountdown.load(std::memory_order_relaxed) > 0) ? 1u : 16u;
-        HRESULT hrAcq = m_duplication->AcquireNextFrame(waitMs, &fi, &res);
-        if (hrAcq == DXGI_ERROR_WAIT_TIMEOUT) {
-            // No new desktop frame. If a redraw was requested (settings changed),
-            // render using the last captured texture so changes appear immediately.
-            int cnt = m_redrawCountdown.load(std::memory_order_relaxed);
-            if (cnt > 0 && m_fullTexture) {
-                winvert4::Logf("DT: timeout; redraw cnt=%d using last texture", cnt);
-                std::vector<Subscription> subsCopy;
-                {
-                    std::lock_guard<std::mutex> lk(m_subMutex);
-                    subsCopy = m_subscriptions;
-                }
-                winvert4::Logf("DT: timeout; rendering to %zu subscribers", subsCopy.size());
-                for (auto& s : subsCopy) {
-                    if (s.Subscriber) {
-                        winvert4::Logf("DT: timeout; Render -> %p", s.Subscriber);
-                        static_cast<EffectWindow*>(s.Subscriber)->Render(m_fullTexture.Get(), 0ULL);
-                    }
-                }
-                m_redrawCountdown.store(cnt - 1, std::memory_order_relaxed);
-            } else if (cnt > 0 && !m_fullTexture) {
-                winvert4::Log("DT: timeout; requested redraw but no fullTexture yet");
+#if defined(_DEBUG) && defined(WINVERT_OBS_MIRROR)
+void DuplicationThread::PresentMirror_(const std::vector<winvert4::CaptureLoop::Subscriber>& subs)
+{
+    ID3D11Texture2D* fullTexture = m_source ? m_source->GetSharedTexture() : nullptr;
+    if (!fullTexture) return;
+    frametrace::TraceScope ts(frametrace::Stage::Mirror);
+    ComPtr<ID3D11Texture2D> mirrorBackBuf;
+    if (SUCCEEDED(m_mirrorSwapChain->GetBuffer(0, IID_PPV_ARGS(&mirrorBackBuf))) && mirrorBackBuf) {
+        m_context->CopyResource(mirrorBackBuf.Get(), fullTexture);
+
+        ComPtr<ID3D11Texture2D> effectTex;
+        RECT effectRect{};
+        for (auto& s : subs) {
+            if (!s.sink) continue;
+            auto* ew = static_cast<EffectWindow*>(s.sink);
+            effectTex = ew->GetLastRenderedTexture();
+            if (effectTex) {
+                effectRect = ew->GetDesktopRect();
+                break;
             }
-            continue;
         }
-        if (FAILED(hrAcq)) {
-            winvert4::Logf("DT: AcquireNextFrame failed hr=0x%08X", hrAcq);
-            if (hrAcq == DXGI_ERROR_ACCESS_LOST) break;
-            continue;
-        }
-
-        ComPtr<ID3D11Texture2D> frameTex;
-        res.As(&frameTex);
 
-        if (frameTex && m_fullTexture) {
-            // Copy frame into our shared texture
-            winvert4::Log("DT: frame acquired; copying to full texture");
-            m_context->CopyResource(m_fullTexture.Get(), frameTex.Get());
-            // Always notify subscribers so effect changes present even if captured pixels are unchanged.
+        if (effectTex) {
+            D3D11_TEXTURE2D_DESC srcDesc{};
+            effectTex->GetDesc(&srcDesc);
+            D3D11_BOX srcBox{ 0, 0, 0, srcDesc.Width, srcDesc.Height, 1 };
+            LONG dstX = effectRect.left - m_outputRect.left;
+            LONG dstY = effectRect.top  - m_outputRect.top;
+            m_context->CopySubresourceRegion(
+                mirrorBackBuf.Get(), 0,
+                dstX, dstY, 0,
+                effectTex.Get(), 0,
+                &srcBox);
         }
 
-        // Render to all subscribers on this thread
-        std::vector<Subscription> subsCopy;
-        if (m_fullTexture) {
-            {
-                std::lock_guard<std::mutex> lk(m_subMutex);
-                subsCopy = m_subscriptions;
-            }
-            winvert4::Logf("DT: rendering to %zu subscribers; LastPresentQpc=%llu", subsCopy.size(), fi.LastPresentTime.QuadPart);
-            for (auto& s : subsCopy) {
-                if (s.Subscriber) {
-                    // Cast and call the new Render method
-                    winvert4::Logf("DT: Render -> %p", s.Subscriber);
-                    static_cast<EffectWindow*>(s.Subscriber)->Render(m_fullTexture.Get(), fi.LastPresentTime.QuadPart);
-                }
-            }
-            m_redrawCountdown.store(0, std::memory_order_relaxed);
-        }
-
-#if defined(_DEBUG) && defined(WINVERT_OBS_MIRROR)
-        // Render to mirror window (raw unprocessed output with effect overlay)
-        if (m_mirrorSwapChain && m_mirrorHwnd && m_fullTexture) {
-            ComPtr<ID3D11Texture2D> mirrorBackBuf;
-            if (SUCCEEDED(m_mirrorSwapChain->GetBuffer(0, IID_PPV_ARGS(&mirrorBackBuf))) && mirrorBackBuf) {
-                m_context->CopyResource(mirrorBackBuf.Get(), m_fullTexture.Get());
-
-                ComPtr<ID3D11Texture2D> effectTex;
-                RECT effectRect{};
-                for (auto& s : subsCopy) {
-                    if (!s.Subscriber) continue;
-                    auto* ew = static_cast<EffectWindow*>(s.Subscriber);
-                    effectTex = ew->GetLastRenderedTexture();
-                    if (effectTex) {
-                        effectRect = ew->GetDesktopRect();
-                        break;
-                    }
-                }
-
-                if (effectTex) {
-                    D3D11_TEXTURE2D_DESC srcDesc{};
-                    effectTex->GetDesc(&srcDesc);
-                    D3D11_BOX srcBox{ 0, 0, 0, srcDesc.Width, srcDesc.Height, 1 };
-                    LONG dstX = effectRect.left - m_outputRect.left;
-                    LONG dstY = effectRect.top  - m_outputRect.top;
-                    m_context->CopySubresourceRegion(
-                        mirrorBackBuf.Get(), 0,
-                        dstX, dstY, 0,
-                        effectTex.Get(), 0,
-                        &srcBox);
-                }
-
-                HRESULT hrPresent = m_mirrorSwapChain->Present(1, 0);
-                if (FAILED(hrPresent)) {
-                    winvert4::Logf("DT: mirror Present failed hr=0x%08X", hrPresent);
-                }
-            } else {
-                winvert4::Log("DT: mirror GetBuffer failed");
-            }
+        HRESULT hrPresent = m_mirrorSwapChain->Present(1, 0);
+        if (FAILED(hrPresent)) {
+            WINVERT_WARN(DT, "DT: mirror Present failed hr=0x%08X", hrPresent);
         }
-#endif
-
-        m_duplication->ReleaseFrame();
+    } else {
+        WINVERT_WARN(DT, "DT: mirror GetBuffer failed");
     }
 }
+#endif
@@ -1,6 +1,10 @@
 #pragma once
 #include "pch.h"
 #include "Subscription.h"
+#include "CaptureLoop.h"
+#include <memory>
+
+class DxgiFrameSource;
 
 class DuplicationThread
 {
@@ -13,31 +17,36 @@ public:
 
     void AddSubscription(const Subscription& sub);
     void RemoveSubscriber(ISubscriber* sub);
-    void RequestRedraw();
+    // Re-render sub from the last frame once; settingsGen (0 = unconditional) lets
+    // repeated requests for a generation already on screen be dropped
+    void RequestRedraw(ISubscriber* sub, uint64_t settingsGen = 0);
+    // Redraw sub at or after dueNs (winvert4::metrics::NowNs())
+    void RequestRedrawAt(ISubscriber* sub, uint64_t dueNs);
     const RECT& GetOutputRect() const { return m_outputRect; }
-    float GetOutputHz() const { return m_outputHz; }
+    // Measured panel refresh once enough frames were seen, else the mode's nominal rate
+    float GetOutputHz() const;
+    winvert4::RefreshEstimator::Estimate GetRefreshEstimate() const { return m_loop.GetRefreshEstimate(); }
     ID3D11Device* GetDevice() { return m_device.Get(); }
 
 private:
     void ThreadProc();
+#if defined(_DEBUG) && defined(WINVERT_OBS_MIRROR)
+    void PresentMirror_(const std::vector<winvert4::CaptureLoop::Subscriber>& subs);
+#endif
 
     std::thread m_thread;
     std::atomic<bool> m_isRunning = false;
 
     RECT m_outputRect{};
-    float m_outputHz{ 0.0f };
+    std::atomic<float> m_outputHz{ 0.0f };  // nominal; updated when capture is recreated
     ::Microsoft::WRL::ComPtr<ID3D11Device> m_device;
     ::Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_context;
     ::Microsoft::WRL::ComPtr<IDXGIOutput1> m_output;
-    ::Microsoft::WRL::ComPtr<IDXGIOutputDuplication> m_duplication;
-
-    std::vector<Subscription> m_subscriptions;
-    std::mutex m_subMutex;
-    std::condition_variable m_subCv;
-    // Shared full-frame texture for this output (sampled by all subscribers)
-    ::Microsoft::WRL::ComPtr<ID3D11Texture2D> m_fullTexture;
-    // Countdown of forced redraw attempts when no new desktop frames arrive.
-    std::atomic<int> m_redrawCountdown{ 0 };
+
+    // Desktop Duplication for this output (created on the capture thread)
+    std::unique_ptr<DxgiFrameSource> m_source;
+    // Acquire/copy/fan-out loop; owns the subscribers, redraw requests and recovery
+    winvert4::CaptureLoop m_loop;
 
     bool m_enableMirror{ false };
     HWND m_mirrorHwnd{ nullptr };
@@ -0,0 +1,219 @@
+#include "pch.h"
+#include "Log.h"
+#include "DxgiFrameSource.h"
+#include <wrl.h>
+#include <dxgi1_2.h>
+#include <d3d11.h>
+
+using Microsoft::WRL::ComPtr;
+using winvert4::AcquireStatus;
+
+namespace {
+static PixelRect ToPixelRect(const RECT& r)
+{
+    return PixelRect{ int32_t(r.left), int32_t(r.top), int32_t(r.right), int32_t(r.bottom) };
+}
+} // namespace
+
+DxgiFrameSource::DxgiFrameSource(ID3D11Device* device, ID3D11DeviceContext* context, IDXGIOutput1* output)
+    : m_device(device)
+    , m_context(context)
+    , m_output(output)
+{
+    LARGE_INTEGER freq{};
+    QueryPerformanceFrequency(&freq);
+    m_ticksPerSecond = uint64_t(freq.QuadPart);
+}
+
+DxgiFrameSource::~DxgiFrameSource()
+{
+    if (m_holding && m_duplication) m_duplication->ReleaseFrame();
+}
+
+bool DxgiFrameSource::Start()
+{
+    if (!m_output || !m_device) return false;
+
+    // Create duplication
+    ComPtr<IDXGIOutputDuplication> dupl;
+    HRESULT hr = m_output->DuplicateOutput(m_device.Get(), &dupl);
+    if (FAILED(hr)) {
+        WINVERT_WARN(DT, "DT: DuplicateOutput failed hr=0x%08X", hr);
+        return false;
+    }
+    m_duplication = dupl;
+
+    // Describe duplication
+    DXGI_OUTDUPL_DESC dd{};
+    m_duplication->GetDesc(&dd);
+    WINVERT_INFO(DT, "DT: desc: Mode=%ux%u fmt=%u Rot=%u",
+        dd.ModeDesc.Width, dd.ModeDesc.Height, dd.ModeDesc.Format, dd.Rotation);
+    // Nominal mode rate; the capture loop measures the real cadence from present times
+    if (dd.ModeDesc.RefreshRate.Denominator != 0)
+    {
+        m_refreshHz = static_cast<float>(double(dd.ModeDesc.RefreshRate.Numerator) / double(dd.ModeDesc.RefreshRate.Denominator));
+    }
+    if (m_refreshHz <= 0.0f)
+    {
+        m_refreshHz = 60.0f; // sensible default
+    }
+
+    // Create full-frame texture to copy into
+    D3D11_TEXTURE2D_DESC texDesc{};
+    texDesc.Width = dd.ModeDesc.Width;
+    texDesc.Height = dd.ModeDesc.Height;
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.Format = dd.ModeDesc.Format; // usually BGRA8 (87)
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.CPUAccessFlags = 0;
+    texDesc.MiscFlags = 0;
+    D3D11_TEXTURE2D_DESC current{};
+    if (m_fullTexture) m_fullTexture->GetDesc(&current);
+    if (!m_fullTexture || current.Width != texDesc.Width || current.Height != texDesc.Height || current.Format != texDesc.Format)
+    {
+        // Subscribers holding a view of the old texture notice the new pointer and rebuild it
+        m_fullTexture.Reset();
+        m_device->CreateTexture2D(&texDesc, nullptr, &m_fullTexture);
+        if (m_fullTexture) {
+            WINVERT_INFO(DT, "DT: full-frame texture created %ux%u", texDesc.Width, texDesc.Height);
+        } else {
+            WINVERT_WARN(DT, "DT: full-frame texture creation FAILED");
+        }
+    }
+    m_width = int32_t(texDesc.Width);
+    m_height = int32_t(texDesc.Height);
+    m_needFullCopy = true;
+
+    // Warm-up: try to capture one frame up front so first subscriber can render
+    // immediately without waiting for a random desktop update cadence.
+    {
+        DXGI_OUTDUPL_FRAME_INFO fi{};
+        ComPtr<IDXGIResource> res;
+        HRESULT hrWarm = m_duplication->AcquireNextFrame(250, &fi, &res);
+        if (SUCCEEDED(hrWarm))
+        {
+            ComPtr<ID3D11Texture2D> frameTex;
+            res.As(&frameTex);
+            if (frameTex && m_fullTexture)
+            {
+                m_context->CopyResource(m_fullTexture.Get(), frameTex.Get());
+                m_needFullCopy = false;
+                WINVERT_DEBUG(DT, "DT: warm-up frame captured");
+            }
+            m_duplication->ReleaseFrame();
+        }
+        else if (hrWarm == DXGI_ERROR_WAIT_TIMEOUT)
+        {
+            WINVERT_DEBUG(DT, "DT: warm-up frame timeout");
+        }
+        else
+        {
+            WINVERT_WARN(DT, "DT: warm-up AcquireNextFrame failed hr=0x%08X", hrWarm);
+        }
+    }
+    return true;
+}
+
+bool DxgiFrameSource::Recreate()
+{
+    if (m_holding && m_duplication) m_duplication->ReleaseFrame();
+    m_holding = false;
+    m_frameTex.Reset();
+    // Only one duplication per output and process: the lost one must go first
+    m_duplication.Reset();
+    return Start();
+}
+
+AcquireStatus DxgiFrameSource::Acquire(uint32_t timeoutMs, winvert4::FrameInfo& info, FrameDamage& damage)
+{
+    DXGI_OUTDUPL_FRAME_INFO fi{};
+    ComPtr<IDXGIResource> res;
+    HRESULT hr = m_duplication->AcquireNextFrame(timeoutMs, &fi, &res);
+    if (hr == DXGI_ERROR_WAIT_TIMEOUT) return AcquireStatus::Timeout;
+    if (FAILED(hr)) {
+        WINVERT_WARN(DT, "DT: AcquireNextFrame failed hr=0x%08X", hr);
+        return (hr == DXGI_ERROR_ACCESS_LOST) ? AcquireStatus::AccessLost : AcquireStatus::Failed;
+    }
+    m_holding = true;
+    info.presentTicks = uint64_t(fi.LastPresentTime.QuadPart);
+    info.accumulatedFrames = fi.AccumulatedFrames;
+
+    m_frameTex.Reset();
+    res.As(&m_frameTex);
+    damage.Reset(m_width, m_height);
+    if (m_frameTex && m_fullTexture) CollectDamage_(fi, damage);
+    return AcquireStatus::Frame;
+}
+
+void DxgiFrameSource::CollectDamage_(const DXGI_OUTDUPL_FRAME_INFO& fi, FrameDamage& damage)
+{
+    if (m_needFullCopy) { damage.MarkAll(); return; }
+    // Pointer-only update: the desktop image did not change
+    if (fi.LastPresentTime.QuadPart == 0 || fi.AccumulatedFrames == 0) return;
+    if (fi.TotalMetadataBufferSize == 0) { damage.MarkAll(); return; }
+
+    if (m_frameMetadata.size() < fi.TotalMetadataBufferSize) m_frameMetadata.resize(fi.TotalMetadataBufferSize);
+
+    // Moves first (DXGI requires them to be applied before dirty rects)
+    UINT moveBytes = 0;
+    auto* moves = reinterpret_cast<DXGI_OUTDUPL_MOVE_RECT*>(m_frameMetadata.data());
+    HRESULT hr = m_duplication->GetFrameMoveRects(UINT(m_frameMetadata.size()), moves, &moveBytes);
+    if (FAILED(hr)) {
+        WINVERT_WARN(DT, "DT: GetFrameMoveRects failed hr=0x%08X; full copy", hr);
+        damage.MarkAll();
+        return;
+    }
+    const UINT moveCount = moveBytes / sizeof(DXGI_OUTDUPL_MOVE_RECT);
+    for (UINT i = 0; i < moveCount; ++i)
+    {
+        damage.AddMove(moves[i].SourcePoint.x, moves[i].SourcePoint.y, ToPixelRect(moves[i].DestinationRect));
+    }
+
+    UINT dirtyBytes = 0;
+    auto* dirty = reinterpret_cast<RECT*>(m_frameMetadata.data() + moveBytes);
+    hr = m_duplication->GetFrameDirtyRects(UINT(m_frameMetadata.size()) - moveBytes, dirty, &dirtyBytes);
+    if (FAILED(hr)) {
+        WINVERT_WARN(DT, "DT: GetFrameDirtyRects failed hr=0x%08X; full copy", hr);
+        damage.MarkAll();
+        return;
+    }
+    const UINT dirtyCount = dirtyBytes / sizeof(RECT);
+    for (UINT i = 0; i < dirtyCount; ++i)
+    {
+        damage.AddDirty(ToPixelRect(dirty[i]));
+    }
+
+    damage.Finalize(winvert4::kMaxCopyRects, winvert4::kFullCopyFraction);
+    WINVERT_TRACE(DT, "DT: damage moves=%u dirty=%u -> %zu rects%s",
+        moveCount, dirtyCount, damage.Rects().size(), damage.IsFull() ? " (full)" : "");
+}
+
+void DxgiFrameSource::CopyFrame(const FrameDamage& damage)
+{
+    if (!m_frameTex || !m_fullTexture) return;
+    if (damage.IsFull())
+    {
+        WINVERT_TRACE(DT, "DT: frame acquired; copying full texture");
+        m_context->CopyResource(m_fullTexture.Get(), m_frameTex.Get());
+        m_needFullCopy = false;
+        return;
+    }
+    for (const PixelRect& r : damage.Rects())
+    {
+        D3D11_BOX box{ UINT(r.left), UINT(r.top), 0, UINT(r.right), UINT(r.bottom), 1 };
+        m_context->CopySubresourceRegion(m_fullTexture.Get(), 0, UINT(r.left), UINT(r.top), 0, m_frameTex.Get(), 0, &box);
+    }
+}
+
+void DxgiFrameSource::Release()
+{
+    m_frameTex.Reset();
+    if (m_holding)
+    {
+        m_duplication->ReleaseFrame();
+        m_holding = false;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "pch.h"
+#include "FrameSource.h"
+#include <vector>
+
+// IFrameSource over DXGI Desktop Duplication for one output. Keeps a shared
+// full-frame texture that subscribers sample, updated from each acquired
+// surface with only its dirty and moved regions.
+class DxgiFrameSource final : public winvert4::IFrameSource
+{
+public:
+    DxgiFrameSource(ID3D11Device* device, ID3D11DeviceContext* context, IDXGIOutput1* output);
+    ~DxgiFrameSource();
+
+    // Create the duplication and the shared texture, and capture a first frame
+    // so the first subscriber can render without waiting for a desktop update.
+    bool Start();
+    // Recreate the duplication after AccessLost. The shared texture (and the last
+    // good frame in it) is kept when the mode's size and format did not change.
+    bool Recreate() override;
+
+    winvert4::AcquireStatus Acquire(uint32_t timeoutMs, winvert4::FrameInfo& info, FrameDamage& damage) override;
+    void CopyFrame(const FrameDamage& damage) override;
+    void Release() override;
+    const void* SharedFrame() const override { return m_fullTexture.Get(); }
+
+    ID3D11Texture2D* GetSharedTexture() const { return m_fullTexture.Get(); }
+
+private:
+    // Fill damage from the acquired frame's move/dirty metadata
+    void CollectDamage_(const DXGI_OUTDUPL_FRAME_INFO& fi, FrameDamage& damage);
+
+    ::Microsoft::WRL::ComPtr<ID3D11Device> m_device;
+    ::Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_context;
+    ::Microsoft::WRL::ComPtr<IDXGIOutput1> m_output;
+    ::Microsoft::WRL::ComPtr<IDXGIOutputDuplication> m_duplication;
+    // Shared full-frame texture for this output (sampled by all subscribers)
+    ::Microsoft::WRL::ComPtr<ID3D11Texture2D> m_fullTexture;
+    // Surface of the frame currently held between Acquire and Release
+    ::Microsoft::WRL::ComPtr<ID3D11Texture2D> m_frameTex;
+    bool m_holding{ false };
+
+    // Metadata buffer the move/dirty rects are read into
+    std::vector<uint8_t> m_frameMetadata;
+    // m_fullTexture holds no valid frame yet; next acquired frame is copied whole
+    bool m_needFullCopy{ true };
+};
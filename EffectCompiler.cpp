@@ -0,0 +1,116 @@
+﻿#include "EffectCompiler.h"
+#include "ColorMapIndex.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // Tolerance for eliding near-identity composites (well below one 8-bit step)
+    constexpr float kIdentityEps = 1e-6f;
+}
+
+CompiledEffect CompileEffectSettings(const EffectSettings& settings, bool invert)
+{
+    CompiledEffect out{};
+
+    // Custom matrix: rgb' = A * rgb + t + o, with t the matrix translation column
+    float A[3][3] = { { 1,0,0 }, { 0,1,0 }, { 0,0,1 } };
+    float b[3] = { 0,0,0 };
+    if (settings.isCustomEffectActive)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int c = 0; c < 3; ++c) A[r][c] = settings.colorMat[r * 4 + c];
+            b[r] = settings.colorMat[r * 4 + 3] + settings.colorOffset[r];
+        }
+    }
+
+    // Fold invert (applied first): A * (1 - rgb) + b = -A * rgb + (A * 1 + b)
+    if (invert)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            b[r] += A[r][0] + A[r][1] + A[r][2];
+            for (int c = 0; c < 3; ++c) A[r][c] = -A[r][c];
+        }
+    }
+
+    bool identity = true;
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            const float expected = (r == c) ? 1.0f : 0.0f;
+            if (std::fabs(A[r][c] - expected) > kIdentityEps) identity = false;
+        }
+        if (std::fabs(b[r]) > kIdentityEps) identity = false;
+    }
+
+    out.hasAffine = !identity;
+    if (out.hasAffine)
+    {
+        for (int r = 0; r < 3; ++r)
+        {
+            for (int c = 0; c < 3; ++c) out.colorMat[r * 4 + c] = A[r][c];
+            out.colorMat[r * 4 + 3] = 0.0f;
+            out.colorOffset[r] = b[r];
+        }
+        // kPS never reads alpha from the transform; keep the row canonical
+        const float alphaRow[4] = { 0,0,0,1 };
+        memcpy(&out.colorMat[12], alphaRow, sizeof(alphaRow));
+        out.colorOffset[3] = 0.0f;
+    }
+
+    if (settings.isColorMappingEnabled)
+    {
+        for (const auto& e : settings.colorMaps)
+        {
+            // Zero tolerance never matches in kPS
+            if (e.enabled && e.tolerance > 0) { out.hasColorMap = true; break; }
+        }
+    }
+
+    out.isPassThrough = !out.hasAffine && !out.hasColorMap;
+    return out;
+}
+
+ColorMapPacking PackColorMaps(const EffectSettings& settings, ColorMapCB& out)
+{
+    ColorMapPacking result;
+    for (const auto& e : settings.colorMaps)
+    {
+        if (!e.enabled) continue;
+        ++result.enabled;
+        if (result.packed >= kMaxColorMaps) continue;
+        const ColorMapItem it = ColorMapIndex::Prepare(e);
+        float* src = out.colorMapSrc[result.packed];
+        float* dst = out.colorMapDst[result.packed];
+        src[0] = it.src[0]; src[1] = it.src[1]; src[2] = it.src[2]; src[3] = it.t2;
+        dst[0] = it.dst[0]; dst[1] = it.dst[1]; dst[2] = it.dst[2]; dst[3] = 0.0f;
+        ++result.packed;
+    }
+    // Unused slots are zeroed so equal tables compare equal bytewise
+    if (result.packed < kMaxColorMaps)
+    {
+        const size_t rest = (kMaxColorMaps - result.packed) * sizeof(out.colorMapSrc[0]);
+        memset(out.colorMapSrc[result.packed], 0, rest);
+        memset(out.colorMapDst[result.packed], 0, rest);
+    }
+    return result;
+}
+
+void PackPixelFlags(const EffectSettings& settings, const CompiledEffect& fx, uint32_t colorMapCount, PixelCB& out)
+{
+    // Invert is folded into the composed matrix, so the shader runs one affine transform
+    out.enableInvert = 0u;
+    out.enableMatrix = fx.hasAffine ? 1u : 0u;
+    out.enableColorMap = fx.hasColorMap ? 1u : 0u;
+    out.preserveMapBrightness = (settings.isColorMappingEnabled && settings.colorMapPreserveBrightness) ? 1u : 0u;
+    memcpy(out.lumaWeights, settings.lumaWeights, sizeof(out.lumaWeights));
+    out._pad2 = 0.0f;
+    memcpy(out.colorMat, fx.colorMat, sizeof(out.colorMat));
+    memcpy(out.colorOffset, fx.colorOffset, sizeof(out.colorOffset));
+    out.colorMapCount = fx.hasColorMap ? colorMapCount : 0u;
+    out.useColorLut = 0u;
+    out.lutScale = 0.0f;
+    out.lutBias = 0.0f;
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+#include "EffectConstants.h"
+#include "EffectSettings.h"
+
+// Minimal canonical form of an EffectSettings for one frame.
+// Invert is the affine map M = -I, O = 1, so invert + custom matrix collapse
+// into a single row-major matrix whose translation column is zero (translation
+// is pre-multiplied into colorOffset). Identity transforms are elided.
+struct CompiledEffect
+{
+    // False when the composed transform is the identity; the affine stage can be skipped.
+    bool hasAffine{ false };
+    float colorMat[16]{
+        1,0,0,0,
+        0,1,0,0,
+        0,0,1,0,
+        0,0,0,1
+    };
+    float colorOffset[4]{ 0,0,0,0 };
+
+    // True when at least one enabled color map needs to run after the affine stage.
+    bool hasColorMap{ false };
+
+    // Output equals input: no draw is needed, the renderer can copy the source.
+    bool isPassThrough{ true };
+};
+
+// invert is the effective invert state (brightness protection may override the toggle).
+CompiledEffect CompileEffectSettings(const EffectSettings& settings, bool invert);
+
+struct ColorMapPacking
+{
+    uint32_t packed{ 0 };   // entries written to the table (at most kMaxColorMaps)
+    uint32_t enabled{ 0 };  // enabled entries in the settings; more than packed on overflow
+};
+
+// Color-map table in shader units: the enabled entries in list order. Depends only
+// on the settings, so it needs repacking only when they change.
+ColorMapPacking PackColorMaps(const EffectSettings& settings, ColorMapCB& out);
+
+// Flags and transform (the first kPixelFlagsBytes of PixelCB) for fx, with
+// colorMapCount entries of the packed table in use. The LUT fields are cleared.
+void PackPixelFlags(const EffectSettings& settings, const CompiledEffect& fx, uint32_t colorMapCount, PixelCB& out);
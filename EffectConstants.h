@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Constant buffer layouts shared by the GPU pipeline (EffectWindow) and the
+// CPU reference kernel (EffectKernel). Kept free of Windows headers so the
+// CPU side builds on any platform. Layouts must match cbuffer packing in kVS/kPS.
+
+struct VertexCB { float scale[2]; float offset[2]; };
+
+static constexpr uint32_t kMaxColorMaps = 64;
+
+struct PixelCB {
+    uint32_t enableInvert;
+    uint32_t enableMatrix;
+    uint32_t enableColorMap;
+    uint32_t preserveMapBrightness; // 1 = preserve original luminance when mapping
+    float lumaWeights[3];
+    float _pad2; // Padding to align colorMat to 16 bytes
+    float colorMat[16];
+    float colorOffset[4];
+    uint32_t colorMapCount;
+    uint32_t useColorLut; // 1 = whole chain baked into the 3D LUT at t1
+    float lutScale;       // uvw = rgb * lutScale + lutBias (texel-center addressing)
+    float lutBias;
+    // Pack src RGB in xyz and tolerance^2 in w
+    float colorMapSrc[kMaxColorMaps][4];
+    // Pack dst RGB in xyz; w unused
+    float colorMapDst[kMaxColorMaps][4];
+};
+
+// On the GPU PixelCB is split in two buffers: the flags and transform above the
+// color-map table (b1, changes with every settings or invert change) and the
+// table itself (b2, ColorMapCB, changes only when the maps do).
+static constexpr size_t kPixelFlagsBytes = offsetof(PixelCB, colorMapSrc);
+
+struct ColorMapCB {
+    float colorMapSrc[kMaxColorMaps][4];
+    float colorMapDst[kMaxColorMaps][4];
+};
+
+// HLSL packs each member on 16-byte register boundaries; catch accidental drift.
+static_assert(offsetof(PixelCB, colorMat) == 32, "PixelCB.colorMat must start at c2");
+static_assert(offsetof(PixelCB, colorMapCount) == 112, "PixelCB.colorMapCount must start at c7");
+static_assert(offsetof(PixelCB, colorMapSrc) == 128, "PixelCB.colorMapSrc must start at c8");
+static_assert(sizeof(PixelCB) % 16 == 0, "PixelCB size must be a multiple of 16 bytes");
+static_assert(sizeof(ColorMapCB) == sizeof(PixelCB) - kPixelFlagsBytes, "ColorMapCB must be the tail of PixelCB");
+static_assert(sizeof(VertexCB) % 16 == 0, "VertexCB size must be a multiple of 16 bytes");
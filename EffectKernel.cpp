@@ -0,0 +1,138 @@
+#include "EffectKernel.h"
+#include "EffectKernelSimd.h"
+#include <algorithm>
+
+// Keep multiplies and adds separate (no FMA contraction) so every path rounds
+// identically. MSVC's default /fp:precise already does not contract.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace {
+    // Exact UNORM8 -> float conversion (c / 255), as performed by the texture sampler
+    struct UnormTable
+    {
+        float v[256];
+        UnormTable() { for (int i = 0; i < 256; ++i) v[i] = float(i) / 255.0f; }
+    };
+    const UnormTable& Unorm()
+    {
+        static const UnormTable s_table;
+        return s_table;
+    }
+
+    // HLSL intrinsics with their documented definitions
+    inline float Saturate(float x) { return (x > 0.0f) ? ((x < 1.0f) ? x : 1.0f) : 0.0f; }
+    inline float Lerp(float a, float b, float s) { return a + s * (b - a); }
+    inline float Smoothstep(float lo, float hi, float x)
+    {
+        float t = Saturate((x - lo) / (hi - lo));
+        return t * t * (3.0f - 2.0f * t);
+    }
+}
+
+void EffectKernel::SetConstants(const PixelCB& cb)
+{
+    m_cb = cb;
+    if (m_cb.colorMapCount > kMaxColorMaps) m_cb.colorMapCount = kMaxColorMaps;
+    m_maps.Build(m_cb);
+}
+
+void EffectKernel::ShadePixel(const float in[3], float out[3]) const
+{
+    const PixelCB& cb = m_cb;
+    float r = in[0], g = in[1], b = in[2];
+
+    if (cb.enableInvert) { r = 1.0f - r; g = 1.0f - g; b = 1.0f - b; }
+
+    if (cb.enableMatrix != 0)
+    {
+        // mul(row_major colorMat, float4(result,1)) + colorOffset
+        const float* m = cb.colorMat;
+        const float nr = m[0] * r + m[1] * g + m[2]  * b + m[3];
+        const float ng = m[4] * r + m[5] * g + m[6]  * b + m[7];
+        const float nb = m[8] * r + m[9] * g + m[10] * b + m[11];
+        r = nr + cb.colorOffset[0];
+        g = ng + cb.colorOffset[1];
+        b = nb + cb.colorOffset[2];
+    }
+
+    if (cb.enableColorMap != 0 && !m_maps.Empty())
+    {
+        const float* lw = cb.lumaWeights;
+        float maxW = 0.0f;
+        float best[3] = { r, g, b };
+        // Only maps whose sphere reaches this grid cell; list order is preserved
+        uint32_t candidateCount = 0;
+        const uint32_t* candidates = m_maps.Candidates(r, g, b, candidateCount);
+        for (uint32_t k = 0; k < candidateCount; ++k)
+        {
+            const ColorMapItem& item = m_maps[candidates[k]];
+            const float* src = item.src;
+            const float t2 = item.t2;
+            const float dr = r - src[0], dg = g - src[1], db = b - src[2];
+            const float dist2 = dr * dr + dg * dg + db * db;
+            if (!(dist2 <= t2 && t2 > 1e-12f)) continue;
+
+            const float* dst = item.dst;
+            float mapped[3] = { dst[0], dst[1], dst[2] };
+            if (cb.preserveMapBrightness != 0)
+            {
+                const float lDst = dst[0] * lw[0] + dst[1] * lw[1] + dst[2] * lw[2];
+                if (!(lDst < 1e-5f || lDst > 0.999f))
+                {
+                    // Preserve luminance with a highlight roll-off to avoid clipping near white
+                    const float lOrig = r * lw[0] + g * lw[1] + b * lw[2];
+                    float scale = lOrig / std::max(lDst, 1e-5f);
+                    const float highlight = Smoothstep(0.85f, 1.0f, lOrig);
+                    scale = Lerp(scale, 1.0f, highlight);
+                    mapped[0] *= scale; mapped[1] *= scale; mapped[2] *= scale;
+                }
+            }
+            float w = Saturate(1.0f - dist2 / t2);
+            w = w * w * w; // cubic
+            if (w > maxW)
+            {
+                maxW = w;
+                best[0] = Lerp(r, Saturate(mapped[0]), w);
+                best[1] = Lerp(g, Saturate(mapped[1]), w);
+                best[2] = Lerp(b, Saturate(mapped[2]), w);
+            }
+        }
+        if (maxW > 0.0f) { r = best[0]; g = best[1]; b = best[2]; }
+    }
+
+    out[0] = r; out[1] = g; out[2] = b;
+}
+
+void EffectKernel::Process(const uint8_t* src, size_t srcPitch,
+                           uint8_t* dst, size_t dstPitch,
+                           uint32_t width, uint32_t height) const
+{
+    if (!src || !dst) return;
+    if (m_cb.enableColorMap == 0 || m_maps.Empty())
+    {
+        // Invert/matrix only: vectorized path with identical results
+        ProcessAffineBGRA8(AffineParamsFromConstants(m_cb), src, srcPitch, dst, dstPitch, width, height);
+        return;
+    }
+    const float* unorm = Unorm().v;
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* s = src + y * srcPitch;
+        uint8_t* d = dst + y * dstPitch;
+        for (uint32_t x = 0; x < width; ++x, s += 4, d += 4)
+        {
+            // BGRA in memory
+            const float in[3] = { unorm[s[2]], unorm[s[1]], unorm[s[0]] };
+            float out[3];
+            ShadePixel(in, out);
+            d[0] = ToUnorm8(out[2]);
+            d[1] = ToUnorm8(out[1]);
+            d[2] = ToUnorm8(out[0]);
+            d[3] = 255;
+        }
+    }
+}
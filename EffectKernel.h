@@ -0,0 +1,44 @@
+#pragma once
+#include "EffectConstants.h"
+#include "ColorMapIndex.h"
+#include <cstddef>
+#include <cstdint>
+
+// CPU reference implementation of the kPS pixel shader (EffectWindow.cpp).
+// Consumes the same PixelCB that is uploaded to the GPU and processes BGRA8
+// buffers with the shader's float math and operation order, so its output can
+// be diffed against the GPU path or used where no GPU path is available.
+class EffectKernel
+{
+public:
+    EffectKernel() = default;
+    explicit EffectKernel(const PixelCB& cb) { SetConstants(cb); }
+
+    void SetConstants(const PixelCB& cb);
+    const PixelCB& GetConstants() const { return m_cb; }
+
+    // Replace the (at most kMaxColorMaps) list carried by the constants with the
+    // full settings list. Call after SetConstants.
+    void SetColorMaps(const std::vector<ColorMapEntry>& maps) { m_maps.Build(maps); }
+    const ColorMapIndex& GetColorMaps() const { return m_maps; }
+
+    // Shade one normalized RGB triple (0..1) exactly as kPS does; output is unclamped.
+    void ShadePixel(const float in[3], float out[3]) const;
+
+    // Shade a BGRA8 image. Rows may be padded (pitch in bytes). Alpha is written
+    // as 255, matching the shader's float4(result, 1). src and dst may alias.
+    void Process(const uint8_t* src, size_t srcPitch,
+                 uint8_t* dst, size_t dstPitch,
+                 uint32_t width, uint32_t height) const;
+
+    // Float -> UNORM8 conversion used by the render target (saturate, round to nearest).
+    static uint8_t ToUnorm8(float v)
+    {
+        v = (v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f;
+        return static_cast<uint8_t>(v * 255.0f + 0.5f);
+    }
+
+private:
+    PixelCB m_cb{};
+    ColorMapIndex m_maps;
+};
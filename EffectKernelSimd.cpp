@@ -0,0 +1,430 @@
+#include "EffectKernelSimd.h"
+#include "EffectKernel.h"
+#include <cstring>
+
+// Keep multiplies and adds separate (no FMA contraction) so every path rounds
+// identically. MSVC's default /fp:precise already does not contract.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WINVERT_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define WINVERT_KERNEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// MSVC allows ISA intrinsics in any function; GCC/Clang need a per-function target.
+#if defined(__GNUC__) || defined(__clang__)
+#define WINVERT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WINVERT_TARGET(isa)
+#endif
+
+namespace {
+    // Same operations, in the same order, as EffectKernel::ShadePixel + ToUnorm8
+    void ShadeScalar(const AffineParams& p, const uint8_t* s, uint8_t* d, uint32_t count)
+    {
+        for (uint32_t x = 0; x < count; ++x, s += 4, d += 4)
+        {
+            float r = float(s[2]) / 255.0f, g = float(s[1]) / 255.0f, b = float(s[0]) / 255.0f;
+            if (p.invert) { r = 1.0f - r; g = 1.0f - g; b = 1.0f - b; }
+            if (p.matrix)
+            {
+                const float nr = p.rows[0][0] * r + p.rows[0][1] * g + p.rows[0][2] * b + p.rows[0][3];
+                const float ng = p.rows[1][0] * r + p.rows[1][1] * g + p.rows[1][2] * b + p.rows[1][3];
+                const float nb = p.rows[2][0] * r + p.rows[2][1] * g + p.rows[2][2] * b + p.rows[2][3];
+                r = nr + p.offset[0];
+                g = ng + p.offset[1];
+                b = nb + p.offset[2];
+            }
+            d[0] = EffectKernel::ToUnorm8(b);
+            d[1] = EffectKernel::ToUnorm8(g);
+            d[2] = EffectKernel::ToUnorm8(r);
+            d[3] = 255;
+        }
+    }
+
+    void RowScalar(const AffineParams& p, const uint8_t* s, uint8_t* d, uint32_t width)
+    {
+        ShadeScalar(p, s, d, width);
+    }
+
+#if defined(WINVERT_KERNEL_X86)
+    // ---- SSE4.1: two 4-pixel halves per iteration ----
+    struct Sse
+    {
+        __m128 m[3][4];
+        __m128 off[3];
+        __m128 zero, one, k255, half;
+        __m128i byteMask, alpha;
+    };
+
+    // max(v,0) returns 0 for NaN like the scalar conversion
+    WINVERT_TARGET("sse4.1")
+    inline __m128i QuantizeSse(const Sse& k, __m128 x)
+    {
+        x = _mm_min_ps(_mm_max_ps(x, k.zero), k.one);
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, k.k255), k.half));
+    }
+
+    WINVERT_TARGET("sse4.1")
+    inline __m128i ShadeBlockSse(const AffineParams& p, const Sse& k, __m128i v)
+    {
+        __m128 b = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(v, k.byteMask)), k.k255);
+        __m128 g = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 8), k.byteMask)), k.k255);
+        __m128 r = _mm_div_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 16), k.byteMask)), k.k255);
+        if (p.invert)
+        {
+            r = _mm_sub_ps(k.one, r); g = _mm_sub_ps(k.one, g); b = _mm_sub_ps(k.one, b);
+        }
+        if (p.matrix)
+        {
+            __m128 c[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                __m128 acc = _mm_add_ps(_mm_mul_ps(k.m[i][0], r), _mm_mul_ps(k.m[i][1], g));
+                acc = _mm_add_ps(acc, _mm_mul_ps(k.m[i][2], b));
+                acc = _mm_add_ps(acc, k.m[i][3]);
+                c[i] = _mm_add_ps(acc, k.off[i]);
+            }
+            r = c[0]; g = c[1]; b = c[2];
+        }
+        __m128i out = _mm_or_si128(QuantizeSse(k, b), _mm_slli_epi32(QuantizeSse(k, g), 8));
+        out = _mm_or_si128(out, _mm_slli_epi32(QuantizeSse(k, r), 16));
+        return _mm_or_si128(out, k.alpha);
+    }
+
+    WINVERT_TARGET("sse4.1")
+    void RowSSE41(const AffineParams& p, const uint8_t* s, uint8_t* d, uint32_t width)
+    {
+        Sse k;
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 4; ++j) k.m[i][j] = _mm_set1_ps(p.rows[i][j]);
+            k.off[i] = _mm_set1_ps(p.offset[i]);
+        }
+        k.zero = _mm_setzero_ps(); k.one = _mm_set1_ps(1.0f);
+        k.k255 = _mm_set1_ps(255.0f); k.half = _mm_set1_ps(0.5f);
+        k.byteMask = _mm_set1_epi32(0xFF);
+        k.alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x * 4));
+            const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x * 4 + 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x * 4), ShadeBlockSse(p, k, v0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x * 4 + 16), ShadeBlockSse(p, k, v1));
+        }
+        ShadeScalar(p, s + x * 4, d + x * 4, width - x);
+    }
+
+    // ---- AVX2: 8 pixels per iteration ----
+    WINVERT_TARGET("avx2")
+    inline __m256i QuantizeAvx2(__m256 t, __m256 zero, __m256 one, __m256 k255, __m256 half)
+    {
+        t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+        return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(t, k255), half));
+    }
+
+    WINVERT_TARGET("avx2")
+    void RowAVX2(const AffineParams& p, const uint8_t* s, uint8_t* d, uint32_t width)
+    {
+        __m256 m[3][4], off[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 4; ++j) m[i][j] = _mm256_set1_ps(p.rows[i][j]);
+            off[i] = _mm256_set1_ps(p.offset[i]);
+        }
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        const __m256 k255 = _mm256_set1_ps(255.0f), half = _mm256_set1_ps(0.5f);
+        const __m256i byteMask = _mm256_set1_epi32(0xFF);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + x * 4));
+            __m256 b = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(v, byteMask)), k255);
+            __m256 g = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v, 8), byteMask)), k255);
+            __m256 r = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v, 16), byteMask)), k255);
+            if (p.invert)
+            {
+                r = _mm256_sub_ps(one, r); g = _mm256_sub_ps(one, g); b = _mm256_sub_ps(one, b);
+            }
+            if (p.matrix)
+            {
+                __m256 c[3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    __m256 acc = _mm256_add_ps(_mm256_mul_ps(m[i][0], r), _mm256_mul_ps(m[i][1], g));
+                    acc = _mm256_add_ps(acc, _mm256_mul_ps(m[i][2], b));
+                    acc = _mm256_add_ps(acc, m[i][3]);
+                    c[i] = _mm256_add_ps(acc, off[i]);
+                }
+                r = c[0]; g = c[1]; b = c[2];
+            }
+            const __m256i qb = QuantizeAvx2(b, zero, one, k255, half);
+            const __m256i qg = QuantizeAvx2(g, zero, one, k255, half);
+            const __m256i qr = QuantizeAvx2(r, zero, one, k255, half);
+            __m256i out = _mm256_or_si256(qb, _mm256_slli_epi32(qg, 8));
+            out = _mm256_or_si256(out, _mm256_slli_epi32(qr, 16));
+            out = _mm256_or_si256(out, alpha);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + x * 4), out);
+        }
+        ShadeScalar(p, s + x * 4, d + x * 4, width - x);
+    }
+
+    // ---- AVX-512F: 16 pixels per iteration ----
+    WINVERT_TARGET("avx512f")
+    inline __m512i QuantizeAvx512(__m512 t, __m512 zero, __m512 one, __m512 k255, __m512 half)
+    {
+        t = _mm512_min_ps(_mm512_max_ps(t, zero), one);
+        return _mm512_cvttps_epi32(_mm512_add_ps(_mm512_mul_ps(t, k255), half));
+    }
+
+    WINVERT_TARGET("avx512f")
+    void RowAVX512(const AffineParams& p, const uint8_t* s, uint8_t* d, uint32_t width)
+    {
+        __m512 m[3][4], off[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 4; ++j) m[i][j] = _mm512_set1_ps(p.rows[i][j]);
+            off[i] = _mm512_set1_ps(p.offset[i]);
+        }
+        const __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f);
+        const __m512 k255 = _mm512_set1_ps(255.0f), half = _mm512_set1_ps(0.5f);
+        const __m512i byteMask = _mm512_set1_epi32(0xFF);
+        const __m512i alpha = _mm512_set1_epi32(static_cast<int>(0xFF000000u));
+
+        uint32_t x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            const __m512i v = _mm512_loadu_si512(s + x * 4);
+            __m512 b = _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_and_si512(v, byteMask)), k255);
+            __m512 g = _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(v, 8), byteMask)), k255);
+            __m512 r = _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_and_si512(_mm512_srli_epi32(v, 16), byteMask)), k255);
+            if (p.invert)
+            {
+                r = _mm512_sub_ps(one, r); g = _mm512_sub_ps(one, g); b = _mm512_sub_ps(one, b);
+            }
+            if (p.matrix)
+            {
+                __m512 c[3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    __m512 acc = _mm512_add_ps(_mm512_mul_ps(m[i][0], r), _mm512_mul_ps(m[i][1], g));
+                    acc = _mm512_add_ps(acc, _mm512_mul_ps(m[i][2], b));
+                    acc = _mm512_add_ps(acc, m[i][3]);
+                    c[i] = _mm512_add_ps(acc, off[i]);
+                }
+                r = c[0]; g = c[1]; b = c[2];
+            }
+            const __m512i qb = QuantizeAvx512(b, zero, one, k255, half);
+            const __m512i qg = QuantizeAvx512(g, zero, one, k255, half);
+            const __m512i qr = QuantizeAvx512(r, zero, one, k255, half);
+            __m512i out = _mm512_or_si512(qb, _mm512_slli_epi32(qg, 8));
+            out = _mm512_or_si512(out, _mm512_slli_epi32(qr, 16));
+            out = _mm512_or_si512(out, alpha);
+            _mm512_storeu_si512(d + x * 4, out);
+        }
+        ShadeScalar(p, s + x * 4, d + x * 4, width - x);
+    }
+
+    KernelIsa DetectX86_()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int r[4]{};
+        __cpuid(r, 0);
+        const int maxLeaf = r[0];
+        __cpuid(r, 1);
+        const bool sse41 = (r[2] & (1 << 19)) != 0;
+        const bool osxsave = (r[2] & (1 << 27)) != 0;
+        const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+        const bool ymmState = (xcr0 & 0x6) == 0x6;
+        const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+        bool avx2 = false, avx512 = false;
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(r, 7, 0);
+            avx2 = ymmState && (r[1] & (1 << 5)) != 0;
+            avx512 = zmmState && (r[1] & (1 << 16)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        const bool sse41 = __builtin_cpu_supports("sse4.1");
+        const bool avx2 = __builtin_cpu_supports("avx2");
+        const bool avx512 = __builtin_cpu_supports("avx512f");
+#endif
+        if (avx512) return KernelIsa::AVX512;
+        if (avx2) return KernelIsa::AVX2;
+        if (sse41) return KernelIsa::SSE41;
+        return KernelIsa::Scalar;
+    }
+#endif // WINVERT_KERNEL_X86
+
+#if defined(WINVERT_KERNEL_NEON)
+    // ---- NEON: 8 pixels per iteration (two float32x4 halves) ----
+    void RowNEON(const AffineParams& p, const uint8_t* s, uint8_t* d, uint32_t width)
+    {
+        const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+        const float32x4_t k255 = vdupq_n_f32(255.0f), half = vdupq_n_f32(0.5f);
+
+        auto shade = [&](float32x4_t& r, float32x4_t& g, float32x4_t& b) {
+            if (p.invert)
+            {
+                r = vsubq_f32(one, r); g = vsubq_f32(one, g); b = vsubq_f32(one, b);
+            }
+            if (p.matrix)
+            {
+                float32x4_t c[3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    float32x4_t acc = vaddq_f32(vmulq_n_f32(r, p.rows[i][0]), vmulq_n_f32(g, p.rows[i][1]));
+                    acc = vaddq_f32(acc, vmulq_n_f32(b, p.rows[i][2]));
+                    acc = vaddq_f32(acc, vdupq_n_f32(p.rows[i][3]));
+                    c[i] = vaddq_f32(acc, vdupq_n_f32(p.offset[i]));
+                }
+                r = c[0]; g = c[1]; b = c[2];
+            }
+        };
+        // vmaxnm returns the number when one operand is NaN, matching the scalar clamp
+        auto q = [&](float32x4_t t) {
+            t = vminq_f32(vmaxnmq_f32(t, zero), one);
+            return vmovn_u32(vcvtq_u32_f32(vaddq_f32(vmulq_f32(t, k255), half)));
+        };
+        auto lo = [&](uint16x8_t v) { return vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), k255); };
+        auto hi = [&](uint16x8_t v) { return vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), k255); };
+
+        uint32_t x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            uint8x8x4_t px = vld4_u8(s + x * 4); // B, G, R, A planes
+            const uint16x8_t b16 = vmovl_u8(px.val[0]);
+            const uint16x8_t g16 = vmovl_u8(px.val[1]);
+            const uint16x8_t r16 = vmovl_u8(px.val[2]);
+            float32x4_t r0 = lo(r16), g0 = lo(g16), b0 = lo(b16);
+            float32x4_t r1 = hi(r16), g1 = hi(g16), b1 = hi(b16);
+            shade(r0, g0, b0);
+            shade(r1, g1, b1);
+            uint8x8x4_t out;
+            out.val[0] = vmovn_u16(vcombine_u16(q(b0), q(b1)));
+            out.val[1] = vmovn_u16(vcombine_u16(q(g0), q(g1)));
+            out.val[2] = vmovn_u16(vcombine_u16(q(r0), q(r1)));
+            out.val[3] = vdup_n_u8(255);
+            vst4_u8(d + x * 4, out);
+        }
+        ShadeScalar(p, s + x * 4, d + x * 4, width - x);
+    }
+#endif // WINVERT_KERNEL_NEON
+
+    KernelIsa DetectKernelIsa_()
+    {
+#if defined(WINVERT_KERNEL_X86)
+        return DetectX86_();
+#elif defined(WINVERT_KERNEL_NEON)
+        return KernelIsa::NEON; // Baseline on AArch64
+#else
+        return KernelIsa::Scalar;
+#endif
+    }
+
+    bool IsaSupported(KernelIsa isa)
+    {
+        const KernelIsa best = DetectKernelIsa();
+        switch (isa)
+        {
+        case KernelIsa::Scalar: return true;
+        case KernelIsa::NEON:   return best == KernelIsa::NEON;
+        case KernelIsa::SSE41:  return best == KernelIsa::SSE41 || best == KernelIsa::AVX2 || best == KernelIsa::AVX512;
+        case KernelIsa::AVX2:   return best == KernelIsa::AVX2 || best == KernelIsa::AVX512;
+        case KernelIsa::AVX512: return best == KernelIsa::AVX512;
+        }
+        return false;
+    }
+}
+
+AffineParams AffineParamsFromSettings(const EffectSettings& settings)
+{
+    AffineParams p;
+    p.invert = settings.isInvertEffectEnabled;
+    p.matrix = settings.isCustomEffectActive;
+    if (p.matrix)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            memcpy(p.rows[i], &settings.colorMat[i * 4], sizeof(p.rows[i]));
+            p.offset[i] = settings.colorOffset[i];
+        }
+    }
+    return p;
+}
+
+AffineParams AffineParamsFromConstants(const PixelCB& cb)
+{
+    AffineParams p;
+    p.invert = cb.enableInvert != 0;
+    p.matrix = cb.enableMatrix != 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        memcpy(p.rows[i], &cb.colorMat[i * 4], sizeof(p.rows[i]));
+        p.offset[i] = cb.colorOffset[i];
+    }
+    return p;
+}
+
+KernelIsa DetectKernelIsa()
+{
+    static const KernelIsa s_isa = DetectKernelIsa_();
+    return s_isa;
+}
+
+const char* KernelIsaName(KernelIsa isa)
+{
+    switch (isa)
+    {
+    case KernelIsa::Scalar: return "scalar";
+    case KernelIsa::SSE41:  return "sse4.1";
+    case KernelIsa::AVX2:   return "avx2";
+    case KernelIsa::AVX512: return "avx512";
+    case KernelIsa::NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+void ProcessAffineBGRA8(const AffineParams& params,
+                        const uint8_t* src, size_t srcPitch,
+                        uint8_t* dst, size_t dstPitch,
+                        uint32_t width, uint32_t height,
+                        KernelIsa isa)
+{
+    if (!src || !dst) return;
+    if (!IsaSupported(isa)) isa = DetectKernelIsa();
+
+    void (*row)(const AffineParams&, const uint8_t*, uint8_t*, uint32_t) = &RowScalar;
+    switch (isa)
+    {
+#if defined(WINVERT_KERNEL_X86)
+    case KernelIsa::SSE41:  row = &RowSSE41;  break;
+    case KernelIsa::AVX2:   row = &RowAVX2;   break;
+    case KernelIsa::AVX512: row = &RowAVX512; break;
+#endif
+#if defined(WINVERT_KERNEL_NEON)
+    case KernelIsa::NEON:   row = &RowNEON;   break;
+#endif
+    default: break;
+    }
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        row(params, src + y * srcPitch, dst + y * dstPitch, width);
+    }
+}
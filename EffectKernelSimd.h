@@ -0,0 +1,43 @@
+#pragma once
+#include "EffectConstants.h"
+#include "EffectSettings.h"
+#include <cstddef>
+#include <cstdint>
+
+// Vectorized invert + color-matrix path of kPS for BGRA8 frames (no color maps).
+// Results are bit-identical to EffectKernel::ShadePixel followed by ToUnorm8:
+// every ISA uses the same operation order and no fused multiply-add.
+
+enum class KernelIsa
+{
+    Scalar,
+    SSE41,   // 8 px / iteration (two 128-bit halves)
+    AVX2,    // 8 px / iteration
+    AVX512,  // 16 px / iteration
+    NEON,    // 8 px / iteration (AArch64)
+};
+
+struct AffineParams
+{
+    bool invert{ false };
+    bool matrix{ false };
+    // First three rows of the row-major colorMat (the alpha row is never read by kPS)
+    float rows[3][4]{ { 1,0,0,0 }, { 0,1,0,0 }, { 0,0,1,0 } };
+    float offset[3]{ 0,0,0 };
+};
+
+// Build parameters from the settings fields that drive the shader's invert/matrix stage.
+AffineParams AffineParamsFromSettings(const EffectSettings& settings);
+AffineParams AffineParamsFromConstants(const PixelCB& cb);
+
+// Best ISA supported by this CPU/OS (cached after the first call).
+KernelIsa DetectKernelIsa();
+const char* KernelIsaName(KernelIsa isa);
+
+// Shade a BGRA8 image with the given ISA; requests for unsupported ISAs fall
+// back to the best supported one. Alpha is written as 255. src and dst may alias.
+void ProcessAffineBGRA8(const AffineParams& params,
+                        const uint8_t* src, size_t srcPitch,
+                        uint8_t* dst, size_t dstPitch,
+                        uint32_t width, uint32_t height,
+                        KernelIsa isa = DetectKernelIsa());
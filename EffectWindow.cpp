@@ -1,16 +1,31 @@
-#include "pch.h"
+﻿#include "pch.h"
 #include "Log.h"
 #include "EffectWindow.h"
 #include "App.xaml.h"
 #include "OutputManager.h"
+#include "EffectCompiler.h"
+#include "EffectKernel.h"
+#include "ColorLut.h"
+#include "ColorMapIndex.h"
+#include "FrameTrace.h"
+#include "ShaderVariants.h"
+#include "ShaderBlobCache.h"
+#include "BrightnessReadback.h"
 #include <dwmapi.h>
 #include <d3dcompiler.h>
+#include <winrt/Windows.Storage.h>
 #include <mutex>
+#include <thread>
 
 using ::Microsoft::WRL::ComPtr;
+namespace frametrace = winvert4::frametrace;
 
 namespace {
     constexpr wchar_t kEffectWndClass[] = L"Winvert4_EffectWindow";
+    // A brightness readback step that takes this long stalled on the GPU
+    constexpr uint64_t kReadbackStallNs = 1000000;
+    // Names each window's metrics; never reused, so windows do not share series
+    std::atomic<uint32_t> g_nextMetricsId{ 0 };
 
     static const float kFSVerts[6] = { -1.f,-1.f,  -1.f,3.f,  3.f,-1.f };
 
@@ -25,9 +40,25 @@ namespace {
           o.uv = suv*scale + offset; return o;
         })";
 
-    // Pixel shader: sample and apply effects; force alpha 1 for opaque overlay
+    // Pixel shader: sample and apply effects; force alpha 1 for opaque overlay.
+    // Without defines this is the uber shader branching on the PixelCB flags; a
+    // variant (ShaderVariants.h) defines the WV_HAS_* switches as 0/1 literals so
+    // unused stages and the map loop compile away.
     static const char* kPS = R"(
+        #ifndef WV_HAS_LUT
+        #define WV_UBER 1
+        #define WV_HAS_LUT (useColorLut != 0)
+        #define WV_HAS_AFFINE (enableMatrix != 0)
+        #define WV_HAS_MAP (enableColorMap != 0)
+        #define WV_HAS_PRESERVE (preserveMapBrightness != 0)
+        #define WV_MAP_SLOTS 64
+        #define WV_MAP_UNROLL 0
+        #else
+        #define WV_UBER 0
+        #endif
+
         Texture2D srcTex : register(t0);
+        Texture3D colorLut : register(t1);
         SamplerState samp0 : register(s0);
         cbuffer PixelCB : register(b1) {
             uint enableInvert;
@@ -39,7 +70,12 @@ namespace {
             row_major float4x4 colorMat;
             float4   colorOffset;
             uint colorMapCount;
-            float3 _pad3; // Padding for alignment
+            uint useColorLut;
+            float lutScale;
+            float lutBias;
+        };
+        // Split from PixelCB: uploaded only when the map list changes
+        cbuffer ColorMapCB : register(b2) {
             float4 colorMapSrc[64];
             float4 colorMapDst[64];
         };
@@ -51,15 +87,27 @@ namespace {
 
         float4 main(PSIn i) : SV_Target {
           float4 c = srcTex.Sample(samp0, i.uv);
+          if (WV_HAS_LUT) {
+              // Whole chain (invert/matrix/color maps) baked on the CPU into a 3D LUT
+              return float4(colorLut.SampleLevel(samp0, c.rgb * lutScale + lutBias, 0).rgb, 1.0);
+          }
           float3 result = c.rgb;
+        #if WV_UBER
           if (enableInvert) { result = 1.0 - result; }
-          if (enableMatrix != 0) { float4 cr = mul(colorMat, float4(result,1.0)); result = cr.rgb + colorOffset.rgb; }
-          if (enableColorMap != 0 && colorMapCount > 0) {
+        #endif
+          if (WV_HAS_AFFINE) { float4 cr = mul(colorMat, float4(result,1.0)); result = cr.rgb + colorOffset.rgb; }
+          if (WV_HAS_MAP && colorMapCount > 0) {
               float3 rgb = result;
               float maxW = 0.0;
               float3 best = rgb;
+              const uint count = min(colorMapCount, (uint)WV_MAP_SLOTS);
+        #if WV_MAP_UNROLL
+              [unroll]
+        #else
               [loop]
-              for (uint i = 0; i < colorMapCount; ++i) {
+        #endif
+              for (uint i = 0; i < (uint)WV_MAP_SLOTS; ++i) {
+                  if (i >= count) break;
                   float3 src = colorMapSrc[i].xyz;
                   float t2 = colorMapSrc[i].w;              // tolerance^2 in RGB space
                   float3 d = rgb - src;
@@ -68,7 +116,7 @@ namespace {
                       // Softly steer nearby colors toward the destination color
                       float3 dst = colorMapDst[i].xyz;
                       float3 mapped;
-                      if (preserveMapBrightness != 0) {
+                      if (WV_HAS_PRESERVE) {
                           float lDst = Luma(dst); // Luminance of destination
                           if (lDst < 1e-5 || lDst > 0.999) {
                               // Destination is black/white. Don't preserve luminance, just use the color directly.
@@ -97,6 +145,70 @@ namespace {
           return float4(result, 1.0);
         })";
 
+    // Bytecode from previous runs lives in LocalFolder\ShaderCache (or
+    // %WINVERT_SHADER_CACHE%, or %TEMP% for unpackaged runs). Null if no directory
+    // could be chosen; compiles then skip the disk.
+    const winvert4::shadercache::BlobCache* DiskShaderCache()
+    {
+        static const winvert4::shadercache::BlobCache* s_cache = []() -> const winvert4::shadercache::BlobCache* {
+            std::wstring dir;
+            wchar_t buf[MAX_PATH];
+            const DWORD n = GetEnvironmentVariableW(L"WINVERT_SHADER_CACHE", buf, MAX_PATH);
+            if (n > 0 && n < MAX_PATH) dir = buf;
+            if (dir.empty())
+            {
+                try
+                {
+                    auto folder = winrt::Windows::Storage::ApplicationData::Current().LocalFolder();
+                    dir = std::wstring(folder.Path().c_str()) + L"\\ShaderCache";
+                }
+                catch (...) {}
+            }
+            if (dir.empty())
+            {
+                const DWORD t = GetTempPathW(MAX_PATH, buf);
+                if (t > 0 && t < MAX_PATH) dir = std::wstring(buf) + L"Winvert4\\ShaderCache";
+            }
+            if (dir.empty()) return nullptr;
+            WINVERT_INFO(EW, "EW: shader blob cache at %ls", dir.c_str());
+            return new winvert4::shadercache::BlobCache(dir);  // leaked: compile threads are detached
+        }();
+        return s_cache;
+    }
+
+    // D3DCompile through the on-disk blob cache. The key covers everything that
+    // changes the bytecode, including the compiler version, so stale blobs are never
+    // loaded; err is only set when the compiler ran.
+    HRESULT CompileShaderCached(const char* src, const D3D_SHADER_MACRO* macros, const char* entry,
+        const char* target, UINT flags, ComPtr<ID3DBlob>& out, ComPtr<ID3DBlob>& err)
+    {
+        namespace sc = winvert4::shadercache;
+        sc::KeyBuilder kb;
+        kb.Add(src).Add(entry).Add(target).Add(uint64_t(flags)).Add(uint64_t(D3D_COMPILER_VERSION));
+        for (const D3D_SHADER_MACRO* m = macros; m && m->Name; ++m) kb.Add(m->Name).Add(m->Definition ? m->Definition : "");
+        const uint64_t key = kb.Key();
+
+        const sc::BlobCache* disk = DiskShaderCache();
+        std::vector<uint8_t> bytes;
+        if (disk)
+        {
+            const sc::LoadResult r = disk->Load(key, bytes);
+            if (r == sc::LoadResult::Hit && SUCCEEDED(D3DCreateBlob(bytes.size(), &out)))
+            {
+                memcpy(out->GetBufferPointer(), bytes.data(), bytes.size());
+                return S_OK;
+            }
+            if (r == sc::LoadResult::Corrupt || r == sc::LoadResult::VersionMismatch)
+                WINVERT_WARN(EW, "EW: discarded %s shader blob %016llX",
+                    r == sc::LoadResult::Corrupt ? "corrupt" : "stale", static_cast<unsigned long long>(key));
+        }
+
+        const HRESULT hr = D3DCompile(src, strlen(src), nullptr, macros, nullptr, entry, target, flags, 0, &out, &err);
+        if (SUCCEEDED(hr) && out && disk && !disk->Store(key, out->GetBufferPointer(), out->GetBufferSize()))
+            WINVERT_WARN(EW, "EW: could not store shader blob %016llX", static_cast<unsigned long long>(key));
+        return hr;
+    }
+
     static bool GetOrCompileShaders(ComPtr<ID3DBlob>& outVs, ComPtr<ID3DBlob>& outPs)
     {
         static std::once_flag s_once;
@@ -108,25 +220,25 @@ namespace {
         std::call_once(s_once, []()
         {
             ComPtr<ID3DBlob> vsb, psb, err;
-            HRESULT hrVS = D3DCompile(kVS, (UINT)strlen(kVS), nullptr, nullptr, nullptr, "main", "vs_4_0", 0, 0, &vsb, &err);
+            HRESULT hrVS = CompileShaderCached(kVS, nullptr, "main", "vs_4_0", 0, vsb, err);
             if (FAILED(hrVS) || !vsb)
             {
                 const char* emsg = err ? (const char*)err->GetBufferPointer() : "";
-                winvert4::Logf("EW: VS compile failed 0x%08X %s", hrVS, emsg);
+                WINVERT_WARN(EW, "EW: VS compile failed 0x%08X %s", hrVS, emsg);
                 return;
             }
             err.Reset();
-            HRESULT hrPS = D3DCompile(kPS, (UINT)strlen(kPS), nullptr, nullptr, nullptr, "main", "ps_4_0", 0, 0, &psb, &err);
+            HRESULT hrPS = CompileShaderCached(kPS, nullptr, "main", "ps_4_0", 0, psb, err);
             if (FAILED(hrPS) || !psb)
             {
                 const char* emsg = err ? (const char*)err->GetBufferPointer() : "";
-                winvert4::Logf("EW: PS compile failed 0x%08X %s", hrPS, emsg);
+                WINVERT_WARN(EW, "EW: PS compile failed 0x%08X %s", hrPS, emsg);
                 return;
             }
             s_vsBlob = vsb;
             s_psBlob = psb;
             s_ok = true;
-            winvert4::Log("EW: shader cache initialized");
+            WINVERT_INFO(EW, "EW: shader cache initialized");
         });
 
         std::lock_guard<std::mutex> guard(s_mutex);
@@ -135,6 +247,101 @@ namespace {
         outPs = s_psBlob;
         return true;
     }
+
+    // Specialized kPS bytecode by PixelShaderKey::Index(). Leaked on purpose: the
+    // compile thread is detached and may still be running at exit.
+    ShaderVariantCache<ComPtr<ID3DBlob>>& PixelVariantCache()
+    {
+        static auto* s_cache = new ShaderVariantCache<ComPtr<ID3DBlob>>(PixelShaderKey::kCount);
+        return *s_cache;
+    }
+
+    // Brightness readback ring slots on the immediate context. Issue reduces the
+    // frame's region through the mip chain into the slot's 1x1 staging texture;
+    // TryRead maps it without waiting for the GPU.
+    class StagingReadback : public winvert4::IReadbackTarget
+    {
+    public:
+        StagingReadback(ID3D11DeviceContext* ctx, ID3D11Texture2D* frame, const D3D11_BOX& box,
+            ID3D11Texture2D* mipTex, ID3D11ShaderResourceView* mipSrv, UINT lastLevel, const ComPtr<ID3D11Texture2D>* staging)
+            : m_ctx(ctx), m_frame(frame), m_box(box), m_mipTex(mipTex), m_mipSrv(mipSrv), m_lastLevel(lastLevel), m_staging(staging)
+        {
+        }
+
+        bool Issue(uint32_t slot) override
+        {
+            if (!m_staging[slot]) return false;
+            m_ctx->CopySubresourceRegion(m_mipTex, 0, 0, 0, 0, m_frame, 0, &m_box);
+            m_ctx->GenerateMips(m_mipSrv);
+            m_ctx->CopySubresourceRegion(m_staging[slot].Get(), 0, 0, 0, 0, m_mipTex, m_lastLevel, nullptr);
+            return true;
+        }
+
+        winvert4::ReadbackStatus TryRead(uint32_t slot, winvert4::Bgra8& out) override
+        {
+            D3D11_MAPPED_SUBRESOURCE map{};
+            const HRESULT hr = m_ctx->Map(m_staging[slot].Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &map);
+            if (hr == DXGI_ERROR_WAS_STILL_DRAWING) return winvert4::ReadbackStatus::Pending;
+            if (FAILED(hr)) return winvert4::ReadbackStatus::Failed;
+            const uint8_t* px = static_cast<const uint8_t*>(map.pData);
+            out = { px[0], px[1], px[2], px[3] };
+            m_ctx->Unmap(m_staging[slot].Get(), 0);
+            return winvert4::ReadbackStatus::Ready;
+        }
+
+    private:
+        ID3D11DeviceContext* m_ctx;
+        ID3D11Texture2D* m_frame;
+        D3D11_BOX m_box;
+        ID3D11Texture2D* m_mipTex;
+        ID3D11ShaderResourceView* m_mipSrv;
+        UINT m_lastLevel;
+        const ComPtr<ID3D11Texture2D>* m_staging;  // ReadbackRing::kDefaultSlots
+    };
+
+    void CompilePixelVariant(uint32_t index)
+    {
+        auto& cache = PixelVariantCache();
+        if (!cache.Claim(index)) return;
+        const PixelShaderKey key = PixelShaderKey::FromIndex(index);
+        ShaderDefine defines[kMaxPixelShaderDefines];
+        const size_t n = PixelShaderDefines(key, defines);
+        D3D_SHADER_MACRO macros[kMaxPixelShaderDefines + 1]{};
+        for (size_t i = 0; i < n; ++i) macros[i] = { defines[i].name, defines[i].value };
+        ComPtr<ID3DBlob> psb, err;
+        const HRESULT hr = CompileShaderCached(kPS, macros, "main", "ps_4_0", D3DCOMPILE_OPTIMIZATION_LEVEL3, psb, err);
+        if (FAILED(hr) || !psb)
+        {
+            const char* emsg = err ? (const char*)err->GetBufferPointer() : "";
+            WINVERT_WARN(EW, "EW: PS variant %u compile failed 0x%08X %s", index, hr, emsg);
+            cache.Fail(index);
+            return;
+        }
+        cache.Complete(index, psb);
+    }
+
+    // Compile every variant once, off the capture threads. Until a variant is
+    // ready its windows draw with the uber shader, so nothing waits on D3DCompile.
+    void StartPixelVariantCompiles()
+    {
+        static std::once_flag s_once;
+        std::call_once(s_once, [] {
+            std::thread([] {
+                for (uint32_t i = 0; i < PixelShaderKey::kCount; ++i) CompilePixelVariant(i);
+                WINVERT_INFO(EW, "EW: %zu/%u pixel shader variants compiled",
+                    PixelVariantCache().ReadyCount(), PixelShaderKey::kCount);
+            }).detach();
+        });
+    }
+}
+
+void EffectWindow::PrewarmShaders()
+{
+    std::thread([] {
+        ComPtr<ID3DBlob> vsb, psb;
+        GetOrCompileShaders(vsb, psb);
+        StartPixelVariantCompiles();
+    }).detach();
 }
 
 LRESULT CALLBACK EffectWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
@@ -155,19 +362,118 @@ EffectWindow::EffectWindow(RECT desktopRect, OutputManager* outputManager)
     : m_desktopRect(desktopRect)
     , m_outputManager(outputManager)
 {
+    auto& registry = winvert4::metrics::Registry::Global();
+    const uint32_t metricsId = g_nextMetricsId.fetch_add(1, std::memory_order_relaxed);
+    char prefix[48];
+    snprintf(prefix, sizeof(prefix), "window.%u", metricsId);
+    const std::string p = prefix;
+    m_metrics.prefix = p + ".";
+    WINVERT_DEBUG(EW, "EW: metrics %s for (%ld,%ld)-(%ld,%ld)", prefix,
+        desktopRect.left, desktopRect.top, desktopRect.right, desktopRect.bottom);
+    m_metrics.rendered = &registry.GetCounter(p + ".rendered");
+    m_metrics.skipped = &registry.GetCounter(p + ".skipped");
+    m_metrics.readbackStalls = &registry.GetCounter(p + ".readback_stalls");
+    m_metrics.fps = &registry.GetGauge(p + ".source_fps");
+    m_metrics.gpuMs = &registry.GetGauge(p + ".gpu_ms");
+    m_metrics.avgLuma = &registry.GetGauge(p + ".avg_luma");
+    m_metrics.readbackLatencyFrames = &registry.GetGauge(p + ".readback_latency_frames");
+    m_metrics.captureToRender = &registry.GetHistogram(p + ".latency_capture_to_render_ns");
+    m_metrics.renderToPresent = &registry.GetHistogram(p + ".latency_render_to_present_ns");
+    m_metrics.total = &registry.GetHistogram(p + ".latency_total_ns");
+    m_metrics.readback = &registry.GetHistogram(p + ".readback_ns");
 }
 
 EffectWindow::~EffectWindow()
 {
+    // Hide stops the capture and present threads, the other metric writers
     Hide();
+    winvert4::metrics::Registry::Global().RemovePrefix(m_metrics.prefix);
 }
 
-// ISubscriber implementation. This is now a no-op because the DuplicationThread
-// calls Render() directly, but it's required to satisfy the interface.
+// ISubscriber implementation. This is now a no-op because the capture loop
+// calls OnFrame() directly, but it's required to satisfy the interface.
 void EffectWindow::OnFrameReady(ComPtr<ID3D11Texture2D>)
 {
 }
 
+bool EffectWindow::OnFrame(const winvert4::FrameEvent& ev)
+{
+    auto* frame = static_cast<ID3D11Texture2D*>(const_cast<void*>(ev.frame));
+    return Render(frame, ev.presentTicks, ev.regionDirty);
+}
+
+void EffectWindow::StartPresentWorker_()
+{
+    // Cap the queue at one frame and wait for room on the worker, not inside Present
+    ComPtr<IDXGISwapChain2> swapChain2;
+    if (SUCCEEDED(m_swapChain.As(&swapChain2)) && swapChain2)
+    {
+        swapChain2->SetMaximumFrameLatency(1);
+        m_frameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+    }
+    if (!m_frameLatencyWaitable)
+    {
+        WINVERT_DEBUG(EW, "EW: no frame-latency waitable object; presents may block the worker");
+    }
+
+    winvert4::PresentWorker::Callbacks cb;
+    cb.waitReady = [this] {
+        if (m_frameLatencyWaitable) WaitForSingleObjectEx(m_frameLatencyWaitable, 100, FALSE);
+    };
+    cb.present = [this] {
+        const HRESULT hr = m_swapChain->Present(1, 0);
+        if (FAILED(hr)) WINVERT_WARN(EW, "EW: Present failed hr=0x%08X", hr);
+        else RecordPresentLatency_();
+    };
+    cb.frameMutex = &m_backBufferMutex;
+    char name[48];
+    snprintf(name, sizeof(name), "Present %ld,%ld", m_desktopRect.left, m_desktopRect.top);
+    m_presentWorker.Start(std::move(cb), name);
+}
+
+void EffectWindow::PresentFrame_()
+{
+    // A coalesced submit replaces the pending frame, so only the newest one is measured
+    m_presentCaptureQpc.store(m_frameCaptureQpc, std::memory_order_relaxed);
+    m_presentRenderQpc.store(m_frameRenderQpc, std::memory_order_release);
+    if (m_presentWorker.IsRunning())
+    {
+        m_presentWorker.Submit();
+        return;
+    }
+    frametrace::TraceScope ts(frametrace::Stage::Present);
+    if (SUCCEEDED(m_swapChain->Present(1, 0))) RecordPresentLatency_();
+}
+
+uint64_t EffectWindow::QpcToNs_(uint64_t qpc) const
+{
+    return m_qpcFreq.QuadPart ? uint64_t(double(qpc) * 1e9 / double(m_qpcFreq.QuadPart)) : 0;
+}
+
+void EffectWindow::RecordPresentLatency_()
+{
+    const unsigned long long renderQpc = m_presentRenderQpc.exchange(0, std::memory_order_acquire);
+    if (renderQpc == 0) return;
+    const unsigned long long captureQpc = m_presentCaptureQpc.load(std::memory_order_relaxed);
+    LARGE_INTEGER now{};
+    QueryPerformanceCounter(&now);
+    const uint64_t nowQpc = uint64_t(now.QuadPart);
+    const uint64_t nowNs = winvert4::metrics::NowNs();
+    if (nowQpc > renderQpc) m_metrics.renderToPresent->Record(QpcToNs_(nowQpc - renderQpc), nowNs);
+    // Redraws of the last frame carry no desktop present time
+    if (captureQpc != 0 && nowQpc > captureQpc) m_metrics.total->Record(QpcToNs_(nowQpc - captureQpc), nowNs);
+}
+
+EffectWindow::LatencyStats EffectWindow::GetLatencyStats() const
+{
+    const uint64_t nowNs = winvert4::metrics::NowNs();
+    LatencyStats stats;
+    stats.captureToRender = m_metrics.captureToRender->Summarize(nowNs);
+    stats.renderToPresent = m_metrics.renderToPresent->Summarize(nowNs);
+    stats.total = m_metrics.total->Summarize(nowNs);
+    return stats;
+}
+
 ::Microsoft::WRL::ComPtr<ID3D11Texture2D> EffectWindow::GetLastRenderedTexture()
 {
     std::lock_guard<std::mutex> lk(m_lastRenderMutex);
@@ -177,38 +483,39 @@ void EffectWindow::OnFrameReady(ComPtr<ID3D11Texture2D>)
 void EffectWindow::UpdateSettings(const EffectSettings& settings)
 {
     m_settings = settings;
-    // Reset brightness protection debounce when settings change
-    m_brightProtPendingCount = 0;
-    m_brightProtPendingState = m_effectiveInvert;
-    // Request an immediate redraw so changes are visible without desktop activity
-    if (m_thread) m_thread->RequestRedraw();
+    // The capture thread keeps rendering with the snapshot it pinned; this one
+    // (and a debounce reset) takes effect at its next frame
+    const uint64_t gen = m_settingsHandoff.Publish(settings);
+    // Redraw this window once so the change is visible without desktop activity; a
+    // slider drag coalesces into one redraw of the newest generation
+    if (m_thread) m_thread->RequestRedraw(this, gen);
 }
 
 void EffectWindow::Show()
 {
-    winvert4::Log("EffectWindow::Show called");
+    WINVERT_INFO(EW, "EffectWindow::Show called");
 
     // 1) Resolve duplication thread and D3D device/context
     if (!m_outputManager) return;
 
-    winvert4::Log("EW.Show calling GetThreadForRect");
+    WINVERT_DEBUG(EW, "EW.Show calling GetThreadForRect");
     m_thread = m_outputManager->GetThreadForRect(m_desktopRect);
-    winvert4::Logf("EW.Show thread=%p", (void*)m_thread);
+    WINVERT_DEBUG(EW, "EW.Show thread=%p", (void*)m_thread);
     if (!m_thread) return;
 
     m_d3d = m_thread->GetDevice();
-    if (!m_d3d) { winvert4::Log("EW.Show: thread->GetDevice null"); return; }
+    if (!m_d3d) { WINVERT_WARN(EW, "EW.Show: thread->GetDevice null"); return; }
     m_d3d->GetImmediateContext(&m_immediateCtx);
-    if (!m_immediateCtx) { winvert4::Log("EW.Show: GetImmediateContext null"); return; }
+    if (!m_immediateCtx) { WINVERT_WARN(EW, "EW.Show: GetImmediateContext null"); return; }
     m_d3d->CreateDeferredContext(0, &m_deferredCtx);
-    if (!m_deferredCtx) { winvert4::Log("EW.Show: CreateDeferredContext null"); return; }
+    if (!m_deferredCtx) { WINVERT_WARN(EW, "EW.Show: CreateDeferredContext null"); return; }
 
     // Ensure multithread protection (same immediate context as duplication thread)
     {
         Microsoft::WRL::ComPtr<ID3D11Multithread> mt;
         if (SUCCEEDED(m_immediateCtx.As(&mt)) && mt) {
             mt->SetMultithreadProtected(TRUE);
-            winvert4::Log("EW.Show: ID3D11Multithread protection ENABLED on immediate context");
+            WINVERT_DEBUG(EW, "EW.Show: ID3D11Multithread protection ENABLED on immediate context");
         }
     }
 
@@ -218,16 +525,16 @@ void EffectWindow::Show()
         sub.Subscriber = this;
         sub.Region     = m_desktopRect;
         m_thread->AddSubscription(sub);
-        winvert4::Log("EW: subscribed to duplication thread");
+        WINVERT_DEBUG(EW, "EW: subscribed to duplication thread");
         // Ask the duplication thread to render immediately so the window shows content without
         // waiting for desktop activity.
-        m_thread->RequestRedraw();
-        winvert4::Log("EW: requested redraw (pre-window)");
+        m_thread->RequestRedraw(this);
+        WINVERT_DEBUG(EW, "EW: requested redraw (pre-window)");
     }
 
     // 3) Create the window and pipeline now.
     CreateAndShow();
-    winvert4::Log("EW: CreateAndShow returned");
+    WINVERT_DEBUG(EW, "EW: CreateAndShow returned");
     m_isHidden = false;
 
     // We requested a redraw before creating the window, but the duplication
@@ -235,23 +542,38 @@ void EffectWindow::Show()
     // (m_run=false / m_swapChain=null) and thus returned early. Request one
     // more redraw now that the window is fully initialized so the first frame
     // presents without waiting for desktop activity.
-    if (m_thread) { winvert4::Log("EW: requested redraw (post-window)"); m_thread->RequestRedraw(); }
+    if (m_thread) { WINVERT_DEBUG(EW, "EW: requested redraw (post-window)"); m_thread->RequestRedraw(this); }
 }
 
 void EffectWindow::Hide()
 {
+    // Stop future callbacks before releasing render resources. Done before taking
+    // the lifecycle lock: RemoveSubscriber waits for an in-flight Render to return.
+    if (m_thread) m_thread->RemoveSubscriber(this);
+
     std::lock_guard<std::mutex> lk(m_lifecycleMutex);
     m_run = false;
+    m_renderedGen.store(0, std::memory_order_relaxed);
+    // No Render is in flight (unsubscribed above): release the pinned snapshot
+    m_frameSettings = nullptr;
+    m_settingsHandoff.Unpin();
 
-    // Stop future callbacks before releasing render resources.
-    if (m_thread) m_thread->RemoveSubscriber(this);
+    // Finish the last queued Present before the swap chain goes away
+    m_presentWorker.Stop();
+    if (m_frameLatencyWaitable) { CloseHandle(m_frameLatencyWaitable); m_frameLatencyWaitable = nullptr; }
 
+    m_lutSrv.Reset();
+    m_lutTex.Reset();
     m_cb.Reset();
+    m_pixelCb.Reset();
+    m_colorMapCb.Reset();
     m_vb.Reset();
     m_il.Reset();
     m_ps.Reset();
+    for (auto& ps : m_psVariants) ps.Reset();
     m_vs.Reset();
-    m_rtv.Reset();
+    if (m_d2dCtx) m_d2dCtx->SetTarget(nullptr);
+    m_targets.Reset();
     m_swapChain.Reset();
     m_factory.Reset();
     m_deferredCtx.Reset();
@@ -265,6 +587,12 @@ void EffectWindow::Hide()
 void EffectWindow::SetHidden(bool hidden)
 {
     m_isHidden = hidden;
+    // Force a fresh Present when shown again
+    if (!hidden)
+    {
+        m_renderedGen.store(0, std::memory_order_relaxed);
+        if (m_thread) m_thread->RequestRedraw(this);
+    }
     if (m_hwnd)
     {
         ::ShowWindow(m_hwnd, hidden ? SW_HIDE : SW_SHOWNOACTIVATE);
@@ -280,15 +608,15 @@ void EffectWindow::EnsureSRVLocked_(ID3D11Texture2D* currentTex)
         HRESULT hr = m_d3d->CreateShaderResourceView(currentTex, nullptr, &m_srv);
         if (SUCCEEDED(hr)) {
             m_srvSourceRaw = currentTex;
-            winvert4::Log("EW: SRV (re)created for new frame texture");
+            WINVERT_DEBUG(EW, "EW: SRV (re)created for new frame texture");
         } else {
-            winvert4::Logf("EW: CreateShaderResourceView failed hr=0x%08X", hr);
+            WINVERT_WARN(EW, "EW: CreateShaderResourceView failed hr=0x%08X", hr);
         }
     }
 }
 
-    void EffectWindow::UpdateCBs_()
-    {
+void EffectWindow::UpdateCBs_(const CompiledEffect& fx)
+{
     RECT outRect = m_thread->GetOutputRect();
     const float outW = float(outRect.right - outRect.left);
     const float outH = float(outRect.bottom - outRect.top);
@@ -298,60 +626,130 @@ void EffectWindow::EnsureSRVLocked_(ID3D11Texture2D* currentTex)
     const float selW = float(m_desktopRect.right  - m_desktopRect.left);
     const float selH = float(m_desktopRect.bottom - m_desktopRect.top);
 
-    // Update Vertex Shader CB
+    // Vertex Shader CB: placement only changes when the window moves
     VertexCB vcb{};
     vcb.scale[0]  = (outW > 0) ? (selW / outW) : 0.0f;
     vcb.scale[1]  = (outH > 0) ? (selH / outH) : 0.0f;
     vcb.offset[0] = (outW > 0) ? (selL / outW) : 0.0f;
     vcb.offset[1] = (outH > 0) ? (selT / outH) : 0.0f;
-    m_deferredCtx->UpdateSubresource(m_cb.Get(), 0, nullptr, &vcb, 0, 0);
-
-    // Update Pixel Shader CB
-        PixelCB pcb{};
-        bool inv = m_settings.isBrightnessProtectionEnabled ? m_effectiveInvert : m_settings.isInvertEffectEnabled;
-        pcb.enableInvert     = inv ? 1u : 0u;
-        pcb.enableMatrix     = m_settings.isCustomEffectActive ? 1u : 0u;
-        pcb.enableColorMap   = (m_settings.isColorMappingEnabled && !m_settings.colorMaps.empty()) ? 1u : 0u;
-        pcb.preserveMapBrightness = (m_settings.isColorMappingEnabled && m_settings.colorMapPreserveBrightness) ? 1u : 0u;
-        memcpy(pcb.lumaWeights, m_settings.lumaWeights, sizeof(pcb.lumaWeights));
-    if (m_settings.isCustomEffectActive)
+    if (!m_vcbUploaded || memcmp(&vcb, &m_vcb, sizeof(VertexCB)) != 0)
     {
-        memcpy(pcb.colorMat,    m_settings.colorMat,    sizeof(pcb.colorMat));
-        memcpy(pcb.colorOffset, m_settings.colorOffset, sizeof(pcb.colorOffset));
+        m_vcb = vcb;
+        m_vcbUploaded = true;
+        m_deferredCtx->UpdateSubresource(m_cb.Get(), 0, nullptr, &m_vcb, 0, 0);
+        WINVERT_TRACE(EW, "EW: CB scale=(%.3f,%.3f) offset=(%.3f,%.3f)", vcb.scale[0], vcb.scale[1], vcb.offset[0], vcb.offset[1]);
     }
-    else
+
+    // Pixel Shader CBs: repacked only when the settings or the effective invert changed
+    const uint64_t settingsGen = m_frameSettingsGen;
+    const bool invert = EffectiveInvert_();
+    if (settingsGen == m_cbPackedGen && invert == m_cbPackedInvert) return;
+
+    if (settingsGen != m_colorMapsPackedGen)
     {
-        const float ident[16] = { 1,0,0,0,  0,1,0,0,  0,0,1,0,  0,0,0,1 };
-        memset(pcb.colorOffset, 0, sizeof(pcb.colorOffset));
-        memcpy(pcb.colorMat, ident, sizeof(ident));
+        ColorMapCB maps;
+        m_colorMapPacking = PackColorMaps(FrameSettings_(), maps);
+        m_colorMapsPackedGen = settingsGen;
+        // Most settings changes (sliders, toggles) leave the table as it was
+        if (memcmp(&maps, m_pcb.colorMapSrc, sizeof(ColorMapCB)) != 0 || m_cbPackedGen == 0)
+        {
+            memcpy(m_pcb.colorMapSrc, maps.colorMapSrc, sizeof(ColorMapCB));
+            m_deferredCtx->UpdateSubresource(m_colorMapCb.Get(), 0, nullptr, m_pcb.colorMapSrc, 0, 0);
+        }
     }
-    // Fill color map list
-    uint32_t count = 0;
-    if (pcb.enableColorMap)
+
+    PixelCB& pcb = m_pcb;
+    PackPixelFlags(FrameSettings_(), fx, m_colorMapPacking.packed, pcb);
+    const uint32_t count = pcb.colorMapCount;
+    const uint32_t enabledCount = pcb.enableColorMap ? m_colorMapPacking.enabled : 0;
+    // Past kMaxColorMaps the constant buffer cannot hold the list, so the LUT (baked
+    // from the full list) is the only complete GPU path. Smaller sets keep the exact
+    // per-pixel loop: the lattice blurs map peaks and overlap edges.
+    if (pcb.enableColorMap && ColorLut::Needed(enabledCount))
     {
-        // Copy only enabled mappings to the GPU list to honor per-row toggles
-        for (size_t i = 0; i < m_settings.colorMaps.size() && count < EffectWindow::kMaxColorMaps; ++i)
+        if (EnsureColorLut_(pcb, settingsGen))
+        {
+            pcb.useColorLut = 1u;
+            pcb.lutScale = m_colorLut.Scale();
+            pcb.lutBias  = m_colorLut.Bias();
+        }
+        else if (enabledCount > count)
         {
-            const auto& e = m_settings.colorMaps[i];
-            if (!e.enabled) continue;
-            float sr = e.srcR / 255.0f, sg = e.srcG / 255.0f, sb = e.srcB / 255.0f;
-            float dr = e.dstR / 255.0f, dg = e.dstG / 255.0f, db = e.dstB / 255.0f;
-            float t  = std::max(0, std::min(255, e.tolerance)) / 255.0f;
-            float t2 = t * t; // store squared radius to avoid sqrt in shader
-            pcb.colorMapSrc[count][0] = sr; pcb.colorMapSrc[count][1] = sg; pcb.colorMapSrc[count][2] = sb; pcb.colorMapSrc[count][3] = t2;
-            pcb.colorMapDst[count][0] = dr; pcb.colorMapDst[count][1] = dg; pcb.colorMapDst[count][2] = db; pcb.colorMapDst[count][3] = 0.0f;
-            ++count;
+            WINVERT_WARN(EW, "EW: color LUT unavailable; applying first %u of %u maps", count, enabledCount);
         }
     }
-    pcb.colorMapCount = count;
     m_deferredCtx->UpdateSubresource(m_pixelCb.Get(), 0, nullptr, &pcb, 0, 0);
+    m_psKey = PixelShaderKeyFor(pcb);
+    m_cbPackedGen = settingsGen;
+    m_cbPackedInvert = invert;
+}
+
+ID3D11PixelShader* EffectWindow::PixelShaderFor_(const PixelShaderKey& key)
+{
+    const uint32_t index = key.Index();
+    ComPtr<ID3D11PixelShader>& ps = m_psVariants[index];
+    if (!ps)
+    {
+        ComPtr<ID3DBlob> blob;
+        if (!PixelVariantCache().TryGet(index, blob)) return m_ps.Get();  // still compiling (or failed)
+        const HRESULT hr = m_d3d->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &ps);
+        if (FAILED(hr))
+        {
+            WINVERT_WARN(EW, "EW: CreatePixelShader(variant %u) failed hr=0x%08X", index, hr);
+            ps.Reset();
+            return m_ps.Get();
+        }
+    }
+    return ps.Get();
+}
 
-    winvert4::Logf("EW: CB scale=(%.3f,%.3f) offset=(%.3f,%.3f)", vcb.scale[0], vcb.scale[1], vcb.offset[0], vcb.offset[1]);
+bool EffectWindow::EnsureColorLut_(const PixelCB& pcb, uint64_t settingsGen)
+{
+    // Re-bake only when the chain changed: constants (e.g. effective invert) or the
+    // settings generation, which also covers maps past the constant-buffer cap
+    if (m_lutSrv && settingsGen == m_lutBakedGen && memcmp(&pcb, &m_lutBakedCb, sizeof(PixelCB)) == 0) return true;
+
+    EffectKernel kernel(pcb);
+    kernel.SetColorMaps(FrameSettings_().colorMaps);
+    const uint32_t size = ColorLut::ChooseSize(kernel);
+    m_colorLut.Bake(kernel, size);
+
+    D3D11_TEXTURE3D_DESC cur{};
+    if (m_lutTex) m_lutTex->GetDesc(&cur);
+    if (!m_lutTex || cur.Width != size)
+    {
+        m_lutSrv.Reset();
+        m_lutTex.Reset();
+        D3D11_TEXTURE3D_DESC td{};
+        td.Width = td.Height = td.Depth = size;
+        td.MipLevels = 1;
+        td.Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+        td.Usage = D3D11_USAGE_DEFAULT;
+        td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        HRESULT hr = m_d3d->CreateTexture3D(&td, nullptr, &m_lutTex);
+        if (FAILED(hr) || !m_lutTex)
+        {
+            WINVERT_WARN(EW, "EW: CreateTexture3D (color LUT) failed hr=0x%08X", hr);
+            return false;
+        }
+        hr = m_d3d->CreateShaderResourceView(m_lutTex.Get(), nullptr, &m_lutSrv);
+        if (FAILED(hr) || !m_lutSrv)
+        {
+            WINVERT_WARN(EW, "EW: color LUT SRV failed hr=0x%08X", hr);
+            m_lutTex.Reset();
+            return false;
+        }
+    }
+    m_deferredCtx->UpdateSubresource(m_lutTex.Get(), 0, nullptr, m_colorLut.Data(), m_colorLut.RowPitch(), m_colorLut.SlicePitch());
+    m_lutBakedCb = pcb;
+    m_lutBakedGen = settingsGen;
+    WINVERT_DEBUG(EW, "EW: color LUT baked %u^3 for %u maps", size, kernel.GetColorMaps().Size());
+    return true;
 }
 
 void EffectWindow::CreateAndShow()
 {
-    winvert4::Log("EW.CreateAndShow: begin");
+    WINVERT_DEBUG(EW, "EW.CreateAndShow: begin");
     // 1) Create window and pipeline objects on this thread
     static ATOM s_atom = 0;
     if (!s_atom) {
@@ -371,8 +769,8 @@ void EffectWindow::CreateAndShow()
         kEffectWndClass, L"", WS_POPUP,
         m_desktopRect.left, m_desktopRect.top, w, h,
         nullptr, nullptr, GetModuleHandleW(nullptr), nullptr);
-    if (!m_hwnd) { winvert4::Log("EffectWindow::RenderThreadProc failed to create HWND"); return; }
-    winvert4::Logf("EW: created HWND=%p size=(%dx%d)", (void*)m_hwnd, w, h);
+    if (!m_hwnd) { WINVERT_WARN(EW, "EffectWindow::RenderThreadProc failed to create HWND"); return; }
+    WINVERT_DEBUG(EW, "EW: created HWND=%p size=(%dx%d)", (void*)m_hwnd, w, h);
 
     // Re-assert click-through + no-activate styles after creation. Some systems
     // are sensitive to style/state ordering for topmost layered overlays.
@@ -405,37 +803,19 @@ void EffectWindow::CreateAndShow()
     sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     sd.BufferCount = 2;
     sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+    sd.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
     HRESULT hrSC = m_factory->CreateSwapChainForHwnd(m_d3d.Get(), m_hwnd, &sd, nullptr, nullptr, &m_swapChain);
     if (FAILED(hrSC) || !m_swapChain) {
-        winvert4::Logf("EW: CreateSwapChainForHwnd failed hr=0x%08X", hrSC);
+        WINVERT_WARN(EW, "EW: CreateSwapChainForHwnd failed hr=0x%08X", hrSC);
         return;
     }
-    winvert4::Log("EW: swapchain created");
+    WINVERT_DEBUG(EW, "EW: swapchain created");
+    m_targets.Attach(m_d3d.Get(), m_swapChain.Get());
+    StartPresentWorker_();
 
     // Create a last-render texture for mirror capture
-    {
-        ComPtr<ID3D11Texture2D> backBuf;
-        if (SUCCEEDED(m_swapChain->GetBuffer(0, IID_PPV_ARGS(&backBuf))) && backBuf)
-        {
-            D3D11_TEXTURE2D_DESC desc{};
-            backBuf->GetDesc(&desc);
-            desc.BindFlags = 0;
-            desc.CPUAccessFlags = 0;
-            desc.Usage = D3D11_USAGE_DEFAULT;
-            desc.MiscFlags = 0;
-            HRESULT hrTex = m_d3d->CreateTexture2D(&desc, nullptr, &m_lastRenderedTex);
-            if (FAILED(hrTex) || !m_lastRenderedTex)
-            {
-                winvert4::Logf("EW: failed to create last-rendered texture hr=0x%08X", hrTex);
-                m_lastRenderedTex.Reset();
-            }
-        }
-        else
-        {
-            winvert4::Log("EW: failed to query backbuffer for mirror texture");
-        }
-    }
+    CreateLastRenderedTex_();
 
     // Init FPS timer (frequency for converting duplication QPC to seconds)
     QueryPerformanceFrequency(&m_qpcFreq);
@@ -453,9 +833,10 @@ void EffectWindow::CreateAndShow()
     // Shaders (compiled once per process and cached)
     ComPtr<ID3DBlob> vsb, psb;
     if (!GetOrCompileShaders(vsb, psb)) {
-        winvert4::Log("EW: failed to initialize shader cache");
+        WINVERT_WARN(EW, "EW: failed to initialize shader cache");
         return;
     }
+    StartPixelVariantCompiles();
 
     if (FAILED(m_d3d->CreateVertexShader(vsb->GetBufferPointer(), vsb->GetBufferSize(), nullptr, &m_vs))) return;
     if (FAILED(m_d3d->CreatePixelShader(psb->GetBufferPointer(), psb->GetBufferSize(), nullptr, &m_ps))) return;
@@ -470,18 +851,21 @@ void EffectWindow::CreateAndShow()
     D3D11_BUFFER_DESC vscbd{}; vscbd.ByteWidth = sizeof(VertexCB); vscbd.Usage = D3D11_USAGE_DEFAULT; vscbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     if (FAILED(m_d3d->CreateBuffer(&vscbd, nullptr, &m_cb))) return;
 
-    D3D11_BUFFER_DESC pscbd{}; pscbd.ByteWidth = sizeof(PixelCB); pscbd.Usage = D3D11_USAGE_DEFAULT; pscbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    D3D11_BUFFER_DESC pscbd{}; pscbd.ByteWidth = UINT(kPixelFlagsBytes); pscbd.Usage = D3D11_USAGE_DEFAULT; pscbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     if (FAILED(m_d3d->CreateBuffer(&pscbd, nullptr, &m_pixelCb))) return;
+    pscbd.ByteWidth = sizeof(ColorMapCB);
+    if (FAILED(m_d3d->CreateBuffer(&pscbd, nullptr, &m_colorMapCb))) return;
+    // Fresh buffers: the next UpdateCBs_ uploads everything
+    m_vcbUploaded = false;
+    m_cbPackedGen = 0;
+    m_colorMapsPackedGen = 0;
 
     D3D11_SAMPLER_DESC sampd{}; sampd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
     sampd.AddressU = sampd.AddressV = sampd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
     if (FAILED(m_d3d->CreateSamplerState(&sampd, &m_samp))) return;
 
-    // Precreate RTV (render loop also recreates per-frame for robustness)
-    ComPtr<ID3D11Texture2D> backBuf;
-    if (SUCCEEDED(m_swapChain->GetBuffer(0, IID_PPV_ARGS(&backBuf)))) {
-        m_d3d->CreateRenderTargetView(backBuf.Get(), nullptr, &m_rtv);
-    }
+    // Back buffer RTV, reused by every frame until the swap chain is resized
+    if (!m_targets.Rtv()) return;
 
     // Exclude from capture.
     SetWindowDisplayAffinity(m_hwnd, WDA_EXCLUDEFROMCAPTURE);
@@ -489,12 +873,12 @@ void EffectWindow::CreateAndShow()
         BOOL exclude = TRUE;
         HRESULT hr = DwmSetWindowAttribute(m_hwnd, DWMWA_EXCLUDED_FROM_CAPTURE, &exclude, sizeof(exclude));
         if (FAILED(hr)) {
-            winvert4::Logf("EW: DwmSetWindowAttribute failed hr=0x%08X", hr);
+            WINVERT_WARN(EW, "EW: DwmSetWindowAttribute failed hr=0x%08X", hr);
         }
     }
 
     ShowWindow(m_hwnd, SW_SHOWNOACTIVATE);
-    winvert4::Log("EW: ShowWindow(SW_SHOWNOACTIVATE)");
+    WINVERT_DEBUG(EW, "EW: ShowWindow(SW_SHOWNOACTIVATE)");
 
     m_run = true;
 
@@ -502,20 +886,15 @@ void EffectWindow::CreateAndShow()
     // even before the first duplication frame arrives. Use opaque alpha to avoid
     // the layered window being fully transparent on the first Present.
     {
-        ComPtr<ID3D11Texture2D> bb;
-        if (SUCCEEDED(m_swapChain->GetBuffer(0, IID_PPV_ARGS(&bb))) && bb)
-        {
-            ComPtr<ID3D11RenderTargetView> rtv;
-            if (SUCCEEDED(m_d3d->CreateRenderTargetView(bb.Get(), nullptr, &rtv)))
-            {
-                const float clear[4] = { 0,0,0,1 };
-                m_immediateCtx->OMSetRenderTargets(1, rtv.GetAddressOf(), nullptr);
-                m_immediateCtx->ClearRenderTargetView(rtv.Get(), clear);
-                // Present immediately without waiting for vblank on the very first frame
-                winvert4::Log("EW: first clear + Present(0,0)");
-                m_swapChain->Present(0, 0);
-            }
-        }
+        ID3D11RenderTargetView* rtv = m_targets.Rtv();
+        const float clear[4] = { 0,0,0,1 };
+        m_immediateCtx->OMSetRenderTargets(1, &rtv, nullptr);
+        m_immediateCtx->ClearRenderTargetView(rtv, clear);
+        // Unbind so the shared immediate context holds no reference to our buffers
+        m_immediateCtx->OMSetRenderTargets(0, nullptr, nullptr);
+        // Present immediately without waiting for vblank on the very first frame
+        WINVERT_DEBUG(EW, "EW: first clear + Present(0,0)");
+        m_swapChain->Present(0, 0);
     }
 
     if (m_settings.showFpsOverlay)
@@ -526,7 +905,7 @@ void EffectWindow::CreateAndShow()
     {
         EnsureBrightnessResources_();
     }
-    winvert4::Log("EW.CreateAndShow: end");
+    WINVERT_DEBUG(EW, "EW.CreateAndShow: end");
 }
 
 void EffectWindow::EnsureOverlayResources_()
@@ -578,6 +957,30 @@ void EffectWindow::EnsureOverlayResources_()
     }
 }
 
+void EffectWindow::CreateLastRenderedTex_()
+{
+    std::lock_guard<std::mutex> lk(m_lastRenderMutex);
+    m_lastRenderedTex.Reset();
+    ID3D11Texture2D* backBuf = m_targets.BackBuffer();
+    if (!backBuf)
+    {
+        WINVERT_WARN(EW, "EW: failed to query backbuffer for mirror texture");
+        return;
+    }
+    D3D11_TEXTURE2D_DESC desc{};
+    backBuf->GetDesc(&desc);
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = 0;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.MiscFlags = 0;
+    HRESULT hrTex = m_d3d->CreateTexture2D(&desc, nullptr, &m_lastRenderedTex);
+    if (FAILED(hrTex) || !m_lastRenderedTex)
+    {
+        WINVERT_WARN(EW, "EW: failed to create last-rendered texture hr=0x%08X", hrTex);
+        m_lastRenderedTex.Reset();
+    }
+}
+
 void EffectWindow::EnsureBrightnessResources_()
 {
     if (!m_d3d || m_mipTex) return;
@@ -618,33 +1021,72 @@ void EffectWindow::EnsureBrightnessResources_()
     rd.SampleDesc.Count = 1;
     rd.Usage = D3D11_USAGE_STAGING;
     rd.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-    m_d3d->CreateTexture2D(&rd, nullptr, &m_mipReadback1x1);
+    for (auto& staging : m_mipReadback) m_d3d->CreateTexture2D(&rd, nullptr, &staging);
 }
 
-void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresentQpc)
+bool EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresentQpc, bool regionDirty)
 {
     std::lock_guard<std::mutex> lk(m_lifecycleMutex);
-    if (!m_run) { winvert4::Log("EW.Render early exit: m_run=false"); return; }
-    if (m_isHidden) { winvert4::Log("EW.Render early exit: hidden"); return; }
-    if (!frame) { winvert4::Log("EW.Render early exit: frame=null"); return; }
-    if (!m_swapChain) { winvert4::Log("EW.Render early exit: swapchain=null"); return; }
+    if (!m_run) { WINVERT_TRACE(EW, "EW.Render early exit: m_run=false"); return false; }
+    if (m_isHidden) { WINVERT_TRACE(EW, "EW.Render early exit: hidden"); return false; }
+    if (!frame) { WINVERT_TRACE(EW, "EW.Render early exit: frame=null"); return false; }
+    if (!m_swapChain) { WINVERT_TRACE(EW, "EW.Render early exit: swapchain=null"); return false; }
+
+    // Newest settings, pinned for this frame: UpdateSettings publishes a new snapshot
+    // instead of writing to the one in use
+    const auto& snapshot = m_settingsHandoff.Acquire();
+    const EffectSettings& settings = snapshot.value;
+    const uint64_t settingsGen = snapshot.generation;
+    m_frameSettings = &settings;
+    if (settingsGen != m_frameSettingsGen)
+    {
+        // Reset brightness protection debounce when settings change
+        m_frameSettingsGen = settingsGen;
+        m_brightness.ClearPending();
+    }
 
-    if (m_settings.showFpsOverlay)
+    // Nothing new to show: no damage in our region, settings unchanged since the last
+    // Present and no brightness readback or decision pending. Skips the readback, draw
+    // and Present.
+    if (!regionDirty && settingsGen == m_renderedGen.load(std::memory_order_relaxed) &&
+        !m_brightness.NeedsFrames() && !settings.showFpsOverlay)
+    {
+        m_framesSkipped.fetch_add(1, std::memory_order_relaxed);
+        m_metrics.skipped->Add();
+        return false;
+    }
+    // Window identity as the event argument so overlapping subscribers can be told apart
+    frametrace::TraceScope renderScope(frametrace::Stage::Render, uint64_t(reinterpret_cast<uintptr_t>(this)));
+    {
+        LARGE_INTEGER now{};
+        QueryPerformanceCounter(&now);
+        m_frameRenderQpc = uint64_t(now.QuadPart);
+        m_frameCaptureQpc = lastPresentQpc;
+        if (lastPresentQpc != 0 && m_frameRenderQpc > lastPresentQpc)
+        {
+            m_metrics.captureToRender->Record(QpcToNs_(m_frameRenderQpc - lastPresentQpc), winvert4::metrics::NowNs());
+        }
+    }
+
+    if (settings.showFpsOverlay)
     {
         EnsureOverlayResources_();
     }
-    if (m_settings.isBrightnessProtectionEnabled)
+    if (settings.isBrightnessProtectionEnabled)
     {
         EnsureBrightnessResources_();
     }
 
     // Ensure SRV reflects current texture
     EnsureSRVLocked_(frame);
-    if (!m_srv) { winvert4::Log("EW.Render early exit: SRV null"); return; }
+    if (!m_srv) { WINVERT_TRACE(EW, "EW.Render early exit: SRV null"); return false; }
 
-    // Brightness protection: compute average luminance of the region via mipmap reduction
-    if (m_settings.isBrightnessProtectionEnabled && m_mipTex && m_mipSrv && m_mipReadback1x1)
+    // Brightness protection: compute average luminance of the region via mipmap
+    // reduction. Readbacks go through a staging ring and are consumed a few frames
+    // later, so the capture thread never waits for the GPU to finish the mip chain.
+    if (settings.isBrightnessProtectionEnabled && m_mipTex && m_mipSrv && m_mipReadback[0])
     {
+        frametrace::TraceScope ts(frametrace::Stage::Brightness);
         RECT outRect = m_thread->GetOutputRect();
         D3D11_BOX box{};
         box.left = (UINT)(m_desktopRect.left - outRect.left);
@@ -652,84 +1094,101 @@ void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresent
         box.right  = (UINT)(box.left + (m_desktopRect.right - m_desktopRect.left));
         box.bottom = (UINT)(box.top  + (m_desktopRect.bottom - m_desktopRect.top));
         box.front = 0; box.back = 1;
-        m_immediateCtx->CopySubresourceRegion(m_mipTex.Get(), 0, 0, 0, 0, frame, 0, &box);
-        m_immediateCtx->GenerateMips(m_mipSrv.Get());
-
-        // Copy last mip to 1x1 staging and read CPU-side
-        m_immediateCtx->CopySubresourceRegion(m_mipReadback1x1.Get(), 0, 0, 0, 0, m_mipTex.Get(), m_mipLastLevel, nullptr);
-        D3D11_MAPPED_SUBRESOURCE map{};
-        if (SUCCEEDED(m_immediateCtx->Map(m_mipReadback1x1.Get(), 0, D3D11_MAP_READ, 0, &map)))
+        StagingReadback target(m_immediateCtx.Get(), frame, box, m_mipTex.Get(), m_mipSrv.Get(), m_mipLastLevel, m_mipReadback);
+
+        const uint64_t beginNs = winvert4::metrics::NowNs();
+        const auto result = m_brightness.Frame(target, regionDirty, settings.lumaWeights, settings.brightnessProtectionDelayFrames);
+        const uint64_t endNs = winvert4::metrics::NowNs();
+        m_metrics.readback->Record(endNs - beginNs, endNs);
+        if (endNs - beginNs >= kReadbackStallNs) m_metrics.readbackStalls->Add();
+        if (result.samples > 0)
         {
-            const uint8_t* px = static_cast<const uint8_t*>(map.pData);
-            float b = px[0] / 255.0f; float g = px[1] / 255.0f; float r = px[2] / 255.0f;
-            // Use configurable luma weights
-            m_avgLuma = r * m_settings.lumaWeights[0] + g * m_settings.lumaWeights[1] + b * m_settings.lumaWeights[2];
-            m_immediateCtx->Unmap(m_mipReadback1x1.Get(), 0);
-
-            // Determine desired state: choose the darker result by comparing luma to inverted luma.
-            float invertedLuma = 1.0f - m_avgLuma;
-            bool desired = (invertedLuma < m_avgLuma);
-            int delay = (m_settings.brightnessProtectionDelayFrames < 0) ? 0 : m_settings.brightnessProtectionDelayFrames;
-            if (delay <= 0)
-            {
-                bool previousInvert = m_effectiveInvert;
-                m_effectiveInvert = desired;
-                if (m_effectiveInvert != previousInvert)
-                {
-                    winvert4::Logf("EW: Brightness protection flipped to %s (Luma: %.3f, Inverted Luma: %.3f)",
-                        m_effectiveInvert ? "ON" : "OFF", m_avgLuma, invertedLuma);
-                }
-                m_brightProtPendingCount = 0;
-                m_brightProtPendingState = desired;
-            }
-            else
-            {
-                if (desired == m_effectiveInvert)
-                {
-                    // Already matched; clear pending
-                    m_brightProtPendingCount = 0;
-                    m_brightProtPendingState = desired;
-                }
-                else
-                {
-                    if (m_brightProtPendingCount == 0 || m_brightProtPendingState != desired)
-                    {
-                        m_brightProtPendingState = desired;
-                        m_brightProtPendingCount = 1;
-                    }
-                    else
-                    {
-                        m_brightProtPendingCount++;
-                    }
-
-                    if (m_brightProtPendingCount >= delay)
-                    {
-                        m_effectiveInvert = desired;
-                        m_brightProtPendingCount = 0;
-                        winvert4::Logf("EW: Brightness protection flipped (delayed %d) to %s (Luma: %.3f, Inverted Luma: %.3f)",
-                            delay, m_effectiveInvert ? "ON" : "OFF", m_avgLuma, invertedLuma);
-                    }
-                }
-            }
+            m_avgLuma = result.luma;
+            m_metrics.avgLuma->Set(m_avgLuma);
+            m_metrics.readbackLatencyFrames->Set(double(result.latencyFrames));
+        }
+        if (result.flipped)
+        {
+            WINVERT_DEBUG(EW, "EW: Brightness protection flipped to %s (Luma: %.3f, Inverted Luma: %.3f, delay %d)",
+                m_brightness.Invert() ? "ON" : "OFF", m_avgLuma, 1.0f - m_avgLuma, settings.brightnessProtectionDelayFrames);
         }
     }
     else
     {
-        m_effectiveInvert = m_settings.isInvertEffectEnabled;
-        m_brightProtPendingCount = 0;
+        m_brightness.Disable(settings.isInvertEffectEnabled);
+    }
+    // Outstanding readbacks and a pending flip count rendered frames; keep them coming
+    // while the desktop is idle, one per refresh period: a readback is not done
+    // sooner, and the debounce counts display frames
+    if (m_brightness.NeedsFrames() && m_thread)
+    {
+        const float hz = m_thread->GetOutputHz();
+        const uint64_t periodNs = uint64_t(1e9 / double(hz > 1.0f ? hz : 60.0f));
+        m_thread->RequestRedrawAt(this, winvert4::metrics::NowNs() + periodNs);
     }
 
-    // Recreate RTV each frame (resize-robust)
-    ComPtr<ID3D11Texture2D> backBuf;
-    if (FAILED(m_swapChain->GetBuffer(0, IID_PPV_ARGS(&backBuf)))) {
-        winvert4::Log("EW.Render: GetBuffer failed; Present passthrough");
-        m_swapChain->Present(1, 0);
-        return;
+    // Compose invert + custom matrix once per frame
+    const CompiledEffect fx = CompileEffectSettings(settings, EffectiveInvert_());
+
+    // From here on the back buffer is written: keep the present worker out until this
+    // frame is complete and submitted
+    std::lock_guard<std::mutex> bbLock(m_backBufferMutex);
+
+    // Identity transform: copy the source region to the back buffer and skip the draw
+    if (fx.isPassThrough && !settings.showFpsOverlay)
+    {
+        D3D11_TEXTURE2D_DESC fd{};
+        frame->GetDesc(&fd);
+        ID3D11Texture2D* bb = m_targets.BackBuffer();
+        D3D11_TEXTURE2D_DESC bd{};
+        if (bb) bb->GetDesc(&bd);
+        // The region in source pixels. A copy only covers it when it lies wholly inside
+        // the frame (a window straddling outputs, or a rect not yet updated after a
+        // mode change, does not) and fits the back buffer; otherwise the draw path
+        // samples it with clamping.
+        const RECT outRect = m_thread->GetOutputRect();
+        const LONG srcLeft = m_desktopRect.left - outRect.left;
+        const LONG srcTop = m_desktopRect.top - outRect.top;
+        const LONG srcRight = srcLeft + (m_desktopRect.right - m_desktopRect.left);
+        const LONG srcBottom = srcTop + (m_desktopRect.bottom - m_desktopRect.top);
+        const bool inside = srcLeft >= 0 && srcTop >= 0 && srcRight > srcLeft && srcBottom > srcTop &&
+            srcRight <= LONG(fd.Width) && srcBottom <= LONG(fd.Height) &&
+            UINT(srcRight - srcLeft) <= bd.Width && UINT(srcBottom - srcTop) <= bd.Height;
+        if (fd.Format == DXGI_FORMAT_B8G8R8A8_UNORM && bb && inside)
+        {
+            D3D11_BOX box{};
+            box.left = UINT(srcLeft);
+            box.top = UINT(srcTop);
+            box.right = UINT(srcRight);
+            box.bottom = UINT(srcBottom);
+            box.front = 0; box.back = 1;
+            m_immediateCtx->CopySubresourceRegion(bb, 0, 0, 0, 0, frame, 0, &box);
+            if (m_lastRenderedTex)
+            {
+                std::lock_guard<std::mutex> lk(m_lastRenderMutex);
+                m_immediateCtx->CopyResource(m_lastRenderedTex.Get(), bb);
+            }
+            WINVERT_TRACE(EW, "EW.Render: pass-through copy + Present(1,0)");
+            PresentFrame_();
+            m_renderedGen.store(settingsGen, std::memory_order_relaxed);
+            m_framesRendered.fetch_add(1, std::memory_order_relaxed);
+            m_metrics.rendered->Add();
+            return true;
+        }
+    }
+
+    // Cached back buffer views; they follow the flip model's buffer rotation
+    ID3D11Texture2D* backBuf = m_targets.BackBuffer();
+    ID3D11RenderTargetView* rtv = m_targets.Rtv();
+    if (!backBuf || !rtv) {
+        WINVERT_WARN(EW, "EW.Render: no back buffer view; Present passthrough");
+        PresentFrame_();
+        return false;
     }
-    ComPtr<ID3D11RenderTargetView> localRTV;
-    m_d3d->CreateRenderTargetView(backBuf.Get(), nullptr, &localRTV);
 
     // Use the deferred context to build commands
+    const bool tracing = frametrace::Recorder::Global().IsEnabled();
+    const uint64_t recordBegin = tracing ? frametrace::NowNs() : 0;
     m_deferredCtx->ClearState();
 
     // Bind pipeline
@@ -751,32 +1210,37 @@ void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresent
     ID3D11Buffer* vscb = m_cb.Get();
     m_deferredCtx->VSSetConstantBuffers(0, 1, &vscb);
 
-    m_deferredCtx->PSSetShader(m_ps.Get(), nullptr, 0);
-    ID3D11Buffer* pscb = m_pixelCb.Get();
-    m_deferredCtx->PSSetConstantBuffers(1, 1, &pscb);
+    ID3D11Buffer* pscbs[2] = { m_pixelCb.Get(), m_colorMapCb.Get() };
+    m_deferredCtx->PSSetConstantBuffers(1, 2, pscbs);
 
     ID3D11SamplerState* ss = m_samp.Get();
     m_deferredCtx->PSSetSamplers(0, 1, &ss);
     ID3D11ShaderResourceView* srv = m_srv.Get();
     m_deferredCtx->PSSetShaderResources(0, 1, &srv);
 
-    ID3D11RenderTargetView* rtv = localRTV.Get();
     m_deferredCtx->OMSetRenderTargets(1, &rtv, nullptr);
 
-    // Update constants & draw (invert handled in pixel shader)
-    UpdateCBs_();
+    // Update constants & draw (invert folded into the matrix)
+    UpdateCBs_(fx);
+    // Specialized for the packed constants (chosen in UpdateCBs_)
+    m_deferredCtx->PSSetShader(PixelShaderFor_(m_psKey), nullptr, 0);
+    // Bound after UpdateCBs_ since that may (re)create the LUT
+    ID3D11ShaderResourceView* lutSrv = m_lutSrv.Get();
+    m_deferredCtx->PSSetShaderResources(1, 1, &lutSrv);
 
     const float clear[4] = { 0,0,0,0 };
-    m_deferredCtx->ClearRenderTargetView(localRTV.Get(), clear);
+    m_deferredCtx->ClearRenderTargetView(rtv, clear);
     m_deferredCtx->Draw(3, 0);
 
     // Unbind SRV to avoid hazards if source updates immediately
-    ID3D11ShaderResourceView* nullSRV[1] = { nullptr };
-    m_deferredCtx->PSSetShaderResources(0, 1, nullSRV);
+    ID3D11ShaderResourceView* nullSRV[2] = { nullptr, nullptr };
+    m_deferredCtx->PSSetShaderResources(0, 2, nullSRV);
 
     // Execute commands on the immediate context
     ComPtr<ID3D11CommandList> commandList;
-    if (SUCCEEDED(m_deferredCtx->FinishCommandList(FALSE, &commandList))) {
+    const HRESULT hrFinish = m_deferredCtx->FinishCommandList(FALSE, &commandList);
+    if (tracing) frametrace::Recorder::Global().Record(frametrace::Stage::Record, recordBegin, frametrace::NowNs());
+    if (SUCCEEDED(hrFinish)) {
         // GPU timer begin (immediate context)
         GpuTimerSlot& slot = m_gpuTimer[m_gpuTimerIndex];
         if (slot.inFlight)
@@ -791,7 +1255,10 @@ void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresent
         }
 
         // Execute draw commands
-        m_immediateCtx->ExecuteCommandList(commandList.Get(), FALSE);
+        {
+            frametrace::TraceScope ts(frametrace::Stage::Execute);
+            m_immediateCtx->ExecuteCommandList(commandList.Get(), FALSE);
+        }
 
         // GPU timer end
         if (!slot.inFlight && slot.disjoint && slot.start && slot.end)
@@ -804,65 +1271,61 @@ void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresent
     }
 
     // Optional FPS overlay (top-right)
-    if (m_settings.showFpsOverlay && m_d2dCtx && m_textFormat && m_textBrush)
+    if (settings.showFpsOverlay && m_d2dCtx && m_textFormat && m_textBrush)
     {
-        // Obtain current back buffer as DXGI surface and set as D2D target
-        ComPtr<ID3D11Texture2D> backBuf;
-        if (SUCCEEDED(m_swapChain->GetBuffer(0, IID_PPV_ARGS(&backBuf))) && backBuf)
+        // D2D target over the back buffer, created once with the swap chain's views
+        if (ID2D1Bitmap1* targetBmp = m_targets.D2DTarget(m_d2dCtx.Get()))
         {
-            ComPtr<IDXGISurface> surf;
-            if (SUCCEEDED(backBuf.As(&surf)))
+            m_d2dCtx->SetTarget(targetBmp);
+            m_d2dCtx->BeginDraw();
+
+            const float w = static_cast<float>(m_desktopRect.right - m_desktopRect.left);
+            // Compact overlay: clamped draw Hz vs source Hz, draw time, and present latency
+            D2D1_RECT_F rect1 = D2D1::RectF(w - 140.f, 4.f,  w - 6.f, 24.f);
+            D2D1_RECT_F rect2 = D2D1::RectF(w - 140.f, 24.f, w - 6.f, 44.f);
+            D2D1_RECT_F rect3 = D2D1::RectF(w - 140.f, 44.f, w - 6.f, 64.f);
+
+            // Clamp draw frequency to monitor/source frequency to avoid meaningless high Hz when draw<vsync
+            // Prefer the measured monitor refresh from the duplication thread; fall back to computed fps
+            float srcHz = m_thread ? m_thread->GetOutputHz() : 0.0f;
+            const bool vrr = m_thread && m_thread->GetRefreshEstimate().variable;
+            if (srcHz <= 0.0f) srcHz = m_fps;
+            float drawHz = m_procFps;
+            if (srcHz > 0.0f && drawHz > srcHz) drawHz = srcHz;
+
+            wchar_t line1[64]; swprintf_s(line1, vrr ? L"%.0f/%.0f Hz VRR" : L"%.0f/%.0f Hz", drawHz, srcHz);
+            wchar_t line2[64]; swprintf_s(line2, L"Draw %.2f ms", m_gpuMsLast);
+            m_d2dCtx->DrawTextW(line1, (UINT32)wcslen(line1), m_textFormat.Get(), rect1, m_textBrush.Get());
+            m_d2dCtx->DrawTextW(line2, (UINT32)wcslen(line2), m_textFormat.Get(), rect2, m_textBrush.Get());
+            // Desktop present to our present, p50/p99 over the last ~10 s
+            const winvert4::LatencyHistogram::Summary lat = m_metrics.total->Summarize(winvert4::metrics::NowNs());
+            if (lat.count > 0)
             {
-                D2D1_BITMAP_PROPERTIES1 bp = D2D1::BitmapProperties1(
-                    D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
-                    D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
-                ::Microsoft::WRL::ComPtr<ID2D1Bitmap1> targetBmp;
-                if (SUCCEEDED(m_d2dCtx->CreateBitmapFromDxgiSurface(surf.Get(), &bp, &targetBmp)))
-                {
-                    m_d2dCtx->SetTarget(targetBmp.Get());
-                    m_d2dCtx->BeginDraw();
-
-                    const float w = static_cast<float>(m_desktopRect.right - m_desktopRect.left);
-                    // Two-line compact overlay: clamped draw Hz vs source Hz, and draw time
-                    D2D1_RECT_F rect1 = D2D1::RectF(w - 140.f, 4.f,  w - 6.f, 24.f);
-                    D2D1_RECT_F rect2 = D2D1::RectF(w - 140.f, 24.f, w - 6.f, 44.f);
-
-                    // Clamp draw frequency to monitor/source frequency to avoid meaningless high Hz when draw<vsync
-                    // Prefer static monitor refresh from duplication thread; fall back to computed fps
-                    float srcHz = m_thread ? m_thread->GetOutputHz() : 0.0f;
-                    if (srcHz <= 0.0f) srcHz = m_fps;
-                    float drawHz = m_procFps;
-                    if (srcHz > 0.0f && drawHz > srcHz) drawHz = srcHz;
-
-                    wchar_t line1[64]; swprintf_s(line1, L"%.0f/%.0f Hz", drawHz, srcHz);
-                    wchar_t line2[64]; swprintf_s(line2, L"Draw %.2f ms", m_gpuMsLast);
-                    m_d2dCtx->DrawTextW(line1, (UINT32)wcslen(line1), m_textFormat.Get(), rect1, m_textBrush.Get());
-                    m_d2dCtx->DrawTextW(line2, (UINT32)wcslen(line2), m_textFormat.Get(), rect2, m_textBrush.Get());
-
-                    // Optional: subtle background for readability
-                    // Could draw with another brush under text if desired
-
-                    HRESULT hr = m_d2dCtx->EndDraw();
-                    (void)hr;
-                }
+                wchar_t line3[64]; swprintf_s(line3, L"Lat %.1f/%.1f ms", lat.p50Ms, lat.p99Ms);
+                m_d2dCtx->DrawTextW(line3, (UINT32)wcslen(line3), m_textFormat.Get(), rect3, m_textBrush.Get());
             }
+
+            // Optional: subtle background for readability
+            // Could draw with another brush under text if desired
+
+            HRESULT hr = m_d2dCtx->EndDraw();
+            (void)hr;
         }
     }
 
     // Copy the final back buffer into the mirror source texture
     if (m_lastRenderedTex)
     {
-        ComPtr<ID3D11Texture2D> backBuf;
-        if (SUCCEEDED(m_swapChain->GetBuffer(0, IID_PPV_ARGS(&backBuf))) && backBuf)
-        {
-            std::lock_guard<std::mutex> lk(m_lastRenderMutex);
-            m_immediateCtx->CopyResource(m_lastRenderedTex.Get(), backBuf.Get());
-        }
+        std::lock_guard<std::mutex> lk(m_lastRenderMutex);
+        m_immediateCtx->CopyResource(m_lastRenderedTex.Get(), backBuf);
     }
 
-    // Present blocks to vblank when sync interval = 1 (vsynced to monitor)
-    winvert4::Log("EW.Render: Present(1,0)");
-    m_swapChain->Present(1, 0);
+    // Present(1,0) is vsynced; it runs on the present worker so the capture thread moves on
+    WINVERT_TRACE(EW, "EW.Render: Present(1,0)");
+    PresentFrame_();
+    m_renderedGen.store(settingsGen, std::memory_order_relaxed);
+    m_framesRendered.fetch_add(1, std::memory_order_relaxed);
+    m_metrics.rendered->Add();
 
     // FPS calculation based on DXGI Desktop Duplication's LastPresentTime (QPC)
     // This reflects the monitor's present cadence, independent of our swapchain/window mode.
@@ -877,6 +1340,7 @@ void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresent
                 if (m_fpsAccum >= 0.5)
                 {
                     m_fps = static_cast<float>(m_fpsFrames / m_fpsAccum);
+                    m_metrics.fps->Set(m_fps);
                     m_fpsAccum = 0.0; m_fpsFrames = 0;
                 }
             }
@@ -885,6 +1349,7 @@ void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresent
     }
 
     // Resolve GPU timers for any slots in flight (non-blocking)
+    frametrace::TraceScope resolveScope(frametrace::Stage::GpuResolve);
     for (int i = 0; i < 8; ++i)
     {
         if (!m_gpuTimer[i].inFlight) continue;
@@ -903,10 +1368,12 @@ void EffectWindow::Render(ID3D11Texture2D* frame, unsigned long long lastPresent
                 {
                     const double gpuSec = double(tsEnd - tsStart) / double(disjointData.Frequency);
                     m_gpuMsLast = gpuSec * 1000.0;
+                    m_metrics.gpuMs->Set(m_gpuMsLast);
                     if (m_gpuMsLast > 0.0) m_procFps = static_cast<float>(1000.0 / m_gpuMsLast);
                 }
             }
             t.inFlight = false;
         }
     }
+    return true;
 }
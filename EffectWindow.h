@@ -1,7 +1,17 @@
-#pragma once
+﻿#pragma once
 #include "pch.h"
 #include "Subscription.h"
 #include "EffectSettings.h"
+#include "EffectConstants.h"
+#include "EffectCompiler.h"
+#include "ColorLut.h"
+#include "CaptureLoop.h"
+#include "PresentWorker.h"
+#include "SwapChainTargets.h"
+#include "SnapshotHandoff.h"
+#include "ShaderVariants.h"
+#include "BrightnessReadback.h"
+#include "Metrics.h"
 #include <mutex>
 #include <condition_variable>
 
@@ -9,7 +19,7 @@
 class DuplicationThread;
 class OutputManager;
 
-class EffectWindow : public ISubscriber
+class EffectWindow : public ISubscriber, public winvert4::IFrameSink
 {
 public:
     explicit EffectWindow(RECT desktopRect, OutputManager* outputManager);
@@ -20,12 +30,32 @@ public:
     void SetHidden(bool hidden);
     bool IsHidden() const { return m_isHidden; }
     void UpdateSettings(const EffectSettings& settings);
-
-    // Called by DuplicationThread to render a frame
-    void Render(ID3D11Texture2D* frame, unsigned long long lastPresentQpc);
+    // Load or compile the shared shaders in the background so the first window
+    // does not wait for them. Safe to call repeatedly.
+    static void PrewarmShaders();
+
+    // Called on the capture thread (via OnFrame) to render a frame. regionDirty is false when no
+    // dirty or move rect of this frame touched the window's region; such frames are
+    // skipped unless settings changed. Returns true when a new image was presented.
+    bool Render(ID3D11Texture2D* frame, unsigned long long lastPresentQpc, bool regionDirty);
+    uint64_t GetRenderedFrameCount() const { return m_framesRendered.load(std::memory_order_relaxed); }
+    uint64_t GetSkippedFrameCount() const { return m_framesSkipped.load(std::memory_order_relaxed); }
     ::Microsoft::WRL::ComPtr<ID3D11Texture2D> GetLastRenderedTexture();
     RECT GetDesktopRect() const { return m_desktopRect; }
 
+    // Latency percentiles over the last ~10 s, from the desktop presenting a frame
+    // (duplication LastPresentTime) to this window presenting it. Any thread.
+    struct LatencyStats
+    {
+        winvert4::LatencyHistogram::Summary captureToRender;  // desktop present -> Render start
+        winvert4::LatencyHistogram::Summary renderToPresent;  // Render start -> our Present returned
+        winvert4::LatencyHistogram::Summary total;
+    };
+    LatencyStats GetLatencyStats() const;
+
+    // IFrameSink: the capture loop hands over the shared frame texture
+    bool OnFrame(const winvert4::FrameEvent& ev) override;
+
     // ISubscriber implementation (now a no-op, but required to compile)
     void OnFrameReady(::Microsoft::WRL::ComPtr<ID3D11Texture2D> texture) override;
 
@@ -35,9 +65,23 @@ private:
     void CreateAndShow();
 
     void EnsureSRVLocked_(ID3D11Texture2D* currentTex);
-    void UpdateCBs_();
+    void UpdateCBs_(const CompiledEffect& fx);
+    // Device object for key's kPS variant; the uber shader until the variant is compiled
+    ID3D11PixelShader* PixelShaderFor_(const PixelShaderKey& key);
+    // Settings snapshot pinned by the current Render (capture thread only)
+    const EffectSettings& FrameSettings_() const { return *m_frameSettings; }
+    bool EffectiveInvert_() const { return FrameSettings_().isBrightnessProtectionEnabled ? m_brightness.Invert() : FrameSettings_().isInvertEffectEnabled; }
     void EnsureOverlayResources_();
     void EnsureBrightnessResources_();
+    // (Re)create the mirror copy of the back buffer at the current size
+    void CreateLastRenderedTex_();
+    bool EnsureColorLut_(const PixelCB& pcb, uint64_t settingsGen);
+    // Hand the back buffer to the present worker (synchronous Present if it is not running)
+    void PresentFrame_();
+    void StartPresentWorker_();
+    // Present returned for the frame published by PresentFrame_: record its latencies
+    void RecordPresentLatency_();
+    uint64_t QpcToNs_(uint64_t qpc) const;
 
 private:
     // Geometry/placement
@@ -50,40 +94,66 @@ private:
     ::Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_immediateCtx; // Shared immediate context
     ::Microsoft::WRL::ComPtr<IDXGIFactory2>       m_factory;
     ::Microsoft::WRL::ComPtr<IDXGISwapChain1>     m_swapChain;
+    // Signaled when the swap chain can queue a frame without Present blocking
+    HANDLE m_frameLatencyWaitable{ nullptr };
+    // Held while Render writes the back buffer and while the worker presents it
+    // (declared first: the worker uses it until it is stopped)
+    std::mutex m_backBufferMutex;
+    // Presents on its own thread so vblank waits do not stall the capture thread
+    winvert4::PresentWorker m_presentWorker;
+
+    // Back buffer views (RTV, D2D target), created once per swap chain size
+    SwapChainTargets m_targets;
 
     // Pipeline
-    ::Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_rtv;
     ::Microsoft::WRL::ComPtr<ID3D11VertexShader>      m_vs;
-    ::Microsoft::WRL::ComPtr<ID3D11PixelShader>       m_ps;
+    ::Microsoft::WRL::ComPtr<ID3D11PixelShader>       m_ps;  // uber shader
+    // Specialized variants on this window's device, created on first use
+    ::Microsoft::WRL::ComPtr<ID3D11PixelShader>       m_psVariants[PixelShaderKey::kCount];
     ::Microsoft::WRL::ComPtr<ID3D11InputLayout>       m_il;
     ::Microsoft::WRL::ComPtr<ID3D11Buffer>            m_vb;
     ::Microsoft::WRL::ComPtr<ID3D11Buffer>            m_cb;
     ::Microsoft::WRL::ComPtr<ID3D11SamplerState>      m_samp;
     ::Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_srv;
 
-    struct VertexCB { float scale[2]; float offset[2]; };
-    static constexpr uint32_t kMaxColorMaps = 64;
-    struct PixelCB {
-        uint32_t enableInvert;
-        uint32_t enableMatrix;
-        uint32_t enableColorMap;
-        uint32_t preserveMapBrightness; // 1 = preserve original luminance when mapping
-        float lumaWeights[3];
-        float _pad2; // Padding to align colorMat to 16 bytes
-        float colorMat[16];
-        float colorOffset[4];
-        uint32_t colorMapCount;
-        float _pad3[3]; // Padding to align colorMapSrc to 16 bytes
-        // Pack src RGB in xyz and tolerance^2 in w
-        float colorMapSrc[kMaxColorMaps][4];
-        // Pack dst RGB in xyz; w unused
-        float colorMapDst[kMaxColorMaps][4];
-    };
-    ::Microsoft::WRL::ComPtr<ID3D11Buffer> m_pixelCb;
-    EffectSettings m_settings{};
+    // Layouts live in EffectConstants.h so the CPU kernel can share them
+    using VertexCB = ::VertexCB;
+    using PixelCB  = ::PixelCB;
+    static constexpr uint32_t kMaxColorMaps = ::kMaxColorMaps;
+    ::Microsoft::WRL::ComPtr<ID3D11Buffer> m_pixelCb;     // PixelCB flags (kPixelFlagsBytes)
+    ::Microsoft::WRL::ComPtr<ID3D11Buffer> m_colorMapCb;  // ColorMapCB
+    // Constants as last uploaded (capture thread). UpdateCBs_ repacks the pixel
+    // constants only when the settings generation or effective invert moved, and
+    // uploads the 2 KB map table only when its contents changed.
+    VertexCB m_vcb{};
+    bool     m_vcbUploaded{ false };
+    PixelCB  m_pcb{};
+    uint64_t m_cbPackedGen{ 0 };         // 0 = nothing uploaded to these buffers yet
+    bool     m_cbPackedInvert{ false };
+    uint64_t m_colorMapsPackedGen{ 0 };
+    ColorMapPacking m_colorMapPacking{};
+    PixelShaderKey  m_psKey{};           // variant for m_pcb
+    EffectSettings m_settings{};  // UI thread's copy
+    // Published by UpdateSettings, picked up by Render at frame start without
+    // locking. The snapshot generation lets caches keyed on settings detect changes
+    // cheaply.
+    winvert4::SnapshotHandoff<EffectSettings> m_settingsHandoff;
+    const EffectSettings* m_frameSettings{ nullptr };  // capture thread; pinned snapshot
+    uint64_t m_frameSettingsGen{ 0 };                  // capture thread; its generation
+    // Settings generation of the last Present (0 = nothing presented yet)
+    std::atomic<uint64_t> m_renderedGen{ 0 };
+    std::atomic<uint64_t> m_framesRendered{ 0 };
+    std::atomic<uint64_t> m_framesSkipped{ 0 };
 
     ID3D11Texture2D* m_srvSourceRaw{ nullptr }; // track which texture SRV is built from
 
+    // Baked color-map LUT (replaces the per-pixel map loop for large map sets)
+    ColorLut m_colorLut;
+    PixelCB  m_lutBakedCb{};
+    uint64_t m_lutBakedGen{ 0 };
+    ::Microsoft::WRL::ComPtr<ID3D11Texture3D>          m_lutTex;
+    ::Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_lutSrv;
+
     // Threading
     std::atomic<bool> m_run{ false };
     bool m_isHidden{ false };
@@ -113,6 +183,29 @@ private:
     double m_fpsAccum{ 0.0 };
     int    m_fpsFrames{ 0 };
 
+    // Registry metrics ("window.<id>.*", bound in the constructor and removed in
+    // the destructor). The histograms are written on the capture and present
+    // threads, read anywhere.
+    struct WindowMetrics
+    {
+        std::string prefix;  // "window.<id>."
+        winvert4::metrics::Counter* rendered{ nullptr };
+        winvert4::metrics::Counter* skipped{ nullptr };
+        winvert4::metrics::Counter* readbackStalls{ nullptr };
+        winvert4::metrics::Gauge* fps{ nullptr };
+        winvert4::metrics::Gauge* gpuMs{ nullptr };
+        winvert4::metrics::Gauge* avgLuma{ nullptr };
+        winvert4::metrics::Gauge* readbackLatencyFrames{ nullptr };
+        winvert4::metrics::Histogram* captureToRender{ nullptr };
+        winvert4::metrics::Histogram* renderToPresent{ nullptr };
+        winvert4::metrics::Histogram* total{ nullptr };
+        winvert4::metrics::Histogram* readback{ nullptr };
+    } m_metrics;
+    unsigned long long m_frameCaptureQpc{ 0 };  // frame being rendered (capture thread)
+    unsigned long long m_frameRenderQpc{ 0 };
+    std::atomic<unsigned long long> m_presentCaptureQpc{ 0 };  // frame handed to the present worker
+    std::atomic<unsigned long long> m_presentRenderQpc{ 0 };
+
     // GPU timing (our draw cost)
     struct GpuTimerSlot {
         ::Microsoft::WRL::ComPtr<ID3D11Query> disjoint;
@@ -127,12 +220,11 @@ private:
     // Brightness protection (GPU-averaged luminance)
     ::Microsoft::WRL::ComPtr<ID3D11Texture2D>        m_mipTex;          // region-sized, mipped, SRV|RTV, GENERATE_MIPS
     ::Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_mipSrv;
-    ::Microsoft::WRL::ComPtr<ID3D11Texture2D>        m_mipReadback1x1;  // staging 1x1
+    // Staging 1x1 ring, read without waiting a few frames after each copy
+    ::Microsoft::WRL::ComPtr<ID3D11Texture2D>        m_mipReadback[winvert4::ReadbackRing::kDefaultSlots];
     UINT m_mipLastLevel{ 0 };
     float m_avgLuma{ 0.0f };
-    bool  m_effectiveInvert{ false };
-    int   m_brightProtPendingCount{ 0 };
-    bool  m_brightProtPendingState{ false };
+    winvert4::BrightnessMonitor m_brightness;  // capture thread; readbacks and flip debounce
 
     // Guards teardown/reset vs. in-flight Render callbacks from duplication thread.
     std::mutex m_lifecycleMutex;
@@ -0,0 +1,70 @@
+#pragma once
+#include "DirtyRects.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace winvert4
+{
+    // Beyond this many rects one full copy is cheaper than many small ones
+    constexpr size_t kMaxCopyRects = 16;
+    // Damage covering at least this fraction of the output is copied whole
+    constexpr float kFullCopyFraction = 0.5f;
+
+    enum class AcquireStatus
+    {
+        Frame,       // a frame is held until Release()
+        Timeout,     // nothing new within the wait
+        AccessLost,  // the source must be recreated (mode change, secure desktop, ...)
+        Failed,      // transient failure; try again
+    };
+
+    struct FrameInfo
+    {
+        // Source clock of the last desktop present (QPC ticks for DXGI); 0 when only
+        // the pointer changed and the desktop image did not
+        uint64_t presentTicks{ 0 };
+        uint32_t accumulatedFrames{ 0 };
+    };
+
+    // Where desktop frames come from. The capture loop only sees this interface, so the
+    // same loop runs against DXGI Desktop Duplication or a scripted synthetic desktop.
+    // All methods except the size/rate getters are called from the capture thread.
+    class IFrameSource
+    {
+    public:
+        virtual ~IFrameSource() = default;
+
+        int32_t Width() const { return m_width; }
+        int32_t Height() const { return m_height; }
+        float RefreshHz() const { return m_refreshHz; }
+        // Rate of FrameInfo::presentTicks
+        uint64_t TicksPerSecond() const { return m_ticksPerSecond; }
+
+        // Wait up to timeoutMs for the next frame. On Frame, damage is reset to the
+        // source size and filled with what changed since the previous frame.
+        virtual AcquireStatus Acquire(uint32_t timeoutMs, FrameInfo& info, FrameDamage& damage) = 0;
+        // Bring the shared frame up to date from the held frame (damaged regions only).
+        virtual void CopyFrame(const FrameDamage& damage) = 0;
+        // Give the held frame back to the source.
+        virtual void Release() = 0;
+
+        // The shared, up-to-date desktop image subscribers sample from; its type is
+        // source specific (ID3D11Texture2D* for DXGI, BGRA pixels for the synthetic source).
+        virtual const void* SharedFrame() const = 0;
+
+        // Replace a capture that reported AccessLost (mode change, secure desktop,
+        // exclusive fullscreen). False while it cannot be created yet; the loop retries
+        // with backoff. The shared frame keeps the last good image meanwhile.
+        virtual bool Recreate() { return false; }
+
+        // Make a blocked (or the next) Acquire return Timeout early. Called from other
+        // threads; sources whose wait cannot be interrupted leave this a no-op.
+        virtual void Wake() {}
+
+    protected:
+        int32_t m_width{ 0 };
+        int32_t m_height{ 0 };
+        float m_refreshHz{ 0.0f };
+        uint64_t m_ticksPerSecond{ 1 };
+    };
+}
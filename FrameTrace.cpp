@@ -0,0 +1,325 @@
+#include "FrameTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace winvert4::frametrace
+{
+    namespace {
+        constexpr uint32_t kMagic = 0x52545657; // "WVTR"
+        constexpr uint32_t kVersion = 1;
+
+        size_t RoundUpPow2(size_t v)
+        {
+            size_t p = 2;
+            while (p < v) p <<= 1;
+            return p;
+        }
+
+        std::atomic<uint32_t> s_nextRecorderId{ 1 };
+
+        template <typename T>
+        void Put(std::vector<uint8_t>& out, const T& v)
+        {
+            const size_t at = out.size();
+            out.resize(at + sizeof(T));
+            std::memcpy(out.data() + at, &v, sizeof(T));
+        }
+
+        template <typename T>
+        bool Get(const uint8_t*& p, const uint8_t* end, T& v)
+        {
+            if (size_t(end - p) < sizeof(T)) return false;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+
+        void AppendJsonString(std::string& out, const std::string& s)
+        {
+            out.push_back('"');
+            for (char c : s)
+            {
+                if (c == '"' || c == '\\') { out.push_back('\\'); out.push_back(c); }
+                else if (static_cast<unsigned char>(c) < 0x20) { char b[8]; std::snprintf(b, sizeof(b), "\\u%04x", c); out += b; }
+                else out.push_back(c);
+            }
+            out.push_back('"');
+        }
+    }
+
+    const char* StageName(Stage s)
+    {
+        switch (s)
+        {
+        case Stage::Acquire:      return "AcquireNextFrame";
+        case Stage::CopyFrame:    return "CopyFrame";
+        case Stage::Render:       return "Render";
+        case Stage::Brightness:   return "Brightness";
+        case Stage::Record:       return "Record";
+        case Stage::Execute:      return "ExecuteCommandList";
+        case Stage::Present:      return "Present";
+        case Stage::GpuResolve:   return "GpuResolve";
+        case Stage::Mirror:       return "Mirror";
+        case Stage::ReleaseFrame: return "ReleaseFrame";
+        default:                  return "Unknown";
+        }
+    }
+
+    uint64_t NowNs()
+    {
+        using namespace std::chrono;
+        return uint64_t(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Single-writer ring owned by one thread; readers only copy it
+    struct Recorder::ThreadBuffer
+    {
+        explicit ThreadBuffer(size_t capacity, uint16_t idx) : events(capacity), index(idx) {}
+        std::vector<Event> events;
+        std::atomic<uint64_t> written{ 0 };
+        uint16_t index;
+        std::string name;   // guarded by State::mutex
+        bool inUse{ true }; // guarded by State::mutex; false once the thread exited
+    };
+
+    struct Recorder::State
+    {
+        std::mutex mutex;  // guards buffers (registration, reuse and snapshots only)
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+        // A ring whose thread exited, or a new one; null when the indices ran out
+        ThreadBuffer* Acquire(size_t capacity, const std::string& name)
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            for (auto& buf : buffers)
+            {
+                if (buf->inUse) continue;
+                buf->inUse = true;
+                buf->name = name;
+                buf->written.store(0, std::memory_order_release);
+                return buf.get();
+            }
+            if (buffers.size() > UINT16_MAX) return nullptr;
+            buffers.push_back(std::make_unique<ThreadBuffer>(capacity, uint16_t(buffers.size())));
+            buffers.back()->name = name;
+            return buffers.back().get();
+        }
+
+        void Release(ThreadBuffer* buf)
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            buf->inUse = false;
+        }
+    };
+
+    // Per-thread: the thread's name and the rings it holds, handed back on exit
+    struct Recorder::ThreadSlots
+    {
+        struct Slot
+        {
+            uint32_t recorderId;
+            std::shared_ptr<State> state;
+            ThreadBuffer* buffer;
+        };
+
+        std::string name;
+        std::vector<Slot> slots;
+        // Most recently used slot, so alternating recorders costs a short search
+        uint32_t lastId{ 0 };
+        ThreadBuffer* last{ nullptr };
+
+        ~ThreadSlots()
+        {
+            for (const Slot& s : slots) s.state->Release(s.buffer);
+        }
+
+        static ThreadSlots& Get()
+        {
+            thread_local ThreadSlots t_slots;
+            return t_slots;
+        }
+    };
+
+    Recorder::Recorder(size_t eventsPerThread)
+        : m_capacity(RoundUpPow2(std::max<size_t>(eventsPerThread, 2)))
+        , m_id(s_nextRecorderId.fetch_add(1, std::memory_order_relaxed))
+        , m_state(std::make_shared<State>())
+    {
+    }
+
+    Recorder::~Recorder() = default;
+
+    Recorder& Recorder::Global()
+    {
+        static Recorder s_recorder;
+        return s_recorder;
+    }
+
+    Recorder::ThreadBuffer* Recorder::LocalBuffer_()
+    {
+        ThreadSlots& t = ThreadSlots::Get();
+        if (t.lastId == m_id && t.last) return t.last;
+        ThreadBuffer* buf = nullptr;
+        for (const auto& s : t.slots)
+        {
+            if (s.recorderId == m_id) { buf = s.buffer; break; }
+        }
+        if (!buf)
+        {
+            buf = m_state->Acquire(m_capacity, t.name);
+            if (!buf) return nullptr;
+            t.slots.push_back({ m_id, m_state, buf });
+        }
+        t.lastId = m_id;
+        t.last = buf;
+        return buf;
+    }
+
+    void Recorder::SetThreadName(const char* name)
+    {
+        ThreadSlots& t = ThreadSlots::Get();
+        t.name = name ? name : "";
+        for (const auto& s : t.slots)
+        {
+            if (s.recorderId != m_id) continue;
+            std::lock_guard<std::mutex> lk(m_state->mutex);
+            s.buffer->name = t.name;
+        }
+    }
+
+    void Recorder::Record(Stage stage, uint64_t beginNs, uint64_t endNs, uint64_t arg)
+    {
+        if (!IsEnabled()) return;
+        ThreadBuffer* buf = LocalBuffer_();
+        if (!buf) return;
+        const uint64_t n = buf->written.load(std::memory_order_relaxed);
+        Event& e = buf->events[size_t(n) & (m_capacity - 1)];
+        e.beginNs = beginNs;
+        const uint64_t dur = (endNs > beginNs) ? endNs - beginNs : 0;
+        e.durationNs = uint32_t(std::min<uint64_t>(dur, UINT32_MAX));
+        e.stage = uint16_t(stage);
+        e.threadIndex = buf->index;
+        e.arg = arg;
+        buf->written.store(n + 1, std::memory_order_release);
+    }
+
+    TraceData Recorder::Snapshot() const
+    {
+        TraceData data;
+        std::lock_guard<std::mutex> lk(m_state->mutex);
+        for (const auto& bufPtr : m_state->buffers)
+        {
+            const ThreadBuffer& buf = *bufPtr;
+            const uint64_t before = buf.written.load(std::memory_order_acquire);
+            const uint64_t first = (before > m_capacity) ? before - m_capacity : 0;
+            std::vector<Event> copy;
+            copy.reserve(size_t(before - first));
+            for (uint64_t i = first; i < before; ++i) copy.push_back(buf.events[size_t(i) & (m_capacity - 1)]);
+
+            // Entries the writer may have overwritten while we copied are dropped
+            const uint64_t after = buf.written.load(std::memory_order_acquire);
+            const uint64_t safeFirst = (after > m_capacity) ? after - m_capacity : 0;
+            const size_t skip = size_t(std::min<uint64_t>(before - first, (safeFirst > first) ? safeFirst - first : 0));
+
+            ThreadInfo info;
+            info.index = buf.index;
+            info.name = buf.name;
+            info.written = before;
+            info.retained = uint64_t(copy.size() - skip);
+            data.threads.push_back(info);
+            data.events.insert(data.events.end(), copy.begin() + skip, copy.end());
+        }
+        return data;
+    }
+
+    void Recorder::Clear()
+    {
+        // Buffers stay registered (threads cache them); only contents are dropped
+        std::lock_guard<std::mutex> lk(m_state->mutex);
+        for (auto& buf : m_state->buffers) buf->written.store(0, std::memory_order_release);
+    }
+
+    void WriteBinary(const TraceData& data, std::vector<uint8_t>& out)
+    {
+        out.clear();
+        Put(out, kMagic);
+        Put(out, kVersion);
+        Put(out, uint32_t(data.threads.size()));
+        Put(out, uint32_t(data.events.size()));
+        for (const auto& t : data.threads)
+        {
+            const uint16_t len = uint16_t(std::min<size_t>(t.name.size(), UINT16_MAX));
+            Put(out, t.index);
+            Put(out, len);
+            Put(out, t.written);
+            Put(out, t.retained);
+            out.insert(out.end(), t.name.begin(), t.name.begin() + len);
+        }
+        const size_t at = out.size();
+        out.resize(at + data.events.size() * sizeof(Event));
+        if (!data.events.empty()) std::memcpy(out.data() + at, data.events.data(), data.events.size() * sizeof(Event));
+    }
+
+    bool ReadBinary(const uint8_t* p, size_t size, TraceData& out)
+    {
+        out = TraceData{};
+        const uint8_t* end = p + size;
+        uint32_t magic = 0, version = 0, threadCount = 0, eventCount = 0;
+        if (!Get(p, end, magic) || magic != kMagic) return false;
+        if (!Get(p, end, version) || version != kVersion) return false;
+        if (!Get(p, end, threadCount) || !Get(p, end, eventCount)) return false;
+        for (uint32_t i = 0; i < threadCount; ++i)
+        {
+            ThreadInfo t;
+            uint16_t len = 0;
+            if (!Get(p, end, t.index) || !Get(p, end, len) || !Get(p, end, t.written) || !Get(p, end, t.retained)) return false;
+            if (size_t(end - p) < len) return false;
+            t.name.assign(reinterpret_cast<const char*>(p), len);
+            p += len;
+            out.threads.push_back(std::move(t));
+        }
+        if (size_t(end - p) / sizeof(Event) < eventCount) return false;
+        out.events.resize(eventCount);
+        if (eventCount) std::memcpy(out.events.data(), p, size_t(eventCount) * sizeof(Event));
+        return true;
+    }
+
+    void ExportChromeJson(const TraceData& data, std::string& out)
+    {
+        out.clear();
+        uint64_t origin = UINT64_MAX;
+        for (const auto& e : data.events) origin = std::min(origin, e.beginNs);
+        if (origin == UINT64_MAX) origin = 0;
+
+        out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        char buf[256];
+        for (const auto& t : data.threads)
+        {
+            if (!first) out.push_back(',');
+            first = false;
+            std::snprintf(buf, sizeof(buf), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", unsigned(t.index));
+            out += buf;
+            AppendJsonString(out, t.name.empty() ? ("thread " + std::to_string(t.index)) : t.name);
+            out += "}}";
+        }
+        for (const auto& e : data.events)
+        {
+            if (!first) out.push_back(',');
+            first = false;
+            // Microseconds with nanosecond precision kept in the fraction
+            const uint64_t rel = e.beginNs - origin;
+            std::snprintf(buf, sizeof(buf),
+                "{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                "\"ts\":%llu.%03u,\"dur\":%u.%03u,\"args\":{\"arg\":%llu}}",
+                StageName(Stage(e.stage)), unsigned(e.threadIndex),
+                static_cast<unsigned long long>(rel / 1000), unsigned(rel % 1000),
+                unsigned(e.durationNs / 1000), unsigned(e.durationNs % 1000),
+                static_cast<unsigned long long>(e.arg));
+            out += buf;
+        }
+        out += "]}";
+    }
+}
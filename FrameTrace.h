@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Low-overhead recorder for the capture -> render pipeline. Each thread appends
+// complete (begin + duration) events to its own fixed-size ring, so recording is
+// a steady_clock read and a few stores, with no locks. Old events are overwritten
+// when a ring wraps. A thread gets its ring on its first event while recording is
+// enabled; when the thread exits the ring (and its events) stays in snapshots
+// until a new thread takes it over, so memory follows the number of live threads.
+// Snapshots serialize to a compact binary format and export to Chrome trace JSON
+// (chrome://tracing, Perfetto). Portable: no Windows headers.
+namespace winvert4::frametrace
+{
+    enum class Stage : uint16_t
+    {
+        Acquire,       // AcquireNextFrame
+        CopyFrame,     // dirty-rect / full copy into the shared texture
+        Render,        // one subscriber's EffectWindow::Render (arg = subscriber index)
+        Brightness,    // brightness-protection mip + readback
+        Record,        // deferred-context command recording
+        Execute,       // ExecuteCommandList
+        Present,       // swap chain Present
+        GpuResolve,    // GPU timer query resolution
+        Mirror,        // debug mirror copy + Present
+        ReleaseFrame,  // ReleaseFrame
+        Count
+    };
+    const char* StageName(Stage s);
+
+    // 24 bytes on disk and in memory
+    struct Event
+    {
+        uint64_t beginNs{ 0 };   // steady_clock, nanoseconds
+        uint32_t durationNs{ 0 };
+        uint16_t stage{ 0 };
+        uint16_t threadIndex{ 0 };
+        uint64_t arg{ 0 };
+    };
+    static_assert(sizeof(Event) == 24, "frametrace::Event must stay 24 bytes");
+
+    struct ThreadInfo
+    {
+        uint16_t index{ 0 };
+        std::string name;
+        uint64_t written{ 0 };   // events ever recorded on the thread
+        uint64_t retained{ 0 };  // events present in the snapshot (the rest were overwritten)
+    };
+
+    struct TraceData
+    {
+        std::vector<ThreadInfo> threads;
+        std::vector<Event> events;   // ordered by thread, then recording order
+    };
+
+    uint64_t NowNs();
+
+    class Recorder
+    {
+    public:
+        static constexpr size_t kDefaultEventsPerThread = 1u << 16;
+
+        explicit Recorder(size_t eventsPerThread = kDefaultEventsPerThread);
+        ~Recorder();
+
+        // Process-wide instance used by the TraceScope helpers.
+        static Recorder& Global();
+
+        void SetEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+        bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+        // Name the calling thread in exports (e.g. "DT 0", "UI"). Allocates nothing;
+        // the name is attached to the thread's ring when it records.
+        void SetThreadName(const char* name);
+        // Dropped while disabled
+        void Record(Stage stage, uint64_t beginNs, uint64_t endNs, uint64_t arg = 0);
+
+        // Copy every thread's retained events. Safe while threads keep recording:
+        // slots that may have been overwritten during the copy are discarded.
+        TraceData Snapshot() const;
+        void Clear();
+
+    private:
+        struct ThreadBuffer;
+        struct State;
+        struct ThreadSlots;
+        // The calling thread's ring, taken on first use; null when 65536 threads
+        // already hold one
+        ThreadBuffer* LocalBuffer_();
+
+        const size_t m_capacity;  // power of two
+        const uint32_t m_id;      // distinguishes recorders in the thread-local cache
+        std::atomic<bool> m_enabled{ false };
+        // Rings, shared with the threads holding them so a thread may exit after
+        // the recorder is gone
+        std::shared_ptr<State> m_state;
+    };
+
+    // Records [construction, destruction) as one event when the recorder is enabled.
+    class TraceScope
+    {
+    public:
+        explicit TraceScope(Stage stage, uint64_t arg = 0, Recorder& recorder = Recorder::Global())
+            : m_recorder(recorder.IsEnabled() ? &recorder : nullptr), m_stage(stage), m_arg(arg),
+              m_begin(m_recorder ? NowNs() : 0) {}
+        ~TraceScope() { if (m_recorder) m_recorder->Record(m_stage, m_begin, NowNs(), m_arg); }
+
+        // Attach a result known only at the end of the scope (frame count, rect count, ...)
+        void SetArg(uint64_t arg) { m_arg = arg; }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        Recorder* m_recorder;
+        Stage m_stage;
+        uint64_t m_arg;
+        uint64_t m_begin;
+    };
+
+    // Binary layout (little-endian):
+    //   "WVTR" u32 version u32 threadCount u32 eventCount
+    //   per thread: u16 index, u16 nameLen, u64 written, u64 retained, name bytes
+    //   eventCount * Event
+    void WriteBinary(const TraceData& data, std::vector<uint8_t>& out);
+    bool ReadBinary(const uint8_t* data, size_t size, TraceData& out);
+
+    // Chrome trace-event JSON: one "X" (complete) event per record, microsecond times
+    // relative to the earliest event, plus thread_name metadata.
+    void ExportChromeJson(const TraceData& data, std::string& out);
+}
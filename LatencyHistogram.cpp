@@ -0,0 +1,105 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <bit>
+
+namespace winvert4
+{
+    // Values below 2 * kSubBuckets us get one bucket each; above, every octave is
+    // split into kSubBuckets equal parts (the top bits after the leading one).
+    uint32_t LatencyHistogram::BucketOf(uint64_t valueUs)
+    {
+        constexpr uint32_t kSubBits = std::countr_zero(kSubBuckets);
+        if (valueUs < 2 * kSubBuckets) return uint32_t(valueUs);
+        const uint32_t shift = uint32_t(std::bit_width(valueUs)) - kSubBits - 1;
+        const uint32_t sub = uint32_t(valueUs >> shift) - kSubBuckets;
+        return std::min(kBuckets - 1, 2 * kSubBuckets + (shift - 1) * kSubBuckets + sub);
+    }
+
+    uint64_t LatencyHistogram::BucketLowUs(uint32_t bucket)
+    {
+        if (bucket < 2 * kSubBuckets) return bucket;
+        const uint32_t shift = (bucket - 2 * kSubBuckets) / kSubBuckets + 1;
+        const uint64_t sub = (bucket - 2 * kSubBuckets) % kSubBuckets + kSubBuckets;
+        return sub << shift;
+    }
+
+    void LatencyHistogram::Record(uint64_t valueNs, uint64_t nowNs)
+    {
+        const uint64_t number = nowNs / m_sliceNs + 1;
+        Slice& slice = m_slices[number % kSlices];
+        uint64_t epoch = slice.epoch.load(std::memory_order_acquire);
+        if (epoch != number)
+        {
+            if (epoch > number) return;  // a late sample for a slice already reused
+            // New period: claim the slice, then clear what it held a window ago. Readers
+            // compare the epoch before and after summing, so they skip it meanwhile.
+            if (slice.epoch.compare_exchange_strong(epoch, 0, std::memory_order_acq_rel))
+            {
+                for (auto& c : slice.counts) c.store(0, std::memory_order_relaxed);
+                slice.maxNs.store(0, std::memory_order_relaxed);
+                slice.epoch.store(number, std::memory_order_release);
+            }
+            else if (epoch != number)
+            {
+                return;  // another writer is clearing it; drop one sample rather than wait
+            }
+        }
+        slice.counts[BucketOf(valueNs / 1000)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t prevMax = slice.maxNs.load(std::memory_order_relaxed);
+        while (valueNs > prevMax && !slice.maxNs.compare_exchange_weak(prevMax, valueNs, std::memory_order_relaxed)) {}
+    }
+
+    LatencyHistogram::Summary LatencyHistogram::Summarize(uint64_t nowNs, uint32_t windowSlices) const
+    {
+        const uint64_t newest = nowNs / m_sliceNs + 1;
+        const uint64_t oldest = newest - std::min<uint64_t>(std::clamp<uint32_t>(windowSlices, 1, kSlices), newest) + 1;
+
+        std::array<uint64_t, kBuckets> merged{};
+        Summary s;
+        uint64_t maxNs = 0;
+        for (const Slice& slice : m_slices)
+        {
+            const uint64_t epoch = slice.epoch.load(std::memory_order_acquire);
+            if (epoch < oldest || epoch > newest) continue;
+            std::array<uint32_t, kBuckets> counts;
+            for (uint32_t i = 0; i < kBuckets; ++i) counts[i] = slice.counts[i].load(std::memory_order_relaxed);
+            const uint64_t sliceMax = slice.maxNs.load(std::memory_order_relaxed);
+            // Reused while we were reading: its contents belong to another period
+            if (slice.epoch.load(std::memory_order_acquire) != epoch) continue;
+            for (uint32_t i = 0; i < kBuckets; ++i) { merged[i] += counts[i]; s.count += counts[i]; }
+            maxNs = std::max(maxNs, sliceMax);
+        }
+        if (s.count == 0) return s;
+
+        // Report the middle of the bucket holding each rank, capped by the exact maximum
+        const double maxMs = double(maxNs) / 1e6;
+        auto quantile = [&](double q) {
+            const uint64_t rank = std::max<uint64_t>(1, uint64_t(q * double(s.count) + 0.5));
+            uint64_t seen = 0;
+            for (uint32_t i = 0; i < kBuckets; ++i)
+            {
+                seen += merged[i];
+                if (seen < rank) continue;
+                const uint64_t lo = BucketLowUs(i);
+                const uint64_t hi = (i + 1 < kBuckets) ? BucketLowUs(i + 1) : lo;
+                return std::min(maxMs, double(lo + hi) / 2000.0);
+            }
+            return maxMs;
+        };
+        s.p50Ms = quantile(0.50);
+        s.p90Ms = quantile(0.90);
+        s.p99Ms = quantile(0.99);
+        s.maxMs = maxMs;
+        return s;
+    }
+
+    void LatencyHistogram::Clear()
+    {
+        for (Slice& slice : m_slices)
+        {
+            slice.epoch.store(0, std::memory_order_release);
+            for (auto& c : slice.counts) c.store(0, std::memory_order_relaxed);
+            slice.maxNs.store(0, std::memory_order_relaxed);
+        }
+    }
+}
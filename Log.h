@@ -1,8 +1,11 @@
 #pragma once
 #include <windows.h>
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
 #include <cstdarg>
 #include <mutex>
+#include "AsyncLogger.h"
 
 #ifndef WINVERT_ENABLE_LOGGING
 #if defined(_DEBUG)
@@ -12,8 +15,56 @@
 #endif
 #endif
 
+// Lowest level compiled in (0 trace, 1 debug, 2 info, 3 warn). Sites below it compile to
+// nothing, so release builds can log warnings without per-frame formatting cost.
+#ifndef WINVERT_LOG_MIN_LEVEL
+#if defined(_DEBUG)
+#define WINVERT_LOG_MIN_LEVEL 0
+#else
+#define WINVERT_LOG_MIN_LEVEL 3
+#endif
+#endif
+
+// Categories compiled in (bitmask of winvert4::LogCat values)
+#ifndef WINVERT_LOG_CATEGORIES
+#define WINVERT_LOG_CATEGORIES 0xFFFFFFFFu
+#endif
+
 namespace winvert4
 {
+    enum class LogLevel : int { Trace = 0, Debug = 1, Info = 2, Warn = 3 };
+
+    // Subsystem categories: duplication threads, effect windows, output manager, UI
+    struct LogCat
+    {
+        static constexpr uint32_t DT = 1u << 0;
+        static constexpr uint32_t EW = 1u << 1;
+        static constexpr uint32_t OM = 1u << 2;
+        static constexpr uint32_t UI = 1u << 3;
+        static constexpr uint32_t All = DT | EW | OM | UI;
+    };
+
+    constexpr bool LogCompiledIn(uint32_t category, LogLevel level)
+    {
+        return WINVERT_ENABLE_LOGGING != 0 &&
+               static_cast<int>(level) >= WINVERT_LOG_MIN_LEVEL &&
+               (category & (WINVERT_LOG_CATEGORIES)) != 0;
+    }
+
+    // Runtime filter on top of the compile-time one. Per-frame trace is off by default
+    // so enabling logging for a startup investigation does not flood the file.
+    inline std::atomic<uint32_t> g_logCategories{ LogCat::All };
+    inline std::atomic<int> g_logLevel{ static_cast<int>(LogLevel::Debug) };
+
+    inline void SetLogCategories(uint32_t mask) { g_logCategories.store(mask, std::memory_order_relaxed); }
+    inline void SetLogLevel(LogLevel level) { g_logLevel.store(static_cast<int>(level), std::memory_order_relaxed); }
+
+    inline bool LogEnabled(uint32_t category, LogLevel level)
+    {
+        return static_cast<int>(level) >= g_logLevel.load(std::memory_order_relaxed) &&
+               (category & g_logCategories.load(std::memory_order_relaxed)) != 0;
+    }
+
     inline const wchar_t* LogFilePath()
     {
 #if WINVERT_ENABLE_LOGGING
@@ -37,29 +88,42 @@ namespace winvert4
 #endif
     }
 
+#if WINVERT_ENABLE_LOGGING
+    // Process-wide async logger; the flusher keeps one append handle open for its lifetime
+    inline AsyncLogger& Logger()
+    {
+        static AsyncLogger s_logger;
+        static std::once_flag s_started;
+        std::call_once(s_started, [] {
+            HANDLE h = CreateFileW(LogFilePath(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            s_logger.Start([h](const char* data, size_t size) {
+                if (h == INVALID_HANDLE_VALUE) return;
+                DWORD w = 0;
+                WriteFile(h, data, (DWORD)size, &w, nullptr);
+            });
+        });
+        return s_logger;
+    }
+#endif
+
     inline void Log(const char* line)
     {
 #if WINVERT_ENABLE_LOGGING
-        static std::mutex m;
-        std::lock_guard<std::mutex> lock(m);
-
-        SYSTEMTIME st{}; GetLocalTime(&st);
-        char header[64];
-        _snprintf_s(header, _TRUNCATE, "%02u:%02u:%02u:%03u ", st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
-
-        HANDLE h = CreateFileW(LogFilePath(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-        if (h == INVALID_HANDLE_VALUE) return;
-        DWORD w = 0;
-        WriteFile(h, header, (DWORD)strlen(header), &w, nullptr);
-        WriteFile(h, line, (DWORD)strlen(line), &w, nullptr);
-        static const char crlf[] = "\r\n";
-        WriteFile(h, crlf, 2, &w, nullptr);
-        CloseHandle(h);
+        // Copied into the ring; timestamping and file I/O happen on the flusher thread
+        Logger().Push(line);
 #else
         (void)line;
 #endif
     }
 
+    // Block until queued lines are on disk (e.g. before an intentional crash or exit)
+    inline void LogFlush()
+    {
+#if WINVERT_ENABLE_LOGGING
+        Logger().Flush();
+#endif
+    }
+
     inline void Logf(const char* fmt, ...)
     {
 #if WINVERT_ENABLE_LOGGING
@@ -73,3 +137,19 @@ namespace winvert4
 #endif
     }
 }
+
+// Leveled, categorized logging: WINVERT_DEBUG(EW, "fmt", args...). Sites filtered out at
+// compile time are discarded by if constexpr (arguments are never evaluated); the rest
+// check the runtime mask before formatting.
+#define WINVERT_LOG_AT(cat, lvl, ...)                                                              \
+    do {                                                                                           \
+        if constexpr (::winvert4::LogCompiledIn(::winvert4::LogCat::cat, ::winvert4::LogLevel::lvl)) { \
+            if (::winvert4::LogEnabled(::winvert4::LogCat::cat, ::winvert4::LogLevel::lvl))        \
+                ::winvert4::Logf(__VA_ARGS__);                                                     \
+        }                                                                                          \
+    } while (0)
+
+#define WINVERT_TRACE(cat, ...) WINVERT_LOG_AT(cat, Trace, __VA_ARGS__)
+#define WINVERT_DEBUG(cat, ...) WINVERT_LOG_AT(cat, Debug, __VA_ARGS__)
+#define WINVERT_INFO(cat, ...)  WINVERT_LOG_AT(cat, Info,  __VA_ARGS__)
+#define WINVERT_WARN(cat, ...)  WINVERT_LOG_AT(cat, Warn,  __VA_ARGS__)
@@ -198,7 +198,7 @@ LRESULT CALLBACK winrt::Winvert4::implementation::MainWindow::LowLevelKeyboardPr
             if (GetAsyncKeyState(VK_MENU) & 0x8000) newMod |= MOD_ALT;
             if ((GetAsyncKeyState(VK_LWIN) & 0x8000) || (GetAsyncKeyState(VK_RWIN) & 0x8000)) newMod |= MOD_WIN;
 
-            winvert4::Logf("Rebind(hook): vk=%u modifiers=%u", (unsigned)p->vkCode, (unsigned)newMod);
+            WINVERT_DEBUG(UI, "Rebind(hook): vk=%u modifiers=%u", (unsigned)p->vkCode, (unsigned)newMod);
 
             if (p->vkCode == VK_SHIFT || p->vkCode == VK_CONTROL || p->vkCode == VK_MENU || p->vkCode == VK_LWIN || p->vkCode == VK_RWIN)
             {
@@ -225,7 +225,7 @@ namespace winrt::Winvert4::implementation
 {
     winrt::Winvert4::implementation::MainWindow::MainWindow()
     {
-        winvert4::Log("MainWindow: ctor start");
+        WINVERT_INFO(UI, "MainWindow: ctor start");
 
         Gdiplus::GdiplusStartupInput gdiplusStartupInput;
         Gdiplus::GdiplusStartup(&m_gdiplusToken, &gdiplusStartupInput, NULL);
@@ -250,7 +250,7 @@ namespace winrt::Winvert4::implementation
 
         auto windowNative{ this->try_as<::IWindowNative>() };
         winrt::check_hresult(windowNative->get_WindowHandle(&m_mainHwnd));
-        winvert4::Logf("MainWindow: got HWND=%p", (void*)m_mainHwnd);
+        WINVERT_DEBUG(UI, "MainWindow: got HWND=%p", (void*)m_mainHwnd);
 
         auto rootElement = this->Content().try_as<winrt::Microsoft::UI::Xaml::FrameworkElement>();
 
@@ -276,7 +276,7 @@ namespace winrt::Winvert4::implementation
                 &borderColor,
                 sizeof(borderColor));
 
-            winvert4::Logf("MainWindow: chrome theme apply dark=%d hrTitle=0x%08X hrBorder=0x%08X",
+            WINVERT_DEBUG(UI, "MainWindow: chrome theme apply dark=%d hrTitle=0x%08X hrBorder=0x%08X",
                 isDark ? 1 : 0, hrTitleBar, hrBorder);
         };
 
@@ -290,6 +290,8 @@ namespace winrt::Winvert4::implementation
         m_outputManager->Initialize();
         // Create duplication threads immediately so debug mirror windows can be spawned at startup
         m_outputManager->PrewarmForSelection();
+        // Load (or on first run, compile) the effect shaders before the first selection
+        EffectWindow::PrewarmShaders();
 
         bool isFirstRun = false;
         try
@@ -470,7 +472,7 @@ namespace winrt::Winvert4::implementation
         // Do not start selection automatically. The global hotkey will start
         // the operation (similar to Snipping Tool) after app launch.
 
-        winvert4::Log("MainWindow: ctor end");
+        WINVERT_INFO(UI, "MainWindow: ctor end");
     }
 
     // DumpAppStateToPath_ removed (external test app will validate by reading debug.log and LocalState)
@@ -487,7 +489,7 @@ namespace winrt::Winvert4::implementation
 
     void winrt::Winvert4::implementation::MainWindow::ToggleSnipping()
     {
-        winvert4::Log("MainWindow: ToggleSnipping");
+        WINVERT_INFO(UI, "MainWindow: ToggleSnipping");
         StartScreenSelection();
     }
 
@@ -1312,7 +1314,7 @@ namespace winrt::Winvert4::implementation
     void winrt::Winvert4::implementation::MainWindow::BeginRebindCapture(RebindingState target, wchar_t const* promptText)
     {
         if (target == RebindingState::None) return;
-        winvert4::Logf("Rebind: start target=%d", static_cast<int>(target));
+        WINVERT_DEBUG(UI, "Rebind: start target=%d", static_cast<int>(target));
 
         UnregisterHotKey(m_mainHwnd, HOTKEY_INVERT_ID);
         UnregisterHotKey(m_mainHwnd, HOTKEY_FILTER_ID);
@@ -1332,7 +1334,7 @@ namespace winrt::Winvert4::implementation
         if (!s_keyboardHook)
         {
             s_keyboardHook = SetWindowsHookExW(WH_KEYBOARD_LL, &MainWindow::LowLevelKeyboardProc, GetModuleHandleW(nullptr), 0);
-            winvert4::Logf("Rebind: installed keyboard hook=%p", (void*)s_keyboardHook);
+            WINVERT_DEBUG(UI, "Rebind: installed keyboard hook=%p", (void*)s_keyboardHook);
         }
         SetTimer(m_mainHwnd, REBIND_TIMEOUT_TIMER_ID, REBIND_TIMEOUT_MS, nullptr);
     }
@@ -1354,7 +1356,7 @@ namespace winrt::Winvert4::implementation
         {
             UnhookWindowsHookEx(s_keyboardHook);
             s_keyboardHook = nullptr;
-            winvert4::Log("Rebind: keyboard hook removed");
+            WINVERT_DEBUG(UI, "Rebind: keyboard hook removed");
         }
     }
 
@@ -1384,7 +1386,7 @@ namespace winrt::Winvert4::implementation
                 L"This hotkey is already assigned to another Winvert action.\nPlease choose a different combination.",
                 L"Winvert Hotkey Error",
                 MB_OK | MB_ICONWARNING);
-            winvert4::Log("Rebind: duplicate combo blocked");
+            WINVERT_DEBUG(UI, "Rebind: duplicate combo blocked");
             return;
         }
 
@@ -1407,7 +1409,7 @@ namespace winrt::Winvert4::implementation
         {
             EndRebindCapture(false, L"Hotkey updated!");
             SaveAppState();
-            winvert4::Log("Rebind: registration succeeded");
+            WINVERT_DEBUG(UI, "Rebind: registration succeeded");
         }
         else
         {
@@ -1416,7 +1418,7 @@ namespace winrt::Winvert4::implementation
             m_hotkeyRemoveMod = oldRemoveMod; m_hotkeyRemoveVk = oldRemoveVk;
             EndRebindCapture(true, L"Hotkey update failed.");
             MessageBoxW(m_mainHwnd, regError.c_str(), L"Winvert Hotkey Error", MB_OK | MB_ICONWARNING);
-            winvert4::Logf("Rebind: registration failed: %s", winrt::to_string(winrt::hstring(regError)).c_str());
+            WINVERT_WARN(UI, "Rebind: registration failed: %s", winrt::to_string(winrt::hstring(regError)).c_str());
         }
     }
 
@@ -1424,7 +1426,7 @@ namespace winrt::Winvert4::implementation
     {
         if (m_isProgrammaticSelectionColorChange || !m_isSavingEnabled) return;
         auto newColor = args.NewColor();
-        winvert4::Logf("SelectionColorPicker_ColorChanged: R=%d G=%d B=%d", (int)newColor.R, (int)newColor.G, (int)newColor.B);
+        WINVERT_TRACE(UI, "SelectionColorPicker_ColorChanged: R=%d G=%d B=%d", (int)newColor.R, (int)newColor.G, (int)newColor.B);
         m_selectionColor = RGB(newColor.R, newColor.G, newColor.B);
         SaveAppState();
     }
@@ -1492,7 +1494,7 @@ namespace
 #if 0
     void winrt::Winvert4::implementation::MainWindow::RunSelfTests_()
     {
-        winvert4::Log("SelfTest: start");
+        WINVERT_INFO(UI, "SelfTest: start");
         auto readJson = [](const std::wstring& path, winrt::Windows::Data::Json::JsonObject& out)->bool{
             std::ifstream jfs(path, std::ios::binary);
             if (!jfs) return false;
@@ -1509,11 +1511,11 @@ namespace
 
         auto verifyAgainst = [&](const std::wstring& path, std::string* outLog)->bool{
             using namespace winrt::Windows::Data::Json;
-            JsonObject root; if (!readJson(path, root)) { winvert4::Log("SelfTest: failed to read expected json"); if(outLog) outLog->append("Failed to read expected JSON\n"); return false; }
+            JsonObject root; if (!readJson(path, root)) { WINVERT_WARN(UI, "SelfTest: failed to read expected json"); if(outLog) outLog->append("Failed to read expected JSON\n"); return false; }
             bool ok = true;
             // toggles
             if (auto v = root.TryLookup(L"toggles")) if (v.ValueType()==JsonValueType::Object){ auto o=v.GetObject();
-                auto eqb=[&](const wchar_t* k, bool actual){ if (auto t=o.TryLookup(k)){ bool exp=false; switch(t.ValueType()){case JsonValueType::Boolean: exp=t.GetBoolean(); break; case JsonValueType::Number: exp=t.GetNumber()!=0.0; break; case JsonValueType::String:{ auto s=t.GetString(); std::wstring ws(s.c_str()); for(auto&ch:ws)ch=(wchar_t)towlower(ch); exp=(ws==L"true"||ws==L"1"||ws==L"yes"||ws==L"on"); break;} default: break;} if (exp!=actual){ std::string kn(k,k+wcslen(k)); winvert4::Logf("SelfTest: toggles.%s mismatch", kn.c_str()); if(outLog){ outLog->append("mismatch toggles."); outLog->append(kn); outLog->append("\n"); } ok=false; } } };
+                auto eqb=[&](const wchar_t* k, bool actual){ if (auto t=o.TryLookup(k)){ bool exp=false; switch(t.ValueType()){case JsonValueType::Boolean: exp=t.GetBoolean(); break; case JsonValueType::Number: exp=t.GetNumber()!=0.0; break; case JsonValueType::String:{ auto s=t.GetString(); std::wstring ws(s.c_str()); for(auto&ch:ws)ch=(wchar_t)towlower(ch); exp=(ws==L"true"||ws==L"1"||ws==L"yes"||ws==L"on"); break;} default: break;} if (exp!=actual){ std::string kn(k,k+wcslen(k)); WINVERT_WARN(UI, "SelfTest: toggles.%s mismatch", kn.c_str()); if(outLog){ outLog->append("mismatch toggles."); outLog->append(kn); outLog->append("\n"); } ok=false; } } };
                 eqb(L"showFps", m_showFpsOverlay);
                 eqb(L"openUiOnStartup", m_openUiOnStartup);
                 eqb(L"runAtStartup", m_runAtStartup);
@@ -1525,35 +1527,35 @@ namespace
                 int er=(int)o.GetNamedNumber(L"r", (double)GetRValue(m_selectionColor));
                 int eg=(int)o.GetNamedNumber(L"g", (double)GetGValue(m_selectionColor));
                 int eb=(int)o.GetNamedNumber(L"b", (double)GetBValue(m_selectionColor));
-                if (er!=(int)GetRValue(m_selectionColor) || eg!=(int)GetGValue(m_selectionColor) || eb!=(int)GetBValue(m_selectionColor)) { winvert4::Log("SelfTest: selectionColor mismatch"); if(outLog) outLog->append("mismatch selectionColor\n"); ok=false; }
+                if (er!=(int)GetRValue(m_selectionColor) || eg!=(int)GetGValue(m_selectionColor) || eb!=(int)GetBValue(m_selectionColor)) { WINVERT_WARN(UI, "SelfTest: selectionColor mismatch"); if(outLog) outLog->append("mismatch selectionColor\n"); ok=false; }
             }
             // brightness
             if (auto v=root.TryLookup(L"brightness")) if (v.ValueType()==JsonValueType::Object){ auto o=v.GetObject();
-                int df=(int)o.GetNamedNumber(L"delayFrames", m_brightnessDelayFrames); if (df!=m_brightnessDelayFrames){ winvert4::Log("SelfTest: delayFrames mismatch"); if(outLog) outLog->append("mismatch delayFrames\n"); ok=false; }
-                if (auto lw=o.TryLookup(L"lumaWeights")) if (lw.ValueType()==JsonValueType::Array){ auto a=lw.GetArray(); if (a.Size()==3){ float r=(float)a.GetAt(0).GetNumber(), g=(float)a.GetAt(1).GetNumber(), b=(float)a.GetAt(2).GetNumber(); if(!(approxEq(r,m_lumaWeights[0])&&approxEq(g,m_lumaWeights[1])&&approxEq(b,m_lumaWeights[2]))){ winvert4::Log("SelfTest: lumaWeights mismatch"); if(outLog) outLog->append("mismatch lumaWeights\n"); ok=false; } } }
+                int df=(int)o.GetNamedNumber(L"delayFrames", m_brightnessDelayFrames); if (df!=m_brightnessDelayFrames){ WINVERT_WARN(UI, "SelfTest: delayFrames mismatch"); if(outLog) outLog->append("mismatch delayFrames\n"); ok=false; }
+                if (auto lw=o.TryLookup(L"lumaWeights")) if (lw.ValueType()==JsonValueType::Array){ auto a=lw.GetArray(); if (a.Size()==3){ float r=(float)a.GetAt(0).GetNumber(), g=(float)a.GetAt(1).GetNumber(), b=(float)a.GetAt(2).GetNumber(); if(!(approxEq(r,m_lumaWeights[0])&&approxEq(g,m_lumaWeights[1])&&approxEq(b,m_lumaWeights[2]))){ WINVERT_WARN(UI, "SelfTest: lumaWeights mismatch"); if(outLog) outLog->append("mismatch lumaWeights\n"); ok=false; } } }
             }
             // hotkeys
             if (auto v=root.TryLookup(L"hotkeys")) if (v.ValueType()==JsonValueType::Object){ auto o=v.GetObject();
-                auto check=[&](const wchar_t* k, UINT mod, UINT vk){ if (auto i=o.TryLookup(k)) if (i.ValueType()==JsonValueType::Object){ auto j=i.GetObject(); UINT em=(UINT)j.GetNamedNumber(L"mod", mod); UINT ev=(UINT)j.GetNamedNumber(L"vk", vk); if(em!=mod||ev!=vk){ std::string kn(k,k+wcslen(k)); winvert4::Logf("SelfTest: hotkeys.%s mismatch", kn.c_str()); if(outLog){ outLog->append("mismatch hotkeys."); outLog->append(kn); outLog->append("\n"); } ok=false; } } };
+                auto check=[&](const wchar_t* k, UINT mod, UINT vk){ if (auto i=o.TryLookup(k)) if (i.ValueType()==JsonValueType::Object){ auto j=i.GetObject(); UINT em=(UINT)j.GetNamedNumber(L"mod", mod); UINT ev=(UINT)j.GetNamedNumber(L"vk", vk); if(em!=mod||ev!=vk){ std::string kn(k,k+wcslen(k)); WINVERT_WARN(UI, "SelfTest: hotkeys.%s mismatch", kn.c_str()); if(outLog){ outLog->append("mismatch hotkeys."); outLog->append(kn); outLog->append("\n"); } ok=false; } } };
                 check(L"invert", m_hotkeyInvertMod, m_hotkeyInvertVk);
                 check(L"filter", m_hotkeyFilterMod, m_hotkeyFilterVk);
                 check(L"remove", m_hotkeyRemoveMod, m_hotkeyRemoveVk);
             }
             // favoriteFilterIndex
-            int ffi=(int)root.GetNamedNumber(L"favoriteFilterIndex", m_favoriteFilterIndex); if (ffi!=m_favoriteFilterIndex){ winvert4::Log("SelfTest: favoriteFilterIndex mismatch"); if(outLog) outLog->append("mismatch favoriteFilterIndex\n"); ok=false; }
+            int ffi=(int)root.GetNamedNumber(L"favoriteFilterIndex", m_favoriteFilterIndex); if (ffi!=m_favoriteFilterIndex){ WINVERT_WARN(UI, "SelfTest: favoriteFilterIndex mismatch"); if(outLog) outLog->append("mismatch favoriteFilterIndex\n"); ok=false; }
             // savedFilters count + names
             if (auto v=root.TryLookup(L"savedFilters")) if (v.ValueType()==JsonValueType::Array){ auto arr=v.GetArray();
                 // Count only non-builtin in model
                 size_t modelCount=0; for (auto& sf : m_savedFilters) if (!sf.isBuiltin) modelCount++;
-                if (modelCount != arr.Size()) { winvert4::Log("SelfTest: savedFilters count mismatch"); if(outLog) outLog->append("mismatch savedFilters count\n"); ok=false; }
+                if (modelCount != arr.Size()) { WINVERT_WARN(UI, "SelfTest: savedFilters count mismatch"); if(outLog) outLog->append("mismatch savedFilters count\n"); ok=false; }
                 else {
                     // Check names in order
-                    size_t idx=0; for (auto& sf : m_savedFilters) { if (sf.isBuiltin) continue; auto item=arr.GetAt((uint32_t)idx); if (item.ValueType()!=JsonValueType::Object){ ok=false; break; } auto o=item.GetObject(); auto name=o.GetNamedString(L"name", L""); if (name != sf.name){ winvert4::Log("SelfTest: savedFilters name mismatch"); if(outLog) outLog->append("mismatch savedFilters name\n"); ok=false; } idx++; }
+                    size_t idx=0; for (auto& sf : m_savedFilters) { if (sf.isBuiltin) continue; auto item=arr.GetAt((uint32_t)idx); if (item.ValueType()!=JsonValueType::Object){ ok=false; break; } auto o=item.GetObject(); auto name=o.GetNamedString(L"name", L""); if (name != sf.name){ WINVERT_WARN(UI, "SelfTest: savedFilters name mismatch"); if(outLog) outLog->append("mismatch savedFilters name\n"); ok=false; } idx++; }
                 }
             }
             // colorMaps
-            if (auto v=root.TryLookup(L"colorMaps")) if (v.ValueType()==JsonValueType::Array){ auto arr=v.GetArray(); if (arr.Size() != m_globalColorMaps.size()){ winvert4::Log("SelfTest: colorMaps count mismatch"); ok=false; } else {
-                for (uint32_t i=0;i<arr.Size();++i){ auto item=arr.GetAt(i); if (item.ValueType()!=JsonValueType::Object){ ok=false; break; } auto o=item.GetObject(); bool en=o.GetNamedBoolean(L"enabled", false); int sr=0,sg=0,sb=0,dr=0,dg=0,db=0; if (auto s=o.TryLookup(L"src")) if (s.ValueType()==JsonValueType::Array){ auto a=s.GetArray(); if (a.Size()==3){ sr=(int)a.GetAt(0).GetNumber(); sg=(int)a.GetAt(1).GetNumber(); sb=(int)a.GetAt(2).GetNumber(); } } if (auto d=o.TryLookup(L"dst")) if (d.ValueType()==JsonValueType::Array){ auto a=d.GetArray(); if (a.Size()==3){ dr=(int)a.GetAt(0).GetNumber(); dg=(int)a.GetAt(1).GetNumber(); db=(int)a.GetAt(2).GetNumber(); } } int tol=(int)o.GetNamedNumber(L"tolerance",0); const auto& me=m_globalColorMaps[i]; if (!(en==me.enabled && sr==me.srcR && sg==me.srcG && sb==me.srcB && dr==me.dstR && dg==me.dstG && db==me.dstB && tol==me.tolerance)) { winvert4::Log("SelfTest: colorMaps entry mismatch"); if(outLog){ char b[256]; _snprintf_s(b,_TRUNCATE,"mismatch colorMap[%u]\n", i); outLog->append(b);} ok=false; break; } }
+            if (auto v=root.TryLookup(L"colorMaps")) if (v.ValueType()==JsonValueType::Array){ auto arr=v.GetArray(); if (arr.Size() != m_globalColorMaps.size()){ WINVERT_WARN(UI, "SelfTest: colorMaps count mismatch"); ok=false; } else {
+                for (uint32_t i=0;i<arr.Size();++i){ auto item=arr.GetAt(i); if (item.ValueType()!=JsonValueType::Object){ ok=false; break; } auto o=item.GetObject(); bool en=o.GetNamedBoolean(L"enabled", false); int sr=0,sg=0,sb=0,dr=0,dg=0,db=0; if (auto s=o.TryLookup(L"src")) if (s.ValueType()==JsonValueType::Array){ auto a=s.GetArray(); if (a.Size()==3){ sr=(int)a.GetAt(0).GetNumber(); sg=(int)a.GetAt(1).GetNumber(); sb=(int)a.GetAt(2).GetNumber(); } } if (auto d=o.TryLookup(L"dst")) if (d.ValueType()==JsonValueType::Array){ auto a=d.GetArray(); if (a.Size()==3){ dr=(int)a.GetAt(0).GetNumber(); dg=(int)a.GetAt(1).GetNumber(); db=(int)a.GetAt(2).GetNumber(); } } int tol=(int)o.GetNamedNumber(L"tolerance",0); const auto& me=m_globalColorMaps[i]; if (!(en==me.enabled && sr==me.srcR && sg==me.srcG && sb==me.srcB && dr==me.dstR && dg==me.dstG && db==me.dstB && tol==me.tolerance)) { WINVERT_WARN(UI, "SelfTest: colorMaps entry mismatch"); if(outLog){ char b[256]; _snprintf_s(b,_TRUNCATE,"mismatch colorMap[%u]\n", i); outLog->append(b);} ok=false; break; } }
             } }
             return ok;
         };
@@ -1569,12 +1571,12 @@ namespace
             {
                 haveDir = true;
                 std::string p(testDir.begin(), testDir.end());
-                winvert4::Logf("SelfTest: auto-detected test dir: %s", p.c_str());
+                WINVERT_INFO(UI, "SelfTest: auto-detected test dir: %s", p.c_str());
             }
         }
         if (!haveDir)
         {
-            winvert4::Log("SelfTest: tests dir not found; skipping");
+            WINVERT_WARN(UI, "SelfTest: tests dir not found; skipping");
             return;
         }
 
@@ -1630,10 +1632,10 @@ namespace
         }
         else
         {
-            winvert4::Log("SelfTest: tests/saves directory not found; skipping");
+            WINVERT_WARN(UI, "SelfTest: tests/saves directory not found; skipping");
         }
 
-        winvert4::Logf("SelfTest: done %d/%d PASS", pass, total);
+        WINVERT_INFO(UI, "SelfTest: done %d/%d PASS", pass, total);
         SetEnvironmentVariableW(L"WINVERT_SETTINGS_PATH", nullptr);
     }
 #endif
@@ -1720,7 +1722,7 @@ namespace
         BOOL okRemove = RegisterHotKey(m_mainHwnd, HOTKEY_REMOVE_ID, m_hotkeyRemoveMod, m_hotkeyRemoveVk);
         DWORD errRemove = okRemove ? 0 : GetLastError();
 
-        winvert4::Logf(
+        WINVERT_INFO(UI,
             "RegisterAllHotkeys: invert(ok=%d mod=%u vk=%u err=%lu) filter(ok=%d mod=%u vk=%u err=%lu) remove(ok=%d mod=%u vk=%u err=%lu)",
             okInvert ? 1 : 0, m_hotkeyInvertMod, m_hotkeyInvertVk, static_cast<unsigned long>(errInvert),
             okFilter ? 1 : 0, m_hotkeyFilterMod, m_hotkeyFilterVk, static_cast<unsigned long>(errFilter),
@@ -1934,7 +1936,7 @@ namespace
     {
         if (m_isSelecting) return;
         m_isSelecting = true;
-        winvert4::Log("MainWindow: StartScreenSelection");
+        WINVERT_INFO(UI, "MainWindow: StartScreenSelection");
 
         // Prewarm output capture threads on hotkey/selection start so first
         // effect application is faster when selection completes.
@@ -1950,7 +1952,7 @@ namespace
 
         static ATOM s_atom = 0;
         if (!s_atom) s_atom = RegisterClassExW(&wcex);
-        winvert4::Logf("MainWindow: selection wnd class atom=%u", (unsigned)s_atom);
+        WINVERT_DEBUG(UI, "MainWindow: selection wnd class atom=%u", (unsigned)s_atom);
 
         const int vx = GetSystemMetrics(SM_XVIRTUALSCREEN);
         const int vy = GetSystemMetrics(SM_YVIRTUALSCREEN);
@@ -1972,7 +1974,7 @@ namespace
 
         if (m_selectionHwnd)
         {
-            winvert4::Logf("MainWindow: selection HWND=%p rect=(%d,%d %dx%d)", (void*)m_selectionHwnd, vx, vy, vw, vh);
+            WINVERT_DEBUG(UI, "MainWindow: selection HWND=%p rect=(%d,%d %dx%d)", (void*)m_selectionHwnd, vx, vy, vw, vh);
             ShowWindow(m_selectionHwnd, SW_SHOW);
             SetForegroundWindow(m_selectionHwnd);
             // If the control panel is visible, keep it interactive above the
@@ -1988,7 +1990,7 @@ namespace
         }
         else
         {
-            winvert4::Log("MainWindow: selection CreateWindowExW failed");
+            WINVERT_WARN(UI, "MainWindow: selection CreateWindowExW failed");
             m_isSelecting = false;
             if (s_keyboardHook)
             {
@@ -2007,7 +2009,7 @@ namespace
         m_virtualOrigin.y = GetSystemMetrics(SM_YVIRTUALSCREEN);
         m_screenSize.cx   = GetSystemMetrics(SM_CXVIRTUALSCREEN);
         m_screenSize.cy   = GetSystemMetrics(SM_CYVIRTUALSCREEN);
-        winvert4::Logf("MainWindow: virtual origin=(%ld,%ld) size=(%ldx%ld)", m_virtualOrigin.x, m_virtualOrigin.y, m_screenSize.cx, m_screenSize.cy);
+        WINVERT_DEBUG(UI, "MainWindow: virtual origin=(%ld,%ld) size=(%ldx%ld)", m_virtualOrigin.x, m_virtualOrigin.y, m_screenSize.cx, m_screenSize.cy);
 
         HDC screenDC = GetDC(nullptr);
         m_screenMemDC = CreateCompatibleDC(screenDC);
@@ -2019,7 +2021,7 @@ namespace
 
         SelectObject(m_screenMemDC, old);
         ReleaseDC(nullptr, screenDC);
-        winvert4::Log("MainWindow: captured screen bitmap");
+        WINVERT_DEBUG(UI, "MainWindow: captured screen bitmap");
     }
 
     void winrt::Winvert4::implementation::MainWindow::EnumerateMonitors()
@@ -2054,7 +2056,7 @@ namespace
         }
         m_screenSize = { 0,0 };
         m_virtualOrigin = { 0,0 };
-        winvert4::Log("MainWindow: released screen bitmap");
+        WINVERT_DEBUG(UI, "MainWindow: released screen bitmap");
     }
 
     RECT MainWindow::MakeRectFromPoints(POINT a, POINT b) const
@@ -2075,14 +2077,14 @@ namespace
         if (m_selectionHwnd) {
             ::DestroyWindow(m_selectionHwnd);
             m_selectionHwnd = nullptr;
-            winvert4::Log("MainWindow: selection overlay destroyed (pre-dup)");
+            WINVERT_DEBUG(UI, "MainWindow: selection overlay destroyed (pre-dup)");
         }
 
         // 2) Yield briefly so the overlay teardown can flush without adding
         // a fixed 16ms stall to every add-zone action.
         ::Sleep(1);
 
-        winvert4::Logf("MainWindow: selection completed rect=(%ld,%ld,%ld,%ld)",
+        WINVERT_DEBUG(UI, "MainWindow: selection completed rect=(%ld,%ld,%ld,%ld)",
                        sel.left, sel.top, sel.right, sel.bottom);
 
         // 3) Create a settings object for the new window
@@ -2128,9 +2130,9 @@ namespace
         // Primary window is the first split; extras are any additional splits
         auto newWindow = std::make_unique<EffectWindow>(splits[0], m_outputManager.get());
         newWindow->UpdateSettings(settings);
-        winvert4::Log("MainWindow: calling primary EffectWindow::Show()");
+        WINVERT_DEBUG(UI, "MainWindow: calling primary EffectWindow::Show()");
         newWindow->Show();
-        winvert4::Log("MainWindow: primary EffectWindow::Show() returned");
+        WINVERT_DEBUG(UI, "MainWindow: primary EffectWindow::Show() returned");
 
         // 4) Add a tab for the new window
         auto newTab = TabViewItem();
@@ -2161,9 +2163,9 @@ namespace
         {
             auto w = std::make_unique<EffectWindow>(splits[i], m_outputManager.get());
             w->UpdateSettings(settings);
-            winvert4::Logf("MainWindow: calling extra EffectWindow::Show() #%zu", i);
+            WINVERT_DEBUG(UI, "MainWindow: calling extra EffectWindow::Show() #%zu", i);
             w->Show();
-            winvert4::Logf("MainWindow: extra EffectWindow::Show() #%zu returned", i);
+            WINVERT_DEBUG(UI, "MainWindow: extra EffectWindow::Show() #%zu returned", i);
             extras.push_back(std::move(w));
         }
 
@@ -2237,7 +2239,7 @@ namespace
             SetCapture(hwnd);
             // Use FALSE to avoid erasing the background, which we handle ourselves
             InvalidateRect(hwnd, nullptr, FALSE);
-            winvert4::Log("MainWindow: selection WM_LBUTTONDOWN");
+            WINVERT_TRACE(UI, "MainWindow: selection WM_LBUTTONDOWN");
             return 0;
         }
 
@@ -2270,7 +2272,7 @@ namespace
             self->OnSelectionCompleted(sel);
 
             DestroyWindow(hwnd);
-            winvert4::Log("MainWindow: selection WM_LBUTTONUP -> DestroyWindow");
+            WINVERT_TRACE(UI, "MainWindow: selection WM_LBUTTONUP -> DestroyWindow");
             return 0;
         }
 
@@ -2294,7 +2296,7 @@ namespace
                     }
                 }
                 DestroyWindow(hwnd);
-                winvert4::Log("MainWindow: selection cancelled via ESC");
+                WINVERT_DEBUG(UI, "MainWindow: selection cancelled via ESC");
                 return 0;
             }
             else if (wParam >= '1' && wParam <= '9')
@@ -2311,7 +2313,7 @@ namespace
                     self->OnSelectionCompleted(s_monitorRects[monitorIndex]);
 
                     DestroyWindow(hwnd);
-                    winvert4::Logf("MainWindow: selection via monitor #%d", monitorIndex + 1);
+                    WINVERT_DEBUG(UI, "MainWindow: selection via monitor #%d", monitorIndex + 1);
                     return 0;
                 }
             }
@@ -2386,7 +2388,7 @@ namespace
             // Log custom border toggle/color on first paint of this overlay
             if (!s_loggedPaint)
             {
-                winvert4::Logf("SelectionWndProc WM_PAINT: selectionColorEnabled=%d color=%d,%d,%d",
+                WINVERT_TRACE(UI, "SelectionWndProc WM_PAINT: selectionColorEnabled=%d color=%d,%d,%d",
                     self->m_useCustomSelectionColor ? 1 : 0,
                     (int)GetRValue(self->m_selectionColor), (int)GetGValue(self->m_selectionColor), (int)GetBValue(self->m_selectionColor));
                 s_loggedPaint = true;
@@ -2424,7 +2426,7 @@ namespace
                 self->m_isSelecting = false;
                 self->ReleaseScreenBitmap();
                 self->m_selectionHwnd = nullptr;
-                winvert4::Log("MainWindow: selection overlay destroyed");
+                WINVERT_DEBUG(UI, "MainWindow: selection overlay destroyed");
             }
             { static bool s_loggedPaint = false; s_loggedPaint = false; }
             return 0;
@@ -2512,13 +2514,13 @@ namespace
                     c.R = (uint8_t)GetRValue(self->m_selectionColor);
                     c.G = (uint8_t)GetGValue(self->m_selectionColor);
                     c.B = (uint8_t)GetBValue(self->m_selectionColor);
-                    winvert4::Logf("ApplySelectionColorToPicker_: deferred set R=%d G=%d B=%d",
+                    WINVERT_TRACE(UI, "ApplySelectionColorToPicker_: deferred set R=%d G=%d B=%d",
                         (int)c.R, (int)c.G, (int)c.B);
                     self->m_isProgrammaticSelectionColorChange = true;
                     cp.Color(c);
                     self->m_isProgrammaticSelectionColorChange = false;
                     auto applied = cp.Color();
-                    winvert4::Logf("ApplySelectionColorToPicker_: deferred applied R=%d G=%d B=%d",
+                    WINVERT_TRACE(UI, "ApplySelectionColorToPicker_: deferred applied R=%d G=%d B=%d",
                         (int)applied.R, (int)applied.G, (int)applied.B);
                 }
             });
@@ -2531,13 +2533,13 @@ namespace
         c.R = (uint8_t)GetRValue(m_selectionColor);
         c.G = (uint8_t)GetGValue(m_selectionColor);
         c.B = (uint8_t)GetBValue(m_selectionColor);
-        winvert4::Logf("ApplySelectionColorToPicker_: immediate set R=%d G=%d B=%d",
+        WINVERT_TRACE(UI, "ApplySelectionColorToPicker_: immediate set R=%d G=%d B=%d",
             (int)c.R, (int)c.G, (int)c.B);
         m_isProgrammaticSelectionColorChange = true;
         cpSel.Color(c);
         m_isProgrammaticSelectionColorChange = false;
         auto applied = cpSel.Color();
-        winvert4::Logf("ApplySelectionColorToPicker_: immediate applied R=%d G=%d B=%d",
+        WINVERT_TRACE(UI, "ApplySelectionColorToPicker_: immediate applied R=%d G=%d B=%d",
             (int)applied.R, (int)applied.G, (int)applied.B);
     }
 
@@ -3022,7 +3024,7 @@ namespace
                 {
                     // Ignore effect hotkeys while rebinding to prevent actions
                     // from firing during key-capture.
-                    winvert4::Logf("Rebind: ignored WM_HOTKEY id=%u while rebinding", (unsigned)wParam);
+                    WINVERT_DEBUG(UI, "Rebind: ignored WM_HOTKEY id=%u while rebinding", (unsigned)wParam);
                     return 0;
                 }
                 // Defer action to the dispatcher to avoid mutating XAML/TabView
@@ -3042,7 +3044,7 @@ namespace
         case WM_TIMER:
             if (wParam == REBIND_TIMEOUT_TIMER_ID && pThis->m_rebindingState != RebindingState::None)
             {
-                winvert4::Log("Rebind: timeout waiting for key combo");
+                WINVERT_DEBUG(UI, "Rebind: timeout waiting for key combo");
                 pThis->EndRebindCapture(true, L"Rebind timed out. Try again.");
                 MessageBoxW(
                     pThis->m_mainHwnd,
@@ -3752,7 +3754,7 @@ void winrt::Winvert4::implementation::MainWindow::PreviewFilterToggle_Unchecked(
 // --- Unified AppState to blob file ---
 void winrt::Winvert4::implementation::MainWindow::SaveAppState()
 {
-    if (!m_isSavingEnabled) { winvert4::Log("SaveAppState: suppressed (init)"); return; }
+    if (!m_isSavingEnabled) { WINVERT_DEBUG(UI, "SaveAppState: suppressed (init)"); return; }
     using winrt::Windows::Storage::ApplicationData;
     using winrt::Windows::Data::Json::JsonObject;
     using winrt::Windows::Data::Json::JsonArray;
@@ -3766,7 +3768,7 @@ void winrt::Winvert4::implementation::MainWindow::SaveAppState()
             std::wstring jsonPath = std::wstring(folder.Path().c_str()) + L"\\settings.json";
             {
                 std::string p(jsonPath.begin(), jsonPath.end());
-                winvert4::Logf("SaveAppState: writing json to %s", p.c_str());
+                WINVERT_DEBUG(UI, "SaveAppState: writing json to %s", p.c_str());
             }
             JsonObject root;
             root.SetNamedValue(L"version", JsonValue::CreateNumberValue(1));
@@ -3820,12 +3822,12 @@ void winrt::Winvert4::implementation::MainWindow::LoadAppState()
             std::wstring jsonPath = LocalStateSettingsPath();
             {
                 std::string p(jsonPath.begin(), jsonPath.end());
-                winvert4::Logf("LoadAppState: jsonPath=%s", p.c_str());
+                WINVERT_DEBUG(UI, "LoadAppState: jsonPath=%s", p.c_str());
             }
             std::ifstream jfs(jsonPath, std::ios::binary);
             if (jfs)
             {
-                winvert4::Log("LoadAppState: opened settings.json");
+                WINVERT_DEBUG(UI, "LoadAppState: opened settings.json");
                 std::string data((std::istreambuf_iterator<char>(jfs)), std::istreambuf_iterator<char>());
                 if (data.size() >= 3 && (unsigned char)data[0] == 0xEF && (unsigned char)data[1] == 0xBB && (unsigned char)data[2] == 0xBF)
                     data.erase(0, 3);
@@ -3839,17 +3841,17 @@ void winrt::Winvert4::implementation::MainWindow::LoadAppState()
                     try {
                         std::wstring wpreview = wjson.substr(0, std::min<size_t>(256, wjson.size()));
                         std::string preview(wpreview.begin(), wpreview.end());
-                        winvert4::Logf("LoadAppState: json preview: %s", preview.c_str());
+                        WINVERT_DEBUG(UI, "LoadAppState: json preview: %s", preview.c_str());
                         std::wstring wkeys;
                         auto it = root.First();
                         while (it.HasCurrent()) { auto kv = it.Current(); wkeys += kv.Key(); wkeys += L" "; it.MoveNext(); }
                         std::string keys(wkeys.begin(), wkeys.end());
-                        winvert4::Logf("LoadAppState: root keys: %s", keys.c_str());
+                        WINVERT_DEBUG(UI, "LoadAppState: root keys: %s", keys.c_str());
                     } catch (...) {}
                     // Toggles (robust to bool, number, or common strings)
                     if (auto v = root.TryLookup(L"toggles")) if (v.ValueType() == winrt::Windows::Data::Json::JsonValueType::Object) {
                         auto o = v.GetObject();
-                        winvert4::Log("LoadAppState: toggles object present");
+                        WINVERT_DEBUG(UI, "LoadAppState: toggles object present");
                         auto readBool = [](winrt::Windows::Data::Json::IJsonValue const& jv, bool& out){
                             using namespace winrt::Windows::Data::Json;
                             if (!jv) return;
@@ -3871,7 +3873,7 @@ void winrt::Winvert4::implementation::MainWindow::LoadAppState()
                         };
                         if (auto t = o.TryLookup(L"showFps")) {
                             readBool(t, m_showFpsOverlay);
-                            winvert4::Logf("LoadAppState: showFps=%d", m_showFpsOverlay ? 1 : 0);
+                            WINVERT_DEBUG(UI, "LoadAppState: showFps=%d", m_showFpsOverlay ? 1 : 0);
                         }
                         if (auto t = o.TryLookup(L"openUiOnStartup")) {
                             readBool(t, m_openUiOnStartup);
@@ -3881,22 +3883,22 @@ void winrt::Winvert4::implementation::MainWindow::LoadAppState()
                         }
                         if (auto t = o.TryLookup(L"selectionColorEnabled")) {
                             using winrt::Windows::Data::Json::JsonValueType;
-                            winvert4::Logf("LoadAppState: selectionColorEnabled ValueType=%d", (int)t.ValueType());
+                            WINVERT_DEBUG(UI, "LoadAppState: selectionColorEnabled ValueType=%d", (int)t.ValueType());
                             readBool(t, m_useCustomSelectionColor);
-                            winvert4::Logf("LoadAppState: selectionColorEnabled parsed=%d", m_useCustomSelectionColor ? 1 : 0);
+                            WINVERT_DEBUG(UI, "LoadAppState: selectionColorEnabled parsed=%d", m_useCustomSelectionColor ? 1 : 0);
                         }
                         else {
-                            winvert4::Log("LoadAppState: selectionColorEnabled not found in toggles");
+                            WINVERT_DEBUG(UI, "LoadAppState: selectionColorEnabled not found in toggles");
                         }
                         if (auto t = o.TryLookup(L"colorMapPreserve")) readBool(t, m_colorMapPreserveToggleState);
                     }
                     else {
                         // Either property absent or not an object (e.g., wrong type)
-                        winvert4::Log("LoadAppState: toggles object missing");
+                        WINVERT_DEBUG(UI, "LoadAppState: toggles object missing");
                         // Fallback: try reading selectionColorEnabled at top-level (dev resilience)
                         if (auto t = root.TryLookup(L"selectionColorEnabled")) {
                             using winrt::Windows::Data::Json::JsonValueType;
-                            winvert4::Logf("LoadAppState: (fallback) selectionColorEnabled ValueType=%d", (int)t.ValueType());
+                            WINVERT_DEBUG(UI, "LoadAppState: (fallback) selectionColorEnabled ValueType=%d", (int)t.ValueType());
                             auto readBool = [](winrt::Windows::Data::Json::IJsonValue const& jv, bool& out){
                                 using namespace winrt::Windows::Data::Json;
                                 if (!jv) return;
@@ -3917,7 +3919,7 @@ void winrt::Winvert4::implementation::MainWindow::LoadAppState()
                                 }
                             };
                             readBool(t, m_useCustomSelectionColor);
-                            winvert4::Logf("LoadAppState: (fallback) selectionColorEnabled parsed=%d", m_useCustomSelectionColor ? 1 : 0);
+                            WINVERT_DEBUG(UI, "LoadAppState: (fallback) selectionColorEnabled parsed=%d", m_useCustomSelectionColor ? 1 : 0);
                         }
                     }
                     // Selection color
@@ -3930,7 +3932,7 @@ void winrt::Winvert4::implementation::MainWindow::LoadAppState()
                             int g = (int)o.GetNamedNumber(L"g", 0);
                             int b = (int)o.GetNamedNumber(L"b", 0);
                             m_selectionColor = RGB(r, g, b);
-                            winvert4::Logf("LoadAppState: selectionColor r=%d g=%d b=%d", r, g, b);
+                            WINVERT_DEBUG(UI, "LoadAppState: selectionColor r=%d g=%d b=%d", r, g, b);
                         }
                     }
                     // Brightness
@@ -4032,7 +4034,7 @@ void winrt::Winvert4::implementation::MainWindow::LoadAppState()
                     }
 
                     // Log loaded selection color settings
-                    winvert4::Logf("Settings loaded: selectionColorEnabled=%d color=%d,%d,%d",
+                    WINVERT_DEBUG(UI, "Settings loaded: selectionColorEnabled=%d color=%d,%d,%d",
                         m_useCustomSelectionColor ? 1 : 0,
                         (int)GetRValue(m_selectionColor), (int)GetGValue(m_selectionColor), (int)GetBValue(m_selectionColor));
 
@@ -4423,16 +4425,16 @@ void winrt::Winvert4::implementation::MainWindow::PreviewColorMapToggle_Unchecke
                 if (auto t = RunAtStartupToggle()) { t.IsOn(isOn); t.IsEnabled(canToggle); }
                 m_isInitializingStartupToggle = false;
             });
-            winvert4::Logf("StartupTask init: state=%s isOn=%d canToggle=%d",
+            WINVERT_INFO(UI, "StartupTask init: state=%s isOn=%d canToggle=%d",
                 StartupTaskStateToString(state), isOn ? 1 : 0, canToggle ? 1 : 0);
         }
         catch (winrt::hresult_error const& ex)
         {
-            winvert4::Logf("StartupTask init failed: hr=0x%08X", static_cast<unsigned int>(ex.code().value));
+            WINVERT_WARN(UI, "StartupTask init failed: hr=0x%08X", static_cast<unsigned int>(ex.code().value));
         }
         catch (...)
         {
-            winvert4::Log("StartupTask init failed: unknown exception");
+            WINVERT_WARN(UI, "StartupTask init failed: unknown exception");
         }
         co_return;
     }
@@ -4491,7 +4493,7 @@ void winrt::Winvert4::implementation::MainWindow::PreviewColorMapToggle_Unchecke
                     if (auto t = RunAtStartupToggle()) t.IsOn(isOn);
                     m_isInitializingStartupToggle = false;
                 });
-                winvert4::Logf("StartupTask first-run prompt: result=%s isOn=%d",
+                WINVERT_INFO(UI, "StartupTask first-run prompt: result=%s isOn=%d",
                     StartupTaskStateToString(res), isOn ? 1 : 0);
             }
             else
@@ -4503,17 +4505,17 @@ void winrt::Winvert4::implementation::MainWindow::PreviewColorMapToggle_Unchecke
                     if (auto t = RunAtStartupToggle()) t.IsOn(false);
                     m_isInitializingStartupToggle = false;
                 });
-                winvert4::Log("StartupTask first-run prompt: user declined");
+                WINVERT_INFO(UI, "StartupTask first-run prompt: user declined");
             }
         }
         catch (winrt::hresult_error const& ex)
         {
-            winvert4::Logf("StartupTask first-run prompt failed: hr=0x%08X",
+            WINVERT_WARN(UI, "StartupTask first-run prompt failed: hr=0x%08X",
                 static_cast<unsigned int>(ex.code().value));
         }
         catch (...)
         {
-            winvert4::Log("StartupTask first-run prompt failed: unknown exception");
+            WINVERT_WARN(UI, "StartupTask first-run prompt failed: unknown exception");
         }
         co_return;
     }
@@ -4542,7 +4544,7 @@ void winrt::Winvert4::implementation::MainWindow::PreviewColorMapToggle_Unchecke
                         auto res = co_await task.RequestEnableAsync();
                         bool isOn = (res == StartupTaskState::Enabled || res == StartupTaskState::EnabledByPolicy);
                         self->m_runAtStartup = isOn;
-                        winvert4::Logf("StartupTask toggle: requestEnable result=%s isOn=%d",
+                        WINVERT_INFO(UI, "StartupTask toggle: requestEnable result=%s isOn=%d",
                             StartupTaskStateToString(res), isOn ? 1 : 0);
                         self->DispatcherQueue().TryEnqueue([self, isOn]()
                         {
@@ -4556,19 +4558,19 @@ void winrt::Winvert4::implementation::MainWindow::PreviewColorMapToggle_Unchecke
                     {
                         task.Disable();
                         self->m_runAtStartup = false;
-                        winvert4::Log("StartupTask toggle: disable requested");
+                        WINVERT_INFO(UI, "StartupTask toggle: disable requested");
                         self->DispatcherQueue().TryEnqueue([self]()
                         {
                             self->SaveAppState();
                         });
                     }
                     auto after = task.State();
-                    winvert4::Logf("StartupTask toggle: before=%s after=%s wantEnable=%d",
+                    WINVERT_INFO(UI, "StartupTask toggle: before=%s after=%s wantEnable=%d",
                         StartupTaskStateToString(before), StartupTaskStateToString(after), wantEnable ? 1 : 0);
                 }
                 catch (winrt::hresult_error const& ex)
                 {
-                    winvert4::Logf("StartupTask toggle failed: hr=0x%08X wantEnable=%d",
+                    WINVERT_WARN(UI, "StartupTask toggle failed: hr=0x%08X wantEnable=%d",
                         static_cast<unsigned int>(ex.code().value), wantEnable ? 1 : 0);
                     self->DispatcherQueue().TryEnqueue([self, wantEnable]()
                     {
@@ -4580,7 +4582,7 @@ void winrt::Winvert4::implementation::MainWindow::PreviewColorMapToggle_Unchecke
                 }
                 catch (...)
                 {
-                    winvert4::Logf("StartupTask toggle failed: unknown exception wantEnable=%d", wantEnable ? 1 : 0);
+                    WINVERT_WARN(UI, "StartupTask toggle failed: unknown exception wantEnable=%d", wantEnable ? 1 : 0);
                     self->DispatcherQueue().TryEnqueue([self, wantEnable]()
                     {
                         self->m_isInitializingStartupToggle = true;
@@ -0,0 +1,232 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace winvert4::metrics
+{
+    uint64_t NowNs()
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    namespace {
+        std::atomic<uint32_t> g_nextShard{ 0 };
+
+        uint32_t ThreadShard()
+        {
+            // Threads take shards round-robin in order of first use
+            thread_local const uint32_t shard = g_nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+            return shard;
+        }
+    }
+
+    void Counter::Add(uint64_t n)
+    {
+        m_shards[ThreadShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t Counter::Value() const
+    {
+        uint64_t sum = 0;
+        for (const Shard& s : m_shards) sum += s.value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    void Gauge::Set(double v)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        m_bits.store(bits, std::memory_order_relaxed);
+    }
+
+    double Gauge::Value() const
+    {
+        const uint64_t bits = m_bits.load(std::memory_order_relaxed);
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    Registry& Registry::Global()
+    {
+        // Leaked on purpose: metrics may be touched by threads still running at exit
+        static Registry* s_registry = new Registry();
+        return *s_registry;
+    }
+
+    Registry::Entry& Registry::Find_(std::string_view name, Kind kind)
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (auto& e : m_entries)
+        {
+            if (e->kind == kind && e->name == name) return *e;
+        }
+        auto e = std::make_unique<Entry>();
+        e->name.assign(name);
+        e->kind = kind;
+        switch (kind)
+        {
+        case Kind::Counter: e->counter = std::make_unique<Counter>(); break;
+        case Kind::Gauge: e->gauge = std::make_unique<Gauge>(); break;
+        case Kind::Histogram: e->histogram = std::make_unique<Histogram>(); break;
+        }
+        m_entries.push_back(std::move(e));
+        return *m_entries.back();
+    }
+
+    Counter& Registry::GetCounter(std::string_view name) { return *Find_(name, Kind::Counter).counter; }
+    Gauge& Registry::GetGauge(std::string_view name) { return *Find_(name, Kind::Gauge).gauge; }
+    Histogram& Registry::GetHistogram(std::string_view name) { return *Find_(name, Kind::Histogram).histogram; }
+
+    size_t Registry::RemovePrefix(std::string_view prefix)
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        const size_t before = m_entries.size();
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+            [prefix](const std::unique_ptr<Entry>& e) { return std::string_view(e->name).substr(0, prefix.size()) == prefix; }),
+            m_entries.end());
+        return before - m_entries.size();
+    }
+
+    size_t Registry::Size() const
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        return m_entries.size();
+    }
+
+    void Registry::Snapshot(std::vector<Sample>& out, uint64_t nowNs) const
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        out.resize(m_entries.size());
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            const Entry& e = *m_entries[i];
+            Sample& s = out[i];
+            s.name = e.name;
+            s.kind = e.kind;
+            s.value = 0.0;
+            s.summary = {};
+            switch (e.kind)
+            {
+            case Kind::Counter: s.value = double(e.counter->Value()); break;
+            case Kind::Gauge: s.value = e.gauge->Value(); break;
+            case Kind::Histogram: s.summary = e.histogram->Summarize(nowNs); s.value = double(s.summary.count); break;
+            }
+        }
+    }
+
+    Exporter::~Exporter()
+    {
+        Stop();
+    }
+
+    bool Exporter::Start(Registry& registry, void* base, size_t bytes, uint32_t periodMs, OverflowFn onOverflow)
+    {
+        if (m_thread.joinable() || !base || bytes < RequiredBytes(0)) return false;
+        m_registry = &registry;
+        m_header = new (base) MappedHeader{};
+        m_entries = reinterpret_cast<MappedEntry*>(m_header + 1);
+        m_capacity = uint32_t(std::min<size_t>((bytes - sizeof(MappedHeader)) / sizeof(MappedEntry), UINT32_MAX));
+        m_periodMs = std::max(1u, periodMs);
+        m_onOverflow = std::move(onOverflow);
+        m_overflowed = false;
+
+        std::memcpy(m_header->magic, "WVMX", 4);
+        m_header->version = kVersion;
+        m_header->capacity = m_capacity;
+        m_header->entrySize = uint32_t(sizeof(MappedEntry));
+
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_stop = false;
+        }
+        m_thread = std::thread(&Exporter::ThreadProc_, this);
+        return true;
+    }
+
+    void Exporter::Stop()
+    {
+        if (!m_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+        ExportNow();
+    }
+
+    void Exporter::ThreadProc_()
+    {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        while (!m_stop)
+        {
+            lk.unlock();
+            ExportNow();
+            lk.lock();
+            m_cv.wait_for(lk, std::chrono::milliseconds(m_periodMs), [this] { return m_stop; });
+        }
+    }
+
+    void Exporter::ExportNow()
+    {
+        if (!m_registry || !m_header) return;
+        std::lock_guard<std::mutex> lk(m_exportMutex);
+        const uint64_t now = NowNs();
+        m_registry->Snapshot(m_scratch, now);
+        const uint32_t count = uint32_t(std::min<size_t>(m_scratch.size(), m_capacity));
+        const size_t dropped = m_scratch.size() - count;
+        // Reported once per overflow, not every period
+        if (dropped > 0 && !m_overflowed && m_onOverflow) m_onOverflow(m_scratch.size(), m_capacity);
+        m_overflowed = dropped > 0;
+
+        // Odd while writing; the fences keep the payload inside the odd/even pair
+        const uint64_t seq = m_header->sequence.load(std::memory_order_relaxed);
+        m_header->sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_header->timestampNs = now;
+        m_header->entryCount = count;
+        m_header->dropped = uint32_t(std::min<size_t>(dropped, UINT32_MAX));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Sample& s = m_scratch[i];
+            MappedEntry& e = m_entries[i];
+            std::memset(&e, 0, sizeof(e));
+            std::memcpy(e.name, s.name.data(), std::min(s.name.size(), sizeof(e.name) - 1));
+            e.kind = uint32_t(s.kind);
+            e.count = s.summary.count;
+            e.value = s.value;
+            e.p50Ms = s.summary.p50Ms;
+            e.p90Ms = s.summary.p90Ms;
+            e.p99Ms = s.summary.p99Ms;
+            e.maxMs = s.summary.maxMs;
+        }
+        m_header->sequence.store(seq + 2, std::memory_order_release);
+        m_exports.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool ReadMapped(const void* base, size_t bytes, uint64_t& timestampNs, std::vector<MappedEntry>& out)
+    {
+        if (!base || bytes < sizeof(MappedHeader)) return false;
+        const auto* header = static_cast<const MappedHeader*>(base);
+        if (std::memcmp(header->magic, "WVMX", 4) != 0 || header->version != Exporter::kVersion) return false;
+        const auto* entries = reinterpret_cast<const MappedEntry*>(header + 1);
+        const size_t room = (bytes - sizeof(MappedHeader)) / sizeof(MappedEntry);
+        for (int attempt = 0; attempt < 64; ++attempt)
+        {
+            const uint64_t before = header->sequence.load(std::memory_order_acquire);
+            if (before == 0) return false;  // nothing published yet
+            if (before & 1) { std::this_thread::yield(); continue; }
+            const size_t count = std::min<size_t>(header->entryCount, room);
+            timestampNs = header->timestampNs;
+            out.resize(count);
+            if (count) std::memcpy(out.data(), entries, count * sizeof(MappedEntry));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include "LatencyHistogram.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Process-wide performance metrics: counters, gauges and latency histograms,
+// registered by name once and then updated without locks. An exporter
+// periodically publishes a snapshot into shared memory (a mapped file) that
+// external tools read with no IPC. Portable: no Windows headers.
+namespace winvert4::metrics
+{
+    constexpr size_t kCacheLine = 64;
+    constexpr uint32_t kShards = 16;
+
+    // steady_clock nanoseconds; the time base histograms are recorded and summarized with
+    uint64_t NowNs();
+
+    // Monotonic count. Each thread adds to its own cache line (threads are spread over
+    // kShards shards), so hot counters shared by several threads do not bounce.
+    class Counter
+    {
+    public:
+        void Add(uint64_t n = 1);
+        uint64_t Value() const;
+
+    private:
+        struct alignas(kCacheLine) Shard
+        {
+            std::atomic<uint64_t> value{ 0 };
+        };
+        std::array<Shard, kShards> m_shards;
+    };
+
+    // Last value set.
+    class alignas(kCacheLine) Gauge
+    {
+    public:
+        void Set(double v);
+        double Value() const;
+
+    private:
+        std::atomic<uint64_t> m_bits{ 0 };  // IEEE double
+    };
+
+    using Histogram = LatencyHistogram;
+
+    enum class Kind : uint32_t
+    {
+        Counter = 1,
+        Gauge = 2,
+        Histogram = 3,
+    };
+
+    struct Sample
+    {
+        std::string name;
+        Kind kind{ Kind::Counter };
+        double value{ 0.0 };                // counter or gauge
+        LatencyHistogram::Summary summary;  // histogram
+    };
+
+    // References handed out stay valid until the metric is removed; per-object
+    // metrics are removed with their owner. Getting an existing name returns the
+    // same metric.
+    class Registry
+    {
+    public:
+        static Registry& Global();
+
+        Counter& GetCounter(std::string_view name);
+        Gauge& GetGauge(std::string_view name);
+        Histogram& GetHistogram(std::string_view name);
+        // Drop every metric whose name starts with prefix; returns how many. The
+        // caller must be done with references to them (other threads included).
+        size_t RemovePrefix(std::string_view prefix);
+
+        // Histograms are summarized over their window ending at nowNs
+        void Snapshot(std::vector<Sample>& out, uint64_t nowNs) const;
+        size_t Size() const;
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            Kind kind{ Kind::Counter };
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+        };
+        Entry& Find_(std::string_view name, Kind kind);
+
+        mutable std::mutex m_mutex;
+        std::vector<std::unique_ptr<Entry>> m_entries;  // guarded by m_mutex
+    };
+
+    // Shared-memory layout (version 1). Readers take the sequence, copy, and retry if
+    // it was odd or changed (the exporter bumps it to odd while writing).
+    struct MappedHeader
+    {
+        char magic[4];                    // "WVMX"
+        uint32_t version;
+        std::atomic<uint64_t> sequence;
+        uint64_t timestampNs;             // NowNs() of the snapshot
+        uint32_t entryCount;
+        uint32_t capacity;
+        uint32_t entrySize;
+        uint32_t dropped;                 // registered metrics that did not fit
+        uint32_t reserved[6];
+    };
+    static_assert(sizeof(MappedHeader) == 64, "metrics::MappedHeader must stay 64 bytes");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory sequence must be lock-free");
+
+    struct MappedEntry
+    {
+        char name[64];                    // NUL-terminated, truncated
+        uint32_t kind;                    // Kind
+        uint32_t reserved;
+        uint64_t count;                   // histogram sample count
+        double value;                     // counter or gauge
+        double p50Ms, p90Ms, p99Ms, maxMs;
+        uint64_t reserved2;
+    };
+    static_assert(sizeof(MappedEntry) == 128, "metrics::MappedEntry must stay 128 bytes");
+
+    // Writes registry snapshots into caller-provided memory every period. The memory
+    // (typically a mapped file) must stay valid until Stop().
+    class Exporter
+    {
+    public:
+        static constexpr uint32_t kVersion = 1;
+        static size_t RequiredBytes(uint32_t capacity) { return sizeof(MappedHeader) + size_t(capacity) * sizeof(MappedEntry); }
+
+        Exporter() = default;
+        ~Exporter();
+        Exporter(const Exporter&) = delete;
+        Exporter& operator=(const Exporter&) = delete;
+
+        // (registered, capacity), on the exporter thread, when a snapshot starts
+        // leaving metrics out
+        using OverflowFn = std::function<void(size_t registered, uint32_t capacity)>;
+
+        // False if the memory cannot hold a header. Metrics beyond its capacity are
+        // left out; onOverflow (optional) reports it.
+        bool Start(Registry& registry, void* base, size_t bytes, uint32_t periodMs, OverflowFn onOverflow = {});
+        // Publishes a final snapshot, then joins the thread.
+        void Stop();
+        // Publish a snapshot now, outside the period
+        void ExportNow();
+        uint64_t Exports() const { return m_exports.load(std::memory_order_relaxed); }
+
+    private:
+        void ThreadProc_();
+
+        Registry* m_registry{ nullptr };
+        MappedHeader* m_header{ nullptr };
+        MappedEntry* m_entries{ nullptr };
+        uint32_t m_capacity{ 0 };
+        uint32_t m_periodMs{ 1000 };
+        OverflowFn m_onOverflow;
+        bool m_overflowed{ false };     // guarded by m_exportMutex
+        std::vector<Sample> m_scratch;  // guarded by m_exportMutex
+        std::mutex m_exportMutex;       // serializes ExportNow callers
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_stop{ false };           // guarded by m_mutex
+        std::thread m_thread;
+        std::atomic<uint64_t> m_exports{ 0 };
+    };
+
+    // Copy the latest consistent snapshot out of exporter memory; false if none yet
+    // or the writer kept it busy. For tools and tests.
+    bool ReadMapped(const void* base, size_t bytes, uint64_t& timestampNs, std::vector<MappedEntry>& out);
+}
@@ -1,13 +1,110 @@
 #include "pch.h"
 #include "Log.h"
 #include "OutputManager.h"
+#include "FrameTrace.h"
+
+namespace frametrace = winvert4::frametrace;
+namespace metrics = winvert4::metrics;
+
+namespace {
+    bool WriteWholeFile(const std::wstring& path, const void* data, size_t size)
+    {
+        HANDLE h = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h == INVALID_HANDLE_VALUE) return false;
+        DWORD written = 0;
+        const BOOL ok = WriteFile(h, data, static_cast<DWORD>(size), &written, nullptr);
+        CloseHandle(h);
+        return ok && written == size;
+    }
+
+    // Room in the exported metrics file, and how often it is refreshed
+    constexpr uint32_t kMetricsCapacity = 512;
+    constexpr uint32_t kMetricsPeriodMs = 500;
+}
 
 OutputManager::OutputManager()
+    : m_threadRebuilds(metrics::Registry::Global().GetCounter("outputs.thread_rebuilds"))
+    , m_threadCount(metrics::Registry::Global().GetGauge("outputs.threads"))
 {
+    // WINVERT_FRAME_TRACE=<path prefix> records capture/render stage timings and
+    // writes <prefix>.wvtrace and <prefix>.json (Chrome trace format) on shutdown
+    wchar_t path[MAX_PATH]{};
+    const DWORD len = GetEnvironmentVariableW(L"WINVERT_FRAME_TRACE", path, MAX_PATH);
+    if (len > 0 && len < MAX_PATH)
+    {
+        m_frameTracePath.assign(path, len);
+        frametrace::Recorder::Global().SetEnabled(true);
+        WINVERT_INFO(OM, "OM: frame trace enabled");
+    }
+
+    // WINVERT_METRICS_FILE=<path> keeps a memory-mapped snapshot of all metrics at
+    // <path> (layout in Metrics.h) that external tools can sample without IPC
+    const DWORD metricsLen = GetEnvironmentVariableW(L"WINVERT_METRICS_FILE", path, MAX_PATH);
+    if (metricsLen > 0 && metricsLen < MAX_PATH)
+    {
+        StartMetricsExport_(std::wstring(path, metricsLen));
+    }
 }
 
 OutputManager::~OutputManager()
 {
+    // Stop the capture threads first so the trace and metrics see their final state
+    m_duplicationThreads.clear();
+    if (!m_frameTracePath.empty())
+    {
+        frametrace::Recorder::Global().SetEnabled(false);
+        WriteFrameTrace_();
+    }
+    StopMetricsExport_();
+}
+
+void OutputManager::StartMetricsExport_(const std::wstring& path)
+{
+    const size_t bytes = metrics::Exporter::RequiredBytes(kMetricsCapacity);
+    m_metricsFile = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_metricsFile != INVALID_HANDLE_VALUE)
+    {
+        m_metricsMapping = CreateFileMappingW(m_metricsFile, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(bytes), nullptr);
+    }
+    if (m_metricsMapping)
+    {
+        m_metricsView = MapViewOfFile(m_metricsMapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    }
+    auto onOverflow = [](size_t registered, uint32_t capacity) {
+        WINVERT_WARN(OM, "OM: %zu metrics registered, export holds %u; the rest are left out", registered, capacity);
+    };
+    if (!m_metricsView || !m_metricsExporter.Start(metrics::Registry::Global(), m_metricsView, bytes, kMetricsPeriodMs, onOverflow))
+    {
+        WINVERT_WARN(OM, "OM: metrics file could not be mapped (err=%u); export off", GetLastError());
+        StopMetricsExport_();
+        return;
+    }
+    WINVERT_INFO(OM, "OM: metrics export enabled (%u entries, every %u ms)", kMetricsCapacity, kMetricsPeriodMs);
+}
+
+void OutputManager::StopMetricsExport_()
+{
+    m_metricsExporter.Stop();
+    if (m_metricsView) { UnmapViewOfFile(m_metricsView); m_metricsView = nullptr; }
+    if (m_metricsMapping) { CloseHandle(m_metricsMapping); m_metricsMapping = nullptr; }
+    if (m_metricsFile != INVALID_HANDLE_VALUE) { CloseHandle(m_metricsFile); m_metricsFile = INVALID_HANDLE_VALUE; }
+}
+
+void OutputManager::WriteFrameTrace_()
+{
+    const frametrace::TraceData data = frametrace::Recorder::Global().Snapshot();
+
+    std::vector<uint8_t> bin;
+    frametrace::WriteBinary(data, bin);
+    const bool binOk = WriteWholeFile(m_frameTracePath + L".wvtrace", bin.data(), bin.size());
+
+    std::string json;
+    frametrace::ExportChromeJson(data, json);
+    const bool jsonOk = WriteWholeFile(m_frameTracePath + L".json", json.data(), json.size());
+
+    WINVERT_INFO(OM, "OM: frame trace written: %zu events, %zu threads (binary %s, json %s)",
+        data.events.size(), data.threads.size(), binOk ? "ok" : "FAILED", jsonOk ? "ok" : "FAILED");
 }
 
 HRESULT OutputManager::Initialize()
@@ -29,11 +126,11 @@ void OutputManager::PrewarmForSelection()
 void OutputManager::EnumerateOutputs_()
 {
     if (m_outputsEnumerated) return;
-    winvert4::Log("OM: EnumerateOutputs start");
+    WINVERT_INFO(OM, "OM: EnumerateOutputs start");
     m_outputRects.clear();
     ::Microsoft::WRL::ComPtr<IDXGIFactory1> factory;
     HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(&factory));
-    if (FAILED(hr)) { winvert4::Logf("OM.CreateDXGIFactory1 FAILED hr=0x%08X", hr); return; }
+    if (FAILED(hr)) { WINVERT_WARN(OM, "OM.CreateDXGIFactory1 FAILED hr=0x%08X", hr); return; }
     for (UINT i = 0; ; ++i)
     {
         ::Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
@@ -54,16 +151,16 @@ void OutputManager::EnumerateOutputs_()
         }
     }
     m_outputsEnumerated = true;
-    winvert4::Logf("OM: EnumerateOutputs done; %zu outputs", m_outputRects.size());
+    WINVERT_INFO(OM, "OM: EnumerateOutputs done; %zu outputs", m_outputRects.size());
 }
 
 void OutputManager::EnsureThreadsCreated_()
 {
     if (m_threadsInitialized) return;
-    winvert4::Log("OM: ensuring duplication threads for current outputs");
+    WINVERT_DEBUG(OM, "OM: ensuring duplication threads for current outputs");
     ::Microsoft::WRL::ComPtr<IDXGIFactory1> factory;
     HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(&factory));
-    if (FAILED(hr)) { winvert4::Logf("OM.CreateDXGIFactory1 FAILED hr=0x%08X", hr); return; }
+    if (FAILED(hr)) { WINVERT_WARN(OM, "OM.CreateDXGIFactory1 FAILED hr=0x%08X", hr); return; }
     for (UINT i = 0; ; ++i)
     {
         ::Microsoft::WRL::ComPtr<IDXGIAdapter1> adapter;
@@ -85,7 +182,7 @@ void OutputManager::EnsureThreadsCreated_()
             bool enableMirror = (_wcsicmp(deviceName.c_str(), L"\\\\.\\DISPLAY1") == 0) || isPrimaryCoords;
             if (m_duplicationThreads.find(deviceName) == m_duplicationThreads.end())
             {
-                winvert4::Logf("OM: creating thread for output %ls rect=(%ld,%ld,%ld,%ld) primaryCoords=%d mirror=%d",
+                WINVERT_INFO(OM, "OM: creating thread for output %ls rect=(%ld,%ld,%ld,%ld) primaryCoords=%d mirror=%d",
                     deviceName.c_str(),
                     outputDesc.DesktopCoordinates.left,
                     outputDesc.DesktopCoordinates.top,
@@ -100,6 +197,7 @@ void OutputManager::EnsureThreadsCreated_()
         }
     }
     m_threadsInitialized = true;
+    m_threadCount.Set(double(m_duplicationThreads.size()));
 }
 
 DuplicationThread* OutputManager::GetThreadForRect(const RECT& rc)
@@ -138,21 +236,22 @@ DuplicationThread* OutputManager::GetThreadForRect(const RECT& rc)
     {
         // Display topology can change while stale duplication threads remain.
         // Rebuild once and retry thread selection.
-        winvert4::Log("OM: no thread match; rebuilding duplication threads and retrying");
+        WINVERT_INFO(OM, "OM: no thread match; rebuilding duplication threads and retrying");
         m_duplicationThreads.clear();
         m_threadsInitialized = false;
+        m_threadRebuilds.Add();
         EnsureThreadsCreated_();
         bestThread = findBest(bestArea);
     }
 
     if (bestThread)
     {
-        winvert4::Logf("OM: GetThreadForRect rc=(%ld,%ld,%ld,%ld) -> thread=%p area=%ld",
+        WINVERT_DEBUG(OM, "OM: GetThreadForRect rc=(%ld,%ld,%ld,%ld) -> thread=%p area=%ld",
             rc.left, rc.top, rc.right, rc.bottom, (void*)bestThread, bestArea);
     }
     else
     {
-        winvert4::Logf("OM: GetThreadForRect rc=(%ld,%ld,%ld,%ld) -> no match",
+        WINVERT_WARN(OM, "OM: GetThreadForRect rc=(%ld,%ld,%ld,%ld) -> no match",
             rc.left, rc.top, rc.right, rc.bottom);
     }
     return bestThread;
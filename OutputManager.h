@@ -2,6 +2,7 @@
 #include "pch.h"
 #include "DuplicationThread.h"
 #include "Subscription.h"
+#include "Metrics.h"
 #include <string>
 #include <vector>
 
@@ -26,7 +27,19 @@ private:
     std::vector<RECT> m_outputRects;
     bool m_outputsEnumerated{ false };
     bool m_threadsInitialized{ false };
+    // Frame-trace output path prefix from WINVERT_FRAME_TRACE; empty = tracing off
+    std::wstring m_frameTracePath;
+    // WINVERT_METRICS_FILE: registry snapshots exported into this mapped file
+    HANDLE m_metricsFile{ INVALID_HANDLE_VALUE };
+    HANDLE m_metricsMapping{ nullptr };
+    void* m_metricsView{ nullptr };
+    winvert4::metrics::Exporter m_metricsExporter;
+    winvert4::metrics::Counter& m_threadRebuilds;
+    winvert4::metrics::Gauge& m_threadCount;
 
     void EnumerateOutputs_();
     void EnsureThreadsCreated_();
+    void WriteFrameTrace_();
+    void StartMetricsExport_(const std::wstring& path);
+    void StopMetricsExport_();
 };
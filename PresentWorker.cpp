@@ -0,0 +1,92 @@
+#include "PresentWorker.h"
+#include "FrameTrace.h"
+
+namespace winvert4
+{
+    PresentWorker::~PresentWorker()
+    {
+        Stop();
+    }
+
+    void PresentWorker::Start(Callbacks callbacks, std::string traceName)
+    {
+        if (m_running.exchange(true, std::memory_order_acq_rel)) return;
+        m_callbacks = std::move(callbacks);
+        m_traceName = std::move(traceName);
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_stop = false;
+            m_pending = false;
+        }
+        m_thread = std::thread(&PresentWorker::ThreadProc_, this);
+    }
+
+    void PresentWorker::Stop()
+    {
+        if (!m_running.exchange(false, std::memory_order_acq_rel)) return;
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+        m_callbacks = {};
+    }
+
+    bool PresentWorker::Submit()
+    {
+        bool coalesced;
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            coalesced = m_pending;
+            m_pending = true;
+        }
+        m_submitted.fetch_add(1, std::memory_order_relaxed);
+        if (coalesced)
+        {
+            m_coalesced.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_cv.notify_one();
+        return true;
+    }
+
+    void PresentWorker::WaitIdle()
+    {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_idleCv.wait(lk, [this] { return (!m_pending && !m_busy) || m_stop; });
+    }
+
+    void PresentWorker::ThreadProc_()
+    {
+        if (!m_traceName.empty()) frametrace::Recorder::Global().SetThreadName(m_traceName.c_str());
+        std::unique_lock<std::mutex> lk(m_mutex);
+        for (;;)
+        {
+            m_cv.wait(lk, [this] { return m_pending || m_stop; });
+            if (!m_pending) break;  // stopping with nothing left to show
+            m_busy = true;
+            lk.unlock();
+
+            if (m_callbacks.waitReady) m_callbacks.waitReady();
+            {
+                // Take the frame only now: a submit that arrived during waitReady is
+                // part of this present, not a second one of an unwritten buffer
+                std::unique_lock<std::mutex> frameLock;
+                if (m_callbacks.frameMutex) frameLock = std::unique_lock<std::mutex>(*m_callbacks.frameMutex);
+                lk.lock();
+                m_pending = false;
+                lk.unlock();
+                frametrace::TraceScope ts(frametrace::Stage::Present);
+                if (m_callbacks.present) m_callbacks.present();
+            }
+            m_presented.fetch_add(1, std::memory_order_relaxed);
+
+            lk.lock();
+            m_busy = false;
+            if (!m_pending) m_idleCv.notify_all();
+        }
+        m_busy = false;
+        m_idleCv.notify_all();
+    }
+}
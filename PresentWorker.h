@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace winvert4
+{
+    // Presents one window's finished frames on a thread of its own, so a vsynced
+    // Present never holds up the capture thread. The queue is a single slot: the
+    // back buffer always holds the newest frame, so a submit while one is still
+    // pending just coalesces into it. Portable; the callbacks do the platform work.
+    class PresentWorker
+    {
+    public:
+        struct Callbacks
+        {
+            // Block until the swap chain can take a frame without Present blocking
+            // (frame-latency waitable object); optional
+            std::function<void()> waitReady;
+            std::function<void()> present;
+            // Held by the producer while it writes the back buffer and submits; the
+            // worker takes the pending frame and presents it under this lock, so a
+            // Present never lands in the middle of a frame and never repeats an
+            // unfinished one. Optional; must outlive Stop().
+            std::mutex* frameMutex{ nullptr };
+        };
+
+        PresentWorker() = default;
+        ~PresentWorker();
+        PresentWorker(const PresentWorker&) = delete;
+        PresentWorker& operator=(const PresentWorker&) = delete;
+
+        void Start(Callbacks callbacks, std::string traceName = {});
+        // Finishes a pending present, then joins the thread.
+        void Stop();
+        bool IsRunning() const { return m_running.load(std::memory_order_acquire); }
+
+        // Queue a present of the current back buffer (with Callbacks::frameMutex held,
+        // if set). Returns false when one was already pending and this frame replaced it.
+        bool Submit();
+        // Block until nothing is pending or being presented.
+        void WaitIdle();
+
+        uint64_t Submitted() const { return m_submitted.load(std::memory_order_relaxed); }
+        uint64_t Presented() const { return m_presented.load(std::memory_order_relaxed); }
+        uint64_t Coalesced() const { return m_coalesced.load(std::memory_order_relaxed); }
+
+    private:
+        void ThreadProc_();
+
+        Callbacks m_callbacks;
+        std::string m_traceName;
+        std::thread m_thread;
+        std::atomic<bool> m_running{ false };
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::condition_variable m_idleCv;
+        bool m_pending{ false };  // guarded by m_mutex
+        bool m_busy{ false };     // guarded by m_mutex
+        bool m_stop{ false };     // guarded by m_mutex
+
+        std::atomic<uint64_t> m_submitted{ 0 }, m_presented{ 0 }, m_coalesced{ 0 };
+    };
+}
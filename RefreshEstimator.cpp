@@ -0,0 +1,109 @@
+#include "RefreshEstimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace winvert4
+{
+    namespace {
+        // Intervals within this fraction of the fastest cluster count as one refresh period
+        constexpr double kClusterTolerance = 0.12;
+        // Distance from a whole number of periods that marks an interval off the vsync grid
+        constexpr double kOffGridFraction = 0.2;
+        // Share of off-grid intervals that means the panel is running variable refresh
+        constexpr double kVariableShare = 0.25;
+    }
+
+    void RefreshEstimator::Reset(uint64_t ticksPerSecond, float nominalHz)
+    {
+        m_msPerTick = ticksPerSecond ? 1000.0 / double(ticksPerSecond) : 0.0;
+        m_nominalPeriodMs = (nominalHz > 0.0f) ? 1000.0 / double(nominalHz) : 0.0;
+        m_lastTicks = 0;
+        m_next = 0;
+        m_count = 0;
+        m_accepted = 0;
+        m_rejected = 0;
+    }
+
+    void RefreshEstimator::AddPresent(uint64_t presentTicks, uint32_t accumulatedFrames)
+    {
+        // No timestamp (pointer-only update) or clock went backwards: nothing to measure
+        if (presentTicks == 0 || presentTicks <= m_lastTicks)
+        {
+            if (presentTicks != 0) m_lastTicks = presentTicks;
+            return;
+        }
+        const uint64_t prev = m_lastTicks;
+        m_lastTicks = presentTicks;
+        if (prev == 0) return;
+
+        const double ms = double(presentTicks - prev) * m_msPerTick;
+        if (accumulatedFrames > 1 || ms < kMinIntervalMs || ms > kMaxIntervalMs)
+        {
+            ++m_rejected;
+            return;
+        }
+        m_intervals[m_next] = ms;
+        m_next = (m_next + 1) % kWindow;
+        m_count = std::min(m_count + 1, kWindow);
+        ++m_accepted;
+    }
+
+    RefreshEstimator::Estimate RefreshEstimator::Get() const
+    {
+        Estimate e;
+        e.samples = uint32_t(m_count);
+        if (m_count < kMinSamples) return e;
+
+        // Until the ring wraps, the first m_count slots are the filled ones
+        std::array<double, kWindow> sorted = m_intervals;
+        std::sort(sorted.begin(), sorted.begin() + m_count);
+        const size_t n = m_count;
+        e.minIntervalMs = sorted[0];
+        e.medianIntervalMs = sorted[n / 2];
+        e.maxIntervalMs = sorted[n - 1];
+
+        // The period is the fastest cadence that recurs: anchor at the 10th percentile so
+        // a few glitched short intervals cannot pull it down, then average its cluster
+        const double anchor = sorted[n / 10];
+        double sum = 0.0;
+        size_t inCluster = 0;
+        for (size_t i = 0; i < n && sorted[i] <= anchor * (1.0 + kClusterTolerance); ++i)
+        {
+            if (sorted[i] < anchor * (1.0 - kClusterTolerance)) continue;
+            sum += sorted[i];
+            ++inCluster;
+        }
+        const double period = inCluster ? sum / double(inCluster) : anchor;
+
+        // Fixed refresh: every interval is a whole number of periods (content slower than
+        // the panel skips vblanks). Variable refresh lands anywhere in between. The mode's
+        // period is the grid unless the panel measurably runs faster than the mode claims;
+        // against the measured period alone, a steady VRR cadence would look fixed.
+        const bool useNominal = m_nominalPeriodMs > 0.0 && period >= m_nominalPeriodMs * (1.0 - kClusterTolerance);
+        const double grid = useNominal ? m_nominalPeriodMs : period;
+        size_t offGrid = 0, judged = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const double r = sorted[i] / grid;
+            if (r > 4.0) break;  // long intervals accumulate jitter; say nothing
+            ++judged;
+            if (std::fabs(r - std::round(r)) > kOffGridFraction) ++offGrid;
+        }
+
+        e.valid = true;
+        e.variable = judged >= kMinSamples && double(offGrid) > kVariableShare * double(judged);
+        if (e.variable && useNominal)
+        {
+            e.hz = float(1000.0 / m_nominalPeriodMs);
+        }
+        else
+        {
+            // Content slower than the panel (a 30 fps video on 60 Hz) clusters at a whole
+            // multiple of the real period; divide it back out
+            const double multiple = useNominal ? std::max(1.0, std::round(period / grid)) : 1.0;
+            e.hz = float(1000.0 * multiple / period);
+        }
+        e.effectiveHz = float(1000.0 / e.medianIntervalMs);
+        return e;
+    }
+}
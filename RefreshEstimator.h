@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace winvert4
+{
+    // Measures an output's present cadence from the desktop's present timestamps
+    // (DXGI_OUTDUPL_FRAME_INFO::LastPresentTime) instead of trusting the mode's
+    // nominal rate. Keeps the last kWindow accepted intervals; idle gaps, coalesced
+    // presents and timer glitches are rejected. Single-threaded; portable.
+    class RefreshEstimator
+    {
+    public:
+        static constexpr size_t kWindow = 128;
+        static constexpr uint32_t kMinSamples = 16;   // intervals before an estimate is valid
+        static constexpr double kMinIntervalMs = 1.0;  // above any real panel (1000 Hz)
+        static constexpr double kMaxIntervalMs = 100.0; // longer gaps are the desktop idling
+
+        struct Estimate
+        {
+            bool valid{ false };
+            // Panel refresh: the fastest steady cadence seen (interval cluster at the low
+            // end); the nominal rate when variable, as the panel can go that fast
+            float hz{ 0.0f };
+            // Rate the desktop actually presented at (median interval)
+            float effectiveHz{ 0.0f };
+            double minIntervalMs{ 0.0 };
+            double medianIntervalMs{ 0.0 };
+            double maxIntervalMs{ 0.0 };
+            // Intervals are not whole multiples of one period: variable refresh
+            bool variable{ false };
+            uint32_t samples{ 0 };
+        };
+
+        explicit RefreshEstimator(uint64_t ticksPerSecond = 1000000000ull, float nominalHz = 0.0f) { Reset(ticksPerSecond, nominalHz); }
+
+        // Forget everything (mode change, new capture). nominalHz is the display mode's
+        // rate if known; a steady VRR cadence is only recognizable against it.
+        void Reset(uint64_t ticksPerSecond, float nominalHz = 0.0f);
+        // One acquired frame. accumulatedFrames > 1 means presents were coalesced, so the
+        // interval spans several of them and is only used as a time base.
+        void AddPresent(uint64_t presentTicks, uint32_t accumulatedFrames);
+
+        // Recomputed on each call (a sort of at most kWindow values)
+        Estimate Get() const;
+        uint64_t Accepted() const { return m_accepted; }
+        uint64_t Rejected() const { return m_rejected; }
+
+    private:
+        double m_msPerTick{ 0.0 };
+        double m_nominalPeriodMs{ 0.0 };
+        uint64_t m_lastTicks{ 0 };
+        std::array<double, kWindow> m_intervals{};  // ms, ring
+        size_t m_next{ 0 };
+        size_t m_count{ 0 };
+        uint64_t m_accepted{ 0 };
+        uint64_t m_rejected{ 0 };
+    };
+}
@@ -0,0 +1,145 @@
+#include "ShaderBlobCache.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <system_error>
+
+namespace winvert4::shadercache
+{
+    uint64_t Fnv1a(const void* data, size_t bytes, uint64_t seed)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        uint64_t h = seed;
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            h ^= p[i];
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    KeyBuilder& KeyBuilder::Add(std::string_view s)
+    {
+        // Length first so ("ab","c") and ("a","bc") differ
+        Add(uint64_t(s.size()));
+        m_hash = Fnv1a(s.data(), s.size(), m_hash);
+        return *this;
+    }
+
+    KeyBuilder& KeyBuilder::Add(uint64_t v)
+    {
+        uint8_t bytes[8];
+        for (int i = 0; i < 8; ++i) bytes[i] = uint8_t(v >> (8 * i));
+        m_hash = Fnv1a(bytes, sizeof(bytes), m_hash);
+        return *this;
+    }
+
+    void Encode(uint64_t key, const void* payload, size_t bytes, std::vector<uint8_t>& file)
+    {
+        FileHeader h{};
+        h.magic = kMagic;
+        h.version = kFormatVersion;
+        h.key = key;
+        h.payloadHash = Fnv1a(payload, bytes);
+        h.payloadBytes = uint32_t(bytes);
+        file.resize(sizeof(h) + bytes);
+        memcpy(file.data(), &h, sizeof(h));
+        if (bytes) memcpy(file.data() + sizeof(h), payload, bytes);
+    }
+
+    LoadResult Decode(uint64_t key, const uint8_t* file, size_t bytes, std::vector<uint8_t>& payload)
+    {
+        FileHeader h{};
+        if (bytes < sizeof(h)) return LoadResult::Corrupt;
+        memcpy(&h, file, sizeof(h));
+        if (h.magic != kMagic) return LoadResult::Corrupt;
+        if (h.version != kFormatVersion) return LoadResult::VersionMismatch;
+        if (h.key != key || h.payloadBytes != bytes - sizeof(h)) return LoadResult::Corrupt;
+        const uint8_t* body = file + sizeof(h);
+        if (Fnv1a(body, h.payloadBytes) != h.payloadHash) return LoadResult::Corrupt;
+        payload.assign(body, body + h.payloadBytes);
+        return LoadResult::Hit;
+    }
+
+    BlobCache::BlobCache(std::filesystem::path dir)
+        : m_dir(std::move(dir))
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(m_dir, ec);
+    }
+
+    std::filesystem::path BlobCache::PathFor(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.wvsb", static_cast<unsigned long long>(key));
+        return m_dir / name;
+    }
+
+    LoadResult BlobCache::Load(uint64_t key, std::vector<uint8_t>& payload) const
+    {
+        const std::filesystem::path path = PathFor(key);
+        std::vector<uint8_t> file;
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) return LoadResult::Missing;
+            in.seekg(0, std::ios::end);
+            const std::streamoff size = in.tellg();
+            if (size < 0) return LoadResult::Missing;
+            in.seekg(0, std::ios::beg);
+            file.resize(size_t(size));
+            if (size > 0 && !in.read(reinterpret_cast<char*>(file.data()), size)) return LoadResult::Missing;
+        }
+        const LoadResult r = Decode(key, file.data(), file.size(), payload);
+        if (r != LoadResult::Hit)
+        {
+            // Unusable: drop it so the next Store starts clean (a racing writer's
+            // rename may already have replaced it; removing that costs one recompile)
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+        return r;
+    }
+
+    bool BlobCache::Store(uint64_t key, const void* payload, size_t bytes) const
+    {
+        std::vector<uint8_t> file;
+        Encode(key, payload, bytes, file);
+
+        // Unique per process and call, in the same directory so the rename stays on
+        // one volume
+        static const uint64_t s_process = (uint64_t(std::random_device{}()) << 32) ^
+            uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+        static std::atomic<uint64_t> s_seq{ 0 };
+        const uint64_t unique = s_process + s_seq.fetch_add(1, std::memory_order_relaxed);
+        char suffix[48];
+        snprintf(suffix, sizeof(suffix), ".%016llx.tmp", static_cast<unsigned long long>(unique));
+        const std::filesystem::path final = PathFor(key);
+        std::filesystem::path tmp = final;
+        tmp += suffix;
+
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+            out.flush();
+            if (!out)
+            {
+                out.close();
+                std::error_code ec;
+                std::filesystem::remove(tmp, ec);
+                return false;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, final, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+// On-disk cache of compiled shader bytecode, so only the first launch on a
+// machine (or after a shader or compiler change) pays for D3DCompile. One file
+// per blob, named after a 64-bit key hashed from everything that affects the
+// output: source, entry point, target, flags, defines and compiler version.
+// Files carry a header with magic, format version, the full key and a payload
+// hash; anything that does not check out is treated as a miss and removed.
+// Writes go to a unique temporary file that is renamed over the final name, so
+// concurrent writers and readers never see a partial blob. Portable.
+namespace winvert4::shadercache
+{
+    constexpr uint32_t kMagic = 0x42535657;  // "WVSB"
+    constexpr uint32_t kFormatVersion = 1;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t payloadHash;  // FNV-1a 64 over the payload
+        uint32_t payloadBytes;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(FileHeader) == 32, "FileHeader is part of the file format");
+
+    uint64_t Fnv1a(const void* data, size_t bytes, uint64_t seed = 0xcbf29ce484222325ull);
+
+    // Incremental key over the compile inputs; Add each one in a fixed order
+    class KeyBuilder
+    {
+    public:
+        KeyBuilder& Add(std::string_view s);
+        KeyBuilder& Add(uint64_t v);
+        uint64_t Key() const { return m_hash; }
+
+    private:
+        uint64_t m_hash{ 0xcbf29ce484222325ull };
+    };
+
+    enum class LoadResult
+    {
+        Hit,
+        Missing,
+        Corrupt,          // bad magic, size, key or payload hash
+        VersionMismatch,  // written by another format version
+    };
+
+    void Encode(uint64_t key, const void* payload, size_t bytes, std::vector<uint8_t>& file);
+    LoadResult Decode(uint64_t key, const uint8_t* file, size_t bytes, std::vector<uint8_t>& payload);
+
+    class BlobCache
+    {
+    public:
+        explicit BlobCache(std::filesystem::path dir);
+
+        // Hit fills payload. Corrupt and mismatched files are deleted.
+        LoadResult Load(uint64_t key, std::vector<uint8_t>& payload) const;
+        // Atomically replaces any existing blob for key; false on I/O failure
+        bool Store(uint64_t key, const void* payload, size_t bytes) const;
+
+        std::filesystem::path PathFor(uint64_t key) const;
+        const std::filesystem::path& Dir() const { return m_dir; }
+
+    private:
+        std::filesystem::path m_dir;
+    };
+}
@@ -0,0 +1,75 @@
+#include "ShaderVariants.h"
+
+namespace {
+    uint32_t BucketOf(uint32_t mapSlots)
+    {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            if (mapSlots <= PixelShaderKey::kMapSlotBuckets[i]) return i;
+        }
+        return 2;
+    }
+}
+
+uint32_t PixelShaderKey::Index() const
+{
+    if (useLut) return 0;
+    uint32_t map = 0;  // 0 = no map stage, then preserve x bucket
+    if (colorMap) map = 1 + (preserveBrightness ? 3u : 0u) + BucketOf(mapSlots);
+    return 1 + (affine ? 7u : 0u) + map;
+}
+
+PixelShaderKey PixelShaderKey::FromIndex(uint32_t index)
+{
+    PixelShaderKey key;
+    if (index == 0 || index >= kCount)
+    {
+        key.useLut = index == 0;
+        return key;
+    }
+    const uint32_t rest = index - 1;
+    key.affine = rest >= 7;
+    const uint32_t map = rest % 7;
+    if (map > 0)
+    {
+        key.colorMap = true;
+        key.preserveBrightness = map >= 4;
+        key.mapSlots = kMapSlotBuckets[(map - 1) % 3];
+    }
+    return key;
+}
+
+PixelShaderKey PixelShaderKeyFor(const PixelCB& cb)
+{
+    PixelShaderKey key;
+    if (cb.useColorLut != 0)
+    {
+        key.useLut = true;
+        return key;
+    }
+    // enableInvert is always folded into the matrix by PackPixelFlags
+    key.affine = cb.enableMatrix != 0 || cb.enableInvert != 0;
+    key.colorMap = cb.enableColorMap != 0 && cb.colorMapCount > 0;
+    if (key.colorMap)
+    {
+        key.preserveBrightness = cb.preserveMapBrightness != 0;
+        key.mapSlots = PixelShaderKey::kMapSlotBuckets[BucketOf(cb.colorMapCount)];
+    }
+    return key;
+}
+
+size_t PixelShaderDefines(const PixelShaderKey& key, ShaderDefine (&out)[kMaxPixelShaderDefines])
+{
+    size_t n = 0;
+    out[n++] = { "WV_HAS_LUT", key.useLut ? "1" : "0" };
+    out[n++] = { "WV_HAS_AFFINE", key.affine ? "1" : "0" };
+    out[n++] = { "WV_HAS_MAP", key.colorMap ? "1" : "0" };
+    out[n++] = { "WV_HAS_PRESERVE", key.preserveBrightness ? "1" : "0" };
+    if (key.colorMap)
+    {
+        out[n++] = { "WV_MAP_SLOTS", key.mapSlots <= 4 ? "4" : key.mapSlots <= 16 ? "16" : "64" };
+        // Short loops unroll; the 64-slot fallback stays a loop to keep code size sane
+        out[n++] = { "WV_MAP_UNROLL", key.mapSlots <= 16 ? "1" : "0" };
+    }
+    return n;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include "EffectConstants.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Specialized pixel shader variants. kPS is compiled once as an uber shader that
+// branches on the PixelCB flags per pixel, and once per feature combination with
+// the flags turned into preprocessor constants so dead stages (and the map loop)
+// compile away. The key is derived from the packed constants, so it reflects the
+// final decisions of UpdateCBs_ (invert folded into the matrix, LUT or loop).
+struct PixelShaderKey
+{
+    bool useLut{ false };              // LUT lookup only; the other stages are baked in
+    bool affine{ false };
+    bool colorMap{ false };
+    bool preserveBrightness{ false };  // only with colorMap
+    uint32_t mapSlots{ 0 };            // loop bound bucket (kMapSlotBuckets) with colorMap, else 0
+
+    static constexpr uint32_t kMapSlotBuckets[3] = { 4, 16, kMaxColorMaps };
+    // Number of distinct keys; Index() is dense in [0, kCount)
+    static constexpr uint32_t kCount = 1 + 2 * (1 + 2 * 3);
+
+    uint32_t Index() const;
+    static PixelShaderKey FromIndex(uint32_t index);
+
+    bool operator==(const PixelShaderKey& o) const
+    {
+        return useLut == o.useLut && affine == o.affine && colorMap == o.colorMap &&
+               preserveBrightness == o.preserveBrightness && mapSlots == o.mapSlots;
+    }
+    bool operator!=(const PixelShaderKey& o) const { return !(*this == o); }
+};
+
+PixelShaderKey PixelShaderKeyFor(const PixelCB& cb);
+
+struct ShaderDefine
+{
+    const char* name;
+    const char* value;
+};
+static constexpr size_t kMaxPixelShaderDefines = 6;
+// Defines selecting key's variant of kPS; returns how many were written
+size_t PixelShaderDefines(const PixelShaderKey& key, ShaderDefine (&out)[kMaxPixelShaderDefines]);
+
+// Bookkeeping for variants compiled in the background: each index is compiled at
+// most once, lookups never wait for a compile in progress. T is the compiled
+// artifact (bytecode); failures are remembered so they are not retried.
+template <class T>
+class ShaderVariantCache
+{
+public:
+    explicit ShaderVariantCache(size_t count) : m_slots(count) {}
+
+    // The compiled variant, or false when it is not ready (pending or failed)
+    bool TryGet(size_t index, T& out) const
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (index >= m_slots.size() || m_slots[index].state != State::Ready) return false;
+        out = m_slots[index].value;
+        return true;
+    }
+
+    // True when the caller should compile index now (first claim wins)
+    bool Claim(size_t index)
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (index >= m_slots.size() || m_slots[index].state != State::Empty) return false;
+        m_slots[index].state = State::Compiling;
+        return true;
+    }
+
+    void Complete(size_t index, T value)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_slots[index].value = std::move(value);
+            m_slots[index].state = State::Ready;
+        }
+        m_cv.notify_all();
+    }
+
+    void Fail(size_t index)
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            m_slots[index].state = State::Failed;
+        }
+        m_cv.notify_all();
+    }
+
+    // Block until index is ready or failed; false if it never will be ready
+    bool Wait(size_t index, T& out) const
+    {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        if (index >= m_slots.size()) return false;
+        m_cv.wait(lk, [&] { return m_slots[index].state == State::Ready || m_slots[index].state == State::Failed; });
+        if (m_slots[index].state != State::Ready) return false;
+        out = m_slots[index].value;
+        return true;
+    }
+
+    size_t ReadyCount() const
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        size_t n = 0;
+        for (const Slot& s : m_slots) n += s.state == State::Ready ? 1 : 0;
+        return n;
+    }
+
+private:
+    enum class State : uint8_t { Empty, Compiling, Ready, Failed };
+    struct Slot
+    {
+        State state{ State::Empty };
+        T value{};
+    };
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    std::vector<Slot> m_slots;
+};
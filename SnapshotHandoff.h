@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace winvert4
+{
+    // Hands immutable snapshots of a value from writers (the UI thread) to one
+    // reader thread (the render thread). Publish copies the value into a new
+    // snapshot and swaps the current pointer; the reader picks up the newest one
+    // at frame start without locking or allocating. The reader announces the
+    // snapshot it uses in a hazard pointer, so writers free every retired
+    // snapshot except that one, and never wait for the reader. At most two
+    // snapshots are alive between publishes. Portable.
+    template <class T>
+    class SnapshotHandoff
+    {
+    public:
+        struct Snapshot
+        {
+            T value;
+            uint64_t generation;  // 1 for the first publish, then increasing
+        };
+
+        explicit SnapshotHandoff(T initial = T{}) { Publish(std::move(initial)); }
+        ~SnapshotHandoff()
+        {
+            delete m_current.load(std::memory_order_relaxed);
+            for (Snapshot* s : m_retired) delete s;
+        }
+        SnapshotHandoff(const SnapshotHandoff&) = delete;
+        SnapshotHandoff& operator=(const SnapshotHandoff&) = delete;
+
+        // Any thread; writers serialize on a mutex the reader never touches.
+        // Returns the generation of the new snapshot.
+        uint64_t Publish(T value)
+        {
+            std::lock_guard<std::mutex> lk(m_writeMutex);
+            Snapshot* next = new Snapshot{ std::move(value), ++m_generation };
+            Snapshot* prev = m_current.exchange(next, std::memory_order_seq_cst);
+            if (prev) m_retired.push_back(prev);
+            Reclaim_();
+            return next->generation;
+        }
+
+        // Reader thread only. Pins and returns the newest snapshot; it stays valid
+        // until the next Acquire or Unpin on this thread. Lock-free: retries only
+        // while a publish lands between the load and the pin.
+        const Snapshot& Acquire()
+        {
+            Snapshot* s = m_current.load(std::memory_order_seq_cst);
+            for (;;)
+            {
+                m_hazard.store(s, std::memory_order_seq_cst);
+                Snapshot* again = m_current.load(std::memory_order_seq_cst);
+                if (again == s) return *s;
+                s = again;
+            }
+        }
+
+        // Drop the reader's pin so the next publish can free its snapshot. Reader
+        // thread, or any thread while the reader is known to be idle.
+        void Unpin() { m_hazard.store(nullptr, std::memory_order_seq_cst); }
+
+        // Newest generation published (any thread)
+        uint64_t Generation() const { return m_current.load(std::memory_order_acquire)->generation; }
+
+    private:
+        // Free retired snapshots the reader cannot be using (m_writeMutex held)
+        void Reclaim_()
+        {
+            const Snapshot* pinned = m_hazard.load(std::memory_order_seq_cst);
+            size_t kept = 0;
+            for (Snapshot* s : m_retired)
+            {
+                if (s == pinned) m_retired[kept++] = s;
+                else delete s;
+            }
+            m_retired.resize(kept);
+        }
+
+        // Acquire touches only these two, so it must not fall back to a lock
+        static_assert(std::atomic<Snapshot*>::is_always_lock_free, "the reader path must be lock-free");
+        std::atomic<Snapshot*> m_current{ nullptr };
+        std::atomic<Snapshot*> m_hazard{ nullptr };  // snapshot the reader is using
+        std::mutex m_writeMutex;
+        std::vector<Snapshot*> m_retired;  // guarded by m_writeMutex
+        uint64_t m_generation{ 0 };        // guarded by m_writeMutex
+    };
+}
@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "Log.h"
+#include "SwapChainTargets.h"
+
+using Microsoft::WRL::ComPtr;
+
+void SwapChainTargets::Attach(ID3D11Device* device, IDXGISwapChain1* swapChain)
+{
+    Reset();
+    m_device = device;
+    m_swapChain = swapChain;
+    m_width = m_height = 0;
+    DXGI_SWAP_CHAIN_DESC1 sd{};
+    if (m_swapChain && SUCCEEDED(m_swapChain->GetDesc1(&sd)))
+    {
+        m_width = sd.Width;
+        m_height = sd.Height;
+    }
+}
+
+void SwapChainTargets::Reset()
+{
+    m_d2dTarget.Reset();
+    m_d2dTargetCtx = nullptr;
+    m_rtv.Reset();
+    m_backBuffer.Reset();
+}
+
+bool SwapChainTargets::EnsureBackBuffer_()
+{
+    if (m_backBuffer) return true;
+    if (!m_swapChain) return false;
+    const HRESULT hr = m_swapChain->GetBuffer(0, IID_PPV_ARGS(&m_backBuffer));
+    if (FAILED(hr))
+    {
+        WINVERT_WARN(EW, "EW: GetBuffer failed hr=0x%08X", hr);
+        m_backBuffer.Reset();
+        return false;
+    }
+    return true;
+}
+
+ID3D11Texture2D* SwapChainTargets::BackBuffer()
+{
+    return EnsureBackBuffer_() ? m_backBuffer.Get() : nullptr;
+}
+
+ID3D11RenderTargetView* SwapChainTargets::Rtv()
+{
+    if (!m_rtv && m_device && EnsureBackBuffer_())
+    {
+        const HRESULT hr = m_device->CreateRenderTargetView(m_backBuffer.Get(), nullptr, &m_rtv);
+        if (FAILED(hr))
+        {
+            WINVERT_WARN(EW, "EW: CreateRenderTargetView failed hr=0x%08X", hr);
+            m_rtv.Reset();
+        }
+    }
+    return m_rtv.Get();
+}
+
+ID2D1Bitmap1* SwapChainTargets::D2DTarget(ID2D1DeviceContext* d2dCtx)
+{
+    if (!d2dCtx) return nullptr;
+    if (m_d2dTarget && m_d2dTargetCtx == d2dCtx) return m_d2dTarget.Get();
+    m_d2dTarget.Reset();
+    m_d2dTargetCtx = nullptr;
+    if (!EnsureBackBuffer_()) return nullptr;
+
+    ComPtr<IDXGISurface> surf;
+    if (FAILED(m_backBuffer.As(&surf))) return nullptr;
+    const D2D1_BITMAP_PROPERTIES1 bp = D2D1::BitmapProperties1(
+        D2D1_BITMAP_OPTIONS_TARGET | D2D1_BITMAP_OPTIONS_CANNOT_DRAW,
+        D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+    const HRESULT hr = d2dCtx->CreateBitmapFromDxgiSurface(surf.Get(), &bp, &m_d2dTarget);
+    if (FAILED(hr))
+    {
+        WINVERT_WARN(EW, "EW: CreateBitmapFromDxgiSurface failed hr=0x%08X", hr);
+        m_d2dTarget.Reset();
+        return nullptr;
+    }
+    m_d2dTargetCtx = d2dCtx;
+    return m_d2dTarget.Get();
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "pch.h"
+
+// Owns the render-target views of one window's swap chain: the back buffer, its
+// RTV and the D2D target bitmap over it, created once and kept until the swap
+// chain is released. With the flip model under D3D11 the runtime
+// rotates the buffers behind index 0, so views of buffer 0 always address the
+// buffer being drawn; nothing has to be looked up or created per frame.
+class SwapChainTargets
+{
+public:
+    // Take over swapChain's views (created on first use). Safe to call again after
+    // Reset().
+    void Attach(ID3D11Device* device, IDXGISwapChain1* swapChain);
+    // Release all views; the swap chain itself is not touched
+    void Reset();
+
+    // Null when the swap chain is gone or the view could not be created
+    ID3D11Texture2D* BackBuffer();
+    ID3D11RenderTargetView* Rtv();
+    // Target bitmap for d2dCtx (premultiplied BGRA); recreated if the context changes
+    ID2D1Bitmap1* D2DTarget(ID2D1DeviceContext* d2dCtx);
+
+    UINT Width() const { return m_width; }
+    UINT Height() const { return m_height; }
+
+private:
+    bool EnsureBackBuffer_();
+
+    ::Microsoft::WRL::ComPtr<ID3D11Device> m_device;
+    ::Microsoft::WRL::ComPtr<IDXGISwapChain1> m_swapChain;
+    ::Microsoft::WRL::ComPtr<ID3D11Texture2D> m_backBuffer;
+    ::Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_rtv;
+    ::Microsoft::WRL::ComPtr<ID2D1Bitmap1> m_d2dTarget;
+    ID2D1DeviceContext* m_d2dTargetCtx{ nullptr };  // context m_d2dTarget belongs to (identity only)
+    UINT m_width{ 0 };
+    UINT m_height{ 0 };
+};
@@ -0,0 +1,287 @@
+#include "SyntheticFrameSource.h"
+#include <algorithm>
+#include <cstring>
+
+namespace winvert4
+{
+    namespace {
+        constexpr uint32_t kBackground = 0xFF2B2B2Bu;
+        constexpr uint32_t kPaper = 0xFFF0F0F0u;
+        constexpr uint32_t kInk = 0xFF202020u;
+        constexpr int32_t kGlyphWidth = 8;
+        constexpr int32_t kNoiseBlock = 8;
+
+        PixelRect DefaultTextPane(int32_t w, int32_t h)
+        {
+            return PixelRect{ w / 32, h / 16, w / 2 - w / 32, h - h / 16 };
+        }
+
+        PixelRect DefaultVideoPane(int32_t w, int32_t h)
+        {
+            const int32_t left = w / 2 + w / 32;
+            const int32_t width = w / 2 - 2 * (w / 32);
+            const int32_t height = std::min(width * 9 / 16, h - h / 8);
+            return PixelRect{ left, h / 8, left + width, h / 8 + height };
+        }
+    }
+
+    SyntheticFrameSource::SyntheticFrameSource(const Config& config)
+        : m_config(config)
+    {
+        m_width = std::max(1, m_config.width);
+        m_height = std::max(1, m_config.height);
+        m_refreshHz = (m_config.hz > 0.0f) ? m_config.hz : 60.0f;
+        m_ticksPerSecond = 1000000000ull;
+        m_periodNs = uint64_t(1e9 / double(m_refreshHz));
+        m_rng = m_config.seed ? m_config.seed : 1u;
+
+        if (m_config.script.empty())
+        {
+            m_config.script = {
+                { SceneKind::ScrollingText, uint32_t(m_refreshHz * 2) },
+                { SceneKind::VideoNoise,    uint32_t(m_refreshHz * 2) },
+                { SceneKind::Idle,          uint32_t(m_refreshHz) },
+            };
+        }
+        for (const auto& s : m_config.script) m_scriptFrames += s.frames;
+        if (m_scriptFrames == 0) { m_config.script = { { SceneKind::Idle, 1 } }; m_scriptFrames = 1; }
+
+        const PixelRect bounds{ 0, 0, m_width, m_height };
+        m_config.textPane = Intersection(m_config.textPane.Empty() ? DefaultTextPane(m_width, m_height) : m_config.textPane, bounds);
+        m_config.videoPane = Intersection(m_config.videoPane.Empty() ? DefaultVideoPane(m_width, m_height) : m_config.videoPane, bounds);
+        m_config.scrollPx = std::clamp(m_config.scrollPx, 1, std::max(1, m_config.textPane.bottom - m_config.textPane.top));
+
+        const size_t pixels = size_t(m_width) * size_t(m_height);
+        m_desktop.assign(pixels, kBackground);
+        m_shared.assign(pixels, 0);
+        m_origin = std::chrono::steady_clock::now();
+    }
+
+    const SyntheticFrameSource::Scene& SyntheticFrameSource::SceneAt_(uint64_t slot) const
+    {
+        uint64_t pos = slot % m_scriptFrames;
+        for (const auto& s : m_config.script)
+        {
+            if (pos < s.frames) return s;
+            pos -= s.frames;
+        }
+        return m_config.script.back();
+    }
+
+    AcquireStatus SyntheticFrameSource::Acquire(uint32_t timeoutMs, FrameInfo& info, FrameDamage& damage)
+    {
+        using namespace std::chrono;
+        // Like DXGI: the previous frame must be released first
+        if (m_holding) return AcquireStatus::Failed;
+        // Like DXGI: a lost duplication keeps failing until it is recreated
+        if (m_lost) return AcquireStatus::AccessLost;
+        uint64_t advanced = 1;
+        if (m_config.realTime)
+        {
+            const auto limit = steady_clock::now() + milliseconds(timeoutMs);
+            // Sleeps until the deadline unless Wake() ends the wait; true when woken
+            auto waitUntil = [this](steady_clock::time_point deadline) {
+                std::unique_lock<std::mutex> lk(m_wakeMutex);
+                const bool woken = m_wakeCv.wait_until(lk, deadline, [this] { return m_wakeRequested; });
+                m_wakeRequested = false;
+                return woken;
+            };
+            for (;;)
+            {
+                const auto next = m_origin + nanoseconds((m_slot + 1) * m_periodNs);
+                if (next > limit)
+                {
+                    waitUntil(limit);
+                    return AcquireStatus::Timeout;
+                }
+                if (waitUntil(next)) return AcquireStatus::Timeout;
+                // A slow consumer skips periods; like DXGI, report them as accumulated
+                const uint64_t due = uint64_t(duration_cast<nanoseconds>(steady_clock::now() - m_origin).count()) / m_periodNs;
+                advanced = std::max<uint64_t>(1, due - m_slot);
+                m_slot += advanced;
+                if (SceneAt_(m_slot).kind != SceneKind::Idle) break;
+            }
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> lk(m_wakeMutex);
+                m_wakeRequested = false;
+            }
+            ++m_slot;
+            if (SceneAt_(m_slot).kind == SceneKind::Idle) return AcquireStatus::Timeout;
+        }
+        if (SceneAt_(m_slot).kind == SceneKind::Lost)
+        {
+            m_lost = true;
+            return AcquireStatus::AccessLost;
+        }
+
+        damage.Reset(m_width, m_height);
+        Generate_(SceneAt_(m_slot).kind, damage);
+        damage.Finalize(kMaxCopyRects, kFullCopyFraction);
+
+        info.presentTicks = m_slot * m_periodNs;
+        info.accumulatedFrames = uint32_t(std::min<uint64_t>(advanced, UINT32_MAX));
+        m_holding = true;
+        ++m_framesProduced;
+        return AcquireStatus::Frame;
+    }
+
+    bool SyntheticFrameSource::Recreate()
+    {
+        using namespace std::chrono;
+        if (m_holding) return false;
+        // Each attempt moves time on: the wall clock in real time, one period otherwise
+        if (m_config.realTime)
+        {
+            const uint64_t due = uint64_t(duration_cast<nanoseconds>(steady_clock::now() - m_origin).count()) / m_periodNs;
+            m_slot = std::max(m_slot, due);
+        }
+        else
+        {
+            ++m_slot;
+        }
+        if (SceneAt_(m_slot).kind == SceneKind::Lost) return false;
+        m_lost = false;
+        // A new duplication starts with a full frame
+        m_firstFrame = true;
+        ++m_recreations;
+        return true;
+    }
+
+    void SyntheticFrameSource::Wake()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_wakeMutex);
+            m_wakeRequested = true;
+        }
+        m_wakeCv.notify_one();
+    }
+
+    void SyntheticFrameSource::Generate_(SceneKind kind, FrameDamage& damage)
+    {
+        if (m_firstFrame)
+        {
+            // Whole desktop is new: paint both panes once
+            std::fill(m_desktop.begin(), m_desktop.end(), kBackground);
+            for (int32_t y = m_config.textPane.top; y < m_config.textPane.bottom; ++y)
+            {
+                uint32_t* row = m_desktop.data() + size_t(y) * size_t(m_width);
+                std::fill(row + m_config.textPane.left, row + m_config.textPane.right, kPaper);
+            }
+            FrameDamage ignored;
+            ignored.Reset(m_width, m_height);
+            FillNoise_(ignored);
+            damage.MarkAll();
+            m_firstFrame = false;
+            return;
+        }
+        if (kind == SceneKind::ScrollingText) ScrollText_(damage);
+        else if (kind == SceneKind::VideoNoise) FillNoise_(damage);
+    }
+
+    void SyntheticFrameSource::ScrollText_(FrameDamage& damage)
+    {
+        const PixelRect& pane = m_config.textPane;
+        if (pane.Empty()) return;
+        const int32_t s = m_config.scrollPx;
+        const size_t rowBytes = size_t(pane.right - pane.left) * sizeof(uint32_t);
+
+        // Move the pane up by s rows
+        for (int32_t y = pane.top; y + s < pane.bottom; ++y)
+        {
+            uint32_t* dst = m_desktop.data() + size_t(y) * size_t(m_width) + pane.left;
+            const uint32_t* src = dst + size_t(s) * size_t(m_width);
+            std::memcpy(dst, src, rowBytes);
+        }
+
+        // New line of "glyphs" in the exposed strip
+        const int32_t stripTop = std::max(pane.top, pane.bottom - s);
+        for (int32_t y = stripTop; y < pane.bottom; ++y)
+        {
+            uint32_t* row = m_desktop.data() + size_t(y) * size_t(m_width);
+            std::fill(row + pane.left, row + pane.right, kPaper);
+        }
+        const int32_t glyphTop = stripTop + s / 4;
+        const int32_t glyphBottom = pane.bottom - s / 4;
+        for (int32_t x = pane.left + kGlyphWidth; x + kGlyphWidth <= pane.right - kGlyphWidth; x += kGlyphWidth)
+        {
+            if ((NextRandom_() & 7u) == 0) continue;  // word gap
+            for (int32_t y = glyphTop; y < glyphBottom; ++y)
+            {
+                uint32_t* row = m_desktop.data() + size_t(y) * size_t(m_width);
+                std::fill(row + x + 1, row + x + kGlyphWidth - 1, kInk);
+            }
+        }
+
+        if (stripTop > pane.top)
+            damage.AddMove(pane.left, pane.top + s, PixelRect{ pane.left, pane.top, pane.right, stripTop });
+        damage.AddDirty(PixelRect{ pane.left, stripTop, pane.right, pane.bottom });
+    }
+
+    void SyntheticFrameSource::FillNoise_(FrameDamage& damage)
+    {
+        const PixelRect& pane = m_config.videoPane;
+        if (pane.Empty()) return;
+        // Blocky noise: cheap to generate, still changes every pixel's neighbourhood
+        for (int32_t by = pane.top; by < pane.bottom; by += kNoiseBlock)
+        {
+            const int32_t yEnd = std::min(pane.bottom, by + kNoiseBlock);
+            for (int32_t bx = pane.left; bx < pane.right; bx += kNoiseBlock)
+            {
+                const uint32_t color = 0xFF000000u | (NextRandom_() & 0x00FFFFFFu);
+                const int32_t xEnd = std::min(pane.right, bx + kNoiseBlock);
+                for (int32_t y = by; y < yEnd; ++y)
+                {
+                    uint32_t* row = m_desktop.data() + size_t(y) * size_t(m_width);
+                    std::fill(row + bx, row + xEnd, color);
+                }
+            }
+        }
+        damage.AddDirty(pane);
+    }
+
+    void SyntheticFrameSource::CopyFrame(const FrameDamage& damage)
+    {
+        if (damage.IsFull())
+        {
+            m_shared = m_desktop;
+            return;
+        }
+        for (const PixelRect& r : damage.Rects())
+        {
+            const size_t rowBytes = size_t(r.right - r.left) * sizeof(uint32_t);
+            for (int32_t y = r.top; y < r.bottom; ++y)
+            {
+                const size_t at = size_t(y) * size_t(m_width) + size_t(r.left);
+                std::memcpy(m_shared.data() + at, m_desktop.data() + at, rowBytes);
+            }
+        }
+    }
+
+    void SyntheticFrameSource::Release()
+    {
+        m_holding = false;
+    }
+
+    uint64_t SyntheticFrameSource::Hash() const
+    {
+        uint64_t h = 1469598103934665603ull;
+        for (uint32_t px : m_shared)
+        {
+            h ^= px;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    uint32_t SyntheticFrameSource::NextRandom_()
+    {
+        // xorshift32: deterministic for a given seed
+        m_rng ^= m_rng << 13;
+        m_rng ^= m_rng >> 17;
+        m_rng ^= m_rng << 5;
+        return m_rng;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "FrameSource.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace winvert4
+{
+    // Deterministic stand-in for a live desktop: replays a looped script of scenes at
+    // a fixed rate, producing BGRA pixels plus the move/dirty damage DXGI would report.
+    // Lets the capture loop be exercised and load-tested without Windows.
+    class SyntheticFrameSource final : public IFrameSource
+    {
+    public:
+        enum class SceneKind
+        {
+            ScrollingText,  // a text pane scrolls up; move rect + dirty strip per frame
+            VideoNoise,     // a video pane changes completely every frame
+            Idle,           // no desktop presents (the source times out)
+            Lost,           // capture unavailable (mode change, secure desktop): Acquire
+                            // reports AccessLost and Recreate fails until the scene ends
+        };
+
+        struct Scene
+        {
+            SceneKind kind{ SceneKind::Idle };
+            uint32_t frames{ 60 };  // length in frame periods
+        };
+
+        struct Config
+        {
+            int32_t width{ 1920 };
+            int32_t height{ 1080 };
+            float hz{ 60.0f };
+            // true: Acquire waits on the wall clock like DXGI. false: a virtual clock
+            // advances one frame period per call, for fast deterministic runs.
+            bool realTime{ true };
+            uint32_t seed{ 1 };
+            std::vector<Scene> script;  // looped; empty = scrolling text, video, idle
+            PixelRect textPane{};       // empty = left half of the desktop
+            PixelRect videoPane{};      // empty = a 16:9 pane in the right half
+            int32_t scrollPx{ 16 };
+        };
+
+        explicit SyntheticFrameSource(const Config& config);
+
+        AcquireStatus Acquire(uint32_t timeoutMs, FrameInfo& info, FrameDamage& damage) override;
+        void CopyFrame(const FrameDamage& damage) override;
+        void Release() override;
+        const void* SharedFrame() const override { return m_shared.data(); }
+        bool Recreate() override;
+        void Wake() override;
+
+        // Shared frame as BGRA rows of Width() pixels
+        const std::vector<uint32_t>& Pixels() const { return m_shared; }
+        uint64_t FramesProduced() const { return m_framesProduced; }
+        uint64_t Recreations() const { return m_recreations; }
+        // steady_clock time that FrameInfo::presentTicks count from (real-time mode)
+        std::chrono::steady_clock::time_point Origin() const { return m_origin; }
+        // FNV-1a over the shared frame, for determinism checks
+        uint64_t Hash() const;
+
+    private:
+        const Scene& SceneAt_(uint64_t slot) const;
+        void Generate_(SceneKind kind, FrameDamage& damage);
+        void ScrollText_(FrameDamage& damage);
+        void FillNoise_(FrameDamage& damage);
+        uint32_t NextRandom_();
+
+        Config m_config;
+        uint64_t m_periodNs{ 0 };
+        uint64_t m_scriptFrames{ 0 };
+        uint64_t m_slot{ 0 };          // frame periods elapsed
+        uint64_t m_framesProduced{ 0 };
+        uint32_t m_rng{ 1 };
+        bool m_firstFrame{ true };
+        bool m_holding{ false };
+        bool m_lost{ false };             // AccessLost reported; dead until Recreate
+        uint64_t m_recreations{ 0 };
+        std::chrono::steady_clock::time_point m_origin;
+
+        // Wake(): auto-reset, like the event a real source would wait on
+        std::mutex m_wakeMutex;
+        std::condition_variable m_wakeCv;
+        bool m_wakeRequested{ false };  // guarded by m_wakeMutex
+
+        std::vector<uint32_t> m_desktop;  // what the "screen" shows now
+        std::vector<uint32_t> m_shared;   // consumer copy, updated by CopyFrame
+    };
+}
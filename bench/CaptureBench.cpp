@@ -0,0 +1,291 @@
+#include "CaptureBench.h"
+#include "CaptureLoop.h"
+#include "LatencyHistogram.h"
+#include "PresentWorker.h"
+#include "SyntheticFrameSource.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace winvert4::bench
+{
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        uint64_t NowNs()
+        {
+            return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+        }
+
+        void Spin(uint32_t us)
+        {
+            const auto until = Clock::now() + std::chrono::microseconds(us);
+            while (Clock::now() < until) {}
+        }
+
+        // One simulated output: its source, loop, thread and fan-out bookkeeping
+        struct OutputRun
+        {
+            std::unique_ptr<SyntheticFrameSource> source;
+            CaptureLoop loop;
+            std::thread thread;
+            uint64_t originNs{ 0 };
+            // Loop thread only: first OnFrame of the current frame, and the sinks' own work in it
+            uint64_t frameStartNs{ 0 };
+            uint64_t frameWorkNs{ 0 };
+            std::vector<double> dispatchUs;  // per measured frame; reserved up front
+            std::atomic<bool>* measuring{ nullptr };
+        };
+
+        class MockSubscriber final : public IFrameSink
+        {
+        public:
+            MockSubscriber(OutputRun& run, const SweepConfig& config, PresentMode mode, float refreshHz, LatencyHistogram& latency)
+                : m_run(run), m_mode(mode), m_cpuUs(config.cpuUs), m_gpuUs(config.gpuUs),
+                  m_periodNs(uint64_t(1e9 / double(refreshHz))), m_latency(latency)
+            {
+                if (m_mode != PresentMode::Worker) return;
+                PresentWorker::Callbacks cb;
+                cb.present = [this] { Present_(); };
+                m_worker.Start(std::move(cb));
+            }
+
+            bool OnFrame(const FrameEvent& ev) override
+            {
+                const uint64_t begin = NowNs();
+                if (m_run.frameStartNs == 0) m_run.frameStartNs = begin;
+                Spin(m_cpuUs);
+                if (ev.presentTicks) m_pendingDueNs.store(m_run.originNs + ev.presentTicks, std::memory_order_release);
+                if (m_mode == PresentMode::Inline)
+                {
+                    // The blocking Present is the sink's own work on the capture thread
+                    Present_();
+                    m_inlinePresents.fetch_add(1, std::memory_order_relaxed);
+                    m_run.frameWorkNs += NowNs() - begin;
+                }
+                else
+                {
+                    m_run.frameWorkNs += NowNs() - begin;
+                    m_worker.Submit();
+                }
+                return true;
+            }
+
+            void Stop() { if (m_mode == PresentMode::Worker) m_worker.Stop(); }
+            uint64_t Presented() const
+            {
+                return m_mode == PresentMode::Worker ? m_worker.Presented() : m_inlinePresents.load(std::memory_order_relaxed);
+            }
+            uint64_t Coalesced() const { return m_mode == PresentMode::Worker ? m_worker.Coalesced() : 0; }
+
+        private:
+            // Mock vsynced Present: the GPU finishes the frame, then the flip waits
+            // for the next vblank of the output (vblanks at origin + k * period)
+            void Present_()
+            {
+                if (m_gpuUs) std::this_thread::sleep_for(std::chrono::microseconds(m_gpuUs));
+                const uint64_t now = NowNs();
+                const uint64_t sinceOrigin = now > m_run.originNs ? now - m_run.originNs : 0;
+                const uint64_t vblank = m_run.originNs + (sinceOrigin / m_periodNs + 1) * m_periodNs;
+                std::this_thread::sleep_for(std::chrono::nanoseconds(vblank - now));
+
+                const uint64_t due = m_pendingDueNs.exchange(0, std::memory_order_acq_rel);
+                const uint64_t done = NowNs();
+                if (due && done > due && m_run.measuring->load(std::memory_order_relaxed)) m_latency.Record(done - due, done);
+            }
+
+            OutputRun& m_run;
+            PresentMode m_mode;
+            uint32_t m_cpuUs;
+            uint32_t m_gpuUs;
+            uint64_t m_periodNs;
+            LatencyHistogram& m_latency;
+            PresentWorker m_worker;
+            std::atomic<uint64_t> m_pendingDueNs{ 0 };
+            std::atomic<uint64_t> m_inlinePresents{ 0 };
+        };
+
+        // Tile the desktop with n regions, as a user would spread magnifiers over it
+        PixelRect RegionRect(uint32_t index, uint32_t n, int32_t w, int32_t h)
+        {
+            const uint32_t cols = uint32_t(std::ceil(std::sqrt(double(n))));
+            const uint32_t rows = (n + cols - 1) / cols;
+            const int32_t cw = w / int32_t(cols), ch = h / int32_t(rows);
+            const int32_t x = int32_t(index % cols) * cw, y = int32_t(index / cols) * ch;
+            return PixelRect{ x, y, x + cw, y + ch };
+        }
+
+        double Percentile(std::vector<double>& v, double q)
+        {
+            if (v.empty()) return 0.0;
+            const size_t k = std::min(v.size() - 1, size_t(q * double(v.size())));
+            std::nth_element(v.begin(), v.begin() + k, v.end());
+            return v[k];
+        }
+    }
+
+    const char* PresentModeName(PresentMode mode)
+    {
+        return mode == PresentMode::Inline ? "inline" : "worker";
+    }
+
+    PointResult RunPoint(const SweepConfig& config, PresentMode present, uint32_t outputs, uint32_t regions, float refreshHz)
+    {
+        PointResult r;
+        r.present = present;
+        r.outputs = outputs;
+        r.regions = regions;
+        r.refreshHz = refreshHz;
+
+        // Slices sized so the whole measurement fits in the window
+        const uint64_t sliceNs = uint64_t(config.durationMs) * 1000000ull / (LatencyHistogram::kSlices - 2) + 1;
+        LatencyHistogram latency(sliceNs);
+        std::atomic<bool> measuring{ false };
+
+        std::vector<std::unique_ptr<OutputRun>> runs;
+        std::vector<std::unique_ptr<MockSubscriber>> subs;
+        const size_t expectedPerOutput = size_t(double(refreshHz) * config.durationMs / 1000.0) + 16;
+        for (uint32_t o = 0; o < outputs; ++o)
+        {
+            auto run = std::make_unique<OutputRun>();
+            SyntheticFrameSource::Config sc;
+            sc.width = config.width;
+            sc.height = config.height;
+            sc.hz = refreshHz;
+            sc.realTime = true;
+            sc.seed = 1 + o;
+            // Always busy: the benchmark measures fan-out, not idle timeouts
+            sc.script = {
+                { SyntheticFrameSource::SceneKind::ScrollingText, uint32_t(refreshHz * 2) },
+                { SyntheticFrameSource::SceneKind::VideoNoise,    uint32_t(refreshHz * 2) },
+            };
+            run->source = std::make_unique<SyntheticFrameSource>(sc);
+            run->originNs = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(run->source->Origin().time_since_epoch()).count());
+            run->dispatchUs.reserve(expectedPerOutput);
+            run->measuring = &measuring;
+
+            OutputRun* raw = run.get();
+            CaptureLoop::Hooks hooks;
+            hooks.afterFrame = [raw](const FrameDamage&, bool, const std::vector<CaptureLoop::Subscriber>&) {
+                if (raw->frameStartNs && raw->measuring->load(std::memory_order_relaxed) &&
+                    raw->dispatchUs.size() < raw->dispatchUs.capacity())
+                {
+                    const uint64_t total = NowNs() - raw->frameStartNs;
+                    raw->dispatchUs.push_back(double(total - std::min(total, raw->frameWorkNs)) / 1000.0);
+                }
+                raw->frameStartNs = 0;
+                raw->frameWorkNs = 0;
+            };
+            run->loop.SetHooks(std::move(hooks));
+            for (uint32_t i = 0; i < regions; ++i)
+            {
+                subs.push_back(std::make_unique<MockSubscriber>(*run, config, present, refreshHz, latency));
+                run->loop.AddSubscriber(subs.back().get(), RegionRect(i, regions, config.width, config.height));
+            }
+            runs.push_back(std::move(run));
+        }
+
+        for (auto& run : runs)
+        {
+            OutputRun* raw = run.get();
+            run->thread = std::thread([raw] { raw->loop.Run(*raw->source); });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(config.warmupMs));
+        std::vector<CaptureLoop::Stats> before;
+        for (auto& run : runs) before.push_back(run->loop.GetStats());
+        uint64_t presentsBefore = 0, coalescedBefore = 0;
+        for (auto& s : subs) { presentsBefore += s->Presented(); coalescedBefore += s->Coalesced(); }
+        const auto start = Clock::now();
+        measuring.store(true, std::memory_order_relaxed);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(config.durationMs));
+
+        measuring.store(false, std::memory_order_relaxed);
+        const auto end = Clock::now();
+        r.seconds = std::chrono::duration<double>(end - start).count();
+        for (size_t i = 0; i < runs.size(); ++i)
+        {
+            const CaptureLoop::Stats after = runs[i]->loop.GetStats();
+            r.acquiredFrames += after.frames - before[i].frames;
+            r.renders += after.renders - before[i].renders;
+        }
+        for (auto& s : subs) { r.presents += s->Presented(); r.coalesced += s->Coalesced(); }
+        r.presents -= presentsBefore;
+        r.coalesced -= coalescedBefore;
+        const LatencyHistogram::Summary lat = latency.Summarize(NowNs());
+
+        for (auto& run : runs) run->loop.Stop();
+        for (auto& run : runs) run->thread.join();
+        for (auto& s : subs) s->Stop();
+
+        r.expectedFrames = uint64_t(r.seconds * double(refreshHz) * double(outputs));
+        r.droppedFrames = r.expectedFrames > r.acquiredFrames ? r.expectedFrames - r.acquiredFrames : 0;
+        r.fps = r.seconds > 0.0 ? double(r.acquiredFrames) / r.seconds / double(outputs) : 0.0;
+
+        std::vector<double> dispatch;
+        for (auto& run : runs) dispatch.insert(dispatch.end(), run->dispatchUs.begin(), run->dispatchUs.end());
+        if (!dispatch.empty())
+        {
+            double sum = 0.0;
+            for (double d : dispatch) sum += d;
+            r.dispatchUsMean = sum / double(dispatch.size());
+            r.dispatchUsP99 = Percentile(dispatch, 0.99);
+        }
+        r.latencyP50Ms = lat.p50Ms;
+        r.latencyP90Ms = lat.p90Ms;
+        r.latencyP99Ms = lat.p99Ms;
+        r.latencyMaxMs = lat.maxMs;
+        return r;
+    }
+
+    std::vector<PointResult> RunSweep(const SweepConfig& config)
+    {
+        std::vector<PointResult> results;
+        for (PresentMode present : config.presentModes)
+        {
+            for (uint32_t regions : config.regions)
+            {
+                for (uint32_t outputs : config.outputs)
+                {
+                    for (float hz : config.refreshHz)
+                    {
+                        results.push_back(RunPoint(config, present, outputs, regions, hz));
+                    }
+                }
+            }
+        }
+        return results;
+    }
+
+    void ToJson(const SweepConfig& config, const std::vector<PointResult>& results, std::string& out)
+    {
+        char buf[768];
+        std::snprintf(buf, sizeof(buf),
+            "{\"config\":{\"durationMs\":%u,\"warmupMs\":%u,\"cpuUs\":%u,\"gpuUs\":%u,\"width\":%d,\"height\":%d},\"points\":[",
+            config.durationMs, config.warmupMs, config.cpuUs, config.gpuUs, int(config.width), int(config.height));
+        out = buf;
+        bool first = true;
+        for (const PointResult& r : results)
+        {
+            if (!first) out.push_back(',');
+            first = false;
+            std::snprintf(buf, sizeof(buf),
+                "{\"present\":\"%s\",\"outputs\":%u,\"regions\":%u,\"refreshHz\":%.3f,\"seconds\":%.3f,\"fps\":%.2f,"
+                "\"expectedFrames\":%llu,\"acquiredFrames\":%llu,\"droppedFrames\":%llu,"
+                "\"dispatchUs\":{\"mean\":%.3f,\"p99\":%.3f},\"renders\":%llu,\"presents\":%llu,\"coalesced\":%llu,"
+                "\"latencyMs\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}}",
+                PresentModeName(r.present), r.outputs, r.regions, double(r.refreshHz), r.seconds, r.fps,
+                static_cast<unsigned long long>(r.expectedFrames), static_cast<unsigned long long>(r.acquiredFrames),
+                static_cast<unsigned long long>(r.droppedFrames), r.dispatchUsMean, r.dispatchUsP99,
+                static_cast<unsigned long long>(r.renders), static_cast<unsigned long long>(r.presents),
+                static_cast<unsigned long long>(r.coalesced),
+                r.latencyP50Ms, r.latencyP90Ms, r.latencyP99Ms, r.latencyMaxMs);
+            out += buf;
+        }
+        out += "]}\n";
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Headless scaling benchmark for the capture loop fan-out. Each sweep point runs
+// one CaptureLoop per simulated output on a real-time SyntheticFrameSource, with
+// N mock subscribers per output that burn CPU in OnFrame (the draw recording) and
+// then present through a mock swap chain: gpuUs of GPU work, then a block until
+// the output's next vblank, like a vsynced Present. The present runs either on
+// the subscriber's own PresentWorker or inline on the capture thread, so the
+// sweep shows what moving it off the loop buys as the region count grows. No
+// Windows or D3D involved, so scaling regressions show up on any machine.
+// Portable.
+namespace winvert4::bench
+{
+    enum class PresentMode
+    {
+        Worker,  // PresentWorker per subscriber, as EffectWindow does
+        Inline,  // Present called from OnFrame on the capture thread
+    };
+    const char* PresentModeName(PresentMode mode);
+
+    struct SweepConfig
+    {
+        std::vector<uint32_t> regions{ 1, 2, 4, 8, 16 };  // subscribers per output
+        std::vector<uint32_t> outputs{ 1, 2 };
+        std::vector<float> refreshHz{ 60.0f, 144.0f, 240.0f };
+        std::vector<PresentMode> presentModes{ PresentMode::Worker, PresentMode::Inline };
+        uint32_t durationMs{ 2000 };   // per point
+        uint32_t warmupMs{ 200 };      // run before measuring
+        uint32_t cpuUs{ 150 };         // busy work per OnFrame
+        uint32_t gpuUs{ 1000 };        // GPU work before a present waits for vblank
+        int32_t width{ 1920 };
+        int32_t height{ 1080 };
+    };
+
+    struct PointResult
+    {
+        PresentMode present{ PresentMode::Worker };
+        uint32_t outputs{ 0 };
+        uint32_t regions{ 0 };
+        float refreshHz{ 0.0f };
+        double seconds{ 0.0 };
+        double fps{ 0.0 };               // acquired frames per second, per output
+        uint64_t expectedFrames{ 0 };    // refresh periods elapsed, all outputs
+        uint64_t acquiredFrames{ 0 };
+        uint64_t droppedFrames{ 0 };     // periods the loops did not get to
+        double dispatchUsMean{ 0.0 };    // fan-out cost per frame beyond the subscribers' own work
+        double dispatchUsP99{ 0.0 };
+        uint64_t renders{ 0 };           // OnFrame calls
+        uint64_t presents{ 0 };          // presents completed (by the workers, or inline)
+        uint64_t coalesced{ 0 };         // submits folded into a pending present (worker mode)
+        double latencyP50Ms{ 0.0 };      // frame due -> present done
+        double latencyP90Ms{ 0.0 };
+        double latencyP99Ms{ 0.0 };
+        double latencyMaxMs{ 0.0 };
+    };
+
+    PointResult RunPoint(const SweepConfig& config, PresentMode present, uint32_t outputs, uint32_t regions, float refreshHz);
+    // Every presentModes x regions x outputs x refreshHz combination, in that nesting order
+    std::vector<PointResult> RunSweep(const SweepConfig& config);
+    void ToJson(const SweepConfig& config, const std::vector<PointResult>& results, std::string& out);
+}
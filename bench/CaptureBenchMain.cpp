@@ -0,0 +1,91 @@
+#include "CaptureBench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// capture_bench [--regions 1,2,4] [--outputs 1,2] [--hz 60,144] [--present worker,inline]
+//               [--duration-ms N] [--warmup-ms N] [--cpu-us N] [--gpu-us N]
+//               [--out results.json]
+// Runs the capture fan-out sweep on synthetic sources and writes the results as
+// JSON to --out, or to stdout.
+namespace {
+    template <class T>
+    bool ParseList(const char* s, std::vector<T>& out)
+    {
+        out.clear();
+        while (*s)
+        {
+            char* end = nullptr;
+            const double v = std::strtod(s, &end);
+            if (end == s || v <= 0.0 || (*end && *end != ',')) return false;
+            out.push_back(T(v));
+            s = *end ? end + 1 : end;
+        }
+        return !out.empty();
+    }
+
+    bool ParsePresentModes(const char* s, std::vector<winvert4::bench::PresentMode>& out)
+    {
+        out.clear();
+        while (*s)
+        {
+            const char* end = std::strchr(s, ',');
+            const size_t len = end ? size_t(end - s) : std::strlen(s);
+            if (len == 6 && !std::strncmp(s, "worker", len)) out.push_back(winvert4::bench::PresentMode::Worker);
+            else if (len == 6 && !std::strncmp(s, "inline", len)) out.push_back(winvert4::bench::PresentMode::Inline);
+            else return false;
+            s = end ? end + 1 : s + len;
+        }
+        return !out.empty();
+    }
+
+    bool ParseUint(const char* s, uint32_t& out)
+    {
+        char* end = nullptr;
+        const unsigned long v = std::strtoul(s, &end, 10);
+        if (end == s || *end) return false;
+        out = uint32_t(v);
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    winvert4::bench::SweepConfig config;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (ok && !std::strcmp(arg, "--regions")) ok = ParseList(value, config.regions);
+        else if (ok && !std::strcmp(arg, "--outputs")) ok = ParseList(value, config.outputs);
+        else if (ok && !std::strcmp(arg, "--hz")) ok = ParseList(value, config.refreshHz);
+        else if (ok && !std::strcmp(arg, "--present")) ok = ParsePresentModes(value, config.presentModes);
+        else if (ok && !std::strcmp(arg, "--duration-ms")) ok = ParseUint(value, config.durationMs);
+        else if (ok && !std::strcmp(arg, "--warmup-ms")) ok = ParseUint(value, config.warmupMs);
+        else if (ok && !std::strcmp(arg, "--cpu-us")) ok = ParseUint(value, config.cpuUs);
+        else if (ok && !std::strcmp(arg, "--gpu-us")) ok = ParseUint(value, config.gpuUs);
+        else if (ok && !std::strcmp(arg, "--out")) outPath = value;
+        else ok = false;
+        if (!ok)
+        {
+            std::fprintf(stderr, "capture_bench: bad argument %s\n", arg);
+            return 2;
+        }
+        ++i;
+    }
+
+    std::string json;
+    winvert4::bench::ToJson(config, winvert4::bench::RunSweep(config), json);
+    FILE* f = outPath ? std::fopen(outPath, "wb") : stdout;
+    if (!f)
+    {
+        std::fprintf(stderr, "capture_bench: cannot write %s\n", outPath);
+        return 1;
+    }
+    std::fwrite(json.data(), 1, json.size(), f);
+    if (outPath) std::fclose(f);
+    return 0;
+}
@@ -0,0 +1,287 @@
+#include "DirtyRects.h"
+#include "FrameSource.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// damage_bench [--width N] [--height N] [--regions N] [--frames N]
+//              [--duration-ms N] [--out results.json]
+// Cost of the per-frame damage bookkeeping DxgiFrameSource and CaptureLoop do
+// on synthetic desktop workloads: building a FrameDamage from the frame's dirty
+// and move rects and finalizing it (merge, collapse to kMaxCopyRects, full-copy
+// escalation), then clipping it to each of --regions subscriber regions. Each
+// workload is --frames pre-generated frames replayed for --duration-ms per phase,
+// so the timings hold no generator or clock overhead. Writes JSON to --out, or
+// to stdout.
+namespace {
+    struct Config
+    {
+        int32_t width{ 3840 };
+        int32_t height{ 2160 };
+        uint32_t regions{ 4 };
+        uint32_t frames{ 4096 };
+        uint32_t durationMs{ 300 };  // per phase and workload
+    };
+
+    // One acquired frame's metadata
+    struct Move
+    {
+        int32_t srcX, srcY;
+        PixelRect dst;
+    };
+    struct FrameInput
+    {
+        std::vector<Move> moves;
+        std::vector<PixelRect> dirty;
+    };
+
+    struct Result
+    {
+        std::string workload;
+        uint64_t frames{ 0 };
+        double finalizeNs{ 0.0 };     // reset + add + finalize, per frame
+        double clipNs{ 0.0 };         // intersect + clip for every region, per frame
+        double rectsIn{ 0.0 };        // mean rects (dirty + move) per frame
+        double rectsOut{ 0.0 };       // mean copy boxes per non-full frame
+        double fullFraction{ 0.0 };   // frames escalated to a full copy
+        double damagedFraction{ 0.0 };
+        double clippedRects{ 0.0 };   // mean rects handed to all subscribers per frame
+    };
+
+    bool ParseUint(const char* s, uint32_t& out)
+    {
+        char* end = nullptr;
+        const unsigned long v = std::strtoul(s, &end, 10);
+        if (end == s || *end || v == 0) return false;
+        out = uint32_t(v);
+        return true;
+    }
+
+    struct Rng
+    {
+        uint32_t state;
+        uint32_t Next() { state = state * 1664525u + 1013904223u; return state >> 8; }
+        int32_t Range(int32_t lo, int32_t hi) { return lo + int32_t(Next() % uint32_t(hi - lo + 1)); }
+    };
+
+    PixelRect Rect(int32_t x, int32_t y, int32_t w, int32_t h) { return PixelRect{ x, y, x + w, y + h }; }
+
+    // A text caret toggling in place
+    std::vector<FrameInput> CaretBlink(const Config& c)
+    {
+        std::vector<FrameInput> frames(c.frames);
+        for (FrameInput& f : frames) f.dirty.push_back(Rect(c.width / 3, c.height / 2, 2, 40));
+        return frames;
+    }
+
+    // Glyphs landing one by one along a line, with the caret following; the
+    // compositor reports each glyph and the caret separately
+    std::vector<FrameInput> Typing(const Config& c)
+    {
+        std::vector<FrameInput> frames(c.frames);
+        const int32_t glyphW = 12, glyphH = 24, x0 = 200, y0 = 300, perLine = (c.width - 2 * x0) / glyphW;
+        for (uint32_t i = 0; i < c.frames; ++i)
+        {
+            const int32_t col = int32_t(i) % perLine, line = int32_t(i) / perLine % 40;
+            const int32_t x = x0 + col * glyphW, y = y0 + line * (glyphH + 6);
+            // A burst of keys can land in one frame
+            for (int32_t k = 0; k < 1 + int32_t(i % 3); ++k) frames[i].dirty.push_back(Rect(x - k * glyphW, y, glyphW, glyphH));
+            frames[i].dirty.push_back(Rect(x + glyphW, y, 2, glyphH));
+        }
+        return frames;
+    }
+
+    // A 1080p browser window scrolling: the content moves up, the revealed strip
+    // is repainted and the scrollbar thumb moves
+    std::vector<FrameInput> Scrolling(const Config& c)
+    {
+        std::vector<FrameInput> frames(c.frames);
+        const PixelRect window = Rect(c.width / 8, c.height / 8, std::min(1920, c.width / 2), std::min(1080, c.height / 2));
+        const int32_t w = window.right - window.left, h = window.bottom - window.top;
+        for (uint32_t i = 0; i < c.frames; ++i)
+        {
+            const int32_t step = 8 + int32_t(i % 5) * 8;
+            frames[i].moves.push_back({ window.left, window.top + step, Rect(window.left, window.top, w - 16, h - step) });
+            frames[i].dirty.push_back(Rect(window.left, window.bottom - step, w - 16, step));
+            frames[i].dirty.push_back(Rect(window.right - 16, window.top + int32_t(i * 4 % uint32_t(h - 60)), 16, 60));
+        }
+        return frames;
+    }
+
+    // 1-64 rects of any size anywhere, some reaching past the output
+    std::vector<FrameInput> RandomRects(const Config& c)
+    {
+        std::vector<FrameInput> frames(c.frames);
+        Rng rng{ 7 };
+        for (FrameInput& f : frames)
+        {
+            const int32_t n = rng.Range(1, 64);
+            for (int32_t k = 0; k < n; ++k)
+            {
+                const int32_t w = rng.Range(1, c.width / 8), h = rng.Range(1, c.height / 8);
+                const PixelRect r = Rect(rng.Range(-40, c.width), rng.Range(-40, c.height), w, h);
+                if (rng.Next() % 8 == 0) f.moves.push_back({ r.left + 10, r.top + 10, r });
+                else f.dirty.push_back(r);
+            }
+        }
+        return frames;
+    }
+
+    // Tile the output with the subscriber regions
+    std::vector<PixelRect> Regions(const Config& c)
+    {
+        uint32_t cols = 1;
+        while (cols * cols < c.regions) ++cols;
+        const uint32_t rows = (c.regions + cols - 1) / cols;
+        const int32_t cw = c.width / int32_t(cols), ch = c.height / int32_t(rows);
+        std::vector<PixelRect> regions;
+        for (uint32_t i = 0; i < c.regions; ++i) regions.push_back(Rect(int32_t(i % cols) * cw, int32_t(i / cols) * ch, cw, ch));
+        return regions;
+    }
+
+    // Replays the frames until durationMs passed; ns per frame
+    double TimePerFrame(uint32_t durationMs, size_t frames, const std::function<void()>& pass, uint64_t& replayed)
+    {
+        using Clock = std::chrono::steady_clock;
+        pass();  // warm up
+        uint64_t passes = 0;
+        const auto start = Clock::now();
+        const auto until = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        do
+        {
+            pass();
+            ++passes;
+            now = Clock::now();
+        } while (now < until);
+        replayed = passes * frames;
+        return std::chrono::duration<double, std::nano>(now - start).count() / double(replayed);
+    }
+
+    Result Run(const Config& c, const char* name, const std::vector<FrameInput>& inputs)
+    {
+        const std::vector<PixelRect> regions = Regions(c);
+        std::vector<FrameDamage> damage(inputs.size());
+        Result r;
+        r.workload = name;
+
+        r.finalizeNs = TimePerFrame(c.durationMs, inputs.size(), [&] {
+            for (size_t i = 0; i < inputs.size(); ++i)
+            {
+                FrameDamage& d = damage[i];
+                d.Reset(c.width, c.height);
+                for (const Move& m : inputs[i].moves) d.AddMove(m.srcX, m.srcY, m.dst);
+                for (const PixelRect& rect : inputs[i].dirty) d.AddDirty(rect);
+                d.Finalize(winvert4::kMaxCopyRects, winvert4::kFullCopyFraction);
+            }
+        }, r.frames);
+
+        std::vector<PixelRect> clipped;
+        clipped.reserve(regions.size() * winvert4::kMaxCopyRects);
+        size_t clippedTotal = 0;
+        uint64_t clipFrames = 0;
+        r.clipNs = TimePerFrame(c.durationMs, inputs.size(), [&] {
+            clippedTotal = 0;
+            for (const FrameDamage& d : damage)
+            {
+                for (const PixelRect& region : regions)
+                {
+                    if (!d.Intersects(region)) continue;
+                    clipped.clear();
+                    clippedTotal += d.ClipTo(region, clipped);
+                }
+            }
+        }, clipFrames);
+
+        const double output = double(c.width) * double(c.height);
+        size_t in = 0, out = 0, full = 0;
+        double damaged = 0.0;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            in += inputs[i].moves.size() + inputs[i].dirty.size();
+            if (damage[i].IsFull()) ++full;
+            else out += damage[i].Rects().size();
+            damaged += double(damage[i].DamagedArea()) / output;
+        }
+        const double n = double(inputs.size());
+        r.rectsIn = double(in) / n;
+        r.rectsOut = full < inputs.size() ? double(out) / double(inputs.size() - full) : 0.0;
+        r.fullFraction = double(full) / n;
+        r.damagedFraction = damaged / n;
+        r.clippedRects = double(clippedTotal) / n;
+        return r;
+    }
+
+    void ToJson(const Config& c, const std::vector<Result>& results, std::string& out)
+    {
+        char line[512];
+        std::snprintf(line, sizeof(line), "{\n  \"width\": %d,\n  \"height\": %d,\n  \"regions\": %u,\n  \"results\": [\n",
+            int(c.width), int(c.height), c.regions);
+        out = line;
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line),
+                "    { \"workload\": \"%s\", \"frames\": %llu, \"finalize_ns\": %.1f, \"clip_ns\": %.1f, \"rects_in\": %.2f, "
+                "\"rects_out\": %.2f, \"full_fraction\": %.3f, \"damaged_fraction\": %.4f, \"clipped_rects\": %.2f }%s\n",
+                r.workload.c_str(), (unsigned long long)r.frames, r.finalizeNs, r.clipNs, r.rectsIn, r.rectsOut,
+                r.fullFraction, r.damagedFraction, r.clippedRects, i + 1 < results.size() ? "," : "");
+            out += line;
+        }
+        out += "  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Config config;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        uint32_t v = 0;
+        if (ok && !std::strcmp(arg, "--width")) { ok = ParseUint(value, v); config.width = int32_t(v); }
+        else if (ok && !std::strcmp(arg, "--height")) { ok = ParseUint(value, v); config.height = int32_t(v); }
+        else if (ok && !std::strcmp(arg, "--regions")) ok = ParseUint(value, config.regions);
+        else if (ok && !std::strcmp(arg, "--frames")) ok = ParseUint(value, config.frames);
+        else if (ok && !std::strcmp(arg, "--duration-ms")) ok = ParseUint(value, config.durationMs);
+        else if (ok && !std::strcmp(arg, "--out")) outPath = value;
+        else ok = false;
+        if (!ok)
+        {
+            std::fprintf(stderr, "damage_bench: bad argument %s\n", arg);
+            return 2;
+        }
+        ++i;
+    }
+    // The workloads place a window and 40 lines of text on the output
+    if (config.width < 640 || config.height < 480)
+    {
+        std::fprintf(stderr, "damage_bench: output must be at least 640x480\n");
+        return 2;
+    }
+
+    std::vector<Result> results;
+    results.push_back(Run(config, "caret_blink", CaretBlink(config)));
+    results.push_back(Run(config, "typing", Typing(config)));
+    results.push_back(Run(config, "scrolling", Scrolling(config)));
+    results.push_back(Run(config, "random_rects", RandomRects(config)));
+
+    std::string json;
+    ToJson(config, results, json);
+    FILE* f = outPath ? std::fopen(outPath, "wb") : stdout;
+    if (!f)
+    {
+        std::fprintf(stderr, "damage_bench: cannot write %s\n", outPath);
+        return 1;
+    }
+    std::fwrite(json.data(), 1, json.size(), f);
+    if (outPath) std::fclose(f);
+    return 0;
+}
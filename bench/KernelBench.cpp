@@ -0,0 +1,311 @@
+#include "ColorLut.h"
+#include "EffectCompiler.h"
+#include "EffectKernel.h"
+#include "EffectKernelSimd.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// kernel_bench [--width N] [--height N] [--duration-ms N] [--maps 1,16,1024]
+//              [--lut-maps 0,8,64] [--lut-sizes 33,65] [--out results.json]
+// Throughput of the CPU effect kernels on one BGRA8 frame, in megapixels per
+// second, at 1080p, 1440p and 4K (or only --width x --height when given): the
+// EffectKernel reference (the kPS port) per effect, the reference with each
+// --maps count of color maps (the grid index should keep the cost flat as the
+// list grows), and the vectorized invert + matrix path for scalar code and the
+// best ISA this CPU runs. Then the time ColorLut::Bake takes for each --lut-maps
+// count at each --lut-sizes lattice, which is what a settings change costs once
+// the map list outgrows the constant buffer. Writes JSON to --out, or to stdout.
+namespace {
+    struct Resolution
+    {
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct Config
+    {
+        std::vector<Resolution> resolutions{ { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+        uint32_t durationMs{ 500 };  // per case
+        std::vector<uint32_t> maps{ 1, 4, 16, 64, 256, 1024 };
+        std::vector<uint32_t> lutMaps{ 0, 1, 8, 32, 64 };
+        std::vector<uint32_t> lutSizes{ 33, ColorLut::kSmallSize, ColorLut::kLargeSize };
+    };
+
+    struct Result
+    {
+        std::string path;
+        std::string effect;
+        Resolution size{ 0, 0 };
+        uint64_t frames{ 0 };
+        double mpps{ 0.0 };
+    };
+
+    struct BakeResult
+    {
+        uint32_t maps{ 0 };
+        uint32_t size{ 0 };
+        uint64_t bakes{ 0 };
+        double msPerBake{ 0.0 };
+    };
+
+    struct Timing
+    {
+        uint64_t runs{ 0 };
+        double seconds{ 0.0 };
+    };
+
+    bool ParseUint(const char* s, uint32_t& out)
+    {
+        char* end = nullptr;
+        const unsigned long v = std::strtoul(s, &end, 10);
+        if (end == s || *end || v == 0) return false;
+        out = uint32_t(v);
+        return true;
+    }
+
+    bool ParseList(const char* s, std::vector<uint32_t>& out, unsigned long minValue = 1)
+    {
+        out.clear();
+        while (*s)
+        {
+            char* end = nullptr;
+            const unsigned long v = std::strtoul(s, &end, 10);
+            if (end == s || v < minValue || (*end && *end != ',')) return false;
+            out.push_back(uint32_t(v));
+            s = *end ? end + 1 : end;
+        }
+        return !out.empty();
+    }
+
+    EffectSettings Invert()
+    {
+        EffectSettings s;
+        s.isInvertEffectEnabled = true;
+        return s;
+    }
+
+    EffectSettings InvertMatrix()
+    {
+        EffectSettings s = Invert();
+        s.isCustomEffectActive = true;
+        // Sepia
+        const float m[16] = { 0.393f, 0.769f, 0.189f, 0, 0.349f, 0.686f, 0.168f, 0, 0.272f, 0.534f, 0.131f, 0, 0, 0, 0, 1 };
+        std::memcpy(s.colorMat, m, sizeof(m));
+        return s;
+    }
+
+    EffectSettings ColorMaps(uint32_t count)
+    {
+        EffectSettings s = Invert();
+        s.isColorMappingEnabled = true;
+        uint32_t rng = 12345;
+        auto next = [&rng] { rng = rng * 1664525u + 1013904223u; return uint8_t(rng >> 24); };
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ColorMapEntry e;
+            e.srcR = next(); e.srcG = next(); e.srcB = next();
+            e.dstR = next(); e.dstG = next(); e.dstB = next();
+            e.tolerance = 24;
+            s.colorMaps.push_back(e);
+        }
+        return s;
+    }
+
+    // The kernel EffectWindow renders with: packed constants plus the full map list
+    EffectKernel KernelFor(const EffectSettings& s)
+    {
+        const CompiledEffect fx = CompileEffectSettings(s, s.isInvertEffectEnabled);
+        ColorMapCB maps;
+        const ColorMapPacking packing = PackColorMaps(s, maps);
+        PixelCB pcb{};
+        std::memcpy(pcb.colorMapSrc, maps.colorMapSrc, sizeof(maps));
+        PackPixelFlags(s, fx, packing.packed, pcb);
+        EffectKernel kernel(pcb);
+        kernel.SetColorMaps(s.colorMaps);
+        return kernel;
+    }
+
+    // A desktop-like frame: flat areas, gradients and noise
+    std::vector<uint8_t> MakeFrame(uint32_t width, uint32_t height)
+    {
+        std::vector<uint8_t> px(size_t(width) * height * 4);
+        uint32_t rng = 1;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint8_t* p = &px[(size_t(y) * width + x) * 4];
+                rng = rng * 1664525u + 1013904223u;
+                if (y < height / 3) { p[0] = p[1] = p[2] = 0xF0; }
+                else if (y < 2 * height / 3) { p[0] = uint8_t(x); p[1] = uint8_t(y); p[2] = uint8_t(x + y); }
+                else { p[0] = uint8_t(rng >> 8); p[1] = uint8_t(rng >> 16); p[2] = uint8_t(rng >> 24); }
+                p[3] = 255;
+            }
+        }
+        return px;
+    }
+
+    // Runs fn for at least durationMs, and at least once after a warm-up call
+    Timing Time(uint32_t durationMs, const std::function<void()>& fn)
+    {
+        using Clock = std::chrono::steady_clock;
+        fn();  // warm caches and lazily built tables
+        Timing t;
+        const auto start = Clock::now();
+        const auto until = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        do
+        {
+            fn();
+            ++t.runs;
+            now = Clock::now();
+        } while (now < until);
+        t.seconds = std::chrono::duration<double>(now - start).count();
+        return t;
+    }
+
+    Result Measure(const Config& config, Resolution size, const char* path, const char* effect, const std::function<void()>& frame)
+    {
+        const Timing t = Time(config.durationMs, frame);
+        Result r;
+        r.path = path;
+        r.effect = effect;
+        r.size = size;
+        r.frames = t.runs;
+        r.mpps = double(t.runs) * size.width * size.height / t.seconds / 1e6;
+        return r;
+    }
+
+    BakeResult MeasureBake(const Config& config, uint32_t maps, uint32_t size)
+    {
+        const EffectKernel kernel = KernelFor(ColorMaps(maps));
+        ColorLut lut;
+        const Timing t = Time(config.durationMs, [&] { lut.Bake(kernel, size); });
+        BakeResult r;
+        r.maps = maps;
+        r.size = size;
+        r.bakes = t.runs;
+        r.msPerBake = t.seconds * 1e3 / double(t.runs);
+        return r;
+    }
+
+    void ToJson(const std::vector<Result>& results, const std::vector<BakeResult>& bakes, std::string& out)
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line), "{\n  \"isa\": \"%s\",\n  \"results\": [\n", KernelIsaName(DetectKernelIsa()));
+        out = line;
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line), "    { \"width\": %u, \"height\": %u, \"path\": \"%s\", \"effect\": \"%s\", \"frames\": %llu, \"mpps\": %.1f }%s\n",
+                r.size.width, r.size.height, r.path.c_str(), r.effect.c_str(), (unsigned long long)r.frames, r.mpps,
+                i + 1 < results.size() ? "," : "");
+            out += line;
+        }
+        out += "  ],\n  \"lut_bakes\": [\n";
+        for (size_t i = 0; i < bakes.size(); ++i)
+        {
+            const BakeResult& b = bakes[i];
+            std::snprintf(line, sizeof(line), "    { \"maps\": %u, \"size\": %u, \"bakes\": %llu, \"ms_per_bake\": %.3f }%s\n",
+                b.maps, b.size, (unsigned long long)b.bakes, b.msPerBake, i + 1 < bakes.size() ? "," : "");
+            out += line;
+        }
+        out += "  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Config config;
+    uint32_t width = 0, height = 0;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (ok && !std::strcmp(arg, "--width")) ok = ParseUint(value, width);
+        else if (ok && !std::strcmp(arg, "--height")) ok = ParseUint(value, height);
+        else if (ok && !std::strcmp(arg, "--duration-ms")) ok = ParseUint(value, config.durationMs);
+        else if (ok && !std::strcmp(arg, "--maps")) ok = ParseList(value, config.maps);
+        else if (ok && !std::strcmp(arg, "--lut-maps")) ok = ParseList(value, config.lutMaps, 0);
+        else if (ok && !std::strcmp(arg, "--lut-sizes")) ok = ParseList(value, config.lutSizes, 2);
+        else if (ok && !std::strcmp(arg, "--out")) outPath = value;
+        else ok = false;
+        if (!ok)
+        {
+            std::fprintf(stderr, "kernel_bench: bad argument %s\n", arg);
+            return 2;
+        }
+        ++i;
+    }
+
+    // A custom size replaces the sweep; a missing dimension keeps 1080p's
+    if (width || height) config.resolutions = { { width ? width : 1920, height ? height : 1080 } };
+
+    const struct { const char* name; EffectSettings settings; } effects[] = {
+        { "invert", Invert() },
+        { "invert_matrix", InvertMatrix() },
+    };
+    std::vector<KernelIsa> isas{ KernelIsa::Scalar };
+    if (DetectKernelIsa() != KernelIsa::Scalar) isas.push_back(DetectKernelIsa());
+
+    std::vector<Result> results;
+    for (const Resolution size : config.resolutions)
+    {
+        const std::vector<uint8_t> src = MakeFrame(size.width, size.height);
+        std::vector<uint8_t> dst(src.size());
+        const size_t pitch = size_t(size.width) * 4;
+
+        for (const auto& e : effects)
+        {
+            const EffectKernel kernel = KernelFor(e.settings);
+            results.push_back(Measure(config, size, "reference", e.name, [&] {
+                kernel.Process(src.data(), pitch, dst.data(), pitch, size.width, size.height);
+            }));
+        }
+
+        for (uint32_t count : config.maps)
+        {
+            const EffectKernel kernel = KernelFor(ColorMaps(count));
+            const std::string name = "invert_maps" + std::to_string(count);
+            results.push_back(Measure(config, size, "reference", name.c_str(), [&] {
+                kernel.Process(src.data(), pitch, dst.data(), pitch, size.width, size.height);
+            }));
+        }
+
+        for (const auto& e : effects)
+        {
+            const AffineParams params = AffineParamsFromSettings(e.settings);
+            for (KernelIsa isa : isas)
+            {
+                results.push_back(Measure(config, size, KernelIsaName(isa), e.name, [&] {
+                    ProcessAffineBGRA8(params, src.data(), pitch, dst.data(), pitch, size.width, size.height, isa);
+                }));
+            }
+        }
+    }
+
+    std::vector<BakeResult> bakes;
+    for (uint32_t size : config.lutSizes)
+    {
+        for (uint32_t maps : config.lutMaps) bakes.push_back(MeasureBake(config, maps, size));
+    }
+
+    std::string json;
+    ToJson(results, bakes, json);
+    FILE* f = outPath ? std::fopen(outPath, "wb") : stdout;
+    if (!f)
+    {
+        std::fprintf(stderr, "kernel_bench: cannot write %s\n", outPath);
+        return 1;
+    }
+    std::fwrite(json.data(), 1, json.size(), f);
+    if (outPath) std::fclose(f);
+    return 0;
+}
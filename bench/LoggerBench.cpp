@@ -0,0 +1,187 @@
+#include "AsyncLogger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// logger_bench [--threads 1,2,4,8] [--duration-ms N] [--slots N] [--writer file|null]
+//              [--out results.json]
+// Throughput of AsyncLogger with N producer threads pushing log-sized lines as
+// fast as they can for --duration-ms: lines accepted and written per second, the
+// producers' mean cost per Push, and how many lines the full ring dropped. The
+// file writer appends to a temporary file the way Log.h's writer does; the null
+// writer discards batches to isolate the ring and the flusher. Writes JSON to
+// --out, or to stdout.
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using winvert4::AsyncLogger;
+
+    struct Config
+    {
+        std::vector<uint32_t> threads{ 1, 2, 4, 8 };
+        uint32_t durationMs{ 1000 };
+        uint32_t slots{ uint32_t(AsyncLogger::kDefaultSlots) };
+        bool fileWriter{ true };
+    };
+
+    struct Result
+    {
+        uint32_t threads{ 0 };
+        double seconds{ 0.0 };
+        uint64_t pushed{ 0 };    // Push calls
+        uint64_t written{ 0 };
+        uint64_t dropped{ 0 };
+        double pushNs{ 0.0 };    // mean wall time per Push on a producer (includes preemption)
+        double linesPerS{ 0.0 }; // written lines per second, drain included
+    };
+
+    bool ParseUint(const char* s, uint32_t& out)
+    {
+        char* end = nullptr;
+        const unsigned long v = std::strtoul(s, &end, 10);
+        if (end == s || *end || v == 0) return false;
+        out = uint32_t(v);
+        return true;
+    }
+
+    bool ParseList(const char* s, std::vector<uint32_t>& out)
+    {
+        out.clear();
+        while (*s)
+        {
+            char* end = nullptr;
+            const unsigned long v = std::strtoul(s, &end, 10);
+            if (end == s || v == 0 || (*end && *end != ',')) return false;
+            out.push_back(uint32_t(v));
+            s = *end ? end + 1 : end;
+        }
+        return !out.empty();
+    }
+
+    Result Run(const Config& config, uint32_t threads)
+    {
+        FILE* file = config.fileWriter ? std::tmpfile() : nullptr;
+        AsyncLogger log(config.slots);
+        log.Start([file](const char* data, size_t size) {
+            if (file) std::fwrite(data, 1, size, file);
+        });
+
+        std::atomic<bool> go{ false }, stop{ false };
+        std::vector<uint64_t> pushes(threads, 0);
+        std::vector<double> busyNs(threads, 0.0);
+        std::vector<std::thread> producers;
+        for (uint32_t t = 0; t < threads; ++t)
+        {
+            producers.emplace_back([&, t] {
+                char line[160];
+                uint64_t n = 0;
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                const auto begin = Clock::now();
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    // What a WINVERT_DEBUG frame-loop line costs: format plus push
+                    const int len = std::snprintf(line, sizeof(line),
+                        "[CAP] thread %u frame %llu: %u rects, %.3f ms since present", t,
+                        static_cast<unsigned long long>(n), unsigned(n % 17), double(n % 1000) / 97.0);
+                    log.Push(line, size_t(len));
+                    ++n;
+                }
+                busyNs[t] = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+                pushes[t] = n;
+            });
+        }
+
+        const auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::milliseconds(config.durationMs));
+        stop.store(true, std::memory_order_relaxed);
+        for (auto& p : producers) p.join();
+        log.Flush();
+        const auto end = Clock::now();
+        log.Stop();
+        if (file) std::fclose(file);
+
+        Result r;
+        r.threads = threads;
+        r.seconds = std::chrono::duration<double>(end - start).count();
+        double busy = 0.0;
+        for (uint32_t t = 0; t < threads; ++t)
+        {
+            r.pushed += pushes[t];
+            busy += busyNs[t];
+        }
+        r.dropped = log.Dropped();
+        // The flusher's own "dropped N lines" reports are written too
+        r.written = log.Written();
+        r.pushNs = r.pushed ? busy / double(r.pushed) : 0.0;
+        r.linesPerS = double(r.written) / r.seconds;
+        return r;
+    }
+
+    void ToJson(const Config& config, const std::vector<Result>& results, std::string& out)
+    {
+        char line[384];
+        std::snprintf(line, sizeof(line), "{\n  \"cpus\": %u,\n  \"slots\": %u,\n  \"writer\": \"%s\",\n  \"results\": [\n",
+            std::thread::hardware_concurrency(), config.slots, config.fileWriter ? "file" : "null");
+        out = line;
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line),
+                "    { \"threads\": %u, \"seconds\": %.3f, \"pushed\": %llu, \"written\": %llu, \"dropped\": %llu, "
+                "\"drop_fraction\": %.4f, \"push_ns\": %.1f, \"lines_per_s\": %.0f }%s\n",
+                r.threads, r.seconds, (unsigned long long)r.pushed, (unsigned long long)r.written,
+                (unsigned long long)r.dropped, r.pushed ? double(r.dropped) / double(r.pushed) : 0.0,
+                r.pushNs, r.linesPerS, i + 1 < results.size() ? "," : "");
+            out += line;
+        }
+        out += "  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Config config;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (ok && !std::strcmp(arg, "--threads")) ok = ParseList(value, config.threads);
+        else if (ok && !std::strcmp(arg, "--duration-ms")) ok = ParseUint(value, config.durationMs);
+        else if (ok && !std::strcmp(arg, "--slots")) ok = ParseUint(value, config.slots);
+        else if (ok && !std::strcmp(arg, "--writer"))
+        {
+            ok = !std::strcmp(value, "file") || !std::strcmp(value, "null");
+            config.fileWriter = ok && !std::strcmp(value, "file");
+        }
+        else if (ok && !std::strcmp(arg, "--out")) outPath = value;
+        else ok = false;
+        if (!ok)
+        {
+            std::fprintf(stderr, "logger_bench: bad argument %s\n", arg);
+            return 2;
+        }
+        ++i;
+    }
+
+    std::vector<Result> results;
+    for (uint32_t threads : config.threads) results.push_back(Run(config, threads));
+
+    std::string json;
+    ToJson(config, results, json);
+    FILE* f = outPath ? std::fopen(outPath, "wb") : stdout;
+    if (!f)
+    {
+        std::fprintf(stderr, "logger_bench: cannot write %s\n", outPath);
+        return 1;
+    }
+    std::fwrite(json.data(), 1, json.size(), f);
+    if (outPath) std::fclose(f);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "EffectCompiler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// pack_bench [--maps 0,16,64] [--duration-ms N] [--out results.json]
+// Cost of building the effect constants on the CPU, per call, for each --maps
+// count of enabled color maps:
+//   full        CompileEffectSettings + PackColorMaps + PackPixelFlags, the
+//               whole PixelCB (what UpdateCBs_ used to do every frame)
+//   flags_only  CompileEffectSettings + PackPixelFlags, the b1 buffer (an
+//               invert flip or a slider change)
+//   maps_only   PackColorMaps plus the bytewise compare that decides whether the
+//               b2 table is uploaded (a settings change that may touch the maps)
+// Each case also lists the bytes it uploads. Writes JSON to --out, or to stdout.
+namespace {
+    struct Config
+    {
+        std::vector<uint32_t> maps{ 0, 16, 64 };
+        uint32_t durationMs{ 300 };  // per case
+    };
+
+    struct Result
+    {
+        std::string path;
+        uint32_t maps{ 0 };
+        uint64_t calls{ 0 };
+        double ns{ 0.0 };
+        size_t uploadBytes{ 0 };
+    };
+
+    bool ParseUint(const char* s, uint32_t& out)
+    {
+        char* end = nullptr;
+        const unsigned long v = std::strtoul(s, &end, 10);
+        if (end == s || *end || v == 0) return false;
+        out = uint32_t(v);
+        return true;
+    }
+
+    bool ParseList(const char* s, std::vector<uint32_t>& out)
+    {
+        out.clear();
+        while (*s)
+        {
+            char* end = nullptr;
+            const unsigned long v = std::strtoul(s, &end, 10);
+            if (end == s || (*end && *end != ',')) return false;
+            out.push_back(uint32_t(v));
+            s = *end ? end + 1 : end;
+        }
+        return !out.empty();
+    }
+
+    EffectSettings Settings(uint32_t maps)
+    {
+        EffectSettings s;
+        s.isInvertEffectEnabled = true;
+        s.isCustomEffectActive = true;
+        const float sepia[16] = { 0.393f, 0.769f, 0.189f, 0, 0.349f, 0.686f, 0.168f, 0, 0.272f, 0.534f, 0.131f, 0, 0, 0, 0, 1 };
+        std::memcpy(s.colorMat, sepia, sizeof(sepia));
+        s.isColorMappingEnabled = maps > 0;
+        uint32_t rng = 12345;
+        auto next = [&rng] { rng = rng * 1664525u + 1013904223u; return uint8_t(rng >> 24); };
+        for (uint32_t i = 0; i < maps; ++i)
+        {
+            ColorMapEntry e;
+            e.srcR = next(); e.srcG = next(); e.srcB = next();
+            e.dstR = next(); e.dstG = next(); e.dstB = next();
+            e.tolerance = 24;
+            s.colorMaps.push_back(e);
+        }
+        return s;
+    }
+
+    // Calls fn in batches until durationMs passed; ns per call
+    double TimePerCall(uint32_t durationMs, const std::function<void()>& fn, uint64_t& calls)
+    {
+        using Clock = std::chrono::steady_clock;
+        constexpr uint32_t kBatch = 256;
+        for (uint32_t i = 0; i < kBatch; ++i) fn();  // warm up
+        calls = 0;
+        const auto start = Clock::now();
+        const auto until = start + std::chrono::milliseconds(durationMs);
+        auto now = start;
+        do
+        {
+            for (uint32_t i = 0; i < kBatch; ++i) fn();
+            calls += kBatch;
+            now = Clock::now();
+        } while (now < until);
+        return std::chrono::duration<double, std::nano>(now - start).count() / double(calls);
+    }
+
+    void ToJson(const std::vector<Result>& results, std::string& out)
+    {
+        char line[256];
+        out = "{\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line), "    { \"path\": \"%s\", \"maps\": %u, \"calls\": %llu, \"ns\": %.1f, \"upload_bytes\": %zu }%s\n",
+                r.path.c_str(), r.maps, (unsigned long long)r.calls, r.ns, r.uploadBytes, i + 1 < results.size() ? "," : "");
+            out += line;
+        }
+        out += "  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Config config;
+    const char* outPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (ok && !std::strcmp(arg, "--maps")) ok = ParseList(value, config.maps);
+        else if (ok && !std::strcmp(arg, "--duration-ms")) ok = ParseUint(value, config.durationMs);
+        else if (ok && !std::strcmp(arg, "--out")) outPath = value;
+        else ok = false;
+        if (!ok)
+        {
+            std::fprintf(stderr, "pack_bench: bad argument %s\n", arg);
+            return 2;
+        }
+        ++i;
+    }
+
+    std::vector<Result> results;
+    volatile float sink = 0.0f;  // keeps the packed output observable
+    for (uint32_t maps : config.maps)
+    {
+        const EffectSettings settings = Settings(maps);
+        bool invert = false;
+        PixelCB pcb{};
+        ColorMapCB table{}, uploaded{};
+
+        Result full{ "full", maps };
+        full.uploadBytes = sizeof(PixelCB);
+        full.ns = TimePerCall(config.durationMs, [&] {
+            const CompiledEffect fx = CompileEffectSettings(settings, invert = !invert);
+            const ColorMapPacking packing = PackColorMaps(settings, table);
+            std::memcpy(pcb.colorMapSrc, table.colorMapSrc, sizeof(table));
+            PackPixelFlags(settings, fx, packing.packed, pcb);
+            sink = pcb.colorMat[0] + pcb.colorMapSrc[0][0];
+        }, full.calls);
+        results.push_back(full);
+
+        Result flagsOnly{ "flags_only", maps };
+        flagsOnly.uploadBytes = kPixelFlagsBytes;
+        const uint32_t packed = PackColorMaps(settings, table).packed;
+        flagsOnly.ns = TimePerCall(config.durationMs, [&] {
+            const CompiledEffect fx = CompileEffectSettings(settings, invert = !invert);
+            PackPixelFlags(settings, fx, packed, pcb);
+            sink = pcb.colorMat[0];
+        }, flagsOnly.calls);
+        results.push_back(flagsOnly);
+
+        Result mapsOnly{ "maps_only", maps };
+        mapsOnly.uploadBytes = 0;  // unchanged maps compare equal and are not uploaded
+        uploaded = table;
+        mapsOnly.ns = TimePerCall(config.durationMs, [&] {
+            PackColorMaps(settings, table);
+            if (std::memcmp(&table, &uploaded, sizeof(table)) != 0) uploaded = table;
+            sink = table.colorMapSrc[0][0];
+        }, mapsOnly.calls);
+        results.push_back(mapsOnly);
+    }
+    (void)sink;
+
+    std::string json;
+    ToJson(results, json);
+    FILE* f = outPath ? std::fopen(outPath, "wb") : stdout;
+    if (!f)
+    {
+        std::fprintf(stderr, "pack_bench: cannot write %s\n", outPath);
+        return 1;
+    }
+    std::fwrite(json.data(), 1, json.size(), f);
+    if (outPath) std::fclose(f);
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "AsyncLogger.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using winvert4::AsyncLogger;
+
+namespace {
+    // Collects writer output; lines without the "HH:MM:SS:mmm " header and CRLF
+    struct Sink
+    {
+        std::mutex mutex;
+        std::string data;
+
+        AsyncLogger::Writer Writer()
+        {
+            return [this](const char* p, size_t n) { std::lock_guard<std::mutex> lk(mutex); data.append(p, n); };
+        }
+
+        std::vector<std::string> Lines()
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            std::vector<std::string> out;
+            size_t pos = 0;
+            while (pos < data.size())
+            {
+                const size_t end = data.find("\r\n", pos);
+                if (end == std::string::npos) break;
+                out.push_back(data.substr(pos + 13, end - pos - 13));
+                pos = end + 2;
+            }
+            return out;
+        }
+    };
+}
+
+TEST(AsyncLogger, WritesHeaderAndCrLf)
+{
+    Sink sink;
+    AsyncLogger log(16);
+    log.Start(sink.Writer());
+    EXPECT_TRUE(log.Push("hello"));
+    log.Flush();
+    log.Stop();
+    ASSERT_EQ(sink.data.size(), 13u + 5 + 2);
+    int h, m, s, ms;
+    EXPECT_EQ(std::sscanf(sink.data.c_str(), "%2d:%2d:%2d:%3d ", &h, &m, &s, &ms), 4);
+    EXPECT_EQ(sink.data.substr(13), "hello\r\n");
+}
+
+TEST(AsyncLogger, FullRingDropsAndReports)
+{
+    Sink sink;
+    AsyncLogger log(8);
+    // Before Start nothing drains: the ring fills after 8 lines
+    for (int i = 0; i < 20; ++i) log.Push(("line " + std::to_string(i)).c_str());
+    EXPECT_EQ(log.Dropped(), 12u);
+    log.Start(sink.Writer());
+    log.Flush();
+    log.Stop();
+    const std::vector<std::string> lines = sink.Lines();
+    ASSERT_EQ(lines.size(), 9u);
+    for (int i = 0; i < 8; ++i) EXPECT_EQ(lines[i], "line " + std::to_string(i));
+    EXPECT_EQ(lines[8], "log: dropped 12 lines (ring full)");
+    EXPECT_EQ(log.Written(), 8u);
+}
+
+TEST(AsyncLogger, TruncatesLongLines)
+{
+    Sink sink;
+    AsyncLogger log(4);
+    log.Start(sink.Writer());
+    const std::string longLine(4 * AsyncLogger::kSlotSize, 'x');
+    log.Push(longLine.c_str(), longLine.size());
+    log.Stop();
+    const std::vector<std::string> lines = sink.Lines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_LT(lines[0].size(), AsyncLogger::kSlotSize);
+    EXPECT_GT(lines[0].size(), AsyncLogger::kSlotSize / 2);
+}
+
+// Lines from one producer come out in push order; across producers every line
+// is either written once or counted as dropped
+TEST(AsyncLogger, ConcurrentProducersKeepPerThreadOrder)
+{
+    Sink sink;
+    AsyncLogger log(256);
+    log.Start(sink.Writer());
+    constexpr int kThreads = 4, kLines = 20000;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        producers.emplace_back([&log, t] {
+            char line[32];
+            for (int i = 0; i < kLines; ++i)
+            {
+                std::snprintf(line, sizeof(line), "%d %d", t, i);
+                log.Push(line);
+            }
+        });
+    }
+    for (auto& p : producers) p.join();
+    log.Stop();
+
+    int last[kThreads] = { -1, -1, -1, -1 };
+    uint64_t lines = 0;
+    for (const std::string& l : sink.Lines())
+    {
+        int t = 0, i = 0;
+        if (std::sscanf(l.c_str(), "%d %d", &t, &i) != 2 || l.rfind("log:", 0) == 0) continue;
+        ASSERT_GE(t, 0);
+        ASSERT_LT(t, kThreads);
+        ASSERT_GT(i, last[t]) << "thread " << t;
+        last[t] = i;
+        ++lines;
+    }
+    EXPECT_EQ(lines, log.Written());
+    EXPECT_EQ(log.Written() + log.Dropped(), uint64_t(kThreads) * kLines);
+}
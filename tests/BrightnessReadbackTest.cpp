@@ -0,0 +1,269 @@
+#include "BrightnessReadback.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace winvert4;
+
+namespace {
+    const float kWeights[3] = { 0.2126f, 0.7152f, 0.0722f };
+
+    // Stands in for the staging textures: a copy issued at tick t is readable from
+    // tick t + delay, and holds the region's gray level at issue time
+    struct MockDevice : IReadbackTarget
+    {
+        struct Slot
+        {
+            uint64_t ready{ 0 };
+            uint8_t value{ 0 };
+            bool fail{ false };
+        };
+
+        MockDevice(uint32_t delay, uint32_t slots) : delay(delay), slots(slots) {}
+
+        bool Issue(uint32_t slot) override
+        {
+            if (refuse) return false;
+            slots[slot] = { tick + delay, region, failNext };
+            failNext = false;
+            ++issued;
+            return true;
+        }
+
+        ReadbackStatus TryRead(uint32_t slot, Bgra8& out) override
+        {
+            if (tick < slots[slot].ready) return ReadbackStatus::Pending;
+            if (slots[slot].fail) return ReadbackStatus::Failed;
+            out = { slots[slot].value, slots[slot].value, slots[slot].value, 255 };
+            return ReadbackStatus::Ready;
+        }
+
+        uint32_t delay;
+        std::vector<Slot> slots;
+        uint64_t tick{ 0 };
+        uint8_t region{ 0 };
+        bool failNext{ false };
+        bool refuse{ false };
+        uint64_t issued{ 0 };
+    };
+
+    // One rendered frame: the monitor runs, then the GPU advances
+    BrightnessMonitor::FrameResult Step(BrightnessMonitor& m, MockDevice& dev, bool changed, int delayFrames)
+    {
+        const BrightnessMonitor::FrameResult r = m.Frame(dev, changed, kWeights, delayFrames);
+        ++dev.tick;
+        return r;
+    }
+
+    uint8_t Gray(float luma) { return uint8_t(luma * 255.0f + 0.5f); }
+}
+
+TEST(ReadbackRing, CollectsInIssueOrderWithoutBlocking)
+{
+    MockDevice dev(2, 3);
+    ReadbackRing ring(3);
+    ReadbackRing::Result r;
+    for (uint64_t frame = 1; frame <= 3; ++frame)
+    {
+        dev.region = uint8_t(frame * 10);
+        EXPECT_TRUE(ring.Issue(dev, frame));
+        ++dev.tick;
+    }
+    EXPECT_FALSE(ring.Issue(dev, 4));  // every slot in flight
+    EXPECT_EQ(ring.InFlight(), 3u);
+
+    // tick 3: the first two copies are done, the third is not
+    EXPECT_TRUE(ring.Poll(dev, r));
+    EXPECT_EQ(r.issuedFrame, 1u);
+    EXPECT_EQ(r.pixel.r, 10);
+    EXPECT_TRUE(ring.Poll(dev, r));
+    EXPECT_EQ(r.issuedFrame, 2u);
+    EXPECT_FALSE(ring.Poll(dev, r));
+    EXPECT_EQ(ring.InFlight(), 1u);
+
+    // A freed slot is reused; slots wrap around
+    dev.region = 40;
+    EXPECT_TRUE(ring.Issue(dev, 4));
+    dev.tick += 2;
+    EXPECT_TRUE(ring.Poll(dev, r));
+    EXPECT_EQ(r.issuedFrame, 3u);
+    EXPECT_TRUE(ring.Poll(dev, r));
+    EXPECT_EQ(r.issuedFrame, 4u);
+    EXPECT_EQ(r.pixel.r, 40);
+    EXPECT_EQ(ring.InFlight(), 0u);
+}
+
+TEST(ReadbackRing, FailedAndRefusedReadbacks)
+{
+    MockDevice dev(0, 2);
+    ReadbackRing ring(2);
+    ReadbackRing::Result r;
+    dev.failNext = true;
+    ring.Issue(dev, 1);
+    dev.region = 99;
+    ring.Issue(dev, 2);
+    // The failed one is dropped and polling moves on to the next
+    EXPECT_TRUE(ring.Poll(dev, r));
+    EXPECT_EQ(r.issuedFrame, 2u);
+    EXPECT_EQ(ring.Failed(), 1u);
+
+    dev.refuse = true;
+    EXPECT_FALSE(ring.Issue(dev, 3));
+    EXPECT_EQ(ring.InFlight(), 0u);
+
+    dev.refuse = false;
+    ring.Issue(dev, 4);
+    ring.Reset();
+    EXPECT_EQ(ring.InFlight(), 0u);
+    EXPECT_FALSE(ring.Poll(dev, r));
+}
+
+// Results arrive delay frames late (at least one: the monitor polls before it
+// issues), each exactly once
+TEST(BrightnessMonitor, LatencyFollowsGpuDelay)
+{
+    for (uint32_t delay = 0; delay <= 4; ++delay)
+    {
+        MockDevice dev(delay, 3);
+        BrightnessMonitor m(3);
+        uint32_t samples = 0, lastLatency = 0;
+        for (int f = 0; f < 100; ++f)
+        {
+            dev.region = uint8_t(f);
+            const auto r = Step(m, dev, true, 0);
+            samples += r.samples;
+            if (r.samples) lastLatency = r.latencyFrames;
+        }
+        EXPECT_EQ(lastLatency, std::max(delay, 1u)) << "delay " << delay;
+        EXPECT_GT(samples, 0u);
+        EXPECT_LE(samples, dev.issued);
+    }
+}
+
+TEST(BrightnessMonitor, FullRingStillMeasuresNewestContent)
+{
+    // The GPU is slower than three slots can hide
+    MockDevice dev(6, 3);
+    BrightnessMonitor m(3);
+    uint8_t seen = 0;
+    for (int f = 0; f < 20; ++f)
+    {
+        dev.region = uint8_t(10 + f);
+        const auto r = Step(m, dev, true, 0);
+        if (r.samples) seen = Gray(r.luma);
+    }
+    EXPECT_EQ(m.Ring().InFlight(), 3u);
+
+    // The desktop goes idle: the change made while the ring was full is still read
+    int frames = 0;
+    while (m.NeedsFrames() && frames < 100)
+    {
+        const auto r = Step(m, dev, false, 0);
+        if (r.samples) seen = Gray(r.luma);
+        ++frames;
+    }
+    EXPECT_FALSE(m.NeedsFrames());
+    EXPECT_EQ(seen, 29);
+}
+
+TEST(BrightnessMonitor, IdleDesktopIssuesOneReadback)
+{
+    MockDevice dev(2, 3);
+    BrightnessMonitor m;
+    dev.region = 40;
+    for (int f = 0; f < 10; ++f) Step(m, dev, false, 0);
+    EXPECT_EQ(dev.issued, 1u);
+    EXPECT_FALSE(m.NeedsFrames());
+    EXPECT_FALSE(m.Invert());
+}
+
+// A bright region flips after delayFrames measurements; while the region stays
+// unchanged the last measurement keeps counting without new GPU work
+TEST(BrightnessMonitor, DebounceCountsIdleFrames)
+{
+    MockDevice dev(2, 3);
+    BrightnessMonitor m;
+    dev.region = 20;
+    for (int f = 0; f < 5; ++f) Step(m, dev, f == 0, 4);
+    EXPECT_FALSE(m.Invert());
+    EXPECT_FALSE(m.NeedsFrames());
+
+    dev.region = 230;
+    const uint64_t issuedBefore = dev.issued;
+    int flipAt = -1;
+    for (int f = 0; f < 20 && (f == 0 || m.NeedsFrames()); ++f)
+    {
+        if (Step(m, dev, f == 0, 4).flipped) flipAt = f;
+    }
+    EXPECT_TRUE(m.Invert());
+    EXPECT_EQ(flipAt, 2 + 3);  // GPU delay, then three more counted frames
+    EXPECT_FALSE(m.NeedsFrames());
+    EXPECT_EQ(dev.issued, issuedBefore + 1);
+}
+
+TEST(BrightnessMonitor, SingleFrameFlashDoesNotFlip)
+{
+    MockDevice dev(2, 3);
+    BrightnessMonitor m;
+    for (int f = 0; f < 30; ++f)
+    {
+        dev.region = f == 10 ? 250 : 20;
+        Step(m, dev, true, 3);
+        ASSERT_FALSE(m.Invert()) << "frame " << f;
+    }
+}
+
+// The ring makes the same decisions the synchronous Map did, only later
+TEST(BrightnessMonitor, MatchesSynchronousDecisions)
+{
+    std::mt19937 rng(7);
+    std::vector<uint8_t> seq(2000);
+    for (uint8_t& v : seq) v = (rng() % 8 == 0) ? uint8_t(rng()) : uint8_t((rng() & 1) ? 30 : 220);
+
+    BrightnessDebounce sync;
+    std::vector<bool> want;
+    for (uint8_t v : seq)
+    {
+        sync.Update(BrightnessMonitor::Luma({ v, v, v, 255 }, kWeights), 3);
+        want.push_back(sync.Invert());
+    }
+
+    MockDevice dev(2, 3);
+    BrightnessMonitor m;
+    std::vector<bool> got;
+    for (size_t i = 0; i < seq.size() + 2; ++i)
+    {
+        dev.region = seq[std::min(i, seq.size() - 1)];
+        if (Step(m, dev, i < seq.size(), 3).samples) got.push_back(m.Invert());
+    }
+    ASSERT_GE(got.size(), seq.size());
+    got.resize(seq.size());
+    EXPECT_EQ(got, want);
+}
+
+TEST(BrightnessMonitor, FailedFirstReadingIsRetried)
+{
+    MockDevice dev(1, 3);
+    BrightnessMonitor m;
+    dev.region = 240;
+    dev.failNext = true;
+    for (int f = 0; f < 10 && (f == 0 || m.NeedsFrames() || !m.Invert()); ++f) Step(m, dev, false, 0);
+    EXPECT_TRUE(m.Invert());
+    EXPECT_EQ(m.Ring().Failed(), 1u);
+    EXPECT_EQ(dev.issued, 2u);
+}
+
+TEST(BrightnessMonitor, DisableDropsReadbacks)
+{
+    MockDevice dev(3, 3);
+    BrightnessMonitor m;
+    dev.region = 240;
+    Step(m, dev, true, 0);
+    Step(m, dev, true, 0);
+    EXPECT_TRUE(m.NeedsFrames());
+    m.Disable(false);
+    EXPECT_FALSE(m.NeedsFrames());
+    EXPECT_FALSE(m.Invert());
+    EXPECT_EQ(m.Ring().InFlight(), 0u);
+}
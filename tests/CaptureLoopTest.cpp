@@ -0,0 +1,457 @@
+#include "CaptureLoop.h"
+#include "SyntheticFrameSource.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using namespace winvert4;
+
+namespace {
+    SyntheticFrameSource::Config IdleDesktop()
+    {
+        SyntheticFrameSource::Config c;
+        c.width = 64;
+        c.height = 64;
+        c.script = { { SyntheticFrameSource::SceneKind::Idle, 1000000 } };
+        return c;
+    }
+
+    // Runs the loop on its own thread for the test's lifetime
+    class LoopThread
+    {
+    public:
+        LoopThread(CaptureLoop& loop, IFrameSource& source) : m_loop(loop), m_thread([&] { loop.Run(source); }) {}
+        ~LoopThread() { m_loop.Stop(); m_thread.join(); }
+
+    private:
+        CaptureLoop& m_loop;
+        std::thread m_thread;
+    };
+
+    SyntheticFrameSource::Config VirtualDesktop(std::vector<SyntheticFrameSource::Scene> script)
+    {
+        SyntheticFrameSource::Config c;
+        c.width = 320;
+        c.height = 200;
+        c.realTime = false;
+        c.script = std::move(script);
+        // Each pane is under kFullCopyFraction of the desktop, so damage stays partial
+        c.textPane = PixelRect{ 0, 0, 100, 200 };
+        c.videoPane = PixelRect{ 200, 0, 320, 100 };
+        return c;
+    }
+
+    struct RecordingSink : IFrameSink
+    {
+        std::vector<FrameEvent> events;
+        bool present{ true };
+        bool OnFrame(const FrameEvent& ev) override { events.push_back(ev); return present; }
+    };
+
+    // Asks for a follow-up frame one period after each frame, like brightness
+    // protection waiting out a readback
+    struct PacedSink : IFrameSink
+    {
+        CaptureLoop* loop{ nullptr };
+        uint64_t periodNs{ 0 };
+        std::atomic<uint32_t> frames{ 0 };
+
+        bool OnFrame(const FrameEvent&) override
+        {
+            ++frames;
+            loop->RequestRedrawAt(this, metrics::NowNs() + periodNs);
+            return true;
+        }
+    };
+}
+
+TEST(CaptureLoop, TimedRedrawsFollowTheirPeriod)
+{
+    SyntheticFrameSource source(IdleDesktop());
+    CaptureLoop loop;
+    PacedSink sink;
+    sink.loop = &loop;
+    sink.periodNs = 10000000;  // 10 ms
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 64, 64 });
+    // The idle desktop never presents; one redraw starts the chain
+    loop.RequestRedraw(&sink);
+    {
+        LoopThread run(loop, source);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        loop.RemoveSubscriber(&sink);
+    }
+    // About 30; an immediate re-request would redraw every loop iteration instead
+    EXPECT_GE(sink.frames.load(), 10u);
+    EXPECT_LE(sink.frames.load(), 32u);
+}
+
+TEST(CaptureLoop, TimedRedrawFromAnotherThreadCutsTheWaitShort)
+{
+    SyntheticFrameSource source(IdleDesktop());
+    CaptureLoop loop;
+    struct CountingSink : IFrameSink
+    {
+        std::atomic<uint32_t> frames{ 0 };
+        bool OnFrame(const FrameEvent&) override { ++frames; return true; }
+    } sink;
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 64, 64 });
+    LoopThread run(loop, source);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint32_t before = sink.frames.load();
+    loop.RequestRedrawAt(&sink, metrics::NowNs() + 5000000);
+    loop.RequestRedrawAt(&sink, metrics::NowNs() + 40000000);  // later deadline: coalesced
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(sink.frames.load(), before + 1);
+    loop.RemoveSubscriber(&sink);
+}
+
+TEST(CaptureLoop, RemovedSinkLosesItsTimedRedraw)
+{
+    SyntheticFrameSource source(IdleDesktop());
+    CaptureLoop loop;
+    struct CountingSink : IFrameSink
+    {
+        std::atomic<uint32_t> frames{ 0 };
+        bool OnFrame(const FrameEvent&) override { ++frames; return true; }
+    } sink, other;
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 64, 64 });
+    loop.AddSubscriber(&other, PixelRect{ 0, 0, 64, 64 });
+    LoopThread run(loop, source);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint32_t before = sink.frames.load();
+    loop.RequestRedrawAt(&sink, metrics::NowNs() + 20000000);
+    loop.RemoveSubscriber(&sink);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_EQ(sink.frames.load(), before);
+    loop.RemoveSubscriber(&other);
+}
+
+TEST(CaptureLoop, FansFramesOutWithPerRegionDamage)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource source(VirtualDesktop({ { Kind::ScrollingText, 4 }, { Kind::VideoNoise, 4 } }));
+    CaptureLoop loop;
+    RecordingSink text, video;
+    video.present = false;
+    loop.AddSubscriber(&text, PixelRect{ 0, 0, 160, 200 });
+    loop.AddSubscriber(&video, PixelRect{ 160, 0, 320, 200 });
+    uint32_t hooked = 0;
+    CaptureLoop::Hooks hooks;
+    hooks.afterFrame = [&](const FrameDamage&, bool anyPresented, const std::vector<CaptureLoop::Subscriber>& subs) {
+        ++hooked;
+        EXPECT_TRUE(anyPresented);
+        EXPECT_EQ(subs.size(), 2u);
+    };
+    loop.SetHooks(hooks);
+
+    for (int i = 0; i < 7; ++i) ASSERT_EQ(loop.Step(source), AcquireStatus::Frame);
+    ASSERT_EQ(text.events.size(), 7u);
+    ASSERT_EQ(video.events.size(), 7u);
+    // The first acquire lands on slot 1: a full frame, two scrolling ones, then video
+    for (size_t i = 0; i < 7; ++i)
+    {
+        EXPECT_EQ(text.events[i].frame, source.SharedFrame());
+        EXPECT_NE(text.events[i].presentTicks, 0u);
+        EXPECT_EQ(text.events[i].regionDirty, i < 3) << "frame " << i;
+        EXPECT_EQ(video.events[i].regionDirty, i == 0 || i >= 3) << "frame " << i;
+    }
+    EXPECT_EQ(hooked, 7u);
+
+    const CaptureLoop::Stats stats = loop.GetStats();
+    EXPECT_EQ(stats.frames, 7u);
+    EXPECT_EQ(stats.renders, 14u);
+    EXPECT_EQ(stats.presents, 7u);
+    EXPECT_EQ(stats.redraws, 0u);
+    loop.RemoveSubscriber(&text);
+    loop.RemoveSubscriber(&video);
+}
+
+TEST(CaptureLoop, IdleStepRedrawsOnlyRequestedSinks)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource source(VirtualDesktop({ { Kind::Idle, 100 } }));
+    CaptureLoop loop;
+    RecordingSink a, b;
+    loop.AddSubscriber(&a, PixelRect{ 0, 0, 160, 200 });
+    loop.AddSubscriber(&b, PixelRect{ 160, 0, 320, 200 });
+    EXPECT_EQ(loop.Step(source), AcquireStatus::Timeout);
+    EXPECT_TRUE(a.events.empty());
+
+    loop.RequestRedraw(&a);
+    loop.RequestRedraw(&a);  // coalesced
+    EXPECT_EQ(loop.Step(source), AcquireStatus::Timeout);
+    ASSERT_EQ(a.events.size(), 1u);
+    EXPECT_EQ(a.events[0].presentTicks, 0u);
+    EXPECT_TRUE(b.events.empty());
+    EXPECT_EQ(loop.GetStats().redraws, 1u);
+    loop.RemoveSubscriber(&a);
+    loop.RemoveSubscriber(&b);
+}
+
+// Subscribers come and go while the loop dispatches: once RemoveSubscriber
+// returns the sink must not be called again, even though the loop reads the
+// list without locks
+TEST(CaptureLoop, RemovedSinkIsNeverCalledAgain)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource source(VirtualDesktop({ { Kind::VideoNoise, 1000 } }));
+    CaptureLoop loop;
+    struct GuardedSink : IFrameSink
+    {
+        std::atomic<bool> removed{ false };
+        std::atomic<uint32_t> lateCalls{ 0 };
+        std::atomic<uint32_t> calls{ 0 };
+        bool OnFrame(const FrameEvent&) override
+        {
+            if (removed.load()) ++lateCalls;
+            ++calls;
+            return false;
+        }
+    };
+    GuardedSink anchor;  // keeps the loop from waiting for subscribers
+    loop.AddSubscriber(&anchor, PixelRect{ 0, 0, 320, 200 });
+    constexpr int kSinks = 8;
+    std::vector<std::unique_ptr<GuardedSink>> sinks;
+    {
+        LoopThread run(loop, source);
+        std::vector<std::thread> churners;
+        std::atomic<uint32_t> lateCalls{ 0 };
+        for (int t = 0; t < 2; ++t)
+        {
+            churners.emplace_back([&loop, &lateCalls] {
+                for (int round = 0; round < 200; ++round)
+                {
+                    std::vector<std::unique_ptr<GuardedSink>> mine;
+                    for (int i = 0; i < kSinks; ++i)
+                    {
+                        mine.push_back(std::make_unique<GuardedSink>());
+                        loop.AddSubscriber(mine.back().get(), PixelRect{ 0, 0, 320, 200 });
+                    }
+                    for (auto& sink : mine)
+                    {
+                        loop.RemoveSubscriber(sink.get());
+                        sink->removed = true;
+                    }
+                    // Destroyed here: a late call would also be a use after free
+                    for (auto& sink : mine) lateCalls += sink->lateCalls.load();
+                }
+            });
+        }
+        for (auto& c : churners) c.join();
+        EXPECT_EQ(lateCalls.load(), 0u);
+        EXPECT_EQ(loop.SubscriberCount(), 1u);
+        loop.RemoveSubscriber(&anchor);
+    }
+    EXPECT_GT(anchor.calls.load(), 0u);
+    EXPECT_EQ(anchor.lateCalls.load(), 0u);
+}
+
+// A sink may unsubscribe itself (or another) from inside OnFrame without
+// deadlocking; the current dispatch finishes with the pinned list
+TEST(CaptureLoop, SinkCanUnsubscribeFromOnFrame)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource source(VirtualDesktop({ { Kind::VideoNoise, 100 } }));
+    CaptureLoop loop;
+    struct SelfRemovingSink : IFrameSink
+    {
+        CaptureLoop* loop{ nullptr };
+        IFrameSink* alsoRemove{ nullptr };
+        uint32_t calls{ 0 };
+        bool OnFrame(const FrameEvent&) override
+        {
+            ++calls;
+            loop->RemoveSubscriber(this);
+            if (alsoRemove) loop->RemoveSubscriber(alsoRemove);
+            return true;
+        }
+    };
+    RecordingSink other;
+    SelfRemovingSink self;
+    self.loop = &loop;
+    self.alsoRemove = &other;
+    loop.AddSubscriber(&self, PixelRect{ 0, 0, 320, 200 });
+    loop.AddSubscriber(&other, PixelRect{ 0, 0, 320, 200 });
+    ASSERT_EQ(loop.Step(source), AcquireStatus::Frame);
+    EXPECT_EQ(self.calls, 1u);
+    EXPECT_EQ(other.events.size(), 1u);  // same dispatch, list was pinned
+    EXPECT_EQ(loop.SubscriberCount(), 0u);
+
+    loop.AddSubscriber(&other, PixelRect{ 0, 0, 320, 200 });
+    ASSERT_EQ(loop.Step(source), AcquireStatus::Frame);
+    EXPECT_EQ(self.calls, 1u);
+    EXPECT_EQ(other.events.size(), 2u);
+    loop.RemoveSubscriber(&other);
+}
+
+TEST(CaptureLoop, ServicedGenerationsAreNotRedrawnAgain)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource source(VirtualDesktop({ { Kind::Idle, 1000 } }));
+    CaptureLoop loop;
+    RecordingSink sink;
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 320, 200 });
+
+    loop.RequestRedraw(&sink, 5);
+    loop.RequestRedraw(&sink, 3);  // coalesced into 5
+    loop.Step(source);
+    EXPECT_EQ(sink.events.size(), 1u);
+
+    loop.RequestRedraw(&sink, 5);  // already on screen
+    loop.RequestRedraw(&sink, 4);
+    loop.Step(source);
+    EXPECT_EQ(sink.events.size(), 1u);
+
+    loop.RequestRedraw(&sink, 6);
+    loop.Step(source);
+    EXPECT_EQ(sink.events.size(), 2u);
+
+    // Generation 0 always redraws
+    loop.RequestRedraw(&sink);
+    loop.Step(source);
+    loop.RequestRedraw(&sink);
+    loop.RequestRedraw(&sink, 9);
+    loop.Step(source);
+    EXPECT_EQ(sink.events.size(), 4u);
+    loop.RemoveSubscriber(&sink);
+}
+
+TEST(CaptureLoop, DesktopFrameServesPendingRedraws)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource source(VirtualDesktop({ { Kind::VideoNoise, 2 }, { Kind::Idle, 1000 } }));
+    CaptureLoop loop;
+    RecordingSink sink;
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 320, 200 });
+    loop.RequestRedraw(&sink, 2);
+    ASSERT_EQ(loop.Step(source), AcquireStatus::Frame);
+    ASSERT_EQ(loop.Step(source), AcquireStatus::Timeout);
+    EXPECT_EQ(sink.events.size(), 1u);
+    EXPECT_NE(sink.events[0].presentTicks, 0u);
+    // The frame put generation 2 on screen
+    loop.RequestRedraw(&sink, 2);
+    loop.Step(source);
+    EXPECT_EQ(sink.events.size(), 1u);
+    EXPECT_EQ(loop.GetStats().redraws, 0u);
+    loop.RemoveSubscriber(&sink);
+}
+
+// On an idle desktop a request from another thread wakes the source instead of
+// waiting out the acquire timeout
+TEST(CaptureLoop, RedrawRequestWakesIdleLoop)
+{
+    SyntheticFrameSource source(IdleDesktop());
+    CaptureLoop loop;
+    struct TimedSink : IFrameSink
+    {
+        std::atomic<uint64_t> lastNs{ 0 };
+        bool OnFrame(const FrameEvent&) override { lastNs = metrics::NowNs(); return true; }
+    } sink;
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 64, 64 });
+    LoopThread run(loop, source);
+    std::vector<uint64_t> latencies;
+    for (int i = 0; i < 15; ++i)
+    {
+        // Land in the middle of an idle wait
+        std::this_thread::sleep_for(std::chrono::milliseconds(7));
+        const uint64_t before = sink.lastNs.load();
+        const uint64_t requested = metrics::NowNs();
+        loop.RequestRedraw(&sink);
+        while (sink.lastNs.load() == before) std::this_thread::yield();
+        latencies.push_back(sink.lastNs.load() - requested);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    // Well under the 16 ms idle timeout; the loop adds a 1 ms grace for a fresh frame
+    EXPECT_LT(latencies[latencies.size() / 2], 8000000u);
+    loop.RemoveSubscriber(&sink);
+}
+
+// Capture lost for a while (secure desktop, mode change): the loop retries with
+// bounded backoff, so it is back within one maximum delay of the output
+// returning, and refreshes every subscriber from the new capture
+TEST(CaptureLoop, RecoversWithBoundedBackoff)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource::Config c = VirtualDesktop({ { Kind::VideoNoise, 4 }, { Kind::Lost, 40 }, { Kind::Idle, 100000 } });
+    c.realTime = true;
+    c.hz = 200.0f;  // 5 ms periods: lost for 200 ms
+    SyntheticFrameSource source(c);
+    CaptureLoop loop;
+    CaptureLoop::RecoveryPolicy policy;
+    policy.initialDelayMs = 4;
+    policy.maxDelayMs = 32;
+    loop.SetRecoveryPolicy(policy);
+
+    std::atomic<uint32_t> lost{ 0 }, recovered{ 0 }, attempts{ 0 };
+    std::atomic<uint64_t> recoverNs{ 0 };
+    CaptureLoop::Hooks hooks;
+    hooks.onLost = [&] { ++lost; };
+    hooks.onRecovered = [&](uint64_t ns, uint32_t n) { recoverNs = ns; attempts = n; ++recovered; };
+    loop.SetHooks(hooks);
+
+    struct DirtySink : IFrameSink
+    {
+        std::atomic<uint32_t> redraws{ 0 };
+        bool OnFrame(const FrameEvent& ev) override
+        {
+            if (ev.presentTicks == 0 && ev.regionDirty) ++redraws;
+            return true;
+        }
+    } sink;
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 320, 200 });
+    {
+        LoopThread run(loop, source);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (recovered.load() == 0 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        loop.RemoveSubscriber(&sink);
+    }
+    ASSERT_EQ(recovered.load(), 1u);
+    EXPECT_EQ(lost.load(), 1u);
+    EXPECT_FALSE(loop.IsRecovering());
+    // Lost for about 180-200 ms; back within the 32 ms cap (plus scheduling slack)
+    EXPECT_GE(recoverNs.load(), 150000000u);
+    EXPECT_LE(recoverNs.load(), 300000000u);
+    // Doubling from 4 ms to the cap, not a retry per millisecond
+    EXPECT_GE(attempts.load(), 3u);
+    EXPECT_LE(attempts.load(), 16u);
+    EXPECT_EQ(sink.redraws.load(), 1u);
+    const CaptureLoop::Stats stats = loop.GetStats();
+    EXPECT_EQ(stats.losses, 1u);
+    EXPECT_EQ(stats.recoveries, 1u);
+    EXPECT_EQ(stats.recoveryAttempts, attempts.load());
+    EXPECT_EQ(stats.lastRecoverNs, recoverNs.load());
+}
+
+TEST(CaptureLoop, StopEndsRecoveryPromptly)
+{
+    using Kind = SyntheticFrameSource::SceneKind;
+    SyntheticFrameSource::Config c = VirtualDesktop({ { Kind::VideoNoise, 2 }, { Kind::Lost, 100000 } });
+    c.realTime = true;
+    c.hz = 200.0f;
+    SyntheticFrameSource source(c);
+    CaptureLoop loop;
+    CaptureLoop::RecoveryPolicy policy;
+    policy.initialDelayMs = 1000;  // a long backoff wait must not hold up Stop
+    loop.SetRecoveryPolicy(policy);
+    RecordingSink sink;
+    loop.AddSubscriber(&sink, PixelRect{ 0, 0, 320, 200 });
+    std::thread run([&] { loop.Run(source); });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!loop.IsRecovering() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_TRUE(loop.IsRecovering());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto stopAt = std::chrono::steady_clock::now();
+    loop.Stop();
+    run.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - stopAt, std::chrono::milliseconds(200));
+    EXPECT_FALSE(loop.IsRecovering());
+    EXPECT_EQ(loop.GetStats().recoveries, 0u);
+}
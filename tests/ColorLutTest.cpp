@@ -0,0 +1,163 @@
+#include "ColorLut.h"
+#include "EffectCompiler.h"
+#include "EffectKernel.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace {
+    // CIE L*a*b* (D65) of an sRGB triple, for CIE76 color differences
+    void ToLab(const float rgb[3], float lab[3])
+    {
+        float lin[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            const float c = std::clamp(rgb[i], 0.0f, 1.0f);
+            lin[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        const float x = (0.4124f * lin[0] + 0.3576f * lin[1] + 0.1805f * lin[2]) / 0.95047f;
+        const float y = 0.2126f * lin[0] + 0.7152f * lin[1] + 0.0722f * lin[2];
+        const float z = (0.0193f * lin[0] + 0.1192f * lin[1] + 0.9505f * lin[2]) / 1.08883f;
+        auto f = [](float t) { return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f; };
+        lab[0] = 116.0f * f(y) - 16.0f;
+        lab[1] = 500.0f * (f(x) - f(y));
+        lab[2] = 200.0f * (f(y) - f(z));
+    }
+
+    float DeltaE(const float a[3], const float b[3])
+    {
+        float la[3], lb[3];
+        ToLab(a, la);
+        ToLab(b, lb);
+        return std::sqrt((la[0] - lb[0]) * (la[0] - lb[0]) + (la[1] - lb[1]) * (la[1] - lb[1]) + (la[2] - lb[2]) * (la[2] - lb[2]));
+    }
+
+    EffectSettings RandomMaps(uint32_t count, int tolerance, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        EffectSettings s;
+        s.isColorMappingEnabled = true;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ColorMapEntry e;
+            e.srcR = uint8_t(rng()); e.srcG = uint8_t(rng()); e.srcB = uint8_t(rng());
+            e.dstR = uint8_t(rng()); e.dstG = uint8_t(rng()); e.dstB = uint8_t(rng());
+            e.tolerance = tolerance;
+            s.colorMaps.push_back(e);
+        }
+        return s;
+    }
+
+    // The kernel EffectWindow bakes from: packed constants plus the full map list
+    EffectKernel KernelFor(const EffectSettings& s)
+    {
+        const CompiledEffect fx = CompileEffectSettings(s, false);
+        ColorMapCB maps;
+        const ColorMapPacking packing = PackColorMaps(s, maps);
+        PixelCB pcb{};
+        memcpy(pcb.colorMapSrc, maps.colorMapSrc, sizeof(maps));
+        PackPixelFlags(s, fx, packing.packed, pcb);
+        EffectKernel kernel(pcb);
+        kernel.SetColorMaps(s.colorMaps);
+        return kernel;
+    }
+
+    struct Error
+    {
+        float mean{ 0 }, p99{ 0 }, atSources{ 0 };
+    };
+
+    Error Measure(const EffectSettings& s, uint32_t* size = nullptr)
+    {
+        const EffectKernel kernel = KernelFor(s);
+        ColorLut lut;
+        lut.Bake(kernel, ColorLut::ChooseSize(kernel));
+        if (size) *size = lut.Size();
+
+        std::mt19937 rng(99);
+        std::vector<float> errors;
+        for (int i = 0; i < 50000; ++i)
+        {
+            const float in[3] = { (rng() % 256) / 255.0f, (rng() % 256) / 255.0f, (rng() % 256) / 255.0f };
+            float exact[3], lutOut[3];
+            kernel.ShadePixel(in, exact);
+            lut.Sample(in, lutOut);
+            errors.push_back(DeltaE(exact, lutOut));
+        }
+        Error e;
+        for (float v : errors) e.mean += v;
+        e.mean /= float(errors.size());
+        std::sort(errors.begin(), errors.end());
+        e.p99 = errors[errors.size() * 99 / 100];
+        // The colors users picked: where the map's effect peaks
+        for (const ColorMapEntry& m : s.colorMaps)
+        {
+            const float in[3] = { m.srcR / 255.0f, m.srcG / 255.0f, m.srcB / 255.0f };
+            float exact[3], lutOut[3];
+            kernel.ShadePixel(in, exact);
+            lut.Sample(in, lutOut);
+            e.atSources = std::max(e.atSources, DeltaE(exact, lutOut));
+        }
+        return e;
+    }
+}
+
+TEST(ColorLut, OnlyPastConstantBufferCap)
+{
+    // Up to the cap the exact per-pixel loop renders every map
+    EXPECT_FALSE(ColorLut::Needed(0));
+    EXPECT_FALSE(ColorLut::Needed(16));
+    EXPECT_FALSE(ColorLut::Needed(kMaxColorMaps));
+    EXPECT_TRUE(ColorLut::Needed(kMaxColorMaps + 1));
+}
+
+TEST(ColorLut, ExactAtLatticePoints)
+{
+    const EffectKernel kernel = KernelFor(RandomMaps(80, 32, 1));
+    ColorLut lut;
+    lut.Bake(kernel, ColorLut::kSmallSize);
+    const float step = 1.0f / float(lut.Size() - 1);
+    for (uint32_t i = 0; i < lut.Size(); i += 7)
+    {
+        const float in[3] = { i * step, (lut.Size() - 1 - i) * step, (i / 2) * step };
+        float exact[3], lutOut[3];
+        kernel.ShadePixel(in, exact);
+        lut.Sample(in, lutOut);
+        for (int c = 0; c < 3; ++c) EXPECT_NEAR(std::clamp(exact[c], 0.0f, 1.0f), lutOut[c], 1.0f / 65535.0f);
+    }
+}
+
+// CIE76 error of the chosen lattice against EffectKernel::ShadePixel for 80 random
+// maps (past the cap), over uniform 8-bit inputs and at each map's own source
+// color. The bounds are what ChooseSize's lattice meets for these tolerances
+// with some margin; a coarser lattice or a filtering change fails them.
+struct DeltaECase
+{
+    int tolerance;
+    uint32_t size;
+    float meanBound, p99Bound, sourceBound;
+};
+void PrintTo(const DeltaECase& c, std::ostream* os) { *os << "tolerance " << c.tolerance; }
+
+class ColorLutDeltaE : public ::testing::TestWithParam<DeltaECase> {};
+
+TEST_P(ColorLutDeltaE, WithinBound)
+{
+    const DeltaECase c = GetParam();
+    uint32_t size = 0;
+    const Error e = Measure(RandomMaps(80, c.tolerance, 1), &size);
+    EXPECT_EQ(size, c.size);
+    EXPECT_LE(e.mean, c.meanBound);
+    EXPECT_LE(e.p99, c.p99Bound);
+    EXPECT_LE(e.atSources, c.sourceBound);
+    RecordProperty("mean", std::to_string(e.mean));
+    RecordProperty("p99", std::to_string(e.p99));
+    RecordProperty("atSources", std::to_string(e.atSources));
+}
+
+INSTANTIATE_TEST_SUITE_P(Tolerances, ColorLutDeltaE, ::testing::Values(
+    DeltaECase{ 16, ColorLut::kLargeSize, 0.25f, 1.5f, 8.0f },
+    DeltaECase{ 24, ColorLut::kSmallSize, 0.5f, 4.0f, 10.0f },
+    DeltaECase{ 32, ColorLut::kSmallSize, 0.5f, 4.0f, 6.0f }));
@@ -0,0 +1,129 @@
+#include "ColorMapIndex.h"
+#include "EffectCompiler.h"
+#include "EffectKernel.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace {
+    std::vector<ColorMapEntry> RandomMaps(uint32_t count, int minTol, int maxTol, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> tol(minTol, maxTol);
+        std::vector<ColorMapEntry> maps;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ColorMapEntry e;
+            e.srcR = uint8_t(rng()); e.srcG = uint8_t(rng()); e.srcB = uint8_t(rng());
+            e.dstR = uint8_t(rng()); e.dstG = uint8_t(rng()); e.dstB = uint8_t(rng());
+            e.tolerance = tol(rng);
+            maps.push_back(e);
+        }
+        return maps;
+    }
+
+    bool Contains(const ColorMapItem& it, const float p[3])
+    {
+        const float dr = p[0] - it.src[0], dg = p[1] - it.src[1], db = p[2] - it.src[2];
+        return it.t2 > 1e-12f && dr * dr + dg * dg + db * db <= it.t2;
+    }
+}
+
+// Every map whose sphere holds the point must be a candidate, in list order, or
+// the first-match result would differ from the shader's linear loop
+TEST(ColorMapIndex, CandidatesCoverEveryMatch)
+{
+    for (uint32_t count : { 1u, 7u, 64u, 300u, 1024u })
+    {
+        ColorMapIndex index;
+        index.Build(RandomMaps(count, 0, 64, count));
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> coord(-0.2f, 1.2f);
+        for (int i = 0; i < 20000; ++i)
+        {
+            const float p[3] = { coord(rng), coord(rng), coord(rng) };
+            uint32_t n = 0;
+            const uint32_t* c = index.Candidates(p[0], p[1], p[2], n);
+            ASSERT_TRUE(std::is_sorted(c, c + n));
+            for (uint32_t m = 0; m < index.Size(); ++m)
+            {
+                if (Contains(index[m], p)) ASSERT_TRUE(std::binary_search(c, c + n, m)) << count << " maps, map " << m;
+            }
+        }
+    }
+}
+
+TEST(ColorMapIndex, DisabledAndZeroToleranceNeverMatch)
+{
+    std::vector<ColorMapEntry> maps = RandomMaps(4, 0, 0, 1);
+    maps[1].enabled = false;
+    ColorMapIndex index;
+    index.Build(maps);
+    EXPECT_EQ(index.Size(), 3u);
+    EXPECT_EQ(index.GridSize(), 0u);
+    uint32_t n = 1;
+    EXPECT_EQ(index.Candidates(0.5f, 0.5f, 0.5f, n), nullptr);
+    EXPECT_EQ(n, 0u);
+}
+
+// The grid keeps per-pixel work near the local overlap, not the list length:
+// the cost of a large set stays flat
+TEST(ColorMapIndex, CandidateListsStayShort)
+{
+    for (uint32_t count : { 64u, 256u, 1024u })
+    {
+        ColorMapIndex index;
+        index.Build(RandomMaps(count, 4, 12, 3));
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> coord(0.0f, 1.0f);
+        uint64_t total = 0;
+        const int samples = 20000;
+        for (int i = 0; i < samples; ++i)
+        {
+            uint32_t n = 0;
+            index.Candidates(coord(rng), coord(rng), coord(rng), n);
+            total += n;
+        }
+        EXPECT_LT(double(total) / samples, 4.0) << count << " maps";
+    }
+}
+
+TEST(ColorMapIndex, HugeTolerancesStayBounded)
+{
+    ColorMapIndex index;
+    index.Build(RandomMaps(4096, 200, 255, 5));
+    uint32_t n = 0;
+    index.Candidates(0.5f, 0.5f, 0.5f, n);
+    EXPECT_EQ(n, 4096u);
+    EXPECT_GE(index.GridSize(), 1u);
+}
+
+// The uncapped list and the constant-buffer list give the same pixels when both
+// hold every map
+TEST(ColorMapIndex, MatchesConstantBufferList)
+{
+    EffectSettings s;
+    s.isColorMappingEnabled = true;
+    s.colorMaps = RandomMaps(kMaxColorMaps, 8, 48, 9);
+    const CompiledEffect fx = CompileEffectSettings(s, false);
+    ColorMapCB maps;
+    const ColorMapPacking packing = PackColorMaps(s, maps);
+    ASSERT_EQ(packing.packed, kMaxColorMaps);
+    PixelCB pcb{};
+    std::memcpy(pcb.colorMapSrc, maps.colorMapSrc, sizeof(maps));
+    PackPixelFlags(s, fx, packing.packed, pcb);
+
+    const EffectKernel packed(pcb);
+    EffectKernel full(pcb);
+    full.SetColorMaps(s.colorMaps);
+    std::mt19937 rng(13);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const float in[3] = { (rng() % 256) / 255.0f, (rng() % 256) / 255.0f, (rng() % 256) / 255.0f };
+        float a[3], b[3];
+        packed.ShadePixel(in, a);
+        full.ShadePixel(in, b);
+        ASSERT_EQ(std::memcmp(a, b, sizeof(a)), 0);
+    }
+}
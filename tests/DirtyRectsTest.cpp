@@ -0,0 +1,138 @@
+#include "DirtyRects.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace {
+    bool Covered(const std::vector<PixelRect>& rects, int32_t x, int32_t y)
+    {
+        for (const PixelRect& r : rects)
+        {
+            if (x >= r.left && x < r.right && y >= r.top && y < r.bottom) return true;
+        }
+        return false;
+    }
+}
+
+TEST(FrameDamage, ClipsToOutputAndDropsEmpty)
+{
+    FrameDamage d;
+    d.Reset(100, 50);
+    d.AddDirty(PixelRect{ -10, -10, 20, 20 });
+    d.AddDirty(PixelRect{ 90, 40, 200, 200 });
+    d.AddDirty(PixelRect{ 30, 30, 30, 40 });      // zero width
+    d.AddDirty(PixelRect{ 150, 10, 160, 20 });    // off the output
+    ASSERT_EQ(d.Rects().size(), 2u);
+    EXPECT_EQ(d.Rects()[0].left, 0);
+    EXPECT_EQ(d.Rects()[0].top, 0);
+    EXPECT_EQ(d.Rects()[1].right, 100);
+    EXPECT_EQ(d.Rects()[1].bottom, 50);
+}
+
+TEST(FrameDamage, MoveDamagesItsDestination)
+{
+    FrameDamage d;
+    d.Reset(100, 100);
+    d.AddMove(0, 10, PixelRect{ 0, 0, 100, 90 });
+    ASSERT_EQ(d.Rects().size(), 1u);
+    EXPECT_EQ(d.Rects()[0].Area(), 100 * 90);
+}
+
+TEST(FrameDamage, MergesSnugNeighboursOnly)
+{
+    FrameDamage d;
+    d.Reset(1000, 1000);
+    d.AddDirty(PixelRect{ 0, 0, 100, 20 });
+    d.AddDirty(PixelRect{ 0, 20, 100, 40 });      // touching strip: merges
+    d.AddDirty(PixelRect{ 500, 500, 510, 510 });  // far away: stays
+    d.AddDirty(PixelRect{ 0, 900, 10, 910 });     // diagonal to the strip, box would waste area
+    d.Finalize(16, 0.9f);
+    ASSERT_EQ(d.Rects().size(), 3u);
+    EXPECT_EQ(d.Rects()[0].bottom, 40);
+    EXPECT_FALSE(d.IsFull());
+}
+
+TEST(FrameDamage, CollapsesToMaxRects)
+{
+    FrameDamage d;
+    d.Reset(1000, 1000);
+    for (int i = 0; i < 10; ++i) d.AddDirty(PixelRect{ i * 100, i * 100, i * 100 + 5, i * 100 + 5 });
+    d.Finalize(3, 1.0f);
+    EXPECT_EQ(d.Rects().size(), 3u);
+    for (int i = 0; i < 10; ++i) EXPECT_TRUE(Covered(d.Rects(), i * 100 + 2, i * 100 + 2));
+}
+
+TEST(FrameDamage, EscalatesToFullCopy)
+{
+    FrameDamage d;
+    d.Reset(100, 100);
+    d.AddDirty(PixelRect{ 0, 0, 100, 70 });
+    d.Finalize(8, 0.6f);
+    EXPECT_TRUE(d.IsFull());
+    EXPECT_TRUE(d.Rects().empty());
+    EXPECT_EQ(d.DamagedArea(), 100 * 100);
+    // Further damage is already covered
+    d.AddDirty(PixelRect{ 0, 0, 1, 1 });
+    EXPECT_TRUE(d.Rects().empty());
+}
+
+TEST(FrameDamage, IntersectsAndClipTo)
+{
+    FrameDamage d;
+    d.Reset(200, 200);
+    EXPECT_TRUE(d.IsEmpty());
+    d.AddDirty(PixelRect{ 10, 10, 50, 50 });
+    d.AddDirty(PixelRect{ 150, 150, 190, 190 });
+    d.Finalize(8, 0.9f);
+    const PixelRect region{ 40, 40, 160, 160 };
+    EXPECT_TRUE(d.Intersects(region));
+    EXPECT_FALSE(d.Intersects(PixelRect{ 60, 0, 140, 100 }));
+    // Shared edges do not count: rects are half-open
+    EXPECT_FALSE(d.Intersects(PixelRect{ 50, 10, 60, 50 }));
+
+    std::vector<PixelRect> out;
+    ASSERT_EQ(d.ClipTo(region, out), 2u);
+    EXPECT_EQ(out[0].Area(), 10 * 10);
+    EXPECT_EQ(out[1].Area(), 10 * 10);
+
+    d.MarkAll();
+    out.clear();
+    ASSERT_EQ(d.ClipTo(PixelRect{ 150, -5, 400, 20 }, out), 1u);
+    EXPECT_EQ(out[0].right, 200);
+    EXPECT_EQ(out[0].top, 0);
+}
+
+// Whatever merging does, no damaged pixel may be left out of the copy list
+TEST(FrameDamage, FinalizeNeverDropsDamage)
+{
+    std::mt19937 rng(42);
+    for (int round = 0; round < 300; ++round)
+    {
+        const int32_t w = 64, h = 48;
+        FrameDamage d;
+        d.Reset(w, h);
+        std::vector<PixelRect> added;
+        const int count = 1 + int(rng() % 12);
+        for (int i = 0; i < count; ++i)
+        {
+            const int32_t x = int32_t(rng() % 80) - 8, y = int32_t(rng() % 60) - 6;
+            const PixelRect r{ x, y, x + 1 + int32_t(rng() % 20), y + 1 + int32_t(rng() % 20) };
+            added.push_back(r);
+            if (rng() % 4 == 0) d.AddMove(0, 0, r);
+            else d.AddDirty(r);
+        }
+        d.Finalize(1 + rng() % 6, 0.95f);
+        if (d.IsFull()) continue;
+        for (int32_t y = 0; y < h; ++y)
+        {
+            for (int32_t x = 0; x < w; ++x)
+            {
+                if (Covered(added, x, y)) ASSERT_TRUE(Covered(d.Rects(), x, y)) << "round " << round;
+            }
+        }
+        for (const PixelRect& r : d.Rects())
+        {
+            EXPECT_FALSE(r.Empty());
+            EXPECT_TRUE(r.left >= 0 && r.top >= 0 && r.right <= w && r.bottom <= h);
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#include "EffectCompiler.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <random>
+
+// EffectWindow::UpdateCBs_ repacks the color-map table only when the settings
+// generation moves and uploads it only when its bytes differ; the flags are
+// repacked on every settings or invert change. These pin down what that relies on.
+
+namespace {
+    EffectSettings RandomSettings(std::mt19937& rng, uint32_t maps)
+    {
+        EffectSettings s;
+        s.isInvertEffectEnabled = rng() % 2 != 0;
+        s.isCustomEffectActive = rng() % 2 != 0;
+        for (float& v : s.colorMat) v = float(int(rng() % 200) - 100) / 100.0f;
+        s.isColorMappingEnabled = rng() % 4 != 0;
+        s.colorMapPreserveBrightness = rng() % 2 != 0;
+        for (uint32_t i = 0; i < maps; ++i)
+        {
+            ColorMapEntry e;
+            e.enabled = rng() % 5 != 0;
+            e.srcR = uint8_t(rng()); e.srcG = uint8_t(rng()); e.srcB = uint8_t(rng());
+            e.dstR = uint8_t(rng()); e.dstG = uint8_t(rng()); e.dstB = uint8_t(rng());
+            e.tolerance = int(rng() % 300) - 20;
+            s.colorMaps.push_back(e);
+        }
+        return s;
+    }
+
+    template <typename T>
+    T Filled(uint8_t byte)
+    {
+        T v;
+        memset(&v, byte, sizeof(v));
+        return v;
+    }
+}
+
+TEST(EffectCompiler, ColorMapTableIsInListOrderInShaderUnits)
+{
+    EffectSettings s;
+    for (int i = 0; i < 5; ++i)
+    {
+        ColorMapEntry e;
+        e.enabled = i != 2;
+        e.srcR = uint8_t(10 * i); e.srcG = 255; e.srcB = 0;
+        e.dstR = 0; e.dstG = uint8_t(20 * i); e.dstB = 51;
+        e.tolerance = i == 4 ? 400 : 51;
+        s.colorMaps.push_back(e);
+    }
+    ColorMapCB cb = Filled<ColorMapCB>(0xAB);
+    const ColorMapPacking p = PackColorMaps(s, cb);
+    EXPECT_EQ(p.packed, 4u);
+    EXPECT_EQ(p.enabled, 4u);
+
+    const int sources[] = { 0, 1, 3, 4 };  // entry 2 is disabled
+    for (uint32_t slot = 0; slot < p.packed; ++slot)
+    {
+        const int i = sources[slot];
+        EXPECT_FLOAT_EQ(cb.colorMapSrc[slot][0], 10 * i / 255.0f);
+        EXPECT_FLOAT_EQ(cb.colorMapSrc[slot][1], 1.0f);
+        EXPECT_FLOAT_EQ(cb.colorMapSrc[slot][3], i == 4 ? 1.0f : 0.04f);  // tolerance^2, clamped to 255
+        EXPECT_FLOAT_EQ(cb.colorMapDst[slot][1], 20 * i / 255.0f);
+        EXPECT_FLOAT_EQ(cb.colorMapDst[slot][2], 0.2f);
+        EXPECT_EQ(cb.colorMapDst[slot][3], 0.0f);
+    }
+}
+
+TEST(EffectCompiler, EqualMapsPackToEqualBytes)
+{
+    // The upload is skipped on a bytewise match, so stale slots must not leak in
+    std::mt19937 rng(21);
+    for (int round = 0; round < 200; ++round)
+    {
+        const EffectSettings s = RandomSettings(rng, rng() % 80);
+        ColorMapCB a = Filled<ColorMapCB>(0x00);
+        ColorMapCB b = Filled<ColorMapCB>(0xCD);
+        const ColorMapPacking pa = PackColorMaps(s, a);
+        const ColorMapPacking pb = PackColorMaps(s, b);
+        ASSERT_EQ(pa.packed, pb.packed);
+        ASSERT_EQ(memcmp(&a, &b, sizeof(a)), 0) << "round " << round;
+
+        // Settings that leave the maps alone pack the same table
+        EffectSettings other = s;
+        other.isInvertEffectEnabled = !s.isInvertEffectEnabled;
+        other.isCustomEffectActive = !s.isCustomEffectActive;
+        other.lumaWeights[0] = 0.5f;
+        ColorMapCB c = Filled<ColorMapCB>(0x11);
+        PackColorMaps(other, c);
+        ASSERT_EQ(memcmp(&a, &c, sizeof(a)), 0) << "round " << round;
+    }
+}
+
+TEST(EffectCompiler, OverflowPacksTheFirstEnabledEntries)
+{
+    EffectSettings s;
+    for (uint32_t i = 0; i < kMaxColorMaps + 36; ++i)
+    {
+        ColorMapEntry e;
+        e.srcR = uint8_t(i);
+        s.colorMaps.push_back(e);
+    }
+    s.colorMaps[0].enabled = false;
+    ColorMapCB cb{};
+    const ColorMapPacking p = PackColorMaps(s, cb);
+    EXPECT_EQ(p.packed, kMaxColorMaps);
+    EXPECT_EQ(p.enabled, kMaxColorMaps + 35);
+    EXPECT_FLOAT_EQ(cb.colorMapSrc[0][0], 1 / 255.0f);
+    EXPECT_FLOAT_EQ(cb.colorMapSrc[kMaxColorMaps - 1][0], kMaxColorMaps / 255.0f);
+}
+
+TEST(EffectCompiler, PixelFlagsLeaveTheTableAlone)
+{
+    std::mt19937 rng(7);
+    for (int round = 0; round < 200; ++round)
+    {
+        const EffectSettings s = RandomSettings(rng, rng() % 20);
+        const bool invert = rng() % 2 != 0;
+        const CompiledEffect fx = CompileEffectSettings(s, invert);
+
+        PixelCB a = Filled<PixelCB>(0x00);
+        PixelCB b = Filled<PixelCB>(0xEE);
+        PackPixelFlags(s, fx, 3, a);
+        PackPixelFlags(s, fx, 3, b);
+        // Every flag byte is written, so an unchanged state compares equal...
+        ASSERT_EQ(memcmp(&a, &b, kPixelFlagsBytes), 0) << "round " << round;
+        // ...and nothing past the flags is touched
+        const PixelCB untouched = Filled<PixelCB>(0xEE);
+        ASSERT_EQ(memcmp(reinterpret_cast<const uint8_t*>(&b) + kPixelFlagsBytes,
+            reinterpret_cast<const uint8_t*>(&untouched) + kPixelFlagsBytes, sizeof(PixelCB) - kPixelFlagsBytes), 0);
+
+        EXPECT_EQ(a.enableInvert, 0u);
+        EXPECT_EQ(a.enableMatrix, fx.hasAffine ? 1u : 0u);
+        EXPECT_EQ(a.colorMapCount, fx.hasColorMap ? 3u : 0u);
+        EXPECT_EQ(a.useColorLut, 0u);
+    }
+}
+
+TEST(EffectCompiler, InvertFlipChangesOnlyTheFlags)
+{
+    EffectSettings s;
+    s.isColorMappingEnabled = true;
+    s.colorMaps.resize(8);
+    ColorMapCB before{}, after{};
+    PixelCB on{}, off{};
+    const ColorMapPacking p = PackColorMaps(s, before);
+    PackPixelFlags(s, CompileEffectSettings(s, true), p.packed, on);
+    PackPixelFlags(s, CompileEffectSettings(s, false), p.packed, off);
+    PackColorMaps(s, after);
+    EXPECT_NE(memcmp(&on, &off, kPixelFlagsBytes), 0);
+    EXPECT_EQ(memcmp(&before, &after, sizeof(before)), 0);
+    EXPECT_EQ(on.enableMatrix, 1u);
+    EXPECT_EQ(off.enableMatrix, 0u);
+    EXPECT_EQ(on.colorMapCount, 8u);
+}
@@ -0,0 +1,179 @@
+#include "EffectKernelSimd.h"
+#include "EffectCompiler.h"
+#include "EffectKernel.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every vector path must produce the bytes EffectKernel::ShadePixel + ToUnorm8
+// produce. ISAs this CPU lacks fall back to the best one it has, so they are
+// still run (and still must match).
+namespace {
+    const KernelIsa kIsas[] = { KernelIsa::Scalar, KernelIsa::SSE41, KernelIsa::AVX2, KernelIsa::AVX512, KernelIsa::NEON };
+
+    struct Case
+    {
+        std::string name;
+        PixelCB cb;
+    };
+
+    PixelCB Constants(bool invert, const float* mat, const float* offset)
+    {
+        PixelCB cb{};
+        cb.enableInvert = invert ? 1u : 0u;
+        cb.enableMatrix = mat ? 1u : 0u;
+        const float identity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+        memcpy(cb.colorMat, mat ? mat : identity, sizeof(cb.colorMat));
+        if (offset) memcpy(cb.colorOffset, offset, 3 * sizeof(float));
+        return cb;
+    }
+
+    std::vector<Case> Cases()
+    {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        const float inf = std::numeric_limits<float>::infinity();
+        const float identity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+        const float sepia[16] = { 0.393f,0.769f,0.189f,0, 0.349f,0.686f,0.168f,0, 0.272f,0.534f,0.131f,0, 0,0,0,1 };
+        const float offset[3] = { 0.05f, -0.1f, 0.2f };
+        // Results far outside [0,1] must saturate the same way everywhere
+        const float huge[16] = { 7.5f,-3.25f,2.0f,-1.5f, -9.0f,4.0f,0.5f,2.5f, 0.1f,-0.2f,12.0f,-6.0f, 0,0,0,1 };
+        const float withNan[16] = { nan,0,0,0, 0,1,nan,0, 0,0,1,nan, 0,0,0,1 };
+        const float withInf[16] = { inf,0,0,0, 0,-inf,0,0, 0,0,1,inf, 0,0,0,1 };
+
+        std::vector<Case> cases;
+        for (bool invert : { false, true })
+        {
+            const std::string inv = invert ? "invert_" : "";
+            cases.push_back({ inv + "passthrough", Constants(invert, nullptr, nullptr) });
+            cases.push_back({ inv + "identity_matrix", Constants(invert, identity, nullptr) });
+            cases.push_back({ inv + "sepia", Constants(invert, sepia, offset) });
+            cases.push_back({ inv + "out_of_range", Constants(invert, huge, offset) });
+            cases.push_back({ inv + "nan", Constants(invert, withNan, nullptr) });
+            cases.push_back({ inv + "inf", Constants(invert, withInf, nullptr) });
+        }
+
+        // The constants UpdateCBs_ uploads: invert folded into the matrix, and an
+        // identity custom matrix elided entirely
+        for (bool invert : { false, true })
+        {
+            EffectSettings s;
+            s.isCustomEffectActive = true;
+            PixelCB cb{};
+            PackPixelFlags(s, CompileEffectSettings(s, invert), 0, cb);
+            cases.push_back({ std::string("compiled_identity") + (invert ? "_invert" : ""), cb });
+        }
+        return cases;
+    }
+
+    std::vector<uint8_t> Reference(const EffectKernel& kernel, const std::vector<uint8_t>& src, size_t pitch, uint32_t width, uint32_t height)
+    {
+        std::vector<uint8_t> out(src.size(), 0xCC);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                const uint8_t* s = &src[y * pitch + x * 4];
+                uint8_t* d = &out[y * pitch + x * 4];
+                const float in[3] = { float(s[2]) / 255.0f, float(s[1]) / 255.0f, float(s[0]) / 255.0f };
+                float shaded[3];
+                kernel.ShadePixel(in, shaded);
+                d[0] = EffectKernel::ToUnorm8(shaded[2]);
+                d[1] = EffectKernel::ToUnorm8(shaded[1]);
+                d[2] = EffectKernel::ToUnorm8(shaded[0]);
+                d[3] = 255;
+            }
+        }
+        return out;
+    }
+}
+
+TEST(EffectKernelSimd, EveryIsaMatchesShadePixel)
+{
+    RecordProperty("best_isa", KernelIsaName(DetectKernelIsa()));
+    std::mt19937 rng(2);
+    // Tails of every length for 4/8/16-pixel vectors, plus a full row
+    std::vector<uint32_t> widths;
+    for (uint32_t w = 1; w <= 40; ++w) widths.push_back(w);
+    widths.push_back(1923);
+
+    for (const Case& c : Cases())
+    {
+        EffectKernel kernel(c.cb);
+        const AffineParams params = AffineParamsFromConstants(c.cb);
+        for (uint32_t width : widths)
+        {
+            const uint32_t height = width > 100 ? 2 : 3;
+            const size_t pitch = size_t(width) * 4 + 12;  // padded rows
+            std::vector<uint8_t> src(pitch * height);
+            for (uint8_t& b : src) b = uint8_t(rng());
+            const std::vector<uint8_t> want = Reference(kernel, src, pitch, width, height);
+
+            for (KernelIsa isa : kIsas)
+            {
+                std::vector<uint8_t> dst(src.size(), 0xCC);
+                ProcessAffineBGRA8(params, src.data(), pitch, dst.data(), pitch, width, height, isa);
+                for (uint32_t y = 0; y < height; ++y)
+                {
+                    // Only the pixels are written; the row padding is untouched
+                    ASSERT_EQ(memcmp(&dst[y * pitch], &want[y * pitch], pitch), 0)
+                        << c.name << " " << KernelIsaName(isa) << " width " << width << " row " << y;
+                }
+            }
+        }
+    }
+}
+
+TEST(EffectKernelSimd, EveryChannelValueInPlace)
+{
+    // All 256 levels on each channel, processed in place (src == dst)
+    std::vector<uint8_t> ramp(256 * 3 * 4);
+    for (uint32_t i = 0; i < 256 * 3; ++i)
+    {
+        uint8_t* p = &ramp[i * 4];
+        p[0] = p[1] = p[2] = uint8_t(255 - i % 256);
+        p[i / 256] = uint8_t(i % 256);
+        p[3] = 0;
+    }
+    const uint32_t width = uint32_t(ramp.size() / 4);
+    for (const Case& c : Cases())
+    {
+        EffectKernel kernel(c.cb);
+        const std::vector<uint8_t> want = Reference(kernel, ramp, ramp.size(), width, 1);
+        for (KernelIsa isa : kIsas)
+        {
+            std::vector<uint8_t> buf = ramp;
+            ProcessAffineBGRA8(AffineParamsFromConstants(c.cb), buf.data(), buf.size(), buf.data(), buf.size(), width, 1, isa);
+            ASSERT_EQ(buf, want) << c.name << " " << KernelIsaName(isa);
+        }
+    }
+}
+
+TEST(EffectKernelSimd, SettingsPathMatchesConstantsPath)
+{
+    EffectSettings s;
+    s.isInvertEffectEnabled = true;
+    s.isCustomEffectActive = true;
+    const float sepia[16] = { 0.393f,0.769f,0.189f,0.01f, 0.349f,0.686f,0.168f,0, 0.272f,0.534f,0.131f,-0.02f, 0,0,0,1 };
+    memcpy(s.colorMat, sepia, sizeof(sepia));
+    s.colorOffset[1] = 0.03f;
+
+    PixelCB cb{};
+    cb.enableInvert = 1;
+    cb.enableMatrix = 1;
+    memcpy(cb.colorMat, s.colorMat, sizeof(cb.colorMat));
+    memcpy(cb.colorOffset, s.colorOffset, sizeof(cb.colorOffset));
+    const EffectKernel kernel(cb);
+
+    std::mt19937 rng(5);
+    const uint32_t width = 77;
+    std::vector<uint8_t> src(width * 4);
+    for (uint8_t& b : src) b = uint8_t(rng());
+    const std::vector<uint8_t> want = Reference(kernel, src, src.size(), width, 1);
+    std::vector<uint8_t> dst(src.size());
+    ProcessAffineBGRA8(AffineParamsFromSettings(s), src.data(), src.size(), dst.data(), dst.size(), width, 1);
+    EXPECT_EQ(dst, want);
+}
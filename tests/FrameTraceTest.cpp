@@ -0,0 +1,114 @@
+#include "FrameTrace.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace winvert4::frametrace;
+
+namespace {
+    void RecordOn(Recorder& rec, const char* name, int events)
+    {
+        rec.SetThreadName(name);
+        for (int i = 0; i < events; ++i) rec.Record(Stage::Render, 100 + i, 150 + i, uint64_t(i));
+    }
+}
+
+TEST(FrameTrace, NothingAllocatedWhileDisabled)
+{
+    Recorder rec(64);
+    std::thread([&] { RecordOn(rec, "idle", 10); }).join();
+    EXPECT_TRUE(rec.Snapshot().threads.empty());
+}
+
+TEST(FrameTrace, ExitedThreadsRecycleTheirRing)
+{
+    Recorder rec(64);
+    rec.SetEnabled(true);
+    for (int i = 0; i < 50; ++i)
+    {
+        std::thread([&] { RecordOn(rec, "DT 0", 3); }).join();
+    }
+    const TraceData data = rec.Snapshot();
+    ASSERT_EQ(data.threads.size(), 1u);
+    EXPECT_EQ(data.threads[0].name, "DT 0");
+    EXPECT_EQ(data.threads[0].written, 3u);
+}
+
+TEST(FrameTrace, LiveThreadsGetSeparateRings)
+{
+    Recorder rec(64);
+    rec.SetEnabled(true);
+    RecordOn(rec, "main", 1);
+    std::thread([&] { RecordOn(rec, "A", 2); }).join();
+    std::thread([&] { RecordOn(rec, "B", 4); }).join();
+    const TraceData data = rec.Snapshot();
+    // "A" exited before "B" started, so "B" took over its ring
+    ASSERT_EQ(data.threads.size(), 2u);
+    EXPECT_EQ(data.threads[0].name, "main");
+    EXPECT_EQ(data.threads[1].name, "B");
+    EXPECT_EQ(data.threads[1].written, 4u);
+}
+
+TEST(FrameTrace, AlternatingRecordersKeepOneRingEach)
+{
+    Recorder a(64), b(64);
+    a.SetEnabled(true);
+    b.SetEnabled(true);
+    std::thread([&] {
+        for (int i = 0; i < 100; ++i)
+        {
+            a.Record(Stage::Present, 1, 2);
+            b.Record(Stage::Present, 1, 2);
+        }
+    }).join();
+    ASSERT_EQ(a.Snapshot().threads.size(), 1u);
+    ASSERT_EQ(b.Snapshot().threads.size(), 1u);
+    EXPECT_EQ(a.Snapshot().threads[0].written, 100u);
+}
+
+TEST(FrameTrace, ThreadOutlivesRecorder)
+{
+    auto rec = std::make_unique<Recorder>(64);
+    rec->SetEnabled(true);
+    rec->Record(Stage::Acquire, 1, 2);
+    // The thread's slot still references the rings; releasing them on exit is safe
+    std::thread t([&] { RecordOn(*rec, "T", 1); rec.reset(); });
+    t.join();
+    EXPECT_EQ(rec, nullptr);
+}
+
+TEST(FrameTrace, RingKeepsNewestEvents)
+{
+    Recorder rec(8);
+    rec.SetEnabled(true);
+    std::thread([&] { RecordOn(rec, "W", 20); }).join();
+    const TraceData data = rec.Snapshot();
+    ASSERT_EQ(data.threads.size(), 1u);
+    EXPECT_EQ(data.threads[0].written, 20u);
+    ASSERT_EQ(data.events.size(), 8u);
+    EXPECT_EQ(data.events.front().arg, 12u);
+    EXPECT_EQ(data.events.back().arg, 19u);
+}
+
+TEST(FrameTrace, BinaryRoundTripAndChromeJson)
+{
+    Recorder rec(64);
+    rec.SetEnabled(true);
+    std::thread([&] { RecordOn(rec, "UI", 5); }).join();
+    const TraceData data = rec.Snapshot();
+
+    std::vector<uint8_t> bytes;
+    WriteBinary(data, bytes);
+    TraceData back;
+    ASSERT_TRUE(ReadBinary(bytes.data(), bytes.size(), back));
+    ASSERT_EQ(back.threads.size(), 1u);
+    EXPECT_EQ(back.threads[0].name, "UI");
+    ASSERT_EQ(back.events.size(), 5u);
+    EXPECT_EQ(back.events[4].beginNs, 104u);
+    EXPECT_EQ(back.events[4].durationNs, 50u);
+    EXPECT_FALSE(ReadBinary(bytes.data(), bytes.size() - 1, back));
+
+    std::string json;
+    ExportChromeJson(data, json);
+    EXPECT_NE(json.find("\"UI\""), std::string::npos);
+    EXPECT_NE(json.find(StageName(Stage::Render)), std::string::npos);
+}
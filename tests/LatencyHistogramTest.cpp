@@ -0,0 +1,114 @@
+#include "LatencyHistogram.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+using winvert4::LatencyHistogram;
+
+namespace {
+    constexpr uint64_t kMs = 1000000;
+
+    // Same rank rule as Summarize
+    double ExactMs(const std::vector<uint64_t>& sortedNs, double q)
+    {
+        const size_t rank = std::max<size_t>(1, size_t(q * double(sortedNs.size()) + 0.5));
+        return double(sortedNs[rank - 1]) / 1e6;
+    }
+}
+
+TEST(LatencyHistogram, BucketsAreContiguousAndNarrow)
+{
+    uint32_t prev = 0;
+    for (uint64_t us = 0; us < (uint64_t(1) << 24); us = us < 4096 ? us + 1 : us + us / 97)
+    {
+        const uint32_t b = LatencyHistogram::BucketOf(us);
+        ASSERT_GE(b, prev) << us;
+        prev = b;
+        ASSERT_LE(LatencyHistogram::BucketLowUs(b), us);
+        if (b + 1 < LatencyHistogram::kBuckets)
+        {
+            const uint64_t hi = LatencyHistogram::BucketLowUs(b + 1);
+            ASSERT_GT(hi, us);
+            // One sub-bucket is at most 1/16 of its octave's base
+            if (us >= 2 * LatencyHistogram::kSubBuckets) ASSERT_LE(double(hi - LatencyHistogram::BucketLowUs(b)), double(us) / 16.0 + 1e-9);
+        }
+    }
+    EXPECT_EQ(LatencyHistogram::BucketOf(UINT64_MAX / 1000), LatencyHistogram::kBuckets - 1);
+}
+
+// Quantiles come from bucket midpoints: within half a bucket, about 3.2%, of the
+// exact sample quantile (plus the microsecond truncation)
+TEST(LatencyHistogram, QuantileErrorWithinBound)
+{
+    std::mt19937_64 rng(17);
+    std::lognormal_distribution<double> frameLike(std::log(8.0), 0.5);     // ms
+    std::uniform_real_distribution<double> uniform(0.05, 50.0);            // ms
+    std::exponential_distribution<double> tail(1.0 / 3.0);                 // ms
+    const std::vector<std::function<double()>> shapes = {
+        [&] { return frameLike(rng); },
+        [&] { return uniform(rng); },
+        [&] { return (rng() % 10 == 0) ? 30.0 + tail(rng) : 4.0 + tail(rng) / 10.0; },  // bimodal
+    };
+    for (size_t shape = 0; shape < shapes.size(); ++shape)
+    {
+        LatencyHistogram h;
+        std::vector<uint64_t> values;
+        for (int i = 0; i < 100000; ++i)
+        {
+            const uint64_t ns = uint64_t(shapes[shape]() * 1e6);
+            values.push_back(ns);
+            h.Record(ns, 5 * kMs);
+        }
+        std::sort(values.begin(), values.end());
+        const LatencyHistogram::Summary s = h.Summarize(5 * kMs);
+        EXPECT_EQ(s.count, values.size());
+        EXPECT_DOUBLE_EQ(s.maxMs, double(values.back()) / 1e6);
+        const struct { double q, got; } checks[] = { { 0.50, s.p50Ms }, { 0.90, s.p90Ms }, { 0.99, s.p99Ms } };
+        for (const auto& c : checks)
+        {
+            const double exact = ExactMs(values, c.q);
+            EXPECT_NEAR(c.got, exact, exact * 0.032 + 0.001) << "shape " << shape << " q " << c.q;
+        }
+    }
+}
+
+TEST(LatencyHistogram, WindowSlidesOverSlices)
+{
+    LatencyHistogram h(100 * kMs);  // 1 s window of 100 ms slices
+    for (int slice = 0; slice < 10; ++slice) h.Record(uint64_t(slice + 1) * kMs, uint64_t(slice) * 100 * kMs + 1);
+    EXPECT_EQ(h.Summarize(999 * kMs).count, 10u);
+    EXPECT_EQ(h.Summarize(999 * kMs, 3).count, 3u);
+    EXPECT_NEAR(h.Summarize(999 * kMs, 1).maxMs, 10.0, 1e-9);
+
+    // Half a window later the oldest five slices have aged out
+    EXPECT_EQ(h.Summarize(1499 * kMs).count, 5u);
+    EXPECT_NEAR(h.Summarize(1499 * kMs).p50Ms, 8.0, 8.0 * 0.032);
+    // Recording reuses the slice that held slice 0
+    h.Record(50 * kMs, 1000 * kMs + 1);
+    EXPECT_EQ(h.Summarize(1000 * kMs + 1).count, 10u);
+    // A late sample for a period whose slice was already reused is dropped
+    h.Record(kMs, 1);
+    EXPECT_EQ(h.Summarize(1000 * kMs + 1).count, 10u);
+
+    h.Clear();
+    EXPECT_EQ(h.Summarize(1000 * kMs + 1).count, 0u);
+}
+
+TEST(LatencyHistogram, ConcurrentWritersLoseNothingWithinASlice)
+{
+    LatencyHistogram h;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+    {
+        writers.emplace_back([&h, t] {
+            for (int i = 0; i < 50000; ++i) h.Record(uint64_t(1 + (i + t) % 40) * kMs, 5 * kMs);
+        });
+    }
+    for (auto& w : writers) w.join();
+    const LatencyHistogram::Summary s = h.Summarize(5 * kMs);
+    EXPECT_EQ(s.count, 200000u);
+    EXPECT_DOUBLE_EQ(s.maxMs, 40.0);
+}
@@ -0,0 +1,144 @@
+#include "Metrics.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using namespace winvert4::metrics;
+
+namespace {
+    std::vector<uint64_t> ExportMemory(uint32_t capacity)
+    {
+        return std::vector<uint64_t>(Exporter::RequiredBytes(capacity) / sizeof(uint64_t));
+    }
+
+    const MappedEntry* FindEntry(const std::vector<MappedEntry>& entries, const char* name)
+    {
+        for (const MappedEntry& e : entries)
+        {
+            if (std::strcmp(e.name, name) == 0) return &e;
+        }
+        return nullptr;
+    }
+}
+
+TEST(Metrics, SameNameSameMetric)
+{
+    Registry registry;
+    Counter& a = registry.GetCounter("c");
+    a.Add(3);
+    EXPECT_EQ(&registry.GetCounter("c"), &a);
+    EXPECT_EQ(registry.GetCounter("c").Value(), 3u);
+    EXPECT_EQ(registry.Size(), 1u);
+}
+
+TEST(Metrics, RemovePrefixDropsOnlyThatObject)
+{
+    Registry registry;
+    registry.GetCounter("window.1.rendered").Add(5);
+    registry.GetGauge("window.1.gpu_ms").Set(2.0);
+    registry.GetCounter("window.10.rendered");
+    registry.GetHistogram("outputs.latency_ns");
+    EXPECT_EQ(registry.RemovePrefix("window.1."), 2u);
+    EXPECT_EQ(registry.Size(), 2u);
+    // A new owner starts a fresh series
+    EXPECT_EQ(registry.GetCounter("window.1.rendered").Value(), 0u);
+}
+
+TEST(Metrics, ExportReportsOverflowOnce)
+{
+    Registry registry;
+    for (int i = 0; i < 6; ++i) registry.GetCounter("c." + std::to_string(i));
+    auto memory = ExportMemory(4);
+    const size_t bytes = memory.size() * sizeof(uint64_t);
+
+    int reports = 0;
+    size_t reported = 0;
+    Exporter exporter;
+    ASSERT_TRUE(exporter.Start(registry, memory.data(), bytes, 60000,
+        [&](size_t registered, uint32_t capacity) { ++reports; reported = registered; EXPECT_EQ(capacity, 4u); }));
+    exporter.ExportNow();
+    exporter.ExportNow();
+    exporter.Stop();
+    EXPECT_EQ(reports, 1);
+    EXPECT_EQ(reported, 6u);
+
+    uint64_t ts = 0;
+    std::vector<MappedEntry> entries;
+    ASSERT_TRUE(ReadMapped(memory.data(), bytes, ts, entries));
+    EXPECT_EQ(entries.size(), 4u);
+    EXPECT_EQ(static_cast<const MappedHeader*>(static_cast<void*>(memory.data()))->dropped, 2u);
+}
+
+TEST(Metrics, MappedRoundTrip)
+{
+    Registry registry;
+    registry.GetCounter("frames").Add(7);
+    registry.GetGauge("hz").Set(143.5);
+    Histogram& h = registry.GetHistogram("lat");
+    const uint64_t now = NowNs();
+    for (int i = 1; i <= 100; ++i) h.Record(uint64_t(i) * 100000, now);
+
+    auto memory = ExportMemory(8);
+    const size_t bytes = memory.size() * sizeof(uint64_t);
+    uint64_t ts = 0;
+    std::vector<MappedEntry> entries;
+    EXPECT_FALSE(ReadMapped(memory.data(), bytes, ts, entries));
+
+    Exporter exporter;
+    ASSERT_TRUE(exporter.Start(registry, memory.data(), bytes, 60000));
+    exporter.Stop();
+    ASSERT_TRUE(ReadMapped(memory.data(), bytes, ts, entries));
+    ASSERT_EQ(entries.size(), 3u);
+    ASSERT_NE(FindEntry(entries, "frames"), nullptr);
+    EXPECT_EQ(FindEntry(entries, "frames")->value, 7.0);
+    EXPECT_EQ(FindEntry(entries, "hz")->value, 143.5);
+    const MappedEntry* lat = FindEntry(entries, "lat");
+    ASSERT_NE(lat, nullptr);
+    EXPECT_EQ(lat->count, 100u);
+    EXPECT_GT(lat->p99Ms, lat->p50Ms);
+}
+
+// The reader must never return a half-written snapshot: every copy it accepts
+// holds all entries, and a counter only bumped between exports never goes back.
+TEST(Metrics, SeqlockReaderSeesWholeSnapshots)
+{
+    Registry registry;
+    Counter& c = registry.GetCounter("ticks");
+    for (int i = 0; i < 30; ++i) registry.GetGauge("g." + std::to_string(i)).Set(i);
+    auto memory = ExportMemory(64);
+    const size_t bytes = memory.size() * sizeof(uint64_t);
+
+    Exporter exporter;
+    ASSERT_TRUE(exporter.Start(registry, memory.data(), bytes, 1));
+    std::atomic<bool> stop{ false };
+    std::thread writer([&] {
+        while (!stop.load())
+        {
+            c.Add();
+            exporter.ExportNow();
+        }
+    });
+
+    uint64_t lastTicks = 0, lastTs = 0;
+    int accepted = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        uint64_t ts = 0;
+        std::vector<MappedEntry> entries;
+        if (!ReadMapped(memory.data(), bytes, ts, entries)) continue;
+        ++accepted;
+        ASSERT_EQ(entries.size(), 31u);
+        const MappedEntry* ticks = FindEntry(entries, "ticks");
+        ASSERT_NE(ticks, nullptr);
+        EXPECT_GE(uint64_t(ticks->value), lastTicks);
+        EXPECT_GE(ts, lastTs);
+        lastTicks = uint64_t(ticks->value);
+        lastTs = ts;
+    }
+    stop = true;
+    writer.join();
+    exporter.Stop();
+    EXPECT_GT(accepted, 0);
+}
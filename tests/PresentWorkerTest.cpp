@@ -0,0 +1,67 @@
+#include "PresentWorker.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using winvert4::PresentWorker;
+
+// The producer writes the back buffer and submits under the frame lock; every
+// present must see a finished frame, never the same one twice, and the last
+// frame submitted must reach the screen
+TEST(PresentWorker, PresentsOnlyFinishedFramesAndCoalesces)
+{
+    std::mutex frameMutex;
+    int backBuffer = 0, lastShown = 0;
+    bool writing = false;
+    int torn = 0, repeats = 0;
+
+    PresentWorker worker;
+    PresentWorker::Callbacks cb;
+    cb.waitReady = [] { std::this_thread::sleep_for(std::chrono::microseconds(300)); };
+    cb.present = [&] {
+        if (writing || backBuffer == 0) ++torn;
+        if (backBuffer == lastShown) ++repeats;
+        lastShown = backBuffer;
+    };
+    cb.frameMutex = &frameMutex;
+    worker.Start(cb, "present test");
+    EXPECT_TRUE(worker.IsRunning());
+
+    constexpr int kFrames = 5000;
+    for (int f = 1; f <= kFrames; ++f)
+    {
+        std::lock_guard<std::mutex> lk(frameMutex);
+        writing = true;
+        backBuffer = f;
+        writing = false;
+        worker.Submit();
+    }
+    worker.WaitIdle();
+    worker.Stop();
+    EXPECT_FALSE(worker.IsRunning());
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(repeats, 0);
+    EXPECT_EQ(lastShown, kFrames);
+    EXPECT_EQ(worker.Submitted(), uint64_t(kFrames));
+    EXPECT_EQ(worker.Presented() + worker.Coalesced(), worker.Submitted());
+    EXPECT_GT(worker.Coalesced(), 0u);  // a slow present drops intermediate frames
+}
+
+TEST(PresentWorker, StopFinishesPendingPresent)
+{
+    std::atomic<int> presents{ 0 };
+    PresentWorker worker;
+    PresentWorker::Callbacks cb;
+    cb.present = [&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ++presents;
+    };
+    worker.Start(cb);
+    EXPECT_TRUE(worker.Submit());
+    worker.Stop();
+    EXPECT_EQ(presents.load(), 1);
+    EXPECT_EQ(worker.Presented(), 1u);
+}
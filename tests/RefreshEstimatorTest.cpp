@@ -0,0 +1,126 @@
+#include "RefreshEstimator.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using winvert4::RefreshEstimator;
+
+namespace {
+    // Feeds presents at the given intervals (ms) on a QPC-like 10 MHz clock
+    struct Trace
+    {
+        static constexpr uint64_t kTicksPerSecond = 10000000;
+        RefreshEstimator estimator;
+        uint64_t ticks{ 1000 };
+
+        explicit Trace(float nominalHz) : estimator(kTicksPerSecond, nominalHz) {}
+
+        void Add(double ms, uint32_t accumulated = 1)
+        {
+            ticks += uint64_t(ms * kTicksPerSecond / 1000.0 + 0.5);
+            estimator.AddPresent(ticks, accumulated);
+        }
+    };
+}
+
+TEST(RefreshEstimator, InvalidUntilEnoughSamples)
+{
+    Trace t(60.0f);
+    t.Add(0);  // first present only sets the time base
+    for (uint32_t i = 0; i + 1 < RefreshEstimator::kMinSamples; ++i) t.Add(16.667);
+    EXPECT_FALSE(t.estimator.Get().valid);
+    t.Add(16.667);
+    EXPECT_TRUE(t.estimator.Get().valid);
+}
+
+TEST(RefreshEstimator, FixedRefreshWithJitterAndSkippedVblanks)
+{
+    Trace t(144.0f);
+    std::mt19937 rng(1);
+    std::normal_distribution<double> jitter(0.0, 0.08);
+    const double period = 1000.0 / 144.0;
+    t.Add(0);
+    for (int i = 0; i < 300; ++i) t.Add(period * ((i % 7 == 3) ? 2 : 1) + jitter(rng));
+    const RefreshEstimator::Estimate e = t.estimator.Get();
+    ASSERT_TRUE(e.valid);
+    EXPECT_FALSE(e.variable);
+    EXPECT_NEAR(e.hz, 144.0f, 0.5f);
+    EXPECT_NEAR(e.effectiveHz, 144.0f, 2.0f);
+    EXPECT_EQ(e.samples, RefreshEstimator::kWindow);
+}
+
+TEST(RefreshEstimator, SlowContentOnFixedPanel)
+{
+    // A 30 fps video on a 60 Hz panel: every interval is two periods
+    Trace t(60.0f);
+    t.Add(0);
+    for (int i = 0; i < 64; ++i) t.Add(33.333);
+    const RefreshEstimator::Estimate e = t.estimator.Get();
+    EXPECT_FALSE(e.variable);
+    EXPECT_NEAR(e.hz, 60.0f, 0.3f);
+    EXPECT_NEAR(e.effectiveHz, 30.0f, 0.3f);
+}
+
+TEST(RefreshEstimator, PanelFasterThanModeClaims)
+{
+    Trace t(60.0f);
+    t.Add(0);
+    for (int i = 0; i < 64; ++i) t.Add(1000.0 / 75.0);
+    const RefreshEstimator::Estimate e = t.estimator.Get();
+    EXPECT_FALSE(e.variable);
+    EXPECT_NEAR(e.hz, 75.0f, 0.3f);
+}
+
+TEST(RefreshEstimator, VariableRefreshTrace)
+{
+    // Game-like frame times anywhere between the panel's 144 Hz and ~40 fps
+    Trace t(144.0f);
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<double> frameMs(7.0, 25.0);
+    t.Add(0);
+    for (int i = 0; i < 300; ++i) t.Add(frameMs(rng));
+    const RefreshEstimator::Estimate e = t.estimator.Get();
+    ASSERT_TRUE(e.valid);
+    EXPECT_TRUE(e.variable);
+    EXPECT_FLOAT_EQ(e.hz, 144.0f);
+    EXPECT_NEAR(e.effectiveHz, 1000.0f / 16.0f, 8.0f);
+}
+
+TEST(RefreshEstimator, SteadyVariableCadenceAgainstNominal)
+{
+    // 57.5 fps on a 144 Hz VRR panel: steady, but 2.5 periods apart. Measured
+    // alone it would look like a fixed 57.5 Hz panel.
+    Trace t(144.0f);
+    t.Add(0);
+    for (int i = 0; i < 64; ++i) t.Add(1000.0 / 57.5);
+    const RefreshEstimator::Estimate e = t.estimator.Get();
+    EXPECT_TRUE(e.variable);
+    EXPECT_FLOAT_EQ(e.hz, 144.0f);
+    EXPECT_NEAR(e.effectiveHz, 57.5f, 0.1f);
+
+    Trace unknownMode(0.0f);
+    unknownMode.Add(0);
+    for (int i = 0; i < 64; ++i) unknownMode.Add(1000.0 / 57.5);
+    EXPECT_FALSE(unknownMode.estimator.Get().variable);
+}
+
+TEST(RefreshEstimator, RejectsGapsCoalescingAndClockSteps)
+{
+    Trace t(60.0f);
+    t.Add(0);
+    for (int i = 0; i < 20; ++i) t.Add(16.667);
+    const uint64_t accepted = t.estimator.Accepted();
+    t.Add(500.0);        // desktop idled
+    t.Add(33.3, 2);      // two presents coalesced
+    t.Add(0.2);          // timer glitch
+    EXPECT_EQ(t.estimator.Accepted(), accepted);
+    EXPECT_EQ(t.estimator.Rejected(), 3u);
+    // Pointer-only updates carry no timestamp; a backwards clock is not measured
+    t.estimator.AddPresent(0, 1);
+    t.estimator.AddPresent(t.ticks - 100, 1);
+    EXPECT_EQ(t.estimator.Accepted(), accepted);
+    EXPECT_NEAR(t.estimator.Get().hz, 60.0f, 0.2f);
+
+    t.estimator.Reset(Trace::kTicksPerSecond, 60.0f);
+    EXPECT_FALSE(t.estimator.Get().valid);
+    EXPECT_EQ(t.estimator.Accepted(), 0u);
+}
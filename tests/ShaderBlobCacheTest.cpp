@@ -0,0 +1,170 @@
+#include "ShaderBlobCache.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace winvert4::shadercache;
+namespace fs = std::filesystem;
+
+namespace {
+    std::vector<uint8_t> Blob(uint32_t seed, size_t n)
+    {
+        std::vector<uint8_t> v(n);
+        for (size_t i = 0; i < n; ++i) v[i] = uint8_t(seed * 31 + i * 7);
+        return v;
+    }
+
+    class ShaderBlobCache : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+            m_dir = fs::temp_directory_path() / (std::string("wvsb_") + info->name());
+            fs::remove_all(m_dir);
+        }
+        void TearDown() override
+        {
+            std::error_code ec;
+            fs::remove_all(m_dir, ec);
+        }
+
+        void Overwrite(const fs::path& path, const std::vector<uint8_t>& bytes)
+        {
+            std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+        }
+
+        fs::path m_dir;
+        const uint64_t m_key = KeyBuilder().Add("src").Add("main").Add("ps_4_0").Add(uint64_t(1)).Key();
+    };
+}
+
+TEST_F(ShaderBlobCache, KeyFieldBoundariesMatter)
+{
+    EXPECT_NE(KeyBuilder().Add("src").Add("main").Key(), KeyBuilder().Add("srcm").Add("ain").Key());
+    EXPECT_NE(KeyBuilder().Add("a").Add(uint64_t(1)).Key(), KeyBuilder().Add("a").Add(uint64_t(2)).Key());
+    EXPECT_EQ(KeyBuilder().Add("x").Add(uint64_t(7)).Key(), KeyBuilder().Add("x").Add(uint64_t(7)).Key());
+}
+
+TEST_F(ShaderBlobCache, StoreThenLoad)
+{
+    BlobCache cache(m_dir);
+    std::vector<uint8_t> out;
+    EXPECT_EQ(cache.Load(m_key, out), LoadResult::Missing);
+    const auto b = Blob(1, 3000);
+    ASSERT_TRUE(cache.Store(m_key, b.data(), b.size()));
+    ASSERT_EQ(cache.Load(m_key, out), LoadResult::Hit);
+    EXPECT_EQ(out, b);
+    // A second instance over the same directory sees it: the cache survives restarts
+    EXPECT_EQ(BlobCache(m_dir).Load(m_key, out), LoadResult::Hit);
+
+    ASSERT_TRUE(cache.Store(m_key + 2, nullptr, 0));
+    ASSERT_EQ(cache.Load(m_key + 2, out), LoadResult::Hit);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST_F(ShaderBlobCache, CorruptFilesAreMissesAndRemoved)
+{
+    BlobCache cache(m_dir);
+    const auto b = Blob(2, 3000);
+    const fs::path path = cache.PathFor(m_key);
+    std::vector<uint8_t> file, out;
+    Encode(m_key, b.data(), b.size(), file);
+
+    struct Case { const char* what; std::vector<uint8_t> bytes; };
+    std::vector<Case> cases;
+    { auto f = file; f[sizeof(FileHeader) + 100] ^= 0x5a; cases.push_back({ "flipped payload byte", f }); }
+    { auto f = file; f.resize(1000); cases.push_back({ "truncated payload", f }); }
+    { auto f = file; f.resize(10); cases.push_back({ "short header", f }); }
+    { cases.push_back({ "empty file", {} }); }
+    { auto f = file; f[0] ^= 1; cases.push_back({ "bad magic", f }); }
+    { auto f = file; f.push_back(0); cases.push_back({ "trailing byte", f }); }
+    for (const Case& c : cases)
+    {
+        Overwrite(path, c.bytes);
+        EXPECT_EQ(cache.Load(m_key, out), LoadResult::Corrupt) << c.what;
+        EXPECT_FALSE(fs::exists(path)) << c.what;
+    }
+
+    // A valid blob copied under another key is not served
+    ASSERT_TRUE(cache.Store(m_key, b.data(), b.size()));
+    fs::copy_file(path, cache.PathFor(m_key + 1));
+    EXPECT_EQ(cache.Load(m_key + 1, out), LoadResult::Corrupt);
+    EXPECT_EQ(cache.Load(m_key, out), LoadResult::Hit);
+
+    // Recovery: the next store replaces a removed file
+    Overwrite(path, cases[0].bytes);
+    EXPECT_EQ(cache.Load(m_key, out), LoadResult::Corrupt);
+    ASSERT_TRUE(cache.Store(m_key, b.data(), b.size()));
+    EXPECT_EQ(cache.Load(m_key, out), LoadResult::Hit);
+}
+
+TEST_F(ShaderBlobCache, OtherFormatVersionIsRemoved)
+{
+    BlobCache cache(m_dir);
+    const auto b = Blob(3, 500);
+    std::vector<uint8_t> file, out;
+    Encode(m_key, b.data(), b.size(), file);
+    FileHeader h;
+    memcpy(&h, file.data(), sizeof(h));
+    h.version = kFormatVersion + 1;
+    memcpy(file.data(), &h, sizeof(h));
+    Overwrite(cache.PathFor(m_key), file);
+    EXPECT_EQ(cache.Load(m_key, out), LoadResult::VersionMismatch);
+    EXPECT_FALSE(fs::exists(cache.PathFor(m_key)));
+}
+
+// Writers race to store different blobs under one key while readers load: a load
+// is a hit with one complete blob or a miss, never a partial file, and no
+// temporaries are left behind
+TEST_F(ShaderBlobCache, ConcurrentWritersAndReaders)
+{
+    BlobCache cache(m_dir);
+    constexpr int kWriters = 3;
+    std::atomic<int> bad{ 0 }, hits{ 0 };
+    std::atomic<int> writersLeft{ kWriters };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kWriters; ++t)
+    {
+        threads.emplace_back([&, t] {
+            const auto v = Blob(t, 700 + 300 * t);
+            for (int i = 0; i < 200; ++i)
+            {
+                if (!BlobCache(m_dir).Store(m_key, v.data(), v.size())) ++bad;
+            }
+            --writersLeft;
+        });
+    }
+    for (int r = 0; r < 2; ++r)
+    {
+        threads.emplace_back([&] {
+            while (writersLeft.load() > 0)
+            {
+                std::vector<uint8_t> o;
+                const LoadResult res = cache.Load(m_key, o);
+                if (res == LoadResult::Hit)
+                {
+                    ++hits;
+                    bool known = false;
+                    for (int s = 0; s < kWriters; ++s) known |= o == Blob(s, 700 + 300 * s);
+                    if (!known) ++bad;
+                }
+                else if (res != LoadResult::Missing)
+                {
+                    ++bad;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(bad.load(), 0);
+
+    int leftovers = 0;
+    for (const auto& e : fs::directory_iterator(m_dir)) leftovers += e.path().extension() == ".tmp" ? 1 : 0;
+    EXPECT_EQ(leftovers, 0);
+    std::vector<uint8_t> out;
+    EXPECT_EQ(cache.Load(m_key, out), LoadResult::Hit);
+}
@@ -0,0 +1,162 @@
+#include "ShaderVariants.h"
+#include "EffectCompiler.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    PixelShaderKey MapKey(bool affine, bool preserve, uint32_t slots)
+    {
+        PixelShaderKey k;
+        k.affine = affine;
+        k.colorMap = true;
+        k.preserveBrightness = preserve;
+        k.mapSlots = slots;
+        return k;
+    }
+
+    std::string DefinesOf(const PixelShaderKey& key)
+    {
+        ShaderDefine defs[kMaxPixelShaderDefines];
+        const size_t n = PixelShaderDefines(key, defs);
+        std::string s;
+        for (size_t i = 0; i < n; ++i) s += std::string(defs[i].name) + "=" + defs[i].value + ";";
+        return s;
+    }
+}
+
+TEST(ShaderVariants, KeyTableIsDenseAndRoundTrips)
+{
+    std::set<std::string> defines;
+    for (uint32_t i = 0; i < PixelShaderKey::kCount; ++i)
+    {
+        const PixelShaderKey k = PixelShaderKey::FromIndex(i);
+        EXPECT_EQ(k.Index(), i);
+        EXPECT_TRUE(k.colorMap || (!k.preserveBrightness && k.mapSlots == 0)) << i;
+        EXPECT_TRUE(!k.useLut || (!k.affine && !k.colorMap)) << i;
+        // Every variant compiles to different source
+        EXPECT_TRUE(defines.insert(DefinesOf(k)).second) << i;
+    }
+    EXPECT_EQ(defines.size(), size_t(PixelShaderKey::kCount));
+}
+
+TEST(ShaderVariants, EveryFeatureCombinationHasAKey)
+{
+    std::set<uint32_t> seen;
+    seen.insert(PixelShaderKey{ true }.Index());
+    for (bool affine : { false, true })
+    {
+        PixelShaderKey plain;
+        plain.affine = affine;
+        seen.insert(plain.Index());
+        for (bool preserve : { false, true })
+        {
+            for (uint32_t slots : PixelShaderKey::kMapSlotBuckets)
+            {
+                const PixelShaderKey k = MapKey(affine, preserve, slots);
+                EXPECT_EQ(PixelShaderKey::FromIndex(k.Index()), k);
+                seen.insert(k.Index());
+            }
+        }
+    }
+    EXPECT_EQ(seen.size(), size_t(PixelShaderKey::kCount));
+    EXPECT_EQ(*seen.rbegin(), PixelShaderKey::kCount - 1);
+}
+
+TEST(ShaderVariants, KeyFollowsPackedConstants)
+{
+    EffectSettings s;
+    s.isColorMappingEnabled = true;
+    const uint32_t counts[] = { 1, 4, 5, 16, 17, kMaxColorMaps };
+    const uint32_t bucket[] = { 4, 4, 16, 16, kMaxColorMaps, kMaxColorMaps };
+    for (size_t i = 0; i < 6; ++i)
+    {
+        s.colorMaps.assign(counts[i], ColorMapEntry{});
+        PixelCB cb{};
+        PackPixelFlags(s, CompileEffectSettings(s, false), counts[i], cb);
+        const PixelShaderKey k = PixelShaderKeyFor(cb);
+        EXPECT_FALSE(k.affine);
+        EXPECT_TRUE(k.colorMap);
+        EXPECT_EQ(k.mapSlots, bucket[i]) << counts[i] << " maps";
+    }
+
+    // Invert is folded into the matrix; preserve only matters with maps
+    s.colorMaps.clear();
+    s.colorMapPreserveBrightness = true;
+    PixelCB cb{};
+    PackPixelFlags(s, CompileEffectSettings(s, true), 0, cb);
+    PixelShaderKey inverted;
+    inverted.affine = true;
+    EXPECT_EQ(PixelShaderKeyFor(cb), inverted);
+
+    s.colorMaps.assign(3, ColorMapEntry{});
+    PackPixelFlags(s, CompileEffectSettings(s, true), 3, cb);
+    EXPECT_EQ(PixelShaderKeyFor(cb), MapKey(true, true, 4));
+
+    // The LUT variant wins over everything it bakes in
+    cb.useColorLut = 1;
+    EXPECT_EQ(PixelShaderKeyFor(cb), PixelShaderKey{ true });
+}
+
+TEST(ShaderVariants, DefinesSelectTheLoopBound)
+{
+    EXPECT_EQ(DefinesOf(PixelShaderKey{}), "WV_HAS_LUT=0;WV_HAS_AFFINE=0;WV_HAS_MAP=0;WV_HAS_PRESERVE=0;");
+    EXPECT_EQ(DefinesOf(MapKey(false, false, 16)),
+        "WV_HAS_LUT=0;WV_HAS_AFFINE=0;WV_HAS_MAP=1;WV_HAS_PRESERVE=0;WV_MAP_SLOTS=16;WV_MAP_UNROLL=1;");
+    EXPECT_EQ(DefinesOf(MapKey(true, true, kMaxColorMaps)),
+        "WV_HAS_LUT=0;WV_HAS_AFFINE=1;WV_HAS_MAP=1;WV_HAS_PRESERVE=1;WV_MAP_SLOTS=64;WV_MAP_UNROLL=0;");
+}
+
+TEST(ShaderVariants, CacheCompilesEachVariantOnce)
+{
+    ShaderVariantCache<int> cache(PixelShaderKey::kCount);
+    int out = 0;
+    EXPECT_FALSE(cache.TryGet(3, out));
+    EXPECT_TRUE(cache.Claim(3));
+    EXPECT_FALSE(cache.Claim(3));
+    EXPECT_FALSE(cache.TryGet(3, out));  // compiling: lookups don't wait
+    cache.Complete(3, 42);
+    EXPECT_TRUE(cache.TryGet(3, out));
+    EXPECT_EQ(out, 42);
+    EXPECT_FALSE(cache.Claim(3));
+
+    // Failures are remembered, not retried
+    EXPECT_TRUE(cache.Claim(4));
+    cache.Fail(4);
+    EXPECT_FALSE(cache.Claim(4));
+    EXPECT_FALSE(cache.TryGet(4, out));
+    EXPECT_FALSE(cache.Wait(4, out));
+
+    EXPECT_FALSE(cache.Claim(PixelShaderKey::kCount));
+    EXPECT_FALSE(cache.Wait(PixelShaderKey::kCount, out));
+    EXPECT_EQ(cache.ReadyCount(), 1u);
+}
+
+TEST(ShaderVariants, WaitersSeeTheSingleCompile)
+{
+    ShaderVariantCache<int> cache(PixelShaderKey::kCount);
+    std::atomic<int> compiles{ 0 };
+    std::vector<std::thread> threads;
+    std::vector<int> results(6, -1);
+    for (int t = 0; t < 6; ++t)
+    {
+        threads.emplace_back([&, t] {
+            if (cache.Claim(7))
+            {
+                ++compiles;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                cache.Complete(7, 700);
+            }
+            int v = 0;
+            if (cache.Wait(7, v)) results[t] = v;
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(compiles.load(), 1);
+    for (int v : results) EXPECT_EQ(v, 700);
+}
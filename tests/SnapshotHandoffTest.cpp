@@ -0,0 +1,204 @@
+#include "SnapshotHandoff.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using winvert4::SnapshotHandoff;
+using Clock = std::chrono::steady_clock;
+
+// Acquire only loads and stores these; a lock-based fallback would let a writer
+// block the render thread
+static_assert(std::atomic<SnapshotHandoff<int>::Snapshot*>::is_always_lock_free, "reader atomics must be lock-free");
+
+namespace {
+    std::atomic<int> g_alive{ 0 };
+
+    // A value big enough that a torn or freed snapshot shows up as a mismatch:
+    // every word holds the same stamp
+    struct Payload
+    {
+        std::vector<uint64_t> words;
+
+        Payload() { ++g_alive; }
+        explicit Payload(uint64_t stamp) : words(64, stamp) { ++g_alive; }
+        Payload(const Payload& o) : words(o.words) { ++g_alive; }
+        Payload(Payload&& o) noexcept : words(std::move(o.words)) { ++g_alive; }
+        Payload& operator=(const Payload&) = default;
+        ~Payload() { --g_alive; }
+
+        bool Consistent() const
+        {
+            for (uint64_t w : words) if (w != words.front()) return false;
+            return true;
+        }
+    };
+}
+
+TEST(SnapshotHandoff, GenerationsCountPublishes)
+{
+    SnapshotHandoff<int> h(5);
+    EXPECT_EQ(h.Generation(), 1u);
+    EXPECT_EQ(h.Acquire().value, 5);
+    EXPECT_EQ(h.Publish(6), 2u);
+    EXPECT_EQ(h.Publish(7), 3u);
+    const auto& s = h.Acquire();
+    EXPECT_EQ(s.value, 7);
+    EXPECT_EQ(s.generation, 3u);
+}
+
+TEST(SnapshotHandoff, PinnedSnapshotSurvivesPublishes)
+{
+    g_alive = 0;
+    {
+        SnapshotHandoff<Payload> h(Payload(1));
+        const auto& pinned = h.Acquire();
+        for (uint64_t i = 2; i < 50; ++i) h.Publish(Payload(i));
+        EXPECT_EQ(pinned.generation, 1u);
+        EXPECT_EQ(pinned.value.words.front(), 1u);
+        EXPECT_TRUE(pinned.value.Consistent());
+        // The pinned snapshot and the current one; everything between was freed
+        EXPECT_EQ(g_alive.load(), 2);
+
+        h.Unpin();
+        h.Publish(Payload(50));
+        EXPECT_EQ(g_alive.load(), 1);
+    }
+    EXPECT_EQ(g_alive.load(), 0);
+}
+
+// Writers publish as fast as they can while the reader acquires and reads whole
+// snapshots: every read is consistent, generations never go backwards, and once
+// everyone stops at most two snapshots are alive
+TEST(SnapshotHandoff, StressWritersAgainstReader)
+{
+    g_alive = 0;
+    constexpr int kWriters = 3;
+    constexpr int kPublishesEach = 20000;
+    {
+        SnapshotHandoff<Payload> h(Payload(0));
+        std::atomic<int> writersLeft{ kWriters };
+        std::atomic<bool> torn{ false };
+        uint64_t reads = 0, newest = 0;
+
+        std::thread reader([&] {
+            uint64_t lastGen = 0;
+            while (writersLeft.load(std::memory_order_acquire) > 0)
+            {
+                const auto& s = h.Acquire();
+                if (s.generation < lastGen || !s.value.Consistent()) torn = true;
+                lastGen = s.generation;
+                ++reads;
+            }
+            newest = h.Acquire().generation;
+        });
+        std::vector<std::thread> writers;
+        for (int w = 0; w < kWriters; ++w)
+        {
+            writers.emplace_back([&, w] {
+                for (int i = 0; i < kPublishesEach; ++i) h.Publish(Payload(uint64_t(w) << 32 | uint64_t(i)));
+                writersLeft.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        for (auto& t : writers) t.join();
+        reader.join();
+
+        EXPECT_FALSE(torn.load());
+        EXPECT_GT(reads, 0u);
+        EXPECT_EQ(newest, uint64_t(kWriters) * kPublishesEach + 1);
+        EXPECT_EQ(h.Generation(), newest);
+        EXPECT_LE(g_alive.load(), 2);
+    }
+    EXPECT_EQ(g_alive.load(), 0);
+}
+
+// The real cadence: settings published from the UI at about 60 Hz by two
+// writers, picked up by a render thread at 240 Hz
+TEST(SnapshotHandoff, PacedWritersAgainst240HzReader)
+{
+    g_alive = 0;
+    constexpr auto kRun = std::chrono::milliseconds(500);
+    constexpr auto kReaderPeriod = std::chrono::microseconds(1000000 / 240);
+    constexpr auto kWriterPeriod = std::chrono::microseconds(1000000 / 60);
+    {
+        SnapshotHandoff<Payload> h(Payload(0));
+        const auto start = Clock::now();
+        std::atomic<bool> torn{ false }, backwards{ false };
+        uint64_t frames = 0, distinct = 0;
+
+        std::thread reader([&] {
+            uint64_t lastGen = 0;
+            for (auto next = start; next < start + kRun; next += kReaderPeriod)
+            {
+                std::this_thread::sleep_until(next);
+                const auto& s = h.Acquire();
+                if (!s.value.Consistent()) torn = true;
+                if (s.generation < lastGen) backwards = true;
+                if (s.generation != lastGen) ++distinct;
+                lastGen = s.generation;
+                ++frames;
+            }
+            h.Unpin();
+        });
+        std::vector<std::thread> writers;
+        std::atomic<uint64_t> published{ 0 };
+        for (uint64_t w = 0; w < 2; ++w)
+        {
+            writers.emplace_back([&, w] {
+                uint64_t i = 0;
+                // Offset by half a period so the two UI sources interleave
+                for (auto next = start + kWriterPeriod * w / 2; next < start + kRun; next += kWriterPeriod)
+                {
+                    std::this_thread::sleep_until(next);
+                    h.Publish(Payload(w << 32 | ++i));
+                    ++published;
+                }
+            });
+        }
+        reader.join();
+        for (auto& t : writers) t.join();
+
+        EXPECT_FALSE(torn.load());
+        EXPECT_FALSE(backwards.load());
+        EXPECT_GT(frames, 0u);
+        EXPECT_GT(published.load(), 0u);
+        // The reader follows the writers rather than sitting on one snapshot
+        EXPECT_GE(distinct, std::min<uint64_t>(published.load(), frames) / 4);
+        EXPECT_EQ(h.Generation(), published.load() + 1);
+        // The current snapshot plus at most one retired while the reader had it pinned
+        EXPECT_LE(g_alive.load(), 2);
+    }
+    EXPECT_EQ(g_alive.load(), 0);
+}
+
+// A publish whose copy is slow holds the writers' mutex; the reader must still
+// get the current snapshot immediately
+TEST(SnapshotHandoff, ReaderNeverWaitsForAPublish)
+{
+    struct Slow
+    {
+        std::atomic<bool>* inPublish{ nullptr };
+        Slow() = default;
+        explicit Slow(std::atomic<bool>* flag) : inPublish(flag) {}
+        Slow(Slow&& o) noexcept : inPublish(o.inPublish)
+        {
+            if (!inPublish) return;
+            inPublish->store(true);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    };
+
+    SnapshotHandoff<Slow> h;
+    std::atomic<bool> inPublish{ false };
+    std::thread writer([&] { h.Publish(Slow(&inPublish)); });
+    while (!inPublish.load()) std::this_thread::yield();
+
+    const auto begin = Clock::now();
+    const auto& s = h.Acquire();
+    const auto waited = Clock::now() - begin;
+    EXPECT_EQ(s.generation, 1u);
+    EXPECT_LT(waited, std::chrono::milliseconds(100));
+    writer.join();
+    EXPECT_EQ(h.Acquire().generation, 2u);
+}
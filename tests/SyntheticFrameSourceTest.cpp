@@ -0,0 +1,111 @@
+#include "SyntheticFrameSource.h"
+#include <gtest/gtest.h>
+
+using namespace winvert4;
+using Kind = SyntheticFrameSource::SceneKind;
+
+namespace {
+    SyntheticFrameSource::Config Virtual(std::vector<SyntheticFrameSource::Scene> script, uint32_t seed = 1)
+    {
+        SyntheticFrameSource::Config c;
+        c.width = 320;
+        c.height = 200;
+        c.realTime = false;
+        c.seed = seed;
+        c.script = std::move(script);
+        return c;
+    }
+
+    bool Inside(const PixelRect& r, const PixelRect& pane)
+    {
+        return r.left >= pane.left && r.top >= pane.top && r.right <= pane.right && r.bottom <= pane.bottom;
+    }
+
+    // Acquire, copy the reported damage and release; the acquire status
+    AcquireStatus Next(SyntheticFrameSource& source, FrameDamage& damage)
+    {
+        FrameInfo info;
+        const AcquireStatus st = source.Acquire(0, info, damage);
+        if (st != AcquireStatus::Frame) return st;
+        source.CopyFrame(damage);
+        source.Release();
+        return st;
+    }
+}
+
+TEST(SyntheticFrameSource, FirstFrameIsFullThenPaneDamage)
+{
+    SyntheticFrameSource::Config c = Virtual({ { Kind::ScrollingText, 3 }, { Kind::VideoNoise, 3 } });
+    c.textPane = PixelRect{ 10, 10, 150, 190 };
+    c.videoPane = PixelRect{ 170, 20, 310, 100 };
+    SyntheticFrameSource source(c);
+    FrameDamage damage;
+
+    ASSERT_EQ(Next(source, damage), AcquireStatus::Frame);
+    EXPECT_TRUE(damage.IsFull());
+    for (int i = 0; i < 5; ++i)
+    {
+        ASSERT_EQ(Next(source, damage), AcquireStatus::Frame);
+        EXPECT_FALSE(damage.IsFull());
+        ASSERT_FALSE(damage.Rects().empty());
+        // Acquires start at slot 1, so frame i shows slot i + 2 of the 6-slot script
+        const PixelRect& pane = ((i + 2) % 6 < 3) ? c.textPane : c.videoPane;
+        for (const PixelRect& r : damage.Rects()) EXPECT_TRUE(Inside(r, pane)) << "frame " << i;
+    }
+}
+
+TEST(SyntheticFrameSource, IdleTimesOut)
+{
+    SyntheticFrameSource source(Virtual({ { Kind::VideoNoise, 1 }, { Kind::Idle, 4 } }));
+    FrameDamage damage;
+    // Slot 0 is skipped by the first acquire, which lands in the idle scene
+    EXPECT_EQ(Next(source, damage), AcquireStatus::Timeout);
+    EXPECT_EQ(source.FramesProduced(), 0u);
+}
+
+TEST(SyntheticFrameSource, MustReleaseBeforeNextAcquire)
+{
+    SyntheticFrameSource source(Virtual({ { Kind::VideoNoise, 10 } }));
+    FrameDamage damage;
+    FrameInfo info;
+    ASSERT_EQ(source.Acquire(0, info, damage), AcquireStatus::Frame);
+    EXPECT_EQ(source.Acquire(0, info, damage), AcquireStatus::Failed);
+    source.Release();
+    EXPECT_EQ(source.Acquire(0, info, damage), AcquireStatus::Frame);
+}
+
+// Copying only the damage must leave the same image as copying everything
+TEST(SyntheticFrameSource, DamageCopiesMatchFullCopies)
+{
+    const auto script = std::vector<SyntheticFrameSource::Scene>{ { Kind::ScrollingText, 20 }, { Kind::VideoNoise, 20 } };
+    SyntheticFrameSource partial(Virtual(script, 7)), full(Virtual(script, 7));
+    FrameDamage dp, df;
+    FrameInfo ip, iff;
+    for (int i = 0; i < 60; ++i)
+    {
+        ASSERT_EQ(partial.Acquire(0, ip, dp), AcquireStatus::Frame);
+        ASSERT_EQ(full.Acquire(0, iff, df), AcquireStatus::Frame);
+        partial.CopyFrame(dp);
+        df.MarkAll();
+        full.CopyFrame(df);
+        partial.Release();
+        full.Release();
+        ASSERT_EQ(partial.Hash(), full.Hash()) << "frame " << i;
+        EXPECT_EQ(ip.presentTicks, iff.presentTicks);
+    }
+}
+
+TEST(SyntheticFrameSource, SeedDeterminesFrames)
+{
+    const auto script = std::vector<SyntheticFrameSource::Scene>{ { Kind::VideoNoise, 8 } };
+    SyntheticFrameSource a(Virtual(script, 3)), b(Virtual(script, 3)), c(Virtual(script, 4));
+    FrameDamage damage;
+    for (int i = 0; i < 8; ++i)
+    {
+        Next(a, damage);
+        Next(b, damage);
+        Next(c, damage);
+    }
+    EXPECT_EQ(a.Hash(), b.Hash());
+    EXPECT_NE(a.Hash(), c.Hash());
+}